@@ -0,0 +1,179 @@
+#pragma once
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stddef.h>
+#include <stdint.h>
+
+/// Frames per I2S DMA buffer (dma_buf_len / dma_frame_num of the driver)
+#ifndef A2DP_OUTPUT_DMA_FRAMES
+#define A2DP_OUTPUT_DMA_FRAMES 64
+#endif
+
+/// DMA buffers which are handed to the output in one write
+#ifndef A2DP_OUTPUT_DMA_BUFFERS_PER_WRITE
+#define A2DP_OUTPUT_DMA_BUFFERS_PER_WRITE 4
+#endif
+
+/**
+ * @brief Conversion of the decoded A2DP frames (16 bit stereo) into the
+ * output format T with CHANNELS channels. Only the specializations below
+ * are defined, so an unsupported format fails at compile time.
+ * @ingroup a2dp
+ */
+template <typename T, int CHANNELS>
+struct A2DPFrameConvert;
+
+/// 16 bit stereo: the data is written as is
+template <>
+struct A2DPFrameConvert<int16_t, 2> {
+  static const bool is_identity = true;
+  static void run(const int16_t *in, int16_t *out, size_t frames) {
+    for (size_t j = 0; j < frames * 2; j++) out[j] = in[j];
+  }
+};
+
+/// 16 bit mono: average of left and right
+template <>
+struct A2DPFrameConvert<int16_t, 1> {
+  static const bool is_identity = false;
+  static void run(const int16_t *in, int16_t *out, size_t frames) {
+    for (size_t j = 0; j < frames; j++) {
+      out[j] = (int16_t)(((int32_t)in[2 * j] + in[2 * j + 1]) >> 1);
+    }
+  }
+};
+
+/// 32 bit stereo: the 16 bit samples end up in the upper half
+template <>
+struct A2DPFrameConvert<int32_t, 2> {
+  static const bool is_identity = false;
+  static void run(const int16_t *in, int32_t *out, size_t frames) {
+    for (size_t j = 0; j < frames * 2; j++) {
+      out[j] = (int32_t)((uint32_t)(uint16_t)in[j] << 16);
+    }
+  }
+};
+
+/// 32 bit mono: sum of left and right, scaled to the upper 17 bits
+template <>
+struct A2DPFrameConvert<int32_t, 1> {
+  static const bool is_identity = false;
+  static void run(const int16_t *in, int32_t *out, size_t frames) {
+    for (size_t j = 0; j < frames; j++) {
+      int32_t sum = (int32_t)in[2 * j] + in[2 * j + 1];
+      out[j] = (int32_t)((uint32_t)sum << 15);
+    }
+  }
+};
+
+/**
+ * @brief Converts the decoded 16 bit stereo frames to the output format
+ * and hands them to the output in chunks of whole DMA buffers.
+ *
+ * The format is a template parameter, so the conversion loop is chosen at
+ * compile time and there are no per sample format checks. 16 bit stereo is
+ * written straight from the packet; the other formats are converted into a
+ * member buffer of DMA_FRAMES * A2DP_OUTPUT_DMA_BUFFERS_PER_WRITE frames.
+ * Each write covers whole DMA buffers, except the last one of a packet when
+ * the packet is not a multiple of DMA_FRAMES (decoded SBC packets usually
+ * are).
+ *
+ * The output is any class with a `size_t write(const uint8_t *, size_t)`,
+ * e.g. an Arduino Print or A2DPNullOutput. It is expected to accept whole
+ * frames: a partially written frame is counted as not written.
+ * @ingroup a2dp
+ * @copyright Apache License Version 2
+ */
+template <typename T, int CHANNELS, int DMA_FRAMES = A2DP_OUTPUT_DMA_FRAMES>
+class A2DPFrameWriter {
+ public:
+  typedef A2DPFrameConvert<T, CHANNELS> convert;
+  /// Bytes per frame of the output
+  static const size_t frame_bytes = sizeof(T) * CHANNELS;
+  /// Frames per write to the output
+  static const size_t chunk_frames =
+      (size_t)DMA_FRAMES * A2DP_OUTPUT_DMA_BUFFERS_PER_WRITE;
+
+  /// Number of bits per sample of the output
+  static int bits_per_sample() { return sizeof(T) * 8; }
+  /// Number of channels of the output
+  static int channels() { return CHANNELS; }
+
+  /// Input bytes (16 bit stereo) which fill one write to the output
+  static size_t input_chunk_bytes() { return chunk_frames * 4; }
+
+  /**
+   * @brief Converts and writes a packet of 16 bit stereo frames
+   * @return Number of input bytes which were written: whole frames only
+   */
+  template <class OUTPUT>
+  size_t write(OUTPUT &output, const uint8_t *data, size_t len) {
+    const int16_t *in = (const int16_t *)data;
+    size_t frames = len / 4;
+    size_t done = 0;
+    while (done < frames) {
+      size_t n = frames - done;
+      if (n > chunk_frames) n = chunk_frames;
+      size_t bytes = n * frame_bytes;
+      const uint8_t *out;
+      if (convert::is_identity) {
+        out = data + done * 4;
+      } else {
+        convert::run(in + done * 2, buffer, n);
+        out = (const uint8_t *)buffer;
+      }
+      size_t written = output.write(out, bytes);
+      done += written / frame_bytes;
+      if (written < bytes) break;
+    }
+    return done * 4;
+  }
+
+ protected:
+  // 16 bit stereo is not converted and needs no buffer
+  T buffer[convert::is_identity ? 1 : chunk_frames * CHANNELS];
+};
+
+/// 16 bit stereo output: the decoded data is written unchanged
+typedef A2DPFrameWriter<int16_t, 2> A2DPFrameWriterStereo16;
+/// 16 bit mono output
+typedef A2DPFrameWriter<int16_t, 1> A2DPFrameWriterMono16;
+/// 32 bit stereo output, e.g. for DACs which do not support 16 bits
+typedef A2DPFrameWriter<int32_t, 2> A2DPFrameWriterStereo32;
+
+/**
+ * @brief Output which only counts what it is given: use it to measure the
+ * cost of the sink and the conversion without I2S, also on the host.
+ * @ingroup a2dp
+ */
+class A2DPNullOutput {
+ public:
+  size_t write(const uint8_t *data, size_t len) {
+    writes++;
+    bytes += len;
+    if (len > 0) checksum = checksum * 31 + data[len - 1];
+    return len;
+  }
+
+  void reset() {
+    writes = 0;
+    bytes = 0;
+    checksum = 0;
+  }
+
+  uint32_t writes = 0;
+  uint64_t bytes = 0;
+  /// depends on the last byte of each write: keeps the data alive
+  uint32_t checksum = 0;
+};
@@ -0,0 +1,205 @@
+#pragma once
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stdint.h>
+
+#include "A2DPVolumeControl.h"
+
+/// Number of 8 bit haptic samples collected before the haptic reader is called
+#ifndef A2DP_HAPTIC_BUFFER_SIZE
+#define A2DP_HAPTIC_BUFFER_SIZE 256
+#endif
+
+/// Largest supported decimation factor of the haptic tap
+#ifndef A2DP_HAPTIC_MAX_DECIMATION
+#define A2DP_HAPTIC_MAX_DECIMATION 64
+#endif
+
+/**
+ * @brief Single pass processing of the decoded PCM frames: swap -> mono
+ * downmix -> volume -> decimate -> 8 bit haptic samples.
+ *
+ * Each frame is loaded and stored once as a 32 bit word. The active stages
+ * are selected in configure() and mapped to one of the template
+ * instantiations of process(), so the per frame loop contains no branches
+ * for disabled stages. The volume stage uses the Q15 gain (and gain ramp) of
+ * the A2DPVolumeControl.
+ *
+ * The haptic tap averages `decimation` mono frames into one unsigned 8 bit
+ * sample (128 = silence) and hands them out in blocks of
+ * A2DP_HAPTIC_BUFFER_SIZE. The averaging state is kept between calls, so
+ * packet sizes don't need to be a multiple of the decimation factor.
+ * @ingroup a2dp
+ * @copyright Apache License Version 2
+ */
+class A2DPFramePipeline {
+ public:
+  /// Callback which receives the unsigned 8 bit mono haptic samples
+  typedef void (*haptic_reader_t)(const uint8_t *data, uint32_t len);
+
+  A2DPFramePipeline() = default;
+
+  /**
+   * @brief Defines the receiver of the haptic samples
+   * @param reader Callback; nullptr disables the haptic tap
+   * @param decimation Number of input frames averaged into one haptic sample
+   * (1 to A2DP_HAPTIC_MAX_DECIMATION)
+   */
+  void set_haptic_reader(haptic_reader_t reader, uint8_t decimation) {
+    if (decimation < 1) decimation = 1;
+    if (decimation > A2DP_HAPTIC_MAX_DECIMATION)
+      decimation = A2DP_HAPTIC_MAX_DECIMATION;
+    haptic_reader = reader;
+    haptic_decimation = decimation;
+    // Q16 reciprocal of the decimation, the /2 of the downmix is folded in
+    haptic_reciprocal = (1UL << 16) / (2UL * decimation);
+    haptic_sum = 0;
+    haptic_count = 0;
+    haptic_len = 0;
+  }
+
+  /**
+   * @brief Selects the stages for the following run() calls
+   * @param swap Swap the left and right channel
+   * @param vc Volume control providing the mono downmix and volume settings;
+   * nullptr skips both stages
+   * @param haptic Feed the haptic tap (if a reader is defined)
+   * @return false if vc can't be fused (custom processing or a volume scale
+   * which is not a power of 2): the mono and volume stages are then disabled
+   * and the caller needs to use vc->update_audio_data() instead
+   */
+  bool configure(bool swap, A2DPVolumeControl *vc, bool haptic) {
+    bool mono = false;
+    bool volume = false;
+    bool result = true;
+    volume_control = nullptr;
+    if (vc != nullptr) {
+      if (vc->is_fusable()) {
+        mono = vc->get_mono_downmix();
+        volume = vc->get_enabled();
+        if (volume) volume_control = vc;
+      } else {
+        result = false;
+      }
+    }
+    haptic = haptic && haptic_reader != nullptr;
+    stages = (swap ? 1 : 0) | (mono ? 2 : 0) | (volume ? 4 : 0) |
+             (haptic ? 8 : 0);
+    return result;
+  }
+
+  /// Processes the frames in place with the stages selected by configure()
+  void run(Frame *frames, uint32_t frame_count) {
+    if (stages == 0 || frames == nullptr || frame_count == 0) return;
+    int32_t gain_acc = 0, gain_step = 0;
+    if (volume_control != nullptr) {
+      volume_control->next_gain_ramp(frame_count, gain_acc, gain_step);
+    }
+    process_fn_t fn = a2dp_is_word_aligned(frames)
+                          ? process_table<true>()[stages]
+                          : process_table<false>()[stages];
+    fn(*this, frames, frame_count, gain_acc, gain_step);
+  }
+
+  /// Hands out the pending haptic samples even if the block is not full
+  void flush_haptic() {
+    if (haptic_len > 0 && haptic_reader != nullptr) {
+      haptic_reader(haptic_buffer, haptic_len);
+    }
+    haptic_len = 0;
+  }
+
+ protected:
+  typedef void (*process_fn_t)(A2DPFramePipeline &self, Frame *frames,
+                               uint32_t frame_count, int32_t gain_acc,
+                               int32_t gain_step);
+
+  int stages = 0;  ///< swap | mono<<1 | volume<<2 | haptic<<3
+  A2DPVolumeControl *volume_control = nullptr;  ///< provides the gain ramp
+  haptic_reader_t haptic_reader = nullptr;
+  uint8_t haptic_decimation = 1;
+  uint32_t haptic_reciprocal = 1UL << 15;
+  int32_t haptic_sum = 0;     ///< sum of left + right over the open window
+  uint8_t haptic_count = 0;   ///< frames in the open window
+  uint16_t haptic_len = 0;    ///< samples in haptic_buffer
+  uint8_t haptic_buffer[A2DP_HAPTIC_BUFFER_SIZE];
+
+  template <bool Aligned, bool Swap, bool Mono, bool Volume, bool Haptic>
+  static void process(A2DPFramePipeline &self, Frame *frames,
+                      uint32_t frame_count, int32_t gain_acc,
+                      int32_t gain_step) {
+    int32_t sum = self.haptic_sum;
+    uint8_t count = self.haptic_count;
+    const uint8_t decimation = self.haptic_decimation;
+    for (uint32_t i = 0; i < frame_count; i++) {
+      int32_t left, right;
+      if (Swap) {
+        a2dp_load_frame<Aligned>(&frames[i], right, left);
+      } else {
+        a2dp_load_frame<Aligned>(&frames[i], left, right);
+      }
+      if (Mono) {
+        left = right = (left + right) / 2;
+      }
+      if (Volume) {
+        int32_t gain = gain_acc >> 8;
+        gain_acc += gain_step;
+        left = A2DPVolumeControl::apply_gain_q15(left, gain);
+        right = Mono ? left : A2DPVolumeControl::apply_gain_q15(right, gain);
+      }
+      if (Swap || Mono || Volume) {
+        a2dp_store_frame<Aligned>(&frames[i], left, right);
+      }
+      if (Haptic) {
+        sum += left + right;
+        if (++count == decimation) {
+          int32_t mono = (int32_t)(((int64_t)sum * self.haptic_reciprocal) >> 16);
+          self.haptic_buffer[self.haptic_len++] = (uint8_t)((mono >> 8) + 128);
+          if (self.haptic_len == A2DP_HAPTIC_BUFFER_SIZE) {
+            self.haptic_reader(self.haptic_buffer, self.haptic_len);
+            self.haptic_len = 0;
+          }
+          sum = 0;
+          count = 0;
+        }
+      }
+    }
+    self.haptic_sum = sum;
+    self.haptic_count = count;
+  }
+
+  /// all 16 stage combinations, indexed by swap | mono<<1 | volume<<2 | haptic<<3
+  template <bool Aligned>
+  static const process_fn_t *process_table() {
+    static const process_fn_t table[16] = {
+        nullptr,
+        &process<Aligned, true, false, false, false>,
+        &process<Aligned, false, true, false, false>,
+        &process<Aligned, true, true, false, false>,
+        &process<Aligned, false, false, true, false>,
+        &process<Aligned, true, false, true, false>,
+        &process<Aligned, false, true, true, false>,
+        &process<Aligned, true, true, true, false>,
+        &process<Aligned, false, false, false, true>,
+        &process<Aligned, true, false, false, true>,
+        &process<Aligned, false, true, false, true>,
+        &process<Aligned, true, true, false, true>,
+        &process<Aligned, false, false, true, true>,
+        &process<Aligned, true, false, true, true>,
+        &process<Aligned, false, true, true, true>,
+        &process<Aligned, true, true, true, true>,
+    };
+    return table;
+  }
+};
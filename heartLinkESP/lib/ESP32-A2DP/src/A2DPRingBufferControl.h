@@ -0,0 +1,210 @@
+#pragma once
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stddef.h>
+#include <stdint.h>
+
+/// Lower limit of the adaptive prefetch watermark in % of the ringbuffer
+#ifndef A2DP_PREFETCH_MIN_PERCENT
+#define A2DP_PREFETCH_MIN_PERCENT 10
+#endif
+
+/// Number of mean deviations of the packet interval the prefetch has to cover
+#ifndef A2DP_PREFETCH_JITTER_FACTOR
+#define A2DP_PREFETCH_JITTER_FACTOR 4
+#endif
+
+/// Extra prefetch in ms which is added after each underflow
+#ifndef A2DP_PREFETCH_UNDERFLOW_MS
+#define A2DP_PREFETCH_UNDERFLOW_MS 10
+#endif
+
+enum A2DPRingBufferMode : char {
+  RINGBUFFER_MODE_PROCESSING,  /* ringbuffer is buffering incoming audio data,
+                                  I2S is working */
+  RINGBUFFER_MODE_PREFETCHING, /* ringbuffer is buffering incoming audio data,
+                                  I2S is waiting */
+  RINGBUFFER_MODE_DROPPING /* ringbuffer is not buffering (dropping) incoming
+                              audio data, I2S is working */
+};
+
+/**
+ * @brief PREFETCHING/PROCESSING/DROPPING state machine of the queued sink.
+ *
+ * The class only sees fill levels, packet sizes and timestamps, so it can be
+ * driven by the FreeRTOS ringbuffer as well as by a simulated clock on the
+ * host. The prefetch watermark follows the observed arrival jitter of the
+ * packets: it covers the mean packet interval plus
+ * A2DP_PREFETCH_JITTER_FACTOR mean deviations, plus
+ * A2DP_PREFETCH_UNDERFLOW_MS for every underflow, and is kept between
+ * A2DP_PREFETCH_MIN_PERCENT and the configured prefetch percent. The
+ * adaptive watermark is off by default: the consumer then waits for the
+ * full prefetch percent, as without this class.
+ * @ingroup a2dp
+ * @copyright Apache License Version 2
+ */
+class A2DPRingBufferControl {
+ public:
+  /**
+   * @param max_percent Upper limit (and fixed value if not adaptive) of the
+   * prefetch watermark in % of the capacity
+   */
+  explicit A2DPRingBufferControl(int max_percent = 100)
+      : max_percent(max_percent) {}
+
+  /**
+   * @brief Defines the ringbuffer and resets the state to prefetching
+   * @param capacity Size of the ringbuffer in bytes
+   */
+  void begin(size_t capacity) {
+    this->capacity = capacity;
+    mode = RINGBUFFER_MODE_PREFETCHING;
+    last_write_ms = 0;
+    has_last_write = false;
+    interval_q4 = 0;
+    deviation_q4 = 0;
+    underflow_margin_ms = 0;
+  }
+
+  /// Upper limit (and fixed value if not adaptive) of the prefetch
+  /// watermark in % of the capacity; applies from the next watermark check
+  void set_max_percent(int percent) { max_percent = percent; }
+
+  /// Uses the adaptive watermark (true) or the fixed max_percent (false)
+  void set_adaptive(bool active) { is_adaptive = active; }
+
+  /// Defines the audio data rate used to convert ms to bytes
+  void set_byte_rate(uint32_t bytes_per_second) {
+    byte_rate = bytes_per_second;
+  }
+
+  /// Restarts with prefetching (e.g. when the output is activated)
+  void restart() { mode = RINGBUFFER_MODE_PREFETCHING; }
+
+  /**
+   * @brief Producer: checks if a packet must be dropped because the
+   * ringbuffer has overflowed; leaves DROPPING once the fill level is back
+   * at the watermark
+   * @param fill Bytes currently in the ringbuffer
+   * @return true if the packet is to be dropped
+   */
+  bool is_dropping(size_t fill) {
+    if (mode != RINGBUFFER_MODE_DROPPING) return false;
+    overflow_count++;
+    if (fill <= watermark()) {
+      mode = RINGBUFFER_MODE_PROCESSING;
+    }
+    return true;
+  }
+
+  /**
+   * @brief Producer: records the result of writing a packet
+   * @param accepted true if the packet was stored in the ringbuffer
+   * @param fill Bytes in the ringbuffer after the write
+   * @param now_ms Arrival time of the packet
+   * @return true if the prefetch is complete and the consumer must be
+   * released; a full ringbuffer also completes it, so a watermark which
+   * can not be reached does not leave the consumer waiting
+   */
+  bool on_write(bool accepted, size_t fill, uint32_t now_ms) {
+    update_jitter(now_ms);
+    if (!accepted) {
+      bool release = mode == RINGBUFFER_MODE_PREFETCHING;
+      overflow_count++;
+      mode = RINGBUFFER_MODE_DROPPING;
+      return release;
+    }
+    if (mode == RINGBUFFER_MODE_PREFETCHING && fill >= watermark()) {
+      mode = RINGBUFFER_MODE_PROCESSING;
+      return true;
+    }
+    return false;
+  }
+
+  /**
+   * @brief Consumer: the ringbuffer ran empty while playing
+   * @return true if this was an underflow (the consumer must now wait for
+   * the prefetch); false if we were already prefetching
+   */
+  bool on_empty() {
+    if (mode == RINGBUFFER_MODE_PREFETCHING) return false;
+    mode = RINGBUFFER_MODE_PREFETCHING;
+    underflow_count++;
+    if (is_adaptive) underflow_margin_ms += A2DP_PREFETCH_UNDERFLOW_MS;
+    return true;
+  }
+
+  /// Current mode
+  A2DPRingBufferMode get_mode() { return mode; }
+
+  /// Number of times the consumer ran out of data while playing
+  uint32_t get_underflow_count() { return underflow_count; }
+
+  /// Number of packets which were dropped because the ringbuffer was full
+  uint32_t get_overflow_count() { return overflow_count; }
+
+  /// Mean packet interval in ms
+  uint32_t get_interval_ms() { return interval_q4 >> 4; }
+
+  /// Mean deviation of the packet interval in ms
+  uint32_t get_jitter_ms() { return deviation_q4 >> 4; }
+
+  /// Fill level in bytes at which the consumer starts (4 byte aligned)
+  size_t watermark() {
+    size_t max_bytes = capacity * max_percent / 100;
+    size_t result = max_bytes;
+    if (is_adaptive && byte_rate > 0 && interval_q4 > 0) {
+      uint32_t cover_ms =
+          ((interval_q4 + A2DP_PREFETCH_JITTER_FACTOR * deviation_q4) >> 4) +
+          underflow_margin_ms;
+      size_t min_bytes = capacity * A2DP_PREFETCH_MIN_PERCENT / 100;
+      result = (size_t)((uint64_t)cover_ms * byte_rate / 1000);
+      if (result < min_bytes) result = min_bytes;
+      if (result > max_bytes) result = max_bytes;
+    }
+    return result / 4 * 4;
+  }
+
+ protected:
+  volatile A2DPRingBufferMode mode = RINGBUFFER_MODE_PREFETCHING;
+  size_t capacity = 0;
+  // set by the application while the producer and consumer tasks run
+  volatile int max_percent;
+  volatile bool is_adaptive = false;
+  uint32_t byte_rate = 0;
+  uint32_t last_write_ms = 0;
+  bool has_last_write = false;
+  uint32_t interval_q4 = 0;   ///< mean packet interval in 1/16 ms
+  uint32_t deviation_q4 = 0;  ///< mean deviation of the interval in 1/16 ms
+  uint32_t underflow_margin_ms = 0;
+  volatile uint32_t underflow_count = 0;
+  volatile uint32_t overflow_count = 0;
+
+  /// running mean and mean deviation of the arrival interval (1/8 and 1/4)
+  void update_jitter(uint32_t now_ms) {
+    if (has_last_write) {
+      int32_t sample = (int32_t)((now_ms - last_write_ms) << 4);
+      if (interval_q4 == 0) {
+        interval_q4 = sample;
+      } else {
+        int32_t error = sample - (int32_t)interval_q4;
+        interval_q4 += error / 8;
+        int32_t abs_error = error < 0 ? -error : error;
+        deviation_q4 += (abs_error - (int32_t)deviation_q4) / 4;
+      }
+    }
+    last_write_ms = now_ms;
+    has_last_write = true;
+  }
+};
@@ -0,0 +1,298 @@
+#include "A2DPSBCHapticDecoder.h"
+
+// loudness offsets of the bit allocation (A2DP spec, 12.6.3)
+static const int8_t sbc_offset4[4][4] = {
+    {-1, 0, 0, 0}, {-2, 0, 0, 1}, {-2, 0, 0, 1}, {-2, 0, 0, 1}};
+static const int8_t sbc_offset8[4][8] = {{-2, 0, 0, 0, 0, 0, 0, 1},
+                                         {-3, 0, 0, 0, 0, 0, 1, 2},
+                                         {-4, 0, 0, 0, 0, 0, 1, 2},
+                                         {-4, 0, 0, 0, 0, 0, 1, 2}};
+static const int sbc_sample_rates[4] = {16000, 32000, 44100, 48000};
+
+/// MSB first bit reader over a frame
+class SBCBitReader {
+ public:
+  SBCBitReader(const uint8_t *data, size_t pos = 0) : data(data), pos(pos) {}
+
+  uint32_t read(uint8_t bits) {
+    uint32_t result = 0;
+    for (uint8_t j = 0; j < bits; j++) {
+      result = (result << 1) | ((data[pos >> 3] >> (7 - (pos & 7))) & 1);
+      pos++;
+    }
+    return result;
+  }
+
+  void skip(size_t bits) { pos += bits; }
+
+  size_t position() { return pos; }
+
+  void set_position(size_t bit_pos) { pos = bit_pos; }
+
+ protected:
+  const uint8_t *data;
+  size_t pos;
+};
+
+int A2DPSBCHapticDecoder::write(const uint8_t *data, size_t len) {
+  int result = 0;
+  size_t pos = 0;
+  while (pos + 4 <= len) {
+    if (data[pos] != SBC_SYNCWORD) {
+      pos++;
+      continue;
+    }
+    SBCFrameInfo info;
+    if (!parse_header(data + pos, len - pos, info)) {
+      frames_rejected++;
+      pos++;
+      continue;
+    }
+    decode_frame(data + pos, info);
+    frames_decoded++;
+    result++;
+    pos += info.length;
+  }
+  return result;
+}
+
+void A2DPSBCHapticDecoder::flush() {
+  if (buffer_len > 0 && reader != nullptr) {
+    reader(buffer, buffer_len);
+  }
+  buffer_len = 0;
+}
+
+bool A2DPSBCHapticDecoder::parse_header(const uint8_t *data, size_t len,
+                                        SBCFrameInfo &info) {
+  static const uint8_t blocks[4] = {4, 8, 12, 16};
+  info.frequency_idx = (data[1] >> 6) & 3;
+  info.sample_rate = sbc_sample_rates[info.frequency_idx];
+  info.blocks = blocks[(data[1] >> 4) & 3];
+  info.channel_mode = (data[1] >> 2) & 3;
+  info.channels = info.channel_mode == MONO ? 1 : 2;
+  info.snr_allocation = (data[1] >> 1) & 1;
+  info.subbands = (data[1] & 1) ? 8 : 4;
+  info.bitpool = data[2];
+
+  // bitpool limits of the spec
+  int max_bitpool = info.subbands * (info.channels == 1 ||
+                                             info.channel_mode == DUAL_CHANNEL
+                                         ? 16
+                                         : 32);
+  if (info.bitpool < 2 || info.bitpool > max_bitpool) return false;
+
+  size_t bits;
+  if (info.channel_mode == MONO || info.channel_mode == DUAL_CHANNEL) {
+    bits = info.blocks * info.channels * info.bitpool;
+  } else if (info.channel_mode == STEREO) {
+    bits = info.blocks * info.bitpool;
+  } else {
+    bits = info.subbands + info.blocks * info.bitpool;
+  }
+  info.length =
+      4 + (4 * info.subbands * info.channels) / 8 + (bits + 7) / 8;
+  return info.length <= len;
+}
+
+void A2DPSBCHapticDecoder::decode_frame(const uint8_t *data,
+                                        const SBCFrameInfo &info) {
+  SBCBitReader in(data, 32);
+  uint8_t join = 0;
+  if (info.channel_mode == JOINT_STEREO) {
+    join = in.read(info.subbands);
+  }
+  // only the join flag of subband 0 (msb) matters for the mono downmix
+  bool join0 = (join >> (info.subbands - 1)) & 1;
+
+  uint8_t sf[SBC_MAX_CHANNELS][SBC_MAX_SUBBANDS];
+  for (int ch = 0; ch < info.channels; ch++) {
+    for (int sb = 0; sb < info.subbands; sb++) {
+      sf[ch][sb] = in.read(4);
+    }
+  }
+
+  uint8_t bits[SBC_MAX_CHANNELS][SBC_MAX_SUBBANDS];
+  calc_bit_allocation(info, sf, bits);
+
+  // bit offsets of subband 0 of each channel within a block
+  size_t channel_offset[SBC_MAX_CHANNELS] = {0, 0};
+  size_t block_bits = 0;
+  for (int ch = 0; ch < info.channels; ch++) {
+    channel_offset[ch] = block_bits;
+    for (int sb = 0; sb < info.subbands; sb++) {
+      block_bits += bits[ch][sb];
+    }
+  }
+
+  out_sample_rate = info.sample_rate / 8;
+  size_t start = in.position();
+  for (int blk = 0; blk < info.blocks; blk++) {
+    size_t block_start = start + blk * block_bits;
+    int32_t sample[SBC_MAX_CHANNELS] = {0, 0};
+    for (int ch = 0; ch < info.channels; ch++) {
+      if (bits[ch][0] > 0) {
+        in.set_position(block_start + channel_offset[ch]);
+        sample[ch] = dequantize(in.read(bits[ch][0]), bits[ch][0], sf[ch][0]);
+      }
+    }
+    int32_t mono;
+    if (info.channels == 1) {
+      mono = sample[0];
+    } else if (join0) {
+      // joint stereo: left = mid + side, right = mid - side
+      mono = sample[0];
+    } else {
+      mono = (sample[0] + sample[1]) / 2;
+    }
+
+    if (info.subbands == 8) {
+      output(mono);
+    } else {
+      decimate(mono);
+    }
+  }
+}
+
+void A2DPSBCHapticDecoder::decimate(int32_t sample) {
+  // 4 subbands: subband 0 runs at fs/4; half band lowpass
+  // (-1 0 9 16 9 0 -1) / 32 and keep every second sample to get to fs/8
+  for (int j = 0; j < 6; j++) history[j] = history[j + 1];
+  history[6] = sample;
+  history_phase ^= 1;
+  if (history_phase) return;
+  output((16 * history[3] + 9 * (history[2] + history[4]) -
+          (history[0] + history[6])) /
+         32);
+}
+
+void A2DPSBCHapticDecoder::calc_bitneed(const SBCFrameInfo &info,
+                                        const uint8_t *sf, int8_t *bitneed) {
+  for (int sb = 0; sb < info.subbands; sb++) {
+    if (info.snr_allocation) {
+      bitneed[sb] = sf[sb];
+    } else if (sf[sb] == 0) {
+      bitneed[sb] = -5;
+    } else {
+      int offset = info.subbands == 4 ? sbc_offset4[info.frequency_idx][sb]
+                                      : sbc_offset8[info.frequency_idx][sb];
+      int loudness = sf[sb] - offset;
+      bitneed[sb] = loudness > 0 ? loudness / 2 : loudness;
+    }
+  }
+}
+
+void A2DPSBCHapticDecoder::calc_bit_allocation(
+    const SBCFrameInfo &info,
+    const uint8_t sf[SBC_MAX_CHANNELS][SBC_MAX_SUBBANDS],
+    uint8_t bits[SBC_MAX_CHANNELS][SBC_MAX_SUBBANDS]) {
+  int8_t bitneed[SBC_MAX_CHANNELS][SBC_MAX_SUBBANDS];
+  const int subbands = info.subbands;
+  // mono and dual channel allocate each channel on its own, stereo and joint
+  // stereo share the bitpool between both channels
+  const bool separate = info.channel_mode == MONO ||
+                        info.channel_mode == DUAL_CHANNEL;
+  const int groups = separate ? info.channels : 1;
+  const int group_channels = separate ? 1 : info.channels;
+
+  for (int ch = 0; ch < info.channels; ch++) {
+    calc_bitneed(info, sf[ch], bitneed[ch]);
+  }
+
+  for (int g = 0; g < groups; g++) {
+    const int first = g;
+    const int last = g + group_channels;
+    int max_bitneed = -128;
+    for (int ch = first; ch < last; ch++)
+      for (int sb = 0; sb < subbands; sb++)
+        if (bitneed[ch][sb] > max_bitneed) max_bitneed = bitneed[ch][sb];
+
+    int bitcount = 0;
+    int slicecount = 0;
+    int bitslice = max_bitneed + 1;
+    do {
+      bitslice--;
+      bitcount += slicecount;
+      slicecount = 0;
+      for (int ch = first; ch < last; ch++) {
+        for (int sb = 0; sb < subbands; sb++) {
+          int need = bitneed[ch][sb];
+          if (need > bitslice + 1 && need < bitslice + 16) {
+            slicecount++;
+          } else if (need == bitslice + 1) {
+            slicecount += 2;
+          }
+        }
+      }
+      // bitneed is >= -5, so below this nothing is counted any more
+    } while (bitcount + slicecount < info.bitpool && bitslice > -32);
+    if (bitcount + slicecount == info.bitpool) {
+      bitcount += slicecount;
+      bitslice--;
+    }
+
+    for (int ch = first; ch < last; ch++) {
+      for (int sb = 0; sb < subbands; sb++) {
+        int need = bitneed[ch][sb];
+        if (need < bitslice + 2) {
+          bits[ch][sb] = 0;
+        } else {
+          int b = need - bitslice;
+          bits[ch][sb] = b > 16 ? 16 : b;
+        }
+      }
+    }
+
+    // distribute the remaining bits: subband major, channel minor
+    int ch = first;
+    int sb = 0;
+    while (bitcount < info.bitpool && sb < subbands) {
+      if (bits[ch][sb] >= 2 && bits[ch][sb] < 16) {
+        bits[ch][sb]++;
+        bitcount++;
+      } else if (bitneed[ch][sb] == bitslice + 1 &&
+                 info.bitpool > bitcount + 1) {
+        bits[ch][sb] = 2;
+        bitcount += 2;
+      }
+      if (ch + 1 < last) {
+        ch++;
+      } else {
+        ch = first;
+        sb++;
+      }
+    }
+    ch = first;
+    sb = 0;
+    while (bitcount < info.bitpool && sb < subbands) {
+      if (bits[ch][sb] < 16) {
+        bits[ch][sb]++;
+        bitcount++;
+      }
+      if (ch + 1 < last) {
+        ch++;
+      } else {
+        ch = first;
+        sb++;
+      }
+    }
+  }
+}
+
+int32_t A2DPSBCHapticDecoder::dequantize(uint32_t value, uint8_t bits,
+                                         uint8_t sf) {
+  // sb_sample = 2^(sf+1) * ((2 * value + 1) / (2^bits - 1) - 1)
+  int64_t levels = ((int64_t)1 << bits) - 1;
+  int64_t scale = (int64_t)1 << (sf + 1);
+  return (int32_t)(((2 * (int64_t)value + 1) * scale) / levels - scale);
+}
+
+void A2DPSBCHapticDecoder::output(int32_t sample) {
+  if (sample > 32767) sample = 32767;
+  if (sample < -32768) sample = -32768;
+  buffer[buffer_len++] = (int16_t)sample;
+  if (buffer_len == SBC_HAPTIC_BUFFER_SIZE) {
+    if (reader != nullptr) reader(buffer, buffer_len);
+    buffer_len = 0;
+  }
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stddef.h>
+#include <stdint.h>
+
+/// Number of haptic samples collected before the reader is called
+#ifndef SBC_HAPTIC_BUFFER_SIZE
+#define SBC_HAPTIC_BUFFER_SIZE 64
+#endif
+
+#define SBC_SYNCWORD 0x9C
+#define SBC_MAX_SUBBANDS 8
+#define SBC_MAX_CHANNELS 2
+
+/**
+ * @brief Reduced SBC decoder for haptics: decodes the raw SBC stream of
+ * BluetoothA2DPSink::set_codec() straight into a low rate mono signal.
+ *
+ * The SBC synthesis filterbank is what makes a full decode expensive. Its
+ * lowest subband already is a critically sampled base band signal:
+ * 0 to fs/16 at fs/8 for 8 subbands (0 - 2.7 kHz at 5.5 kHz for 44.1 kHz),
+ * which covers everything an actuator can reproduce. So we only parse the
+ * frame, run the bit allocation, skip the bits of the upper subbands and
+ * dequantize subband 0 of each channel. With 4 subbands a half band filter
+ * decimates by 2 to get the same fs/8 output rate. The output is mono int16 at
+ * sample_rate(); its scale is the one of the coded subband samples.
+ *
+ * Usage:
+ * @code
+ * A2DPSBCHapticDecoder decoder(on_haptic_samples);
+ * void on_sbc(const uint8_t *data, size_t len) { decoder.write(data, len); }
+ * a2dp_sink.set_codec(A2DP_CODEC_SBC, on_sbc);
+ * @endcode
+ * @ingroup a2dp
+ * @copyright Apache License Version 2
+ */
+class A2DPSBCHapticDecoder {
+ public:
+  /// Callback which receives the mono haptic samples
+  typedef void (*haptic_reader_t)(const int16_t *data, uint32_t len);
+
+  A2DPSBCHapticDecoder(haptic_reader_t reader = nullptr) : reader(reader) {}
+
+  /// Defines the receiver of the haptic samples
+  void set_reader(haptic_reader_t reader) { this->reader = reader; }
+
+  /**
+   * @brief Decodes all SBC frames in the data. Bytes in front of a frame
+   * (e.g. the A2DP media payload header) are skipped.
+   * @param data Encoded data
+   * @param len Number of bytes
+   * @return Number of frames decoded
+   */
+  int write(const uint8_t *data, size_t len);
+
+  /// Hands out the pending samples even if the buffer is not full
+  void flush();
+
+  /// Output sample rate (sampling frequency / 8) of the last frame, 0 if none
+  int sample_rate() { return out_sample_rate; }
+
+  /// Number of decoded frames
+  uint32_t frame_count() { return frames_decoded; }
+
+  /// Number of rejected (invalid or truncated) frames
+  uint32_t error_count() { return frames_rejected; }
+
+ protected:
+  enum { MONO = 0, DUAL_CHANNEL = 1, STEREO = 2, JOINT_STEREO = 3 };
+
+  struct SBCFrameInfo {
+    int sample_rate;
+    uint8_t frequency_idx;
+    uint8_t blocks;
+    uint8_t channel_mode;
+    uint8_t channels;
+    uint8_t snr_allocation;
+    uint8_t subbands;
+    uint8_t bitpool;
+    size_t length;
+  };
+
+  haptic_reader_t reader = nullptr;
+  int out_sample_rate = 0;
+  uint32_t frames_decoded = 0;
+  uint32_t frames_rejected = 0;
+  int16_t buffer[SBC_HAPTIC_BUFFER_SIZE];
+  uint16_t buffer_len = 0;
+  int32_t history[7] = {0};  ///< half band filter state (4 subbands)
+  uint8_t history_phase = 0;
+
+  bool parse_header(const uint8_t *data, size_t len, SBCFrameInfo &info);
+  void decode_frame(const uint8_t *data, const SBCFrameInfo &info);
+  void calc_bit_allocation(const SBCFrameInfo &info,
+                           const uint8_t sf[SBC_MAX_CHANNELS][SBC_MAX_SUBBANDS],
+                           uint8_t bits[SBC_MAX_CHANNELS][SBC_MAX_SUBBANDS]);
+  void calc_bitneed(const SBCFrameInfo &info, const uint8_t *sf,
+                    int8_t *bitneed);
+  int32_t dequantize(uint32_t value, uint8_t bits, uint8_t sf);
+  void decimate(int32_t sample);
+  void output(int32_t sample);
+};
@@ -0,0 +1,227 @@
+#pragma once
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <stdio.h>
+#include <string.h>
+
+/// Number of buckets of the callback time histogram
+#ifndef A2DP_TELEMETRY_HISTOGRAM_BINS
+#define A2DP_TELEMETRY_HISTOGRAM_BINS 10
+#endif
+
+/// Upper limit of the first histogram bucket in us; each further bucket doubles
+#ifndef A2DP_TELEMETRY_HISTOGRAM_MIN_US
+#define A2DP_TELEMETRY_HISTOGRAM_MIN_US 64
+#endif
+
+/**
+ * @brief Snapshot of the counters of a BluetoothA2DPSink stream.
+ *
+ * All counters are 32 bit and wrap around; compare two snapshots by their
+ * difference.
+ * @ingroup a2dp
+ */
+struct A2DPSinkTelemetry {
+  uint32_t packets = 0;          ///< audio packets received
+  uint32_t bytes = 0;            ///< PCM bytes received
+  uint32_t dropped_packets = 0;  ///< packets not queued (ringbuffer full or
+                                 ///< DROPPING) or not taken in full by I2S
+  uint32_t dropped_bytes = 0;
+  uint32_t underflows = 0;       ///< ringbuffer ran empty while playing
+  uint32_t ringbuffer_size = 0;  ///< capacity in bytes, 0 w/o ringbuffer
+  uint32_t ringbuffer_high_water = 0;  ///< largest fill level seen in bytes
+  uint32_t callback_count = 0;
+  uint32_t callback_max_us = 0;
+  uint32_t callback_total_us = 0;
+  /// callback times: bucket 0 is below A2DP_TELEMETRY_HISTOGRAM_MIN_US,
+  /// each further bucket doubles, the last one is open ended
+  uint32_t callback_histogram[A2DP_TELEMETRY_HISTOGRAM_BINS] = {0};
+  bool rssi_valid = false;
+  int8_t rssi_delta = 0;         ///< last value reported to update_rssi()
+  uint32_t rssi_age_ms = 0;      ///< time since the last rssi report
+
+  /// Upper limit in us of a histogram bucket (0 for the open ended one)
+  static uint32_t histogram_limit_us(int bin) {
+    if (bin >= A2DP_TELEMETRY_HISTOGRAM_BINS - 1) return 0;
+    return (uint32_t)A2DP_TELEMETRY_HISTOGRAM_MIN_US << bin;
+  }
+
+  /**
+   * @brief Writes the counters as one line of key=value pairs
+   * @return Number of characters which were written (w/o the terminating 0)
+   */
+  int print_to(char *buffer, size_t len) const {
+    if (buffer == nullptr || len == 0) return 0;
+    int pos = snprintf(
+        buffer, len,
+        "packets=%lu bytes=%lu dropped=%lu/%lu underflows=%lu "
+        "rb_high=%lu/%lu cb_max_us=%lu cb_avg_us=%lu rssi=",
+        (unsigned long)packets, (unsigned long)bytes,
+        (unsigned long)dropped_packets, (unsigned long)dropped_bytes,
+        (unsigned long)underflows, (unsigned long)ringbuffer_high_water,
+        (unsigned long)ringbuffer_size, (unsigned long)callback_max_us,
+        (unsigned long)(callback_count ? callback_total_us / callback_count
+                                       : 0));
+    if (pos < 0 || (size_t)pos >= len) return (int)strlen(buffer);
+    if (rssi_valid) {
+      pos += snprintf(buffer + pos, len - pos, "%d(%lums)", rssi_delta,
+                      (unsigned long)rssi_age_ms);
+    } else {
+      pos += snprintf(buffer + pos, len - pos, "n/a");
+    }
+    if ((size_t)pos >= len) return (int)strlen(buffer);
+    pos += snprintf(buffer + pos, len - pos, " cb_hist=");
+    for (int j = 0; j < A2DP_TELEMETRY_HISTOGRAM_BINS && (size_t)pos < len;
+         j++) {
+      pos += snprintf(buffer + pos, len - pos, j == 0 ? "%lu" : ",%lu",
+                      (unsigned long)callback_histogram[j]);
+    }
+    return (size_t)pos >= len ? (int)strlen(buffer) : pos;
+  }
+};
+
+/**
+ * @brief Collects the A2DPSinkTelemetry counters.
+ *
+ * The sink updates the counters from the BT callback, the I2S task and the
+ * GAP callback, while the application takes snapshots and resets them. Every
+ * counter is a 32 bit atomic, which the ESP32 updates without a lock, so no
+ * value is ever torn and a reset can't be undone by a writer that read the
+ * old value. A snapshot taken while the stream is running may mix values
+ * from two consecutive packets.
+ * @ingroup a2dp
+ * @copyright Apache License Version 2
+ */
+class A2DPTelemetryCounter {
+ public:
+  /// A packet of len bytes was received
+  void on_packet(uint32_t len) {
+    packets.fetch_add(1, std::memory_order_relaxed);
+    bytes.fetch_add(len, std::memory_order_relaxed);
+  }
+
+  /// A packet of len bytes could not be queued
+  void on_drop(uint32_t len) {
+    dropped_packets.fetch_add(1, std::memory_order_relaxed);
+    dropped_bytes.fetch_add(len, std::memory_order_relaxed);
+  }
+
+  /// The ringbuffer ran empty while playing
+  void on_underflow() { underflows.fetch_add(1, std::memory_order_relaxed); }
+
+  /// Records the fill level of the ringbuffer
+  void on_fill(uint32_t fill, uint32_t capacity) {
+    ringbuffer_size.store(capacity, std::memory_order_relaxed);
+    raise(ringbuffer_high_water, fill);
+  }
+
+  /// Records the processing time of one audio data callback
+  void on_callback(uint32_t us) {
+    callback_count.fetch_add(1, std::memory_order_relaxed);
+    callback_total_us.fetch_add(us, std::memory_order_relaxed);
+    raise(callback_max_us, us);
+    callback_histogram[histogram_bin(us)].fetch_add(1,
+                                                    std::memory_order_relaxed);
+  }
+
+  /// Records an rssi report
+  void on_rssi(int8_t rssi_delta, uint32_t now_ms) {
+    rssi_delta_value.store(rssi_delta, std::memory_order_relaxed);
+    rssi_ms.store(now_ms, std::memory_order_relaxed);
+    rssi_valid.store(true, std::memory_order_release);
+  }
+
+  /// Provides a copy of the counters
+  A2DPSinkTelemetry snapshot(uint32_t now_ms) const {
+    A2DPSinkTelemetry result;
+    result.packets = packets.load(std::memory_order_relaxed);
+    result.bytes = bytes.load(std::memory_order_relaxed);
+    result.dropped_packets = dropped_packets.load(std::memory_order_relaxed);
+    result.dropped_bytes = dropped_bytes.load(std::memory_order_relaxed);
+    result.underflows = underflows.load(std::memory_order_relaxed);
+    result.ringbuffer_size = ringbuffer_size.load(std::memory_order_relaxed);
+    result.ringbuffer_high_water =
+        ringbuffer_high_water.load(std::memory_order_relaxed);
+    result.callback_count = callback_count.load(std::memory_order_relaxed);
+    result.callback_max_us = callback_max_us.load(std::memory_order_relaxed);
+    result.callback_total_us =
+        callback_total_us.load(std::memory_order_relaxed);
+    for (int j = 0; j < A2DP_TELEMETRY_HISTOGRAM_BINS; j++) {
+      result.callback_histogram[j] =
+          callback_histogram[j].load(std::memory_order_relaxed);
+    }
+    result.rssi_valid = rssi_valid.load(std::memory_order_acquire);
+    if (result.rssi_valid) {
+      result.rssi_delta = rssi_delta_value.load(std::memory_order_relaxed);
+      result.rssi_age_ms = now_ms - rssi_ms.load(std::memory_order_relaxed);
+    }
+    return result;
+  }
+
+  /// Sets all counters to 0; the ringbuffer size is kept
+  void reset() {
+    packets.store(0, std::memory_order_relaxed);
+    bytes.store(0, std::memory_order_relaxed);
+    dropped_packets.store(0, std::memory_order_relaxed);
+    dropped_bytes.store(0, std::memory_order_relaxed);
+    underflows.store(0, std::memory_order_relaxed);
+    ringbuffer_high_water.store(0, std::memory_order_relaxed);
+    callback_count.store(0, std::memory_order_relaxed);
+    callback_max_us.store(0, std::memory_order_relaxed);
+    callback_total_us.store(0, std::memory_order_relaxed);
+    for (int j = 0; j < A2DP_TELEMETRY_HISTOGRAM_BINS; j++) {
+      callback_histogram[j].store(0, std::memory_order_relaxed);
+    }
+    rssi_valid.store(false, std::memory_order_relaxed);
+  }
+
+  /// Histogram bucket of a callback time
+  static int histogram_bin(uint32_t us) {
+    int bin = 0;
+    uint32_t limit = A2DP_TELEMETRY_HISTOGRAM_MIN_US;
+    while (bin < A2DP_TELEMETRY_HISTOGRAM_BINS - 1 && us >= limit) {
+      bin++;
+      limit <<= 1;
+    }
+    return bin;
+  }
+
+ protected:
+  std::atomic<uint32_t> packets{0};
+  std::atomic<uint32_t> bytes{0};
+  std::atomic<uint32_t> dropped_packets{0};
+  std::atomic<uint32_t> dropped_bytes{0};
+  std::atomic<uint32_t> underflows{0};
+  std::atomic<uint32_t> ringbuffer_size{0};
+  std::atomic<uint32_t> ringbuffer_high_water{0};
+  std::atomic<uint32_t> callback_count{0};
+  std::atomic<uint32_t> callback_max_us{0};
+  std::atomic<uint32_t> callback_total_us{0};
+  std::atomic<uint32_t> callback_histogram[A2DP_TELEMETRY_HISTOGRAM_BINS] = {};
+  std::atomic<bool> rssi_valid{false};
+  std::atomic<int8_t> rssi_delta_value{0};
+  std::atomic<uint32_t> rssi_ms{0};
+
+  /// keeps the larger value without a lock
+  static void raise(std::atomic<uint32_t> &max, uint32_t value) {
+    uint32_t current = max.load(std::memory_order_relaxed);
+    while (value > current &&
+           !max.compare_exchange_weak(current, value,
+                                      std::memory_order_relaxed)) {
+    }
+  }
+};
@@ -15,8 +15,16 @@
 // Copyright 2020 Phil Schatzmann
 // Copyright 2015-2016 Espressif Systems (Shanghai) PTE LTD
 
+#include <stdint.h>
+#include <string.h>
+
 #include "esp_log.h"
 
+/// Ramp the gain over one block when the volume changes (avoids clicks)
+#ifndef A2DP_VOLUME_RAMP
+#define A2DP_VOLUME_RAMP true
+#endif
+
     /**
      * @brief Utility structure that can be used to split a int32_t up into 2
      * separate channels with int16_t data.
@@ -44,6 +52,42 @@
   }
 };
 
+/// 32 bit view of a Frame: channel1 in the low and channel2 in the high half
+typedef uint32_t __attribute__((may_alias)) a2dp_frame_word_t;
+
+/**
+ * @brief Loads both channels of a frame with a single 32 bit access. The
+ * decoder buffers are word aligned; Aligned = false handles user buffers
+ * which are only 16 bit aligned.
+ */
+template <bool Aligned>
+inline void a2dp_load_frame(const Frame* frame, int32_t& left, int32_t& right) {
+  uint32_t word;
+  if (Aligned) {
+    word = *(const a2dp_frame_word_t*)frame;
+  } else {
+    memcpy(&word, (const void*)frame, sizeof(word));
+  }
+  left = (int16_t)(word & 0xffff);
+  right = (int16_t)(word >> 16);
+}
+
+/// Stores both channels of a frame with a single 32 bit access
+template <bool Aligned>
+inline void a2dp_store_frame(Frame* frame, int32_t left, int32_t right) {
+  uint32_t word = ((uint32_t)right << 16) | ((uint32_t)left & 0xffff);
+  if (Aligned) {
+    *(a2dp_frame_word_t*)frame = word;
+  } else {
+    memcpy((void*)frame, &word, sizeof(word));
+  }
+}
+
+/// True if the frames can be accessed as 32 bit words
+inline bool a2dp_is_word_aligned(const void* ptr) {
+  return ((uintptr_t)ptr & 3) == 0;
+}
+
 /**
  * @brief Abstract class for handling of the volume of the audio data
  * @ingroup a2dp
@@ -75,22 +119,85 @@ class A2DPVolumeControl {
   virtual void update_audio_data(Frame* data, uint16_t frameCount) {
     if (data != nullptr && frameCount > 0 && (mono_downmix || is_volume_used)) {
       ESP_LOGD("VolumeControl", "update_audio_data");
-      for (int i = 0; i < frameCount; i++) {
-        int32_t pcmLeft = data[i].channel1;
-        int32_t pcmRight = data[i].channel2;
-        // if mono -> we provide the same output on both channels
-        if (mono_downmix) {
-          pcmRight = pcmLeft = (pcmLeft + pcmRight) / 2;
-        }
-        // adjust the volume
-        if (is_volume_used) {
-          pcmLeft = clip(pcmLeft * volumeFactor / volumeFactorMax);
-          pcmRight = clip(pcmRight * volumeFactor / volumeFactorMax);
-        }
-        data[i].channel1 = pcmLeft;
-        data[i].channel2 = pcmRight;
+      if (is_volume_used && get_q15_shift() < 0) {
+        update_audio_data_divide(data, frameCount);
+        return;
       }
+      int32_t gainAcc = 0, gainStep = 0;
+      if (is_volume_used) next_gain_ramp(frameCount, gainAcc, gainStep);
+      bool aligned = a2dp_is_word_aligned(data);
+      if (aligned && mono_downmix && is_volume_used)
+        process<true, true, true>(data, frameCount, gainAcc, gainStep);
+      else if (aligned && is_volume_used)
+        process<true, false, true>(data, frameCount, gainAcc, gainStep);
+      else if (aligned)
+        process<true, true, false>(data, frameCount, gainAcc, gainStep);
+      else if (mono_downmix && is_volume_used)
+        process<false, true, true>(data, frameCount, gainAcc, gainStep);
+      else if (is_volume_used)
+        process<false, false, true>(data, frameCount, gainAcc, gainStep);
+      else
+        process<false, true, false>(data, frameCount, gainAcc, gainStep);
+    }
+  }
+
+  /**
+   * @brief Provides the Q15 gain for the next block of frames. When the
+   * volume has changed since the last block the gain ramps linearly from
+   * the previous to the new value over this block; otherwise it is constant.
+   * @param frameCount Number of frames in the block
+   * @param gainAcc Start gain in Q15 << 8: the gain of a frame is gainAcc >> 8
+   * @param gainStep Increment of gainAcc per frame (0 if no ramp is active)
+   */
+  void next_gain_ramp(uint32_t frameCount, int32_t& gainAcc,
+                      int32_t& gainStep) {
+    int32_t target = get_gain_q15();
+    if (!is_ramp_used || currentGain < 0 || currentGain == target ||
+        frameCount == 0) {
+      gainAcc = target << 8;
+      gainStep = 0;
+    } else {
+      gainAcc = currentGain << 8;
+      gainStep = (target - currentGain) * 256 / (int32_t)frameCount;
     }
+    currentGain = target;
+  }
+
+  /**
+   * @brief Gets the volume as Q15 gain (0x8000 = unity)
+   * @return Gain from 0 to 0xffff
+   */
+  int32_t get_gain_q15() {
+    int shift = get_q15_shift();
+    int32_t gain = shift < 0 ? 0x8000 : volumeFactor << shift;
+    if (gain < 0) gain = 0;
+    if (gain > 0xffff) gain = 0xffff;
+    return gain;
+  }
+
+  /**
+   * @brief Applies a Q15 gain with the rounding of an integer division
+   * (towards 0) and saturates to 16 bits: for gain = volumeFactor << n this
+   * is bit exact with pcm * volumeFactor / volumeFactorMax.
+   * @param pcm 16 bit sample
+   * @param gain Q15 gain from 0 to 0xffff
+   * @return Scaled sample
+   */
+  static inline int32_t apply_gain_q15(int32_t pcm, int32_t gain) {
+    int32_t product = pcm * gain;
+    return clip16((product + ((product >> 31) & 0x7fff)) >> 15);
+  }
+
+  /**
+   * @brief Saturates to the 16 bit range. Written as two selects, which the
+   * compiler can map to min/max or conditional moves; whether that is free of
+   * branches depends on the target and the optimization level
+   * @param value Input audio sample value
+   * @return Value within -32768 to 32767
+   */
+  static inline int32_t clip16(int32_t value) {
+    value = value < -32768 ? -32768 : value;
+    return value > 32767 ? 32767 : value;
   }
 
   /**
@@ -117,6 +224,34 @@ class A2DPVolumeControl {
    */
   void set_mono_downmix(bool enabled) { mono_downmix = enabled; }
 
+  /**
+   * @brief Checks if volume control is enabled
+   * @return True if the volume factor is applied
+   */
+  bool get_enabled() { return is_volume_used; }
+
+  /**
+   * @brief Checks if mono downmix is enabled
+   * @return True if both channels are replaced by their average
+   */
+  bool get_mono_downmix() { return mono_downmix; }
+
+  /**
+   * @brief Checks if update_audio_data() only applies the mono downmix and
+   * the volume factor, so that the sink can fold it into its single pass
+   * A2DPFramePipeline. False by default, so that a subclass with its own
+   * update_audio_data() is always called; the volume controls of this
+   * library opt in.
+   * @return True if the processing can be fused
+   */
+  virtual bool is_fusable() { return false; }
+
+  /**
+   * @brief Enables or disables the gain ramp on volume changes
+   * @param enabled True to ramp over one block, false to switch immediately
+   */
+  void set_ramp_enabled(bool enabled) { is_ramp_used = enabled; }
+
   /**
    * @brief Sets the volume level (pure virtual function)
    * @param volume Volume level (0-127)
@@ -129,6 +264,67 @@ class A2DPVolumeControl {
   int32_t volumeFactor = 1;     ///< Current volume factor
   int32_t volumeFactorMax = 0x1000;     ///< Maximum volume factor (4096)
   int32_t volumeFactorClippingLimit = 0xfff;  ///< Volume factor clipping limit (4095)
+  bool is_ramp_used = A2DP_VOLUME_RAMP;  ///< Flag indicating if volume changes are ramped
+  int32_t currentGain = -1;  ///< Q15 gain of the last block (-1 = none yet)
+
+  /**
+   * @brief Determines the shift which turns the volume factor into a Q15 gain
+   * @return 15 - log2(volumeFactorMax), or -1 if volumeFactorMax is not a
+   * power of 2 up to 0x8000
+   */
+  int get_q15_shift() {
+    if (volumeFactorMax <= 0 || volumeFactorMax > 0x8000 ||
+        (volumeFactorMax & (volumeFactorMax - 1)) != 0)
+      return -1;
+    return 15 - __builtin_ctz(volumeFactorMax);
+  }
+
+  /**
+   * @brief is_fusable() of the library's volume controls: the pipeline can
+   * only apply a Q15 gain
+   */
+  bool is_q15_fusable() { return get_q15_shift() >= 0; }
+
+  /**
+   * @brief Single pass over the frames. A frame is loaded and stored as one
+   * 32 bit word; mono downmix and gain work on each sample separately
+   */
+  template <bool Aligned, bool Mono, bool Volume>
+  static void process(Frame* data, uint16_t frameCount, int32_t gainAcc,
+                      int32_t gainStep) {
+    for (int i = 0; i < frameCount; i++) {
+      int32_t pcmLeft, pcmRight;
+      a2dp_load_frame<Aligned>(&data[i], pcmLeft, pcmRight);
+      if (Mono) {
+        pcmRight = pcmLeft = (pcmLeft + pcmRight) / 2;
+      }
+      if (Volume) {
+        int32_t gain = gainAcc >> 8;
+        gainAcc += gainStep;
+        pcmLeft = apply_gain_q15(pcmLeft, gain);
+        pcmRight = Mono ? pcmLeft : apply_gain_q15(pcmRight, gain);
+      }
+      a2dp_store_frame<Aligned>(&data[i], pcmLeft, pcmRight);
+    }
+  }
+
+  /**
+   * @brief Generic path with a division per sample for volume scales which
+   * are not a power of 2
+   */
+  void update_audio_data_divide(Frame* data, uint16_t frameCount) {
+    for (int i = 0; i < frameCount; i++) {
+      int32_t pcmLeft = data[i].channel1;
+      int32_t pcmRight = data[i].channel2;
+      if (mono_downmix) {
+        pcmRight = pcmLeft = (pcmLeft + pcmRight) / 2;
+      }
+      pcmLeft = clip(pcmLeft * volumeFactor / volumeFactorMax);
+      pcmRight = clip(pcmRight * volumeFactor / volumeFactorMax);
+      data[i].channel1 = pcmLeft;
+      data[i].channel2 = pcmRight;
+    }
+  }
 
   /**
    * @brief Clips audio sample value to prevent overflow
@@ -165,6 +361,12 @@ class A2DPDefaultVolumeControl : public A2DPVolumeControl {
     volumeFactorClippingLimit = limit;
   };
 
+  /**
+   * @brief Fusable with a power of 2 volumeFactorMax; a subclass which
+   * overrides update_audio_data() must return false again
+   */
+  bool is_fusable() override { return is_q15_fusable(); }
+
  protected:
   /**
    * @brief Sets the volume using exponential curve calculation
@@ -207,6 +409,9 @@ class A2DPSimpleExponentialVolumeControl : public A2DPVolumeControl {
     volumeFactorClippingLimit = limit;
   };
 
+  /** @brief Fusable with a power of 2 volumeFactorMax */
+  bool is_fusable() override { return is_q15_fusable(); }
+
  protected:
   /**
    * @brief Sets the volume using simple exponential calculation
@@ -234,6 +439,9 @@ class A2DPLinearVolumeControl : public A2DPVolumeControl {
    */
   A2DPLinearVolumeControl() { volumeFactorMax = 128; }
 
+  /** @brief Fusable with a power of 2 volumeFactorMax */
+  bool is_fusable() override { return is_q15_fusable(); }
+
  protected:
   /**
    * @brief Sets the volume using direct linear mapping
@@ -263,14 +471,17 @@ class A2DPNoVolumeControl : public A2DPVolumeControl {
   
   /**
    * @brief Override that does nothing - no audio data modification
-   * @param data Pointer to audio frame data (unused)
-   * @param frameCount Number of frames (unused)
    */
-  void update_audio_data(Frame* data, uint16_t frameCount) override {}
+  void update_audio_data(Frame*, uint16_t) override {}
+
+  /**
+   * @brief Not fusable: the audio data must stay unchanged
+   * @return false
+   */
+  bool is_fusable() override { return false; }
 
   /**
    * @brief Override that does nothing - no volume setting
-   * @param volume Volume level (unused)
    */
-  void set_volume(uint8_t volume) override {}
+  void set_volume(uint8_t) override {}
 };
\ No newline at end of file
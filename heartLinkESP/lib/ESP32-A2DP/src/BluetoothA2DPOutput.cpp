@@ -231,11 +231,11 @@ void BluetoothA2DPOutputAudioTools::set_sample_rate(int m_sample_rate) {
   ESP_LOGI(BT_AV_TAG, "%s %d", __func__, m_sample_rate);
   if (p_audio_print != nullptr) {
     audio_tools::AudioInfo info = p_audio_print->audioInfo();
-    if (info.sample_rate != m_sample_rate || info.channels != 2 ||
-        info.bits_per_sample != 16) {
+    if (info.sample_rate != m_sample_rate || info.channels != output_channels ||
+        info.bits_per_sample != output_bits_per_sample) {
       info.sample_rate = m_sample_rate;
-      info.channels = 2;
-      info.bits_per_sample = 16;
+      info.channels = output_channels;
+      info.bits_per_sample = output_bits_per_sample;
       p_audio_print->setAudioInfo(info);
       ESP_LOGI(BT_AV_TAG, "%s sample_rate %d -> %d", __func__, info.sample_rate, p_audio_print->audioInfo().sample_rate);
     } else {
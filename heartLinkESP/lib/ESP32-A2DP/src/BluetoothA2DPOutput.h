@@ -1,5 +1,6 @@
 #pragma once
 #include "BluetoothA2DPCommon.h"
+#include "A2DPFrameFormat.h"
 
 #ifdef ARDUINO
 #include "Print.h"
@@ -26,6 +27,9 @@ class BluetoothA2DPOutput {
   virtual void end() = 0;
   virtual void set_sample_rate(int rate) = 0;
   virtual void set_output_active(bool active) = 0;
+  /// Preferred number of bytes per write(): the sink splits its packets
+  /// into multiples of it (0 = any size)
+  virtual size_t write_chunk_size() { return 0; }
 
 #if A2DP_I2S_AUDIOTOOLS
   /// Not implemented
@@ -113,8 +117,54 @@ class BluetoothA2DPOutputAudioTools : public BluetoothA2DPOutput {
 #if A2DP_I2S_AUDIOTOOLS
   audio_tools::AudioOutput *p_audio_print = nullptr;
 #endif
+  // format which is reported to the AudioOutput
+  int output_channels = 2;
+  int output_bits_per_sample = 16;
 };
 
+#if A2DP_I2S_AUDIOTOOLS || defined(ARDUINO)
+
+/**
+ * @brief AudioTools / Print output with a format which is fixed at compile
+ * time: T is the sample type (int16_t or int32_t), CHANNELS 1 or 2. The
+ * conversion from the decoded 16 bit stereo data and the write loop are
+ * resolved by the template, and the data is written in chunks of whole DMA
+ * buffers of DMA_FRAMES frames.
+ *
+ * @code {.cpp}
+ * BluetoothA2DPOutputFormatted<int32_t, 2> out32;
+ * BluetoothA2DPSink a2dp_sink(out32);
+ * out32.set_output(i2s);
+ * @endcode
+ * @author Phil Schatzmann
+ * @copyright Apache License Version 2
+ */
+template <typename T, int CHANNELS, int DMA_FRAMES = A2DP_OUTPUT_DMA_FRAMES>
+class BluetoothA2DPOutputFormatted : public BluetoothA2DPOutputAudioTools {
+ public:
+  BluetoothA2DPOutputFormatted() {
+    output_channels = CHANNELS;
+    output_bits_per_sample = sizeof(T) * 8;
+  }
+
+  size_t write(const uint8_t *data, size_t len) override {
+    if (p_print == nullptr) return 0;
+    return writer.write(*p_print, data, len);
+  }
+
+  size_t write_chunk_size() override { return writer.input_chunk_bytes(); }
+
+ protected:
+  A2DPFrameWriter<T, CHANNELS, DMA_FRAMES> writer;
+};
+
+/// 16 bit mono AudioTools / Print output
+typedef BluetoothA2DPOutputFormatted<int16_t, 1> BluetoothA2DPOutputMono16;
+/// 32 bit stereo AudioTools / Print output
+typedef BluetoothA2DPOutputFormatted<int32_t, 2> BluetoothA2DPOutputStereo32;
+
+#endif
+
 #ifdef ARDUINO
 
 /**
@@ -203,55 +253,40 @@ class BluetoothA2DPOutputLegacy : public BluetoothA2DPOutput {
 class BluetoothA2DPOutputDefault : public BluetoothA2DPOutput {
  public:
   BluetoothA2DPOutputDefault() = default;
-  bool begin() {
-    bool rc = false;
-    if (out_tools)
-      rc = out_tools.begin();
-    else
-      rc = out_legacy.begin();
-    return rc;
-  }
-  
+  // the active output is selected in set_output() and not per call
+  bool begin() { return p_active->begin(); }
+
   size_t write(const uint8_t *data, size_t len) {
-    size_t result = 0;
-    if (out_tools)
-      result = out_tools.write(data, len);
-    else
-      result = out_legacy.write(data, len);
-    return result;
-  }
-  
-  void end() override {
-    if (out_tools)
-      out_tools.end();
-    else
-      out_legacy.end();
-  }
-  
-  void set_sample_rate(int rate) override {
-    if (out_tools)
-      out_tools.set_sample_rate(rate);
-    else
-      out_legacy.set_sample_rate(rate);
+    return p_active->write(data, len);
   }
 
+  void end() override { p_active->end(); }
+
+  void set_sample_rate(int rate) override { p_active->set_sample_rate(rate); }
+
   void set_output_active(bool active) override {
-    if (out_tools)
-      out_tools.set_output_active(active);
-    else
-      out_legacy.set_output_active(active);
+    p_active->set_output_active(active);
   }
 
 #if A2DP_I2S_AUDIOTOOLS
   /// Output AudioStream using AudioTools library
-  void set_output(audio_tools::AudioOutput &output) override  { out_tools.set_output(output); }
+  void set_output(audio_tools::AudioOutput &output) override {
+    out_tools.set_output(output);
+    p_active = &out_tools;
+  }
   /// Output AudioStream using AudioTools library
-  void set_output(audio_tools::AudioStream &output) override { out_tools.set_output(output); }
+  void set_output(audio_tools::AudioStream &output) override {
+    out_tools.set_output(output);
+    p_active = &out_tools;
+  }
 #endif
 
 #ifdef ARDUINO
   /// Output to Arduino Print
-  void set_output(Print &output) override { out_tools.set_output(output); }
+  void set_output(Print &output) override {
+    out_tools.set_output(output);
+    p_active = &out_tools;
+  }
 #endif
 
 #if A2DP_LEGACY_I2S_SUPPORT
@@ -284,4 +319,10 @@ class BluetoothA2DPOutputDefault : public BluetoothA2DPOutput {
  protected:
   BluetoothA2DPOutputAudioTools out_tools;
   BluetoothA2DPOutputLegacy out_legacy;
+  BluetoothA2DPOutput *p_active = &out_legacy;
+
+  // not copyable: p_active points to a member
+  BluetoothA2DPOutputDefault(const BluetoothA2DPOutputDefault &) = delete;
+  BluetoothA2DPOutputDefault &operator=(const BluetoothA2DPOutputDefault &) =
+      delete;
 };
\ No newline at end of file
@@ -407,6 +407,7 @@ void BluetoothA2DPSink::app_gap_callback(esp_bt_gap_cb_event_t event,
 
     case ESP_BT_GAP_READ_RSSI_DELTA_EVT: {
       last_rssi_delta = param->read_rssi_delta;
+      telemetry.on_rssi(last_rssi_delta.rssi_delta, get_millis());
       if (rssi_callback != nullptr) {
         rssi_callback(last_rssi_delta);
       }
@@ -1147,25 +1148,25 @@ void BluetoothA2DPSink::app_a2d_callback(esp_a2d_cb_event_t event,
 
 void BluetoothA2DPSink::audio_data_callback(const uint8_t *data, uint32_t len) {
   ESP_LOGD(BT_AV_TAG, "%s", __func__);
+  int64_t start_us = esp_timer_get_time();
+  telemetry.on_packet(len);
+  Frame *frames = (Frame *)data;
+  uint32_t frame_count = len / 4;
 
-  // swap left and right channels
-  if (swap_left_right) {
-    Frame *frame = (Frame *)data;
-    for (int i = 0; i < len / 4; i++) {
-      int16_t temp = frame[i].channel1;
-      frame[i].channel1 = frame[i].channel2;
-      frame[i].channel2 = temp;
-    }
-  }
-
-  // make data available via callback, before volume control
   if (raw_stream_reader != nullptr) {
+    // the raw data is swapped but not volume adjusted: split the pass
+    frame_pipeline.configure(swap_left_right, nullptr, false);
+    frame_pipeline.run(frames, frame_count);
+
+    // make data available via callback, before volume control
     ESP_LOGD(BT_AV_TAG, "raw_stream_reader");
     (*raw_stream_reader)(data, len);
-  }
 
-  // adjust the volume
-  volume_control()->update_audio_data((Frame *)data, len / 4);
+    run_volume_pipeline(false, frames, frame_count);
+  } else {
+    // swap, adjust the volume and feed the haptic tap in one pass
+    run_volume_pipeline(swap_left_right, frames, frame_count);
+  }
 
   // make data available via callback
   if (stream_reader != nullptr) {
@@ -1183,6 +1184,26 @@ void BluetoothA2DPSink::audio_data_callback(const uint8_t *data, uint32_t len) {
     ESP_LOGD(BT_AV_TAG, "data_received");
     (*data_received)();
   }
+
+  telemetry.on_callback((uint32_t)(esp_timer_get_time() - start_us));
+}
+
+void BluetoothA2DPSink::run_volume_pipeline(bool swap, Frame *frames,
+                                            uint32_t frame_count) {
+  A2DPVolumeControl *vc = volume_control();
+  if (!frame_pipeline.configure(swap, vc, true)) {
+    // custom volume control: keep its own pass between swap and haptic tap
+    frame_pipeline.configure(swap, nullptr, false);
+    frame_pipeline.run(frames, frame_count);
+    vc->update_audio_data(frames, frame_count);
+    frame_pipeline.configure(false, nullptr, true);
+  }
+  frame_pipeline.run(frames, frame_count);
+}
+
+void BluetoothA2DPSink::set_haptic_stream_reader(
+    void (*callBack)(const uint8_t *, uint32_t), uint8_t decimation) {
+  frame_pipeline.set_haptic_reader(callBack, decimation);
 }
 
 bool BluetoothA2DPSink::is_avrc_connected() { return avrc_connection_state; }
@@ -1295,15 +1316,29 @@ size_t BluetoothA2DPSink::i2s_write_data(const uint8_t *data,
     return 0;
   }
 
-  // split up outout to max size
+  // split up outout to max size, rounded down to the chunk size the output
+  // prefers (whole DMA buffers). A blocking output takes every chunk; one
+  // that takes less is full, so we yield (or sleep max_write_delay_ms)
+  // instead of spinning, and drop the rest after A2DP_I2S_MAX_WRITE_RETRIES
+  // writes in a row that took nothing
+  int chunk = max_write_size;
+  int preferred = out->write_chunk_size();
+  if (preferred > 0 && chunk > preferred) chunk -= chunk % preferred;
   int open = item_size;
   int processed = 0;
+  int retries = 0;
   while (open > 0) {
-    int written = out->write(data + processed, std::min(open, max_write_size));
-    open -= written;
-    processed += written;
-    // add some delay between the writes
+    int len = std::min(open, chunk);
+    int written = out->write(data + processed, len);
+    if (written > 0) {
+      open -= written;
+      processed += written;
+      retries = 0;
+    }
+    if (written >= len) continue;
+    if (written <= 0 && ++retries > A2DP_I2S_MAX_WRITE_RETRIES) break;
     delay_ms(max_write_delay_ms);
+    if (!is_i2s_active) break;
   }
   return processed;
 }
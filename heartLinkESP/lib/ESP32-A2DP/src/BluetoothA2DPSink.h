@@ -17,6 +17,8 @@
 #include "BluetoothA2DPCommon.h"
 #if IS_VALID_PLATFORM
 
+#include "A2DPFramePipeline.h"
+#include "A2DPSinkTelemetry.h"
 #include "BluetoothA2DPOutput.h"
 #include "freertos/ringbuf.h"
 
@@ -239,6 +241,13 @@ class BluetoothA2DPSink : public BluetoothA2DPCommon {
   virtual void set_raw_stream_reader(void (*callBack)(const uint8_t *,
                                                       uint32_t));
 
+  /// Define a callback which receives the volume adjusted audio as unsigned
+  /// 8 bit mono samples (128 = silence) for haptic output: decimation frames
+  /// are averaged into one sample, e.g. 6 gives 7350 Hz from 44100 Hz
+  virtual void set_haptic_stream_reader(void (*callBack)(const uint8_t *,
+                                                         uint32_t),
+                                        uint8_t decimation = 1);
+
   /// Define callback which is called when we receive data
   virtual void set_on_data_received(void (*callBack)());
 
@@ -346,6 +355,15 @@ class BluetoothA2DPSink : public BluetoothA2DPCommon {
     return last_rssi_delta;
   }
 
+  /// Provides the stream counters: packets, drops, underflows, ringbuffer
+  /// high-water mark, callback times and the last rssi
+  A2DPSinkTelemetry get_telemetry() {
+    return telemetry.snapshot(get_millis());
+  }
+
+  /// Sets the stream counters back to 0
+  void reset_telemetry() { telemetry.reset(); }
+
   /// Defines the callback that is called when we get an new rssi value
   void set_rssi_callback(
       void (*callback)(esp_bt_gap_cb_param_t::read_rssi_delta_param &rssi)) {
@@ -384,7 +402,8 @@ class BluetoothA2DPSink : public BluetoothA2DPCommon {
   /// defines the max write size: default is A2DP_I2S_MAX_WRITE_SIZE
   void set_max_write_size(int size) { max_write_size = size; }
 
-  /// defines a small delay after each write: default is 0 ms
+  /// defines the delay before retrying a write which the output did not
+  /// fully accept: default is 0 ms (just yield)
   void set_max_write_delay_ms(int delay) { max_write_delay_ms = delay; }
 
 #if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(4, 0, 0)
@@ -455,11 +474,13 @@ class BluetoothA2DPSink : public BluetoothA2DPCommon {
   bool (*address_validator)(esp_bd_addr_t remote_bda) = nullptr;
   void (*sample_rate_callback)(uint16_t rate) = nullptr;
   bool swap_left_right = false;
+  A2DPFramePipeline frame_pipeline;
   int try_reconnect_max_count = AUTOCONNECT_TRY_NUM;
 
   // RSSI support
   esp_bt_gap_cb_param_t::read_rssi_delta_param last_rssi_delta;
   bool rssi_active = false;
+  A2DPTelemetryCounter telemetry;
   void (*rssi_callback)(esp_bt_gap_cb_param_t::read_rssi_delta_param &rssi) =
       nullptr;
   void (*peer_name_callback)(char *peer_name) =
@@ -511,6 +532,9 @@ class BluetoothA2DPSink : public BluetoothA2DPCommon {
    */
   // Callback for music stream
   virtual void audio_data_callback(const uint8_t *data, uint32_t len);
+  // volume (and swap) stages of the frame pipeline plus the haptic tap
+  virtual void run_volume_pipeline(bool swap, Frame *frames,
+                                   uint32_t frame_count);
   // a2dp event handler
   virtual void av_hdl_a2d_evt(uint16_t event, void *p_param);
   // avrc event handler
@@ -541,7 +565,10 @@ class BluetoothA2DPSink : public BluetoothA2DPCommon {
 
   /// output audio data e.g. to i2s or to queue
   virtual size_t write_audio(const uint8_t *data, size_t size) {
-    return i2s_write_data(data, size);
+    // without a ringbuffer, what I2S does not take is lost
+    size_t written = i2s_write_data(data, size);
+    if (written < size) telemetry.on_drop(size - written);
+    return written;
   }
 
   /// writes the data to i2s
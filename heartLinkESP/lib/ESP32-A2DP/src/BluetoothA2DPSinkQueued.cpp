@@ -4,23 +4,38 @@
 #if IS_VALID_PLATFORM
 
 void BluetoothA2DPSinkQueued::bt_i2s_task_start_up(void) {
+    // without I2S output write_audio() is not called: don't reserve the
+    // ringbuffer and the task stack until it is (see write_audio())
+    if (!is_output) {
+        ESP_LOGI(BT_APP_TAG, "no I2S output: ringbuffer and I2S task not needed");
+        return;
+    }
+    i2s_queue_start_up();
+}
+
+bool BluetoothA2DPSinkQueued::i2s_queue_start_up(void) {
+    if (s_bt_i2s_task_handle != nullptr) return true;
     ESP_LOGI(BT_APP_TAG, "ringbuffer data empty! mode changed: RINGBUFFER_MODE_PREFETCHING");
-    ringbuffer_mode = RINGBUFFER_MODE_PREFETCHING;
-    if ((s_i2s_write_semaphore = xSemaphoreCreateBinary()) == nullptr) {
+    if (s_i2s_write_semaphore == nullptr && (s_i2s_write_semaphore = xSemaphoreCreateBinary()) == nullptr) {
         ESP_LOGE(BT_APP_TAG, "%s, Semaphore create failed", __func__);
-        return;
+        return false;
     }
-    if ((s_ringbuf_i2s = xRingbufferCreate(i2s_ringbuffer_size, RINGBUF_TYPE_BYTEBUF)) == nullptr) {
-        ESP_LOGE(BT_APP_TAG, "%s, ringbuffer create failed", __func__);
-        return;
+    if (s_ringbuf_i2s == nullptr) {
+        if ((s_ringbuf_i2s = xRingbufferCreate(i2s_ringbuffer_size, RINGBUF_TYPE_BYTEBUF)) == nullptr) {
+            ESP_LOGE(BT_APP_TAG, "%s, ringbuffer create failed", __func__);
+            return false;
+        }
+        ringbuffer_control.begin(i2s_ringbuffer_size);
     }
     //xTaskCreate(bt_i2s_task_handler, "BtI2STask", 2048, nullptr, configMAX_PRIORITIES - 3, &s_bt_i2s_task_handle);
     BaseType_t result = xTaskCreatePinnedToCore(ccall_i2s_task_handler, "BtI2STask", i2s_stack_size, nullptr, i2s_task_priority, &s_bt_i2s_task_handle, task_core);
     if (result!=pdPASS){
         ESP_LOGE(BT_AV_TAG, "xTaskCreatePinnedToCore");
-    } else {
-        ESP_LOGI(BT_AV_TAG, "BtI2STask Started");
+        s_bt_i2s_task_handle = nullptr;
+        return false;
     }
+    ESP_LOGI(BT_AV_TAG, "BtI2STask Started");
+    return true;
 }
 
 void BluetoothA2DPSinkQueued::bt_i2s_task_shut_down(void) {
@@ -49,27 +64,35 @@ void BluetoothA2DPSinkQueued::i2s_task_handler(void *arg) {
      * The total length of DMA buffer of I2S is:
      * `dma_frame_num * dma_desc_num * i2s_channel_num * i2s_data_bit_width / 8`.
      * Transmit `dma_frame_num * dma_desc_num` bytes to DMA is trade-off.
+     *
+     * There are no fixed sleeps: we block on the prefetch semaphore while
+     * the ringbuffer fills up, on the ringbuffer while it is empty and in
+     * i2s_write_data() until the DMA has room for the data.
      */
-    is_starting = true;
+    bool is_waiting = true;
 
     while (true) {
-        if (is_starting){
-            // wait for ringbuffer to be filled
+        if (is_waiting){
+            // wait for ringbuffer to be filled up to the watermark
             if (pdTRUE != xSemaphoreTake(s_i2s_write_semaphore, portMAX_DELAY)){
                 continue;
             }
-            is_starting = false;
+            // ignore a give which is left over from an earlier prefetch
+            if (ringbuffer_control.get_mode() == RINGBUFFER_MODE_PREFETCHING){
+                continue;
+            }
+            is_waiting = false;
         }
-        // xSemaphoreTake was succeeding here, so we have the buffer filled up
         item_size = 0;
 
         // receive data from ringbuffer and write it to I2S DMA transmit buffer 
         data = (uint8_t *)xRingbufferReceiveUpTo(s_ringbuf_i2s, &item_size, (TickType_t)pdMS_TO_TICKS(i2s_ticks), i2s_write_size_upto);
         if (item_size == 0) {
-            if (ringbuffer_mode != RINGBUFFER_MODE_PREFETCHING) {
+            if (ringbuffer_control.on_empty()) {
+                telemetry.on_underflow();
                 ESP_LOGI(BT_APP_TAG, "ringbuffer underflowed! mode changed: RINGBUFFER_MODE_PREFETCHING");
-                ringbuffer_mode = RINGBUFFER_MODE_PREFETCHING;
             }
+            is_waiting = ringbuffer_control.get_mode() == RINGBUFFER_MODE_PREFETCHING;
             continue;
         } 
 
@@ -79,20 +102,24 @@ void BluetoothA2DPSinkQueued::i2s_task_handler(void *arg) {
             ESP_LOGD(BT_AV_TAG, "i2s_task_handler: %d->%d", item_size, written);
             if (written==0){
                 ESP_LOGE(BT_APP_TAG, "i2s_write_data failed %d->%d", item_size, written);
-                continue;
             }
         }
 
         vRingbufferReturnItem(s_ringbuf_i2s, (void *)data);
-        delay_ms(5);
     }
 }
 
 size_t BluetoothA2DPSinkQueued::write_audio(const uint8_t *data, size_t size)
 {
-    size_t item_size = 0;
     BaseType_t done = pdFALSE;
 
+    // the I2S output was enabled after the start (set_stream_reader(cb, true)):
+    // create the ringbuffer and the task now
+    if (s_bt_i2s_task_handle == nullptr && !i2s_queue_start_up()) {
+        telemetry.on_drop(size);
+        return 0;
+    }
+
     // This should not really happen!
     if (!is_i2s_active){
         ESP_LOGW(BT_APP_TAG, "i2s is not active: we try to activate it");
@@ -100,41 +127,28 @@ size_t BluetoothA2DPSinkQueued::write_audio(const uint8_t *data, size_t size)
         delay_ms(200);
     }
 
-    if (ringbuffer_mode == RINGBUFFER_MODE_DROPPING) {
+    if (ringbuffer_control.is_dropping(i2s_ringbuffer_fill())) {
         ESP_LOGW(BT_APP_TAG, "ringbuffer is full, drop this packet!");
-#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(4, 0, 0)
-        vRingbufferGetInfo(s_ringbuf_i2s, nullptr, nullptr, nullptr, nullptr, &item_size);
-#else
-        vRingbufferGetInfo(s_ringbuf_i2s, nullptr, nullptr, nullptr, &item_size);
-#endif
-        if (item_size <= i2s_ringbuffer_prefetch_size()) {
+        if (ringbuffer_control.get_mode() == RINGBUFFER_MODE_PROCESSING) {
             ESP_LOGI(BT_APP_TAG, "ringbuffer data decreased! mode changed: RINGBUFFER_MODE_PROCESSING");
-            ringbuffer_mode = RINGBUFFER_MODE_PROCESSING;
         }
+        telemetry.on_drop(size);
         return 0;
     }
 
     done = xRingbufferSend(s_ringbuf_i2s, (void *)data, size, (TickType_t)0);
-
-    if (!done) {
-        ESP_LOGW(BT_APP_TAG, "ringbuffer overflowed, ready to decrease data! mode changed: RINGBUFFER_MODE_DROPPING");
-        ringbuffer_mode = RINGBUFFER_MODE_DROPPING;
-    }
-
-    if (ringbuffer_mode == RINGBUFFER_MODE_PREFETCHING) {
-#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(4, 0, 0)
-        vRingbufferGetInfo(s_ringbuf_i2s, nullptr, nullptr, nullptr, nullptr, &item_size);
-#else
-        vRingbufferGetInfo(s_ringbuf_i2s, nullptr, nullptr, nullptr, &item_size);
-#endif
-
-        if (item_size >= i2s_ringbuffer_prefetch_size()) {
-            ESP_LOGI(BT_APP_TAG, "ringbuffer data increased! mode changed: RINGBUFFER_MODE_PROCESSING");
-            ringbuffer_mode = RINGBUFFER_MODE_PROCESSING;
-            if (pdFALSE == xSemaphoreGive(s_i2s_write_semaphore)) {
-                ESP_LOGE(BT_APP_TAG, "semphore give failed");
-            }
+    size_t fill = i2s_ringbuffer_fill();
+    telemetry.on_fill(fill, i2s_ringbuffer_size);
+    if (!done) telemetry.on_drop(size);
+
+    ringbuffer_control.set_byte_rate(sample_rate() * 4);
+    if (ringbuffer_control.on_write(done, fill, get_millis())) {
+        ESP_LOGI(BT_APP_TAG, "ringbuffer data increased! prefetch done, mode changed: %s", done ? "RINGBUFFER_MODE_PROCESSING" : "RINGBUFFER_MODE_DROPPING");
+        if (pdFALSE == xSemaphoreGive(s_i2s_write_semaphore)) {
+            ESP_LOGE(BT_APP_TAG, "semphore give failed");
         }
+    } else if (!done) {
+        ESP_LOGW(BT_APP_TAG, "ringbuffer overflowed, ready to decrease data! mode changed: RINGBUFFER_MODE_DROPPING");
     }
 
     return done ? size : 0;
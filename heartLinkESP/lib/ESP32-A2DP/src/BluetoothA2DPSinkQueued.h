@@ -7,18 +7,13 @@
 #define RINGBUF_HIGHEST_WATER_LEVEL (32 * 1024)
 #define RINGBUF_PREFETCH_PERCENT 65
 
-enum A2DPRingBufferMode : char {
-  RINGBUFFER_MODE_PROCESSING,  /* ringbuffer is buffering incoming audio data,
-                                  I2S is working */
-  RINGBUFFER_MODE_PREFETCHING, /* ringbuffer is buffering incoming audio data,
-                                  I2S is waiting */
-  RINGBUFFER_MODE_DROPPING /* ringbuffer is not buffering (dropping) incoming
-                              audio data, I2S is working */
-};
+#include "A2DPRingBufferControl.h"
 
 /**
  * @brief The BluetoothA2DPSinkQueued is using a separate Task with an additinal
- * Queue to write the I2S data. application.
+ * Queue to write the I2S data. application. When the I2S output is disabled
+ * (set_stream_reader(reader, false)) neither the queue nor the task are
+ * created; they are created with the first packet once it is enabled.
  * @ingroup a2dp
  * @author Phil Schatzmann
  * @copyright Apache License Version 2
@@ -51,14 +46,16 @@ class BluetoothA2DPSinkQueued : public BluetoothA2DPSink {
   /// Defines the stack size of the i2s task (in bytes)
   void set_i2s_stack_size(int size) { i2s_stack_size = size; }
 
-  /// Defines the ringbuffer size used by the i2s task (in bytes)
+  /// Defines the ringbuffer size used by the i2s task (in bytes); a running
+  /// ringbuffer keeps its size until the next start
   void set_i2s_ringbuffer_size(int size) { i2s_ringbuffer_size = size; }
 
-  /// Audio starts to play when limit exeeded
+  /// Audio starts to play when limit exeeded. With the adaptive prefetch
+  /// this is the upper limit of the watermark. Takes effect immediately.
   void set_i2s_ringbuffer_prefetch_percent(int percent) {
     if (percent < 0) return;
     if (percent > 100) return;
-    ringbuffer_prefetch_percent = percent;
+    ringbuffer_control.set_max_percent(percent);
   }
 
   /// Defines the priority of the I2S task
@@ -68,6 +65,25 @@ class BluetoothA2DPSinkQueued : public BluetoothA2DPSink {
 
   void set_i2s_ticks(int ticks) { i2s_ticks = ticks; }
 
+  /// Adapts the prefetch watermark to the observed packet jitter instead of
+  /// always prefetching the full prefetch percent (off by default)
+  void set_i2s_adaptive_prefetch(bool active) {
+    ringbuffer_control.set_adaptive(active);
+  }
+
+  /// Number of times the I2S output ran out of data while playing
+  uint32_t get_underflow_count() {
+    return ringbuffer_control.get_underflow_count();
+  }
+
+  /// Number of packets dropped because the ringbuffer was full
+  uint32_t get_overflow_count() {
+    return ringbuffer_control.get_overflow_count();
+  }
+
+  /// Current prefetch watermark in bytes
+  size_t get_prefetch_watermark() { return ringbuffer_control.watermark(); }
+
  protected:
   TaskHandle_t s_bt_i2s_task_handle = nullptr; /* handle of I2S task */
   RingbufHandle_t s_ringbuf_i2s = nullptr;    /* handle of ringbuffer for I2S */
@@ -76,13 +92,13 @@ class BluetoothA2DPSinkQueued : public BluetoothA2DPSink {
   int i2s_stack_size = 2048;
   int i2s_ringbuffer_size = RINGBUF_HIGHEST_WATER_LEVEL;
   UBaseType_t i2s_task_priority = configMAX_PRIORITIES - 3;
-  volatile A2DPRingBufferMode ringbuffer_mode = RINGBUFFER_MODE_PROCESSING;
-  volatile bool is_starting = true;
+  A2DPRingBufferControl ringbuffer_control{RINGBUF_PREFETCH_PERCENT};
   size_t i2s_write_size_upto = 240 * 6;
   int i2s_ticks = 20;
-  int ringbuffer_prefetch_percent = RINGBUF_PREFETCH_PERCENT;
 
   void bt_i2s_task_start_up(void) override;
+  /// creates whatever is missing of the semaphore, ringbuffer and I2S task
+  bool i2s_queue_start_up(void);
   void bt_i2s_task_shut_down(void) override;
   void i2s_task_handler(void *arg) override;
   size_t write_audio(const uint8_t *data, size_t size) override;
@@ -90,14 +106,19 @@ class BluetoothA2DPSinkQueued : public BluetoothA2DPSink {
   void set_i2s_active(bool active) override {
     BluetoothA2DPSink::set_i2s_active(active);
     if (active) {
-      ringbuffer_mode = RINGBUFFER_MODE_PREFETCHING;
-      is_starting = true;
+      ringbuffer_control.restart();
     }
   }
 
-  int i2s_ringbuffer_prefetch_size() {
-    int bytes = i2s_ringbuffer_size * ringbuffer_prefetch_percent / 100;
-    return (bytes / 4 * 4);
+  size_t i2s_ringbuffer_fill() {
+    size_t item_size = 0;
+    if (s_ringbuf_i2s == nullptr) return 0;
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(4, 0, 0)
+    vRingbufferGetInfo(s_ringbuf_i2s, nullptr, nullptr, nullptr, nullptr, &item_size);
+#else
+    vRingbufferGetInfo(s_ringbuf_i2s, nullptr, nullptr, nullptr, &item_size);
+#endif
+    return item_size;
   }
 };
 
@@ -30,6 +30,11 @@
 #  define A2DP_I2S_MAX_WRITE_DELAY_MS 0
 #endif
 
+// Writes in a row the output may refuse before the rest of the data is dropped
+#ifndef A2DP_I2S_MAX_WRITE_RETRIES 
+#  define A2DP_I2S_MAX_WRITE_RETRIES 100
+#endif
+
 // Maximum wait time for status change in 100 ms when calling end()
 #ifndef A2DP_DISCONNECT_LIMIT 
 #  define A2DP_DISCONNECT_LIMIT 20
@@ -566,6 +566,57 @@ uint8_t MPU6050_6Axis_MotionApps20::dmpGetYawPitchRoll(float *data, Quaternion *
 }
 #endif
 
+uint8_t MPU6050_6Axis_MotionApps20::dmpGetQuaternion(QuaternionQ14 *q, const uint8_t* packet) {
+    // TODO: accommodate different arrangements of sent data (ONLY default supported now)
+    if (packet == 0) packet = dmpPacketBuffer;
+    q -> w = (packet[0] << 8) | packet[1];
+    q -> x = (packet[4] << 8) | packet[5];
+    q -> y = (packet[8] << 8) | packet[9];
+    q -> z = (packet[12] << 8) | packet[13];
+    return 0;
+}
+
+uint8_t MPU6050_6Axis_MotionApps20::dmpGetGravity(VectorInt16 *v, QuaternionQ14 *q) {
+    /* same terms as dmpGetGravity(VectorFloat*), Q28 products scaled to +1g = 8192 */
+    v -> x = ((int32_t)q -> x*q -> z - (int32_t)q -> w*q -> y) >> 14;
+    v -> y = ((int32_t)q -> w*q -> x + (int32_t)q -> y*q -> z) >> 14;
+    v -> z = ((int32_t)q -> w*q -> w - (int32_t)q -> x*q -> x
+            - (int32_t)q -> y*q -> y + (int32_t)q -> z*q -> z) >> 15;
+    return 0;
+}
+
+uint8_t MPU6050_6Axis_MotionApps20::dmpGetLinearAccel(VectorInt16 *v, VectorInt16 *vRaw, VectorInt16 *gravity) {
+    // gravity is already in accel units, so this is a plain subtraction
+    v -> x = vRaw -> x - gravity -> x;
+    v -> y = vRaw -> y - gravity -> y;
+    v -> z = vRaw -> z - gravity -> z;
+    return 0;
+}
+
+uint8_t MPU6050_6Axis_MotionApps20::dmpGetLinearAccelInWorld(VectorInt16 *v, VectorInt16 *vReal, QuaternionQ14 *q) {
+    memcpy(v, vReal, sizeof(VectorInt16));
+    v -> rotate(q);
+    return 0;
+}
+
+uint8_t MPU6050_6Axis_MotionApps20::dmpGetYawPitchRoll(int16_t *data, QuaternionQ14 *q, VectorInt16 *gravity) {
+    // yaw: (about Z axis), both atan2 arguments in Q28
+    data[0] = fixedAtan2(2 * ((int32_t)q -> x*q -> y - (int32_t)q -> w*q -> z),
+                         2 * ((int32_t)q -> w*q -> w + (int32_t)q -> x*q -> x) - (1L << 28));
+    // pitch: (nose up/down, about Y axis)
+    data[1] = fixedAtan2(gravity -> x, fixedSqrt((int32_t)gravity -> y*gravity -> y + (int32_t)gravity -> z*gravity -> z));
+    // roll: (tilt left/right, about X axis)
+    data[2] = fixedAtan2(gravity -> y, gravity -> z);
+    if (gravity -> z < 0) {
+        if(data[1] > 0) {
+            data[1] = Q13_PI - data[1];
+        } else {
+            data[1] = -Q13_PI - data[1];
+        }
+    }
+    return 0;
+}
+
 // uint8_t MPU6050_6Axis_MotionApps20::dmpGetAccelFloat(float *data, const uint8_t* packet);
 // uint8_t MPU6050_6Axis_MotionApps20::dmpGetQuaternionFloat(float *data, const uint8_t* packet);
 
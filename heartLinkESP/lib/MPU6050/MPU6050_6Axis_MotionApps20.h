@@ -124,6 +124,14 @@ class MPU6050_6Axis_MotionApps20 : public MPU6050_Base {
         uint8_t dmpGetEuler(float *data, Quaternion *q);
         uint8_t dmpGetYawPitchRoll(float *data, Quaternion *q, VectorFloat *gravity);
 
+        // Get Fixed Point (Q14) derived data; no float, sqrt or libm trig per packet.
+        // Gravity uses the accel scale (+1g = 8192), angles are Q13 radians.
+        uint8_t dmpGetQuaternion(QuaternionQ14 *q, const uint8_t* packet=0);
+        uint8_t dmpGetGravity(VectorInt16 *v, QuaternionQ14 *q);
+        uint8_t dmpGetLinearAccel(VectorInt16 *v, VectorInt16 *vRaw, VectorInt16 *gravity);
+        uint8_t dmpGetLinearAccelInWorld(VectorInt16 *v, VectorInt16 *vReal, QuaternionQ14 *q);
+        uint8_t dmpGetYawPitchRoll(int16_t *data, QuaternionQ14 *q, VectorInt16 *gravity);
+
         // Get Floating Point data from FIFO
         uint8_t dmpGetAccelFloat(float *data, const uint8_t* packet=0);
         uint8_t dmpGetQuaternionFloat(float *data, const uint8_t* packet=0);
@@ -3,6 +3,7 @@
 // Updates should (hopefully) always be available at https://github.com/jrowberg/i2cdevlib
 //
 // Changelog:
+//     2026-10-18 - add Q14 fixed-point quaternion/vector math for the DMP pipeline
 //     2012-06-05 - add 3D math helper file to DMP6 example sketch
 
 /* ============================================
@@ -32,6 +33,54 @@ THE SOFTWARE.
 #ifndef _HELPER_3DMATH_H_
 #define _HELPER_3DMATH_H_
 
+// Fixed-point scales used by the integer DMP path. The DMP writes quaternion
+// components as Q30 words; their high halves (what dmpGetQuaternion(int16_t*)
+// returns) are Q14, so 1.0 == 16384. Angles are returned in Q13 radians so
+// that +/-PI still fits in an int16_t.
+#define Q14_ONE 16384
+#define Q13_PI 25736
+#define Q13_HALF_PI 12868
+
+// Integer square root (floor), bit-by-bit; no float, no divide.
+static inline uint32_t fixedSqrt(uint32_t v) {
+    uint32_t root = 0;
+    uint32_t bit = 1UL << 30;
+    while (bit > v) bit >>= 2;
+    while (bit != 0) {
+        if (v >= root + bit) {
+            v -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return root;
+}
+
+// atan2 approximation returning Q13 radians in [-PI, PI]. Inputs may be in any
+// (shared) scale. Uses atan(r) ~ PI/4*r + r*(1-r)*(0.2447 + 0.0663*r) on the
+// first octant, max error ~0.002 rad (0.1 deg), one divide per call.
+static inline int16_t fixedAtan2(int32_t y, int32_t x) {
+    if (x == 0 && y == 0) return 0;
+    uint32_t ax = x < 0 ? -(uint32_t)x : (uint32_t)x;
+    uint32_t ay = y < 0 ? -(uint32_t)y : (uint32_t)y;
+    // bring both under 16 bits so the Q15 ratio below cannot overflow
+    while ((ax | ay) > 0xFFFF) {
+        ax >>= 1;
+        ay >>= 1;
+    }
+    bool swap = ay > ax;
+    uint32_t num = swap ? ax : ay;
+    uint32_t den = swap ? ay : ax;
+    int32_t r = den ? (int32_t)((num << 15) / den) : 0; // Q15, 0..1
+    int32_t corr = (((r * (32768 - r)) >> 15) * (2005 + ((543 * r) >> 15))) >> 15;
+    int32_t angle = ((6434 * r) >> 15) + corr;        // Q13, 0..PI/4
+    if (swap) angle = Q13_HALF_PI - angle;
+    if (x < 0) angle = Q13_PI - angle;
+    return (int16_t)(y < 0 ? -angle : angle);
+}
+
 class Quaternion {
     public:
         float w;
@@ -89,6 +138,76 @@ class Quaternion {
         }
 };
 
+class QuaternionQ14 {
+    public:
+        int16_t w;
+        int16_t x;
+        int16_t y;
+        int16_t z;
+
+        QuaternionQ14() {
+            w = Q14_ONE;
+            x = 0;
+            y = 0;
+            z = 0;
+        }
+
+        QuaternionQ14(int16_t nw, int16_t nx, int16_t ny, int16_t nz) {
+            w = nw;
+            x = nx;
+            y = ny;
+            z = nz;
+        }
+
+        QuaternionQ14 getProduct(QuaternionQ14 q) {
+            // same terms as Quaternion::getProduct, Q14 * Q14 -> Q28 -> Q14
+            return QuaternionQ14(
+                (int16_t)(((int32_t)w*q.w - (int32_t)x*q.x - (int32_t)y*q.y - (int32_t)z*q.z) >> 14),
+                (int16_t)(((int32_t)w*q.x + (int32_t)x*q.w + (int32_t)y*q.z - (int32_t)z*q.y) >> 14),
+                (int16_t)(((int32_t)w*q.y - (int32_t)x*q.z + (int32_t)y*q.w + (int32_t)z*q.x) >> 14),
+                (int16_t)(((int32_t)w*q.z + (int32_t)x*q.y - (int32_t)y*q.x + (int32_t)z*q.w) >> 14));
+        }
+
+        QuaternionQ14 getConjugate() {
+            return QuaternionQ14(w, -x, -y, -z);
+        }
+
+        // squared magnitude in Q26 (1.0 == 1 << 26) so four int16 squares cannot overflow
+        uint32_t getMagnitudeSquared() {
+            return ((uint32_t)((int32_t)w*w) >> 2) + ((uint32_t)((int32_t)x*x) >> 2)
+                 + ((uint32_t)((int32_t)y*y) >> 2) + ((uint32_t)((int32_t)z*z) >> 2);
+        }
+
+        // Newton iterations on 1/sqrt(m), without sqrt or divide. m is first
+        // scaled by powers of 4 into [0.5, 2), where a straight line is within
+        // 15% of 1/sqrt(m); four iterations then reach Q14 precision for any
+        // non-zero quaternion. The scale comes back as a shift.
+        void normalize() {
+            uint32_t m = getMagnitudeSquared(); // Q26
+            if (m == 0) return;
+            int8_t shift = 14;
+            while (m >= (2UL << 26)) { m >>= 2; shift++; }
+            while (m < (1UL << 25)) { m <<= 2; shift--; }
+            int32_t mq = (int32_t)(m >> 12); // Q14, 0.5..2
+            int32_t inv = 27034 - (mq >> 1);  // 1.65 - m / 2
+            for (uint8_t i = 0; i < 4; i++) {
+                int32_t inv2 = (inv * inv) >> 14;
+                inv = (inv * ((3 * Q14_ONE - ((mq * inv2) >> 14)) >> 1)) >> 14;
+            }
+            // m >= 1 needs at most 13 steps up, so the shift stays positive
+            w = (int16_t)(((int32_t)w * inv) >> shift);
+            x = (int16_t)(((int32_t)x * inv) >> shift);
+            y = (int16_t)(((int32_t)y * inv) >> shift);
+            z = (int16_t)(((int32_t)z * inv) >> shift);
+        }
+
+        QuaternionQ14 getNormalized() {
+            QuaternionQ14 r(w, x, y, z);
+            r.normalize();
+            return r;
+        }
+};
+
 class VectorInt16 {
     public:
         int16_t x;
@@ -154,6 +273,33 @@ class VectorInt16 {
             r.rotate(q);
             return r;
         }
+
+        // sum of squares without the sqrt, for threshold comparisons
+        uint32_t getMagnitudeSquared() {
+            return (uint32_t)((int32_t)x*x) + (uint32_t)((int32_t)y*y) + (uint32_t)((int32_t)z*z);
+        }
+
+        void rotate(QuaternionQ14 *q) {
+            // P_out = q * P_in * conj(q), expanded as
+            // v' = v + w*t + (q_xyz x t) with t = 2*(q_xyz x v)
+            // which needs 15 multiplies instead of two full quaternion products.
+            // t is kept halved so the Q14 products below stay inside int32.
+            int32_t tx = ((int32_t)q -> y*z - (int32_t)q -> z*y) >> 14;
+            int32_t ty = ((int32_t)q -> z*x - (int32_t)q -> x*z) >> 14;
+            int32_t tz = ((int32_t)q -> x*y - (int32_t)q -> y*x) >> 14;
+            int32_t nx = x + ((q -> w*tx + q -> y*tz - q -> z*ty) >> 13);
+            int32_t ny = y + ((q -> w*ty + q -> z*tx - q -> x*tz) >> 13);
+            int32_t nz = z + ((q -> w*tz + q -> x*ty - q -> y*tx) >> 13);
+            x = (int16_t)nx;
+            y = (int16_t)ny;
+            z = (int16_t)nz;
+        }
+
+        VectorInt16 getRotated(QuaternionQ14 *q) {
+            VectorInt16 r(x, y, z);
+            r.rotate(q);
+            return r;
+        }
 };
 
 class VectorFloat {
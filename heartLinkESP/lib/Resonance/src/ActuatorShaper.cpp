@@ -0,0 +1,146 @@
+#include "ActuatorShaper.h"
+#include <cmath>
+
+ActuatorShaper::ActuatorShaper(const ActuatorModel &model, uint32_t sampleRate, float settleMs)
+    : mModel(model), mSampleRate(sampleRate ? sampleRate : MC_DEFAULT_SAMPLE_RATE), mSettleMs(settleMs > 0 ? settleMs : ACT_SETTLE_MS)
+{
+    update();
+}
+
+void ActuatorShaper::setModel(const ActuatorModel &model)
+{
+    mModel = model;
+    update();
+}
+
+void ActuatorShaper::update()
+{
+    float tauMs = mModel.timeConstantMs > 0 ? mModel.timeConstantMs : 1.0f;
+    float samples = tauMs * mSampleRate / 1000.0f;
+    mAlpha = 1.0f - expf(-1.0f / samples);
+    // the step that would settle in mSettleMs, relative to the actuator's own
+    float settle = 1.0f - expf(-1000.0f / (mSettleMs * mSampleRate));
+    mGain = settle / mAlpha;
+    if (mGain < 1.0f)
+        mGain = 1.0f;
+    if (mModel.ratedDrive <= 0.0f || mModel.ratedDrive > 1.0f)
+        mModel.ratedDrive = 1.0f;
+    mPhaseStep = mModel.type == ActuatorType::ERM ? 0 : (uint32_t)(mModel.resonantHz / mSampleRate * 4294967296.0f);
+}
+
+int16_t ActuatorShaper::step(float target, bool braking)
+{
+    // drive in units of the rated level; full scale is 1 / ratedDrive
+    float limit = 1.0f / mModel.ratedDrive;
+    float u = target;
+    if (mShaping)
+    {
+        u = mLevel + (target - mLevel) * mGain;
+        if (target == 0.0f && mLevel < ACT_BRAKE_FLOOR)
+            u = 0.0f;
+    }
+    float low = (mShaping && braking) ? -limit : 0.0f;
+    u = u > limit ? limit : (u < low ? low : u);
+    mLevel += (u - mLevel) * mAlpha;
+    if (target == 0.0f && mLevel < ACT_BRAKE_FLOOR && mLevel > -ACT_BRAKE_FLOOR && mShaping)
+        mLevel = 0.0f;
+
+    float out = u * mModel.ratedDrive * 255.0f;
+    if (mPhaseStep)
+    {
+        // square carrier; negative drive flips it, which brakes the resonance
+        if (mPhase & 0x80000000u)
+            out = -out;
+        mPhase += mPhaseStep;
+    }
+    return (int16_t)lrintf(out);
+}
+
+bool ActuatorShaper::play(const HapticCue &cue)
+{
+    if (cue.type != HapticCueType::PULSE && cue.type != HapticCueType::TICK)
+        return false;
+    pulse(cue.intensity, cue.durationMs);
+    return true;
+}
+
+void ActuatorShaper::pulse(float intensity, uint16_t durationMs)
+{
+    float level = intensity < 0.0f ? 0.0f : (intensity > 1.0f ? 1.0f : intensity);
+    uint32_t samples = (uint32_t)durationMs * mSampleRate / 1000;
+    if (samples > ACT_CUE_SAMPLES)
+        samples = ACT_CUE_SAMPLES;
+    // one word, so render() in the scheduler's task sees all of the cue or none
+    mCue.store((uint32_t)lrintf(level * 255.0f) << 24 | ACT_CUE_PENDING | samples, std::memory_order_release);
+}
+
+void ActuatorShaper::render(int16_t *drive, size_t count)
+{
+    render(drive, count, mBraking);
+}
+
+void ActuatorShaper::render(int16_t *drive, size_t count, bool braking)
+{
+    uint32_t cue = mCue.exchange(0, std::memory_order_acquire);
+    if (cue & ACT_CUE_PENDING)
+    {
+        mPulseLevel = (cue >> 24) / 255.0f;
+        mPulseSamples = cue & ACT_CUE_SAMPLES;
+    }
+    for (size_t i = 0; i < count; i++)
+    {
+        float target = 0.0f;
+        if (mPulseSamples)
+        {
+            target = mPulseLevel;
+            mPulseSamples--;
+        }
+        drive[i] = step(target, braking);
+    }
+}
+
+void ActuatorShaper::process(const uint8_t *target, int16_t *drive, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+        drive[i] = step(target[i] / 255.0f, mBraking);
+}
+
+void ActuatorShaper::toPins(const int16_t *drive, size_t count, ActuatorOutput output, uint8_t *pins, uint8_t *reverse)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        int16_t d = drive[i];
+        switch (output)
+        {
+        case ActuatorOutput::CENTERED:
+            pins[i] = (uint8_t)(128 + (d >= 0 ? (d * 127 + 127) / 255 : -((-d * 128 + 127) / 255)));
+            break;
+        case ActuatorOutput::BRIDGE:
+            pins[i] = d > 0 ? (uint8_t)d : 0;
+            if (reverse)
+                reverse[i] = d < 0 ? (uint8_t)-d : 0;
+            break;
+        case ActuatorOutput::UNIPOLAR:
+        default:
+            pins[i] = d > 0 ? (uint8_t)d : 0;
+            break;
+        }
+    }
+}
+
+McRenderFn ActuatorShaper::source(ActuatorOutput output)
+{
+    // a single pin can't reverse; the model must know the brake isn't applied
+    return [this, output](uint8_t *samples, size_t count) {
+        bool braking = mBraking && output != ActuatorOutput::UNIPOLAR;
+        int16_t drive[MC_BLOCK_SAMPLES];
+        while (count)
+        {
+            size_t n = count < MC_BLOCK_SAMPLES ? count : MC_BLOCK_SAMPLES;
+            render(drive, n, braking);
+            toPins(drive, n, output, samples);
+            samples += n;
+            count -= n;
+        }
+    };
+}
@@ -0,0 +1,186 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <Utilities/VHUtilities.h>
+#include "MultiChannelOutput.h"
+#include "HapticMapper.h"
+
+#define ACT_LRA_TAU_MS 25.0f   /*!< Q of about 12 at 160 Hz: tau = Q / (pi * f0) */
+#define ACT_ERM_TAU_MS 40.0f   /*!< Spin-up of a coin ERM */
+#define ACT_VC_TAU_MS 4.0f
+#define ACT_SETTLE_MS 2.0f     /*!< Time constant the shaped response aims for */
+#define ACT_BRAKE_FLOOR 0.02f  /*!< Modelled level below which braking stops */
+#define ACT_CUE_PENDING 0x00800000u  /*!< Cue slot: level << 24 | flag | samples */
+#define ACT_CUE_SAMPLES 0x007FFFFFu
+
+enum class ActuatorType : uint8_t
+{
+    LRA,        /*!< Driven with a carrier at its resonance */
+    ERM,        /*!< Driven with DC, the level sets the speed */
+    VOICE_COIL, /*!< Driven with a carrier, wide band */
+};
+
+/**
+ * @brief First-order model of an actuator's vibration level.
+ *
+ * The level follows the drive with timeConstantMs; for an LRA that is the
+ * envelope of its resonance, Q / (pi * resonantHz). ratedDrive is the part
+ * of full-scale drive the actuator is rated for, the rest is the headroom
+ * overdrive can use at full intensity.
+ */
+struct ActuatorModel
+{
+    ActuatorType type = ActuatorType::LRA;
+    float resonantHz = RESONANT_FREQ; /*!< Carrier frequency; unused for ERM */
+    float timeConstantMs = ACT_LRA_TAU_MS;
+    float ratedDrive = 1.0f;          /*!< 0-1 of full scale */
+
+    static ActuatorModel lra(float resonantHz = RESONANT_FREQ, float timeConstantMs = ACT_LRA_TAU_MS, float ratedDrive = 1.0f)
+    {
+        return {ActuatorType::LRA, resonantHz, timeConstantMs, ratedDrive};
+    }
+    static ActuatorModel erm(float timeConstantMs = ACT_ERM_TAU_MS, float ratedDrive = 1.0f)
+    {
+        return {ActuatorType::ERM, 0.0f, timeConstantMs, ratedDrive};
+    }
+    static ActuatorModel voiceCoil(float frequencyHz, float timeConstantMs = ACT_VC_TAU_MS, float ratedDrive = 1.0f)
+    {
+        return {ActuatorType::VOICE_COIL, frequencyHz, timeConstantMs, ratedDrive};
+    }
+};
+
+/**
+ * @brief How a signed drive block becomes pin values.
+ */
+enum class ActuatorOutput : uint8_t
+{
+    UNIPOLAR, /*!< Single pin, 0-255; negative drive (braking) becomes 0 */
+    CENTERED, /*!< Single pin through an amplifier, 128 = rest */
+    BRIDGE,   /*!< Two pins of an H-bridge, forward and reverse duty */
+};
+
+/**
+ * @brief Overdrive and active braking for one channel.
+ *
+ * A plain PULSE or TICK switches the drive to its level and back to 0, so
+ * the actuator follows with its own time constant: an LRA takes tens of ms
+ * to build up and as long to ring out. This stage runs a first-order
+ * ActuatorModel of the channel next to the output and drives so that the
+ * modelled level reaches the target in about settleMs instead:
+ *
+ *     drive = level + (target - level) * tau / settle, clamped to full scale
+ *
+ * At an onset that is full drive (overdrive, up to 1 / ratedDrive of the
+ * rated level) until the level is close, then the target itself; at an
+ * offset it is full reverse drive (braking: antiphase carrier for LRA and
+ * voice coil, reverse polarity for ERM) until the level drops below
+ * ACT_BRAKE_FLOOR. The model integrates the clamped drive, so it stays
+ * right when the headroom runs out. With braking off (single-pin ERM) the
+ * reverse part is clamped to 0 and the model coasts.
+ *
+ * The output is signed, -255..255 per sample: the envelope times a square
+ * carrier at resonantHz for LRA and voice coil, the envelope alone for
+ * ERM. toPins() turns it into pin values for the wiring in use; with
+ * ActuatorOutput::BRIDGE the two values go to writeDualPin() or to two
+ * MultiChannelOutput channels.
+ *
+ * @code {.cpp}
+ * ActuatorShaper shaper(ActuatorModel::lra(170, 25, 0.6f), 8000);
+ * scheduler.addSource(0, shaper.source(ActuatorOutput::CENTERED));
+ * ...
+ * shaper.play(cue); // HapticCueType::PULSE or TICK from HapticMapper
+ * @endcode
+ */
+class ActuatorShaper
+{
+    ActuatorModel mModel;
+    uint32_t mSampleRate;
+    float mSettleMs;
+    float mAlpha = 1.0f;     /*!< Per-sample step of the model */
+    float mGain = 1.0f;      /*!< tau / settle */
+    float mLevel = 0.0f;     /*!< Modelled level, 1 = rated */
+    uint32_t mPhase = 0;
+    uint32_t mPhaseStep = 0;
+    bool mShaping = true;
+    bool mBraking = true;
+    // pulse played by play() / pulse(): handed over in mCue, owned by render()
+    std::atomic<uint32_t> mCue{0};
+    float mPulseLevel = 0.0f;
+    uint32_t mPulseSamples = 0;
+
+    void update();
+    int16_t step(float target, bool braking);
+    void render(int16_t *drive, size_t count, bool braking);
+
+public:
+    /**
+     * @brief Construct a new shaper.
+     *
+     * @param model Actuator on the channel.
+     * @param sampleRate Rate of the output, in Hz.
+     * @param settleMs Time constant the shaped response aims for.
+     */
+    explicit ActuatorShaper(const ActuatorModel &model = ActuatorModel(), uint32_t sampleRate = MC_DEFAULT_SAMPLE_RATE,
+                            float settleMs = ACT_SETTLE_MS);
+
+    void setModel(const ActuatorModel &model);
+    const ActuatorModel &getModel() const { return mModel; }
+    /**
+     * @brief Turn overdrive and braking off to drive the target directly,
+     * e.g. to compare.
+     */
+    void setShaping(bool enable) { mShaping = enable; }
+    /**
+     * @brief Allow reverse drive; off for wiring that can't reverse (a
+     * single-pin ERM).
+     */
+    void setBraking(bool enable) { mBraking = enable; }
+    /**
+     * @brief Modelled vibration level, 1 = rated.
+     */
+    float getLevel() const { return mLevel; }
+
+    /**
+     * @brief Start a PULSE or TICK cue: its intensity for durationMs. May be
+     * called from another task than the one rendering; the cue starts with
+     * the next render().
+     *
+     * @return bool false for other cue types.
+     */
+    bool play(const HapticCue &cue);
+    /**
+     * @brief Start a rectangular pulse, replacing the current one; like play().
+     *
+     * @param intensity 0-1 of the rated level, in steps of 1/255.
+     */
+    void pulse(float intensity, uint16_t durationMs);
+
+    /**
+     * @brief Render the pulses started with play() or pulse().
+     *
+     * @param drive Signed drive, -255..255.
+     */
+    void render(int16_t *drive, size_t count);
+    /**
+     * @brief Shape an envelope from another source.
+     *
+     * @param target Wanted level per sample, 255 = rated.
+     * @param drive Signed drive, -255..255.
+     */
+    void process(const uint8_t *target, int16_t *drive, size_t count);
+
+    /**
+     * @brief Pin values for a drive block.
+     *
+     * @param reverse BRIDGE only: receives the reverse duty; pins gets the forward duty.
+     */
+    static void toPins(const int16_t *drive, size_t count, ActuatorOutput output, uint8_t *pins, uint8_t *reverse = nullptr);
+    /**
+     * @brief Render source for RenderScheduler or MultiChannelOutput that
+     * plays the pulses through toPins(); UNIPOLAR (ERM, rendered without
+     * braking whatever setBraking() says) or CENTERED (LRA or voice coil
+     * through an amplifier).
+     */
+    McRenderFn source(ActuatorOutput output = ActuatorOutput::CENTERED);
+};
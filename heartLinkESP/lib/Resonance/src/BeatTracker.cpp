@@ -0,0 +1,365 @@
+#include "BeatTracker.h"
+
+/* log2(x) in Q8 with a linear mantissa, x >= 1 */
+static int32_t log2Q8(uint32_t x)
+{
+    int32_t n = 31 - __builtin_clz(x);
+    uint32_t frac = n >= 8 ? (x >> (n - 8)) : (x << (8 - n));
+    return (n << 8) + (int32_t)(frac & 0xff);
+}
+
+static uint16_t saturate16(uint32_t v)
+{
+    return v > UINT16_MAX ? UINT16_MAX : (uint16_t)v;
+}
+
+BeatTracker::BeatTracker(uint32_t sampleRate, uint8_t channels)
+{
+    setFormat(sampleRate, channels);
+}
+
+void BeatTracker::setFormat(uint32_t sampleRate, uint8_t channels)
+{
+    mSampleRate = sampleRate ? sampleRate : BEAT_DEFAULT_SAMPLE_RATE;
+    mChannels = channels ? channels : 1;
+    mHopSamples = mSampleRate * BEAT_HOP_MS / 1000;
+    mBassFilter.setLowPass((float)mSampleRate / BEAT_BASS_DECIMATION, BEAT_BASS_CUTOFF);
+    mTickFilter.setHighPass((float)mSampleRate, BEAT_TICK_CUTOFF);
+
+    // log-Gaussian tempo prior, one octave wide, centred on BEAT_PREFERRED_BPM
+    mMinLag = 60000 / (BEAT_MAX_BPM * BEAT_HOP_MS);
+    mMaxLag = 60000 / (BEAT_MIN_BPM * BEAT_HOP_MS);
+    const float preferred = 60000.0f / (BEAT_PREFERRED_BPM * BEAT_HOP_MS);
+    for (uint16_t lag = mMinLag; lag <= mMaxLag; lag++)
+    {
+        float octaves = log2f(lag / preferred);
+        mLagWeight[lag - mMinLag] = (int16_t)lrintf(256.0f * expf(-0.5f * octaves * octaves));
+    }
+    reset();
+}
+
+void BeatTracker::reset()
+{
+    mBassFilter.reset();
+    mTickFilter.reset();
+    mHopCount = 0;
+    mDecimSum = 0;
+    mDecimCount = 0;
+    mBassSum = mTickSum = 0;
+    mBassCount = 0;
+    mHop = 0;
+    mBassEnv = mTickEnv = 0;
+    mBassPeak = mTickPeak = 0;
+    mBassLog = mTickLog = 0;
+    mBassOdf[0] = mBassOdf[1] = mTickOdf[0] = mTickOdf[1] = 0;
+    mBassOdfMean = mTickOdfMean = 0;
+    mBassOnsetLevel = 0;
+    mLastBassOnset = mLastTickOnset = 0;
+    mHaveBassOnset = mHaveTickOnset = false;
+    mHistoryPos = mHistoryCount = 0;
+    mPeriodQ4 = 0;
+    mLocked = false;
+    mBeatQ4 = mMatchedQ4 = 0;
+    mBusyUs = mAudioUs = 0;
+    mStats = BeatTrackerStats();
+}
+
+size_t BeatTracker::process(const int16_t *samples, size_t frames, HapticCue *cues, size_t maxCues)
+{
+    unsigned long start = mClock ? mClock() : 0;
+    mCues = cues;
+    mCueCount = 0;
+    mMaxCues = cues ? maxCues : 0;
+
+    for (size_t i = 0; i < frames; i++)
+    {
+        const int16_t *frame = samples + i * mChannels;
+        int32_t mono = mChannels > 1 ? (frame[0] + frame[1]) >> 1 : frame[0];
+        int32_t tick = mTickFilter.process(mono);
+        mTickSum += tick < 0 ? -tick : tick;
+        mDecimSum += mono;
+        if (++mDecimCount == BEAT_BASS_DECIMATION)
+        {
+            int32_t bass = mBassFilter.process(mDecimSum / BEAT_BASS_DECIMATION);
+            mBassSum += bass < 0 ? -bass : bass;
+            mBassCount++;
+            mDecimSum = 0;
+            mDecimCount = 0;
+        }
+        if (++mHopCount == mHopSamples)
+            endHop();
+    }
+
+    // predicted beats and reactive onsets interleave; hand them out in start order
+    for (size_t i = 1; i < mCueCount; i++)
+    {
+        HapticCue cue = cues[i];
+        size_t j = i;
+        while (j > 0 && (int32_t)(cues[j - 1].startMs - cue.startMs) > 0)
+        {
+            cues[j] = cues[j - 1];
+            j--;
+        }
+        cues[j] = cue;
+    }
+
+    if (mClock && frames)
+    {
+        uint32_t us = (uint32_t)(mClock() - start);
+        mStats.lastBlockUs = us;
+        if (us > mStats.maxBlockUs)
+            mStats.maxBlockUs = us;
+        mStats.blocks++;
+        mBusyUs += us;
+        mAudioUs += (uint64_t)frames * 1000000 / mSampleRate;
+        mStats.loadPermille = mAudioUs ? saturate16((uint32_t)(mBusyUs * 1000 / mAudioUs)) : 0;
+    }
+    mCues = nullptr;
+    return mCueCount;
+}
+
+void BeatTracker::endHop()
+{
+    mBassEnv = mBassCount ? saturate16(mBassSum / mBassCount) : 0;
+    mTickEnv = saturate16(mTickSum / mHopSamples);
+    mHopCount = 0;
+    mBassSum = mTickSum = 0;
+    mBassCount = 0;
+
+    // decaying peaks (~1.3 s) scale the cue intensities
+    mBassPeak -= mBassPeak >> 7;
+    if (mBassEnv > mBassPeak)
+        mBassPeak = mBassEnv;
+    mTickPeak -= mTickPeak >> 7;
+    if (mTickEnv > mTickPeak)
+        mTickPeak = mTickEnv;
+
+    // onset functions: rise of the log level, muted in near silence
+    int32_t bassLog = log2Q8((uint32_t)mBassEnv + 1);
+    int32_t tickLog = log2Q8((uint32_t)mTickEnv + 1);
+    int32_t bassOdf = mBassEnv >= BEAT_MIN_LEVEL && bassLog > mBassLog ? bassLog - mBassLog : 0;
+    int32_t tickOdf = mTickEnv >= BEAT_MIN_LEVEL && tickLog > mTickLog ? tickLog - mTickLog : 0;
+    mBassLog = bassLog;
+    mTickLog = tickLog;
+
+    mHistory[mHistoryPos] = (int16_t)(bassOdf > INT16_MAX ? INT16_MAX : bassOdf);
+    mHistoryPos = (mHistoryPos + 1) % BEAT_HISTORY_HOPS;
+    if (mHistoryCount < BEAT_HISTORY_HOPS)
+        mHistoryCount++;
+
+    // the previous hop is an onset if it is a local maximum above threshold
+    const uint32_t bassRefractory = BEAT_BASS_REFRACTORY_MS / BEAT_HOP_MS;
+    const uint32_t tickRefractory = BEAT_TICK_REFRACTORY_MS / BEAT_HOP_MS;
+    uint32_t candidate = mHop - 1;
+    if (mBassOdf[0] > mBassOdf[1] && mBassOdf[0] >= bassOdf &&
+        mBassOdf[0] > (mBassOdfMean >> 4) + BEAT_ONSET_DELTA_Q8 &&
+        (!mHaveBassOnset || candidate - mLastBassOnset >= bassRefractory))
+    {
+        mHaveBassOnset = true;
+        mLastBassOnset = candidate;
+        onBassOnset(candidate, mBassEnv);
+    }
+    if (mTickOdf[0] > mTickOdf[1] && mTickOdf[0] >= tickOdf &&
+        mTickOdf[0] > (mTickOdfMean >> 4) + BEAT_ONSET_DELTA_Q8 &&
+        (!mHaveTickOnset || candidate - mLastTickOnset >= tickRefractory))
+    {
+        mHaveTickOnset = true;
+        mLastTickOnset = candidate;
+        onTickOnset(candidate);
+    }
+    mBassOdf[1] = mBassOdf[0];
+    mBassOdf[0] = bassOdf;
+    mTickOdf[1] = mTickOdf[0];
+    mTickOdf[0] = tickOdf;
+    mBassOdfMean += ((bassOdf << 4) - mBassOdfMean) >> BEAT_ONSET_MEAN_SHIFT;
+    mTickOdfMean += ((tickOdf << 4) - mTickOdfMean) >> BEAT_ONSET_MEAN_SHIFT;
+
+    mHop++;
+    if (mHop % BEAT_TEMPO_UPDATE_HOPS == 0)
+        updateTempo();
+    scheduleBeats();
+}
+
+void BeatTracker::updateTempo()
+{
+    if (mHistoryCount < BEAT_HISTORY_HOPS)
+        return;
+
+    // oldest first, mean removed
+    int16_t x[BEAT_HISTORY_HOPS];
+    int32_t sum = 0;
+    for (uint16_t i = 0; i < BEAT_HISTORY_HOPS; i++)
+        sum += mHistory[(mHistoryPos + i) % BEAT_HISTORY_HOPS];
+    int32_t mean = sum / BEAT_HISTORY_HOPS;
+    int64_t energy = 0;
+    for (uint16_t i = 0; i < BEAT_HISTORY_HOPS; i++)
+    {
+        x[i] = (int16_t)(mHistory[(mHistoryPos + i) % BEAT_HISTORY_HOPS] - mean);
+        energy += (int32_t)x[i] * x[i];
+    }
+    if (energy == 0)
+        return;
+
+    auto acf = [&x](uint16_t lag) {
+        int64_t acc = 0;
+        for (uint16_t i = lag; i < BEAT_HISTORY_HOPS; i++)
+            acc += (int32_t)x[i] * x[i - lag];
+        return acc;
+    };
+
+    int64_t bestScore = 0, best = 0;
+    uint16_t bestLag = 0;
+    for (uint16_t lag = mMinLag; lag <= mMaxLag; lag++)
+    {
+        int64_t a = acf(lag);
+        int64_t score = a * mLagWeight[lag - mMinLag];
+        if (score > bestScore)
+        {
+            bestScore = score;
+            best = a;
+            bestLag = lag;
+        }
+    }
+    if (!bestLag || best * 256 < energy * BEAT_MIN_CONFIDENCE_Q8)
+        return;
+
+    // parabolic interpolation of the peak, in 1/16 hop
+    int64_t before = acf(bestLag - 1), after = acf(bestLag + 1);
+    int64_t curvature = before - 2 * best + after;
+    int32_t offsetQ4 = 0;
+    if (curvature < 0)
+    {
+        offsetQ4 = (int32_t)((before - after) * 8 / curvature);
+        if (offsetQ4 > 8)
+            offsetQ4 = 8;
+        if (offsetQ4 < -8)
+            offsetQ4 = -8;
+    }
+    mPeriodQ4 = ((uint32_t)bestLag << 4) + offsetQ4;
+
+    // phase: comb over the onset history, the newest entry is hop mHop - 1
+    int32_t bestComb = -1;
+    uint16_t bestPhase = 0;
+    for (uint16_t phase = 0; phase < bestLag; phase++)
+    {
+        int32_t comb = 0;
+        for (uint32_t offsetQ4 = (uint32_t)phase << 4; (offsetQ4 >> 4) < BEAT_HISTORY_HOPS; offsetQ4 += mPeriodQ4)
+            comb += x[BEAT_HISTORY_HOPS - 1 - (offsetQ4 >> 4)];
+        if (comb > bestComb)
+        {
+            bestComb = comb;
+            bestPhase = phase;
+        }
+    }
+    uint32_t beatQ4 = (mHop - 1 - bestPhase) << 4;
+    uint32_t nowQ4 = mHop << 4;
+    if (!mLocked)
+    {
+        // resume on the grid without handing out beats that are already past
+        mLocked = true;
+        mBeatQ4 = beatQ4;
+        while ((int32_t)(mBeatQ4 + mPeriodQ4 - nowQ4) < 0)
+            mBeatQ4 += mPeriodQ4;
+        mMatchedQ4 = nowQ4;
+        return;
+    }
+    // locked on the wrong phase (e.g. the off-beats): jump to the comb's
+    int32_t err = wrapToPeriod((int32_t)(beatQ4 - mBeatQ4));
+    if ((err < 0 ? -err : err) > (int32_t)mPeriodQ4 / 4)
+        mBeatQ4 += err;
+}
+
+int32_t BeatTracker::wrapToPeriod(int32_t deltaQ4) const
+{
+    int32_t period = (int32_t)mPeriodQ4;
+    int32_t err = deltaQ4 % period;
+    if (err > period / 2)
+        err -= period;
+    if (err < -period / 2)
+        err += period;
+    return err;
+}
+
+void BeatTracker::onBassOnset(uint32_t hop, uint16_t level)
+{
+    uint32_t timeQ4 = hop << 4;
+    mBassOnsetLevel = level;
+    if (mLocked)
+    {
+        // error against the nearest predicted beat
+        int32_t err = wrapToPeriod((int32_t)(timeQ4 - mBeatQ4));
+        if ((err < 0 ? -err : err) <= (int32_t)mPeriodQ4 / 4)
+        {
+            mBeatQ4 += err / (1 << BEAT_PHASE_GAIN_SHIFT);
+            mMatchedQ4 = timeQ4;
+        }
+        return;
+    }
+    emit(HapticCueType::PULSE, timeQ4, intensity(level, mBassPeak));
+}
+
+void BeatTracker::onTickOnset(uint32_t hop)
+{
+    uint32_t timeQ4 = hop << 4;
+    const int32_t guardQ4 = (BEAT_TICK_GUARD_MS << 4) / BEAT_HOP_MS;
+    int32_t distance;
+    if (mLocked)
+        distance = wrapToPeriod((int32_t)(timeQ4 - mBeatQ4));
+    else
+    {
+        distance = mHaveBassOnset ? (int32_t)(timeQ4 - (mLastBassOnset << 4)) : guardQ4;
+    }
+    if ((distance < 0 ? -distance : distance) < guardQ4)
+        return;
+    emit(HapticCueType::TICK, timeQ4, intensity(mTickEnv, mTickPeak));
+}
+
+void BeatTracker::scheduleBeats()
+{
+    if (!mLocked)
+        return;
+    uint32_t nowQ4 = mHop << 4;
+    if (nowQ4 - mMatchedQ4 > ((uint32_t)BEAT_HOLD_MS << 4) / BEAT_HOP_MS)
+    {
+        mLocked = false;
+        return;
+    }
+    const uint32_t lookaheadQ4 = ((uint32_t)BEAT_LOOKAHEAD_MS << 4) / BEAT_HOP_MS;
+    while ((int32_t)(mBeatQ4 + mPeriodQ4 - (nowQ4 + lookaheadQ4)) <= 0)
+    {
+        mBeatQ4 += mPeriodQ4;
+        emit(HapticCueType::PULSE, mBeatQ4, intensity(mBassOnsetLevel, mBassPeak));
+    }
+}
+
+float BeatTracker::intensity(uint16_t level, uint16_t peak)
+{
+    float relative = peak ? (float)level / peak : 1.0f;
+    if (relative > 1)
+        relative = 1;
+    return BEAT_MIN_INTENSITY + (1.0f - BEAT_MIN_INTENSITY) * relative;
+}
+
+void BeatTracker::emit(HapticCueType type, uint32_t timeQ4, float intensity)
+{
+    if (mCueCount >= mMaxCues)
+    {
+        mStats.droppedCues++;
+        return;
+    }
+    HapticCue &cue = mCues[mCueCount++];
+    cue = HapticCue();
+    cue.type = type;
+    cue.startMs = q4ToMs(timeQ4);
+    cue.intensity = intensity;
+    if (type == HapticCueType::TICK)
+    {
+        cue.durationMs = BEAT_TICK_MS;
+        cue.sharpness = BEAT_TICK_SHARPNESS;
+    }
+    else
+    {
+        cue.durationMs = BEAT_PULSE_MS;
+        cue.sharpness = BEAT_PULSE_SHARPNESS;
+    }
+}
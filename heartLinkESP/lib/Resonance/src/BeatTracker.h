@@ -0,0 +1,199 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include "BiquadFilter.h"
+#include "HapticMapper.h"
+
+#define BEAT_DEFAULT_SAMPLE_RATE 44100
+#define BEAT_DEFAULT_CHANNELS 2
+#define BEAT_HOP_MS 10              /*!< Analysis hop; envelopes and onsets run at this rate */
+#define BEAT_BASS_DECIMATION 8      /*!< Box-car decimation in front of the bass low-pass */
+#define BEAT_BASS_CUTOFF 150.0f     /*!< Kick / bass band */
+#define BEAT_TICK_CUTOFF 3000.0f    /*!< High-pass for hi-hat / snare transients */
+#define BEAT_MIN_LEVEL 32           /*!< Band level below which the onset function is muted */
+#define BEAT_ONSET_DELTA_Q8 96      /*!< Minimum rise of log2 level per hop, 1/256 octave (~2.3 dB) */
+#define BEAT_ONSET_MEAN_SHIFT 5     /*!< Onset function mean EWMA weight 1/2^n per hop */
+#define BEAT_BASS_REFRACTORY_MS 150
+#define BEAT_TICK_REFRACTORY_MS 60
+#define BEAT_MIN_BPM 60
+#define BEAT_MAX_BPM 180
+#define BEAT_HISTORY_HOPS 256       /*!< Onset function history for the tempo estimate */
+#define BEAT_TEMPO_UPDATE_HOPS 32
+#define BEAT_PREFERRED_BPM 120      /*!< Centre of the tempo prior, against octave errors */
+#define BEAT_MIN_CONFIDENCE_Q8 40   /*!< Autocorrelation peak over energy needed to lock */
+#define BEAT_PHASE_GAIN_SHIFT 1     /*!< Phase correction 1/2^n of the onset error per beat */
+#define BEAT_HOLD_MS 2500           /*!< Keep predicting beats this long without a matching onset */
+#define BEAT_LOOKAHEAD_MS 100       /*!< Predicted beats are handed out this far ahead */
+#define BEAT_TICK_GUARD_MS 50       /*!< Transients this close to a beat don't get their own TICK */
+#define BEAT_PULSE_MS 40
+#define BEAT_TICK_MS 12
+#define BEAT_MIN_INTENSITY 0.3f
+#define BEAT_PULSE_SHARPNESS 0.4f
+#define BEAT_TICK_SHARPNESS 1.0f
+#define BEAT_MAX_LAGS ((60000 / (BEAT_MIN_BPM * BEAT_HOP_MS)) - (60000 / (BEAT_MAX_BPM * BEAT_HOP_MS)) + 1)
+
+/**
+ * @brief CPU cost of BeatTracker::process(), measured with the clock given
+ * to BeatTracker::setClock().
+ */
+struct BeatTrackerStats
+{
+    uint32_t lastBlockUs = 0;
+    uint32_t maxBlockUs = 0;
+    uint32_t blocks = 0;
+    uint16_t loadPermille = 0; /*!< Processing time over audio time, averaged over blocks */
+    uint32_t droppedCues = 0;  /*!< Cues that didn't fit the caller's array */
+};
+
+/**
+ * @brief Turns a PCM music stream into beat-synchronous PULSE and TICK cues.
+ *
+ * Works on whole blocks as they come from the A2DP stream reader, instead of
+ * the per-sample AudioStreaming::setAudioDSP() hook. The mono mix is split
+ * into a bass band (box-car decimated by BEAT_BASS_DECIMATION, then a
+ * BEAT_BASS_CUTOFF low-pass) and a transient band (BEAT_TICK_CUTOFF
+ * high-pass) with the fixed-point BiquadFilter. Every BEAT_HOP_MS the mean
+ * rectified level of each band gives the envelopes, and the rise of their
+ * log2 gives an onset function; local maxima above its running mean plus
+ * BEAT_ONSET_DELTA_Q8 are onsets.
+ *
+ * The tempo comes from the autocorrelation of the bass onset function over
+ * the last BEAT_HISTORY_HOPS, weighted towards BEAT_PREFERRED_BPM, and the
+ * beat phase from a comb over the same history. Once both are known, beats
+ * are predicted from the last beat plus the period and handed out
+ * BEAT_LOOKAHEAD_MS early as PULSE cues, so they can land on the beat; each
+ * bass onset near a prediction pulls the phase towards it. Until then, and
+ * after BEAT_HOLD_MS without a matching onset, bass onsets are passed on
+ * directly. Transient onsets away from the beats become TICK cues.
+ *
+ * All memory is fixed, the per-sample path is integer only, and time comes
+ * from the sample count (cue times are on that clock), so WAV files can be
+ * run through it on the host with the same results as on the board.
+ *
+ * @code {.cpp}
+ * BeatTracker beats(44100, 2);
+ * beats.setClock(micros);
+ * void onAudio(const uint8_t *data, uint32_t length) {
+ *     HapticCue cues[HAPTIC_MAX_CUES];
+ *     size_t n = beats.process((const int16_t *)data, length / 4, cues, HAPTIC_MAX_CUES);
+ *     uint32_t offset = millis() - beats.getTimeMs();
+ *     for (size_t i = 0; i < n; i++)
+ *         cues[i].startMs += offset;
+ *     output.submit(cues, n, millis());
+ * }
+ * a2dp_sink.set_stream_reader(onAudio, false);
+ * @endcode
+ */
+class BeatTracker
+{
+    uint32_t mSampleRate;
+    uint8_t mChannels;
+    uint32_t mHopSamples;
+    BiquadFilter mBassFilter, mTickFilter;
+    unsigned long (*mClock)() = nullptr;
+    uint64_t mBusyUs = 0, mAudioUs = 0;
+    BeatTrackerStats mStats;
+
+    // per hop accumulation
+    uint32_t mHopCount = 0;
+    int32_t mDecimSum = 0;
+    uint8_t mDecimCount = 0;
+    uint32_t mBassSum = 0;
+    uint16_t mBassCount = 0;
+    uint32_t mTickSum = 0;
+    uint32_t mHop = 0; /*!< Hops since reset; the analysis clock */
+
+    // envelopes and onset functions
+    uint16_t mBassEnv = 0, mTickEnv = 0;
+    uint16_t mBassPeak = 0, mTickPeak = 0; /*!< Decaying peaks of the envelopes, for intensity */
+    int32_t mBassLog = 0, mTickLog = 0;
+    int32_t mBassOdf[2] = {0, 0}, mTickOdf[2] = {0, 0}; /*!< Previous two, newest first */
+    int32_t mBassOdfMean = 0, mTickOdfMean = 0;
+    uint16_t mBassOnsetLevel = 0;
+    uint32_t mLastBassOnset = 0, mLastTickOnset = 0;
+    bool mHaveBassOnset = false, mHaveTickOnset = false;
+
+    // tempo
+    int16_t mHistory[BEAT_HISTORY_HOPS];
+    uint16_t mHistoryPos = 0;
+    uint16_t mHistoryCount = 0;
+    int16_t mLagWeight[BEAT_MAX_LAGS];
+    uint16_t mMinLag = 0, mMaxLag = 0;
+    uint32_t mPeriodQ4 = 0; /*!< Beat period in 1/16 hop, 0 while unknown */
+
+    // beat phase, in 1/16 hop
+    bool mLocked = false;
+    uint32_t mBeatQ4 = 0;      /*!< Last handed out beat */
+    uint32_t mMatchedQ4 = 0;   /*!< Last beat confirmed by an onset */
+
+    HapticCue *mCues = nullptr;
+    size_t mCueCount = 0, mMaxCues = 0;
+
+    void endHop();
+    void updateTempo();
+    void onBassOnset(uint32_t hop, uint16_t level);
+    void onTickOnset(uint32_t hop);
+    void scheduleBeats();
+    int32_t wrapToPeriod(int32_t deltaQ4) const;
+    void emit(HapticCueType type, uint32_t timeQ4, float intensity);
+    static float intensity(uint16_t level, uint16_t peak);
+    uint32_t q4ToMs(uint32_t q4) const { return (uint32_t)(((uint64_t)q4 * BEAT_HOP_MS) >> 4); }
+
+public:
+    /**
+     * @brief Construct a new tracker.
+     *
+     * @param sampleRate Sample rate of the PCM stream in Hz.
+     * @param channels Interleaved channels per frame.
+     */
+    explicit BeatTracker(uint32_t sampleRate = BEAT_DEFAULT_SAMPLE_RATE,
+                         uint8_t channels = BEAT_DEFAULT_CHANNELS);
+    /**
+     * @brief Change the stream format; restarts the analysis.
+     *
+     * @param sampleRate Sample rate of the PCM stream in Hz.
+     * @param channels Interleaved channels per frame.
+     */
+    void setFormat(uint32_t sampleRate, uint8_t channels);
+    /**
+     * @brief Forget tempo, phase, envelopes and the sample clock.
+     */
+    void reset();
+    /**
+     * @brief Set the microsecond clock used for the CPU time statistics.
+     *
+     * @param clock e.g. Arduino's micros(); nullptr disables the measurement.
+     */
+    void setClock(unsigned long (*clock)()) { mClock = clock; }
+    /**
+     * @brief Analyse one block of interleaved 16 bit PCM.
+     *
+     * @param samples Interleaved samples.
+     * @param frames Number of frames (samples / channels).
+     * @param cues Output array for the cues that became due in this block.
+     * @param maxCues Capacity of the array; extra cues are dropped and counted.
+     * @return size_t Number of cues written, in start order.
+     */
+    size_t process(const int16_t *samples, size_t frames, HapticCue *cues, size_t maxCues);
+    /**
+     * @brief Current time on the sample clock, in ms.
+     */
+    uint32_t getTimeMs() const { return mHop * BEAT_HOP_MS + (uint32_t)((uint64_t)mHopCount * 1000 / mSampleRate); }
+    /**
+     * @brief Tempo in beats per minute, 0 while unknown.
+     */
+    uint16_t getBpm() const { return mPeriodQ4 ? (uint16_t)((60000UL * 16 / BEAT_HOP_MS + mPeriodQ4 / 2) / mPeriodQ4) : 0; }
+    /**
+     * @brief true while beats are predicted from the tempo.
+     */
+    bool isLocked() const { return mLocked; }
+    /**
+     * @brief Mean rectified bass level of the last hop, in PCM counts.
+     */
+    uint16_t getBassEnvelope() const { return mBassEnv; }
+    /**
+     * @brief Mean rectified transient level of the last hop, in PCM counts.
+     */
+    uint16_t getTickEnvelope() const { return mTickEnv; }
+    const BeatTrackerStats &getStats() const { return mStats; }
+};
@@ -0,0 +1,101 @@
+#pragma once
+#include <cstdint>
+#include <cmath>
+
+/**
+ * @brief Second-order IIR section in fixed point.
+ *
+ * Coefficients are computed once in float (RBJ cookbook) and stored as Q28;
+ * per-sample filtering is integer only, Direct Form I with a 64-bit
+ * accumulator so low cutoffs relative to the sample rate stay stable.
+ */
+class BiquadFilter
+{
+    static constexpr int COEF_SHIFT = 28;
+    int32_t mB0 = 1L << COEF_SHIFT, mB1 = 0, mB2 = 0, mA1 = 0, mA2 = 0;
+    int32_t mX1 = 0, mX2 = 0, mY1 = 0, mY2 = 0;
+
+    void setCoefficients(float b0, float b1, float b2, float a0, float a1, float a2)
+    {
+        const float scale = (float)(1L << COEF_SHIFT) / a0;
+        mB0 = (int32_t)lrintf(b0 * scale);
+        mB1 = (int32_t)lrintf(b1 * scale);
+        mB2 = (int32_t)lrintf(b2 * scale);
+        mA1 = (int32_t)lrintf(a1 * scale);
+        mA2 = (int32_t)lrintf(a2 * scale);
+        reset();
+    }
+
+public:
+    /**
+     * @brief Configure as a low-pass filter.
+     *
+     * @param sampleRate Sample rate in Hz.
+     * @param cutoff Cutoff frequency in Hz.
+     * @param q Quality factor, 0.7071 for Butterworth.
+     */
+    void setLowPass(float sampleRate, float cutoff, float q = 0.7071f)
+    {
+        const float w0 = 2.0f * (float)M_PI * cutoff / sampleRate;
+        const float alpha = sinf(w0) / (2.0f * q);
+        const float c = cosf(w0);
+        setCoefficients((1.0f - c) / 2.0f, 1.0f - c, (1.0f - c) / 2.0f,
+                        1.0f + alpha, -2.0f * c, 1.0f - alpha);
+    }
+
+    /**
+     * @brief Configure as a high-pass filter.
+     *
+     * @param sampleRate Sample rate in Hz.
+     * @param cutoff Cutoff frequency in Hz.
+     * @param q Quality factor, 0.7071 for Butterworth.
+     */
+    void setHighPass(float sampleRate, float cutoff, float q = 0.7071f)
+    {
+        const float w0 = 2.0f * (float)M_PI * cutoff / sampleRate;
+        const float alpha = sinf(w0) / (2.0f * q);
+        const float c = cosf(w0);
+        setCoefficients((1.0f + c) / 2.0f, -(1.0f + c), (1.0f + c) / 2.0f,
+                        1.0f + alpha, -2.0f * c, 1.0f - alpha);
+    }
+
+    /**
+     * @brief Clear the filter history.
+     */
+    void reset()
+    {
+        mX1 = mX2 = mY1 = mY2 = 0;
+    }
+
+    /**
+     * @brief Preload the history as if the filter had settled.
+     *
+     * Avoids the start-up transient of a step from zero to the first sample.
+     *
+     * @param input Constant input the filter has been seeing.
+     * @param output Output it has settled to (the input for a low-pass, 0 for a high-pass).
+     */
+    void reset(int32_t input, int32_t output)
+    {
+        mX1 = mX2 = input;
+        mY1 = mY2 = output;
+    }
+
+    /**
+     * @brief Filter one sample.
+     *
+     * @param x Input sample; keep it within +/-2^23 to leave accumulator headroom.
+     * @return int32_t Filtered sample in the same scale as the input.
+     */
+    int32_t process(int32_t x)
+    {
+        int64_t acc = (int64_t)mB0 * x + (int64_t)mB1 * mX1 + (int64_t)mB2 * mX2
+                    - (int64_t)mA1 * mY1 - (int64_t)mA2 * mY2;
+        int32_t y = (int32_t)(acc >> COEF_SHIFT);
+        mX2 = mX1;
+        mX1 = x;
+        mY2 = mY1;
+        mY1 = y;
+        return y;
+    }
+};
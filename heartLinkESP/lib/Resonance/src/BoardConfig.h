@@ -0,0 +1,64 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <type_traits>
+#include <BoardProfile.h>
+
+/*
+ * Board the firmware image is built for. A build flag picks the concrete
+ * profile class, e.g. in platformio.ini:
+ *
+ *     build_flags = -DRESONANCE_BOARD_ESP32
+ *
+ * The per-sample pin writes of the Resonance output classes then go to
+ * that class's own writePins(), which BoardProfile doesn't have. Without a
+ * flag the pins are written one at a time through the BoardProfile vtable.
+ */
+#if defined(RESONANCE_BOARD_ESP32)
+#include <ESP32Profiles.h>
+typedef ESP32Profile ResonanceBoard;
+#define RESONANCE_STATIC_BOARD 1
+#elif defined(RESONANCE_BOARD_ESP32_RMT)
+#include <Esp32RmtProfile.h>
+typedef Esp32RmtProfile ResonanceBoard;
+#define RESONANCE_STATIC_BOARD 1
+#elif defined(RESONANCE_BOARD_HOST)
+#include "HostBoardProfile.h"
+typedef HostBoardProfile ResonanceBoard;
+#define RESONANCE_STATIC_BOARD 1
+#else
+typedef BoardProfile ResonanceBoard;
+#define RESONANCE_STATIC_BOARD 0
+#endif
+
+/**
+ * @brief The batched pin write of the per-sample path, resolved at compile
+ * time.
+ *
+ * writePins() is a non-virtual member defined inline in the header of each
+ * concrete profile, so the call is direct and can be inlined. BOARD must
+ * declare it itself: a derived profile must not get its base's silently.
+ * BoardCall<BoardProfile> writes pin by pin. Everything else (sendDataDMA(),
+ * timers, ...) stays virtual, so derived profiles keep their overrides.
+ */
+template <class BOARD>
+struct BoardCall
+{
+    static_assert(std::is_base_of<BoardProfile, BOARD>::value, "BOARD must be a BoardProfile");
+    // &BOARD::writePins has the type of the class that declares it
+    static_assert(std::is_same<decltype(&BOARD::writePins), void (BOARD::*)(const PinWrite *, size_t)>::value,
+                  "BOARD must declare its own writePins()");
+
+    static void writePins(BOARD *board, const PinWrite *writes, size_t count) { board->BOARD::writePins(writes, count); }
+};
+
+template <>
+struct BoardCall<BoardProfile>
+{
+    static void writePins(BoardProfile *board, const PinWrite *writes, size_t count)
+    {
+        // BoardProfile has no batched write: it can't take new virtuals
+        for (size_t i = 0; i < count; i++)
+            board->writeSinglePin(writes[i].pin, writes[i].value);
+    }
+};
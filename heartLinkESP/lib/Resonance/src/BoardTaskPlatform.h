@@ -0,0 +1,24 @@
+#pragma once
+#include <BoardProfile.h>
+#include "TaskFramework.h"
+
+/**
+ * @brief TaskFramework platform backed by a BoardProfile.
+ */
+class BoardTaskPlatform : public ITaskPlatform
+{
+    BoardProfile *mBoard;
+
+public:
+    explicit BoardTaskPlatform(BoardProfile *board) : mBoard(board) {}
+    ITaskManager *createTask(TaskConfig *config) override { return mBoard->createTask(config); }
+    IBoardQueue *createQueue(unsigned int length, unsigned int itemSize) override
+    {
+        // the board's queue reports no allocation failure; only a missing handle is caught
+        IBoardQueue *queue = mBoard->createQueueHandle();
+        if (queue)
+            queue->createQueue(length, itemSize);
+        return queue;
+    }
+    uint32_t millis() override { return mBoard->millis(); }
+};
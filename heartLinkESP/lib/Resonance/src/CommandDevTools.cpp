@@ -0,0 +1,75 @@
+#include "CommandDevTools.h"
+#include <VectorHaptics.h>
+
+bool CommandDevTools::addCommand(const std::string &name, std::function<std::string(const std::string &)> handler)
+{
+    if (mCommandCount >= DEVTOOLS_MAX_COMMANDS || name.empty() || !handler)
+        return false;
+    mCommands[mCommandCount].name = name;
+    mCommands[mCommandCount].handler = handler;
+    mCommandCount++;
+    return true;
+}
+
+const CommandDevTools::Command *CommandDevTools::find(const std::string &name) const
+{
+    for (uint8_t i = 0; i < mCommandCount; i++)
+    {
+        if (mCommands[i].name == name)
+            return &mCommands[i];
+    }
+    return nullptr;
+}
+
+void CommandDevTools::init()
+{
+    if (mInner == nullptr)
+        return;
+    // VectorHaptics::init() only sets up the object it was given
+    static_cast<VHBaseType *>(mInner)->init(m_pBoard, mVhPtr);
+    mInner->init();
+}
+
+int CommandDevTools::parseCommandList(std::string &strCmd)
+{
+    std::string rest;
+    size_t start = 0;
+    while (start < strCmd.size())
+    {
+        size_t end = strCmd.find(';', start);
+        if (end == std::string::npos)
+            end = strCmd.size();
+        std::string command = strCmd.substr(start, end - start);
+        start = end + 1;
+
+        size_t first = command.find_first_not_of(' ');
+        if (first == std::string::npos)
+            continue;
+        size_t nameEnd = command.find(' ', first);
+        std::string name = command.substr(first, nameEnd == std::string::npos ? std::string::npos : nameEnd - first);
+        const Command *match = find(name);
+        if (match == nullptr)
+        {
+            rest += command;
+            rest += ';';
+            continue;
+        }
+        std::string args;
+        size_t argStart = nameEnd == std::string::npos ? std::string::npos : command.find_first_not_of(' ', nameEnd);
+        if (argStart != std::string::npos)
+            args = command.substr(argStart, command.find_last_not_of(' ') + 1 - argStart);
+        std::string reply = match->handler(args);
+        if (mVhPtr != nullptr && !reply.empty())
+            mVhPtr->logMessages(reply, LOG_TYPE::RESPONSE_MSG);
+    }
+
+    if (rest.empty())
+        return VH_SUCCESS;
+    if (mInner == nullptr)
+    {
+        if (mVhPtr != nullptr)
+            mVhPtr->logMessages("Unknown command " + rest, LOG_TYPE::ERROR_MSG);
+        return VH_ERROR;
+    }
+    return mInner->parseCommandList(rest);
+}
@@ -0,0 +1,83 @@
+#pragma once
+#include <Interface.h>
+#include <functional>
+#include <string>
+
+#define DEVTOOLS_MAX_COMMANDS 8
+#define DEVTOOLS_TELEMETRY_LINE 256 /*!< Longest reply of the telemetry command */
+
+/**
+ * @brief Adds commands of our own to the Vector Haptics developer tools.
+ *
+ * VHDevTools comes precompiled and has no way to register commands, so this
+ * wraps it: it is handed to VectorHaptics::init() in its place, answers the
+ * commands registered with addCommand() and passes every other command of
+ * the list on to the wrapped instance unchanged. Commands are separated by
+ * ';' and the name is the first word; the handler gets the rest of the
+ * command and its reply is logged as a RESPONSE_MSG, so it comes out of the
+ * same serial / BLE path as the built-in replies.
+ *
+ * @code {.cpp}
+ * VHDevTools devToolsBase;
+ * CommandDevTools devTools(&devToolsBase);
+ * devTools.addTelemetryCommand(&a2dp_sink);
+ * vh.init(&board, {&channels, &devTools, &receiver});
+ * vh.executeStringCommand("a2dp;p 1 10;a2dp reset;");
+ * @endcode
+ */
+class CommandDevTools : public IDevTools
+{
+    struct Command
+    {
+        std::string name;
+        std::function<std::string(const std::string &)> handler;
+    };
+
+    IDevTools *mInner;
+    Command mCommands[DEVTOOLS_MAX_COMMANDS];
+    uint8_t mCommandCount = 0;
+
+    const Command *find(const std::string &name) const;
+
+public:
+    /**
+     * @brief Construct a new wrapper.
+     *
+     * @param inner Developer tools to pass the other commands to; may be nullptr.
+     */
+    explicit CommandDevTools(IDevTools *inner) : mInner(inner) {}
+    /**
+     * @brief Register a command; call before VectorHaptics::init().
+     *
+     * @param name First word of the command.
+     * @param handler Gets the arguments after the name, returns the reply.
+     * @return true if registered, false if all DEVTOOLS_MAX_COMMANDS are in use.
+     */
+    bool addCommand(const std::string &name, std::function<std::string(const std::string &)> handler);
+    /**
+     * @brief Register the stream telemetry command of an A2DP sink: it
+     * replies with A2DPSinkTelemetry::print_to(), "reset" clears the counters.
+     *
+     * @param sink BluetoothA2DPSink or BluetoothA2DPSinkQueued.
+     * @param name Command name.
+     * @return true if registered.
+     */
+    template <typename Sink>
+    bool addTelemetryCommand(Sink *sink, const std::string &name = "a2dp")
+    {
+        if (sink == nullptr)
+            return false;
+        return addCommand(name, [sink](const std::string &args) {
+            if (args == "reset")
+            {
+                sink->reset_telemetry();
+                return std::string("telemetry reset");
+            }
+            char line[DEVTOOLS_TELEMETRY_LINE];
+            sink->get_telemetry().print_to(line, sizeof(line));
+            return std::string(line);
+        });
+    }
+    void init() override;
+    int parseCommandList(std::string &strCmd) override;
+};
@@ -0,0 +1,147 @@
+#include "HapticA2DPSource.h"
+
+HapticA2DPSource::HapticA2DPSource(uint32_t inputRate, uint32_t outputRate)
+    : mInputRate(inputRate ? inputRate : HAPTIC_SOURCE_INPUT_RATE),
+      mOutputRate(outputRate ? outputRate : HAPTIC_SOURCE_OUTPUT_RATE)
+{
+    mStepQ32 = (uint32_t)(((uint64_t)mInputRate << 32) / mOutputRate);
+    reset();
+}
+
+int HapticA2DPSource::addTap(HapticSourceSide side)
+{
+    if (mTapCount >= HAPTIC_SOURCE_MAX_TAPS)
+        return -1;
+    mTaps[mTapCount].side = side;
+    return mTapCount++;
+}
+
+bool HapticA2DPSource::push(int tap, uint8_t value)
+{
+    if (tap < 0 || tap >= mTapCount)
+        return false;
+    if (!mTaps[tap].ring.push(value))
+    {
+        mTaps[tap].overruns.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    return true;
+}
+
+void HapticA2DPSource::reset()
+{
+    for (uint8_t i = 0; i < HAPTIC_SOURCE_MAX_TAPS; i++)
+    {
+        mTaps[i].ring.reset();
+        mTaps[i].previous = mTaps[i].current = 0;
+        mTaps[i].overruns.store(0, std::memory_order_relaxed);
+    }
+    mPhaseQ32 = 0;
+    mIntegral = 0;
+    mPrefetching = true;
+    mStats = HapticSourceStats();
+}
+
+size_t HapticA2DPSource::fullestFill() const
+{
+    size_t fill = 0;
+    for (uint8_t i = 0; i < mTapCount; i++)
+    {
+        size_t size = mTaps[i].ring.size();
+        if (size > fill)
+            fill = size;
+    }
+    return fill;
+}
+
+void HapticA2DPSource::advance()
+{
+    bool empty = true;
+    for (uint8_t i = 0; i < mTapCount; i++)
+    {
+        Tap &tap = mTaps[i];
+        uint8_t value;
+        tap.previous = tap.current;
+        if (tap.ring.pop(value))
+        {
+            tap.current = ((int32_t)value - HAPTIC_SOURCE_REST) * 256;
+            empty = false;
+        }
+        else
+        {
+            // a channel without input (idle) ramps to rest
+            tap.current = 0;
+        }
+    }
+    if (empty && mTapCount)
+    {
+        for (uint8_t i = 0; i < mTapCount; i++)
+            mTaps[i].previous = 0;
+        mPrefetching = true;
+        mStats.underruns++;
+    }
+}
+
+int32_t HapticA2DPSource::read(int16_t *frames, int32_t frameCount)
+{
+    if (frames == nullptr || frameCount <= 0)
+        return 0;
+
+    const size_t target = (size_t)HAPTIC_SOURCE_RING_SIZE * HAPTIC_SOURCE_TARGET_PERCENT / 100;
+    size_t fill = fullestFill();
+    mStats.fill = (uint16_t)fill;
+    if (mPrefetching && fill >= target)
+        mPrefetching = false;
+
+    // trim the ratio once per block to hold the fill level at the target
+    const int32_t maxIntegral = HAPTIC_SOURCE_MAX_CORRECTION_PPM << HAPTIC_SOURCE_KI_SHIFT;
+    int32_t error = (int32_t)fill - (int32_t)target;
+    if (!mPrefetching)
+    {
+        mIntegral += error;
+        if (mIntegral > maxIntegral)
+            mIntegral = maxIntegral;
+        if (mIntegral < -maxIntegral)
+            mIntegral = -maxIntegral;
+    }
+    int32_t ppm = error * HAPTIC_SOURCE_KP_PPM + (mIntegral >> HAPTIC_SOURCE_KI_SHIFT);
+    if (ppm > HAPTIC_SOURCE_MAX_CORRECTION_PPM)
+        ppm = HAPTIC_SOURCE_MAX_CORRECTION_PPM;
+    if (ppm < -HAPTIC_SOURCE_MAX_CORRECTION_PPM)
+        ppm = -HAPTIC_SOURCE_MAX_CORRECTION_PPM;
+    mStats.correctionPpm = mPrefetching ? 0 : ppm;
+    uint32_t step = (uint32_t)((int64_t)mStepQ32 + (int64_t)mStepQ32 * ppm / 1000000);
+
+    for (int32_t n = 0; n < frameCount; n++)
+    {
+        if (!mPrefetching)
+        {
+            uint64_t phase = (uint64_t)mPhaseQ32 + step;
+            mPhaseQ32 = (uint32_t)phase;
+            if (phase >> 32)
+                advance();
+        }
+        int32_t frac = (int32_t)(mPhaseQ32 >> 16);
+        int32_t left = 0, right = 0;
+        for (uint8_t i = 0; i < mTapCount; i++)
+        {
+            const Tap &tap = mTaps[i];
+            int32_t sample = tap.previous + (int32_t)(((int64_t)(tap.current - tap.previous) * frac) >> 16);
+            if (tap.side != HapticSourceSide::RIGHT)
+                left += sample;
+            if (tap.side != HapticSourceSide::LEFT)
+                right += sample;
+        }
+        frames[2 * n] = (int16_t)(left > INT16_MAX ? INT16_MAX : left < INT16_MIN ? INT16_MIN : left);
+        frames[2 * n + 1] = (int16_t)(right > INT16_MAX ? INT16_MAX : right < INT16_MIN ? INT16_MIN : right);
+    }
+    return frameCount;
+}
+
+HapticSourceStats HapticA2DPSource::getStats() const
+{
+    HapticSourceStats stats = mStats;
+    for (uint8_t i = 0; i < mTapCount; i++)
+        stats.overruns += mTaps[i].overruns.load(std::memory_order_relaxed);
+    return stats;
+}
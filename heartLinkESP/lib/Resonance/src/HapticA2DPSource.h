@@ -0,0 +1,151 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <functional>
+#include <RingBuffer.h>
+
+#define HAPTIC_SOURCE_MAX_TAPS 4
+#define HAPTIC_SOURCE_RING_SIZE 512       /*!< Per tap, in rendered samples */
+#define HAPTIC_SOURCE_INPUT_RATE 8000     /*!< Rate at which the channels render, in Hz */
+#define HAPTIC_SOURCE_OUTPUT_RATE 44100
+#define HAPTIC_SOURCE_TARGET_PERCENT 50   /*!< Fill level of the rings to hold */
+#define HAPTIC_SOURCE_KP_PPM 100          /*!< Rate correction per sample of fill error */
+#define HAPTIC_SOURCE_KI_SHIFT 2          /*!< Integral gain: 2^-n ppm per sample of error and read() */
+#define HAPTIC_SOURCE_MAX_CORRECTION_PPM 20000
+#define HAPTIC_SOURCE_REST 128            /*!< Rendered value that means no drive */
+
+/**
+ * @brief Audio side a tapped haptic channel is sent on.
+ */
+enum class HapticSourceSide : uint8_t
+{
+    LEFT,
+    RIGHT,
+    BOTH,
+};
+
+/**
+ * @brief Counters of the producer and consumer side.
+ */
+struct HapticSourceStats
+{
+    uint32_t overruns = 0;    /*!< Rendered samples dropped because a ring was full */
+    uint32_t underruns = 0;   /*!< Times the rings ran dry and the output went back to prefetching */
+    int32_t correctionPpm = 0;
+    uint16_t fill = 0;        /*!< Fullest ring at the last read() */
+};
+
+/**
+ * @brief Streams the rendered haptic output as 44.1 kHz stereo PCM, for a
+ * BluetoothA2DPSource feeding a second unit that mirrors the patterns.
+ *
+ * Each tapped channel gets a lock-free single producer / single consumer
+ * VH::RingBuffer. The producer is the channel's DSP hook (see dspTap()),
+ * which records every rendered value and passes it through unchanged, so
+ * the local output is not affected. applyDSP() replaces the channel's hook,
+ * so a DSP function the channel already had is handed to dspTap() and runs
+ * first; the tap records what it returns. The consumer is read(), called from the
+ * A2DP source's data callback: it never blocks or locks. It upsamples all
+ * taps in lockstep with linear interpolation and mixes them onto the left
+ * and/or right channel, one audio channel per haptic channel of a pair.
+ * Rendered values are offset binary, so value v becomes (v - 128) * 256.
+ *
+ * The render clock and the Bluetooth clock differ, so the resampling ratio
+ * is trimmed by a PI controller, by up to HAPTIC_SOURCE_MAX_CORRECTION_PPM,
+ * to hold the fullest ring at HAPTIC_SOURCE_TARGET_PERCENT. When all rings run dry (the
+ * channels went idle) the output ramps to rest and waits until the target
+ * is reached again before it resumes, so a restart doesn't stutter.
+ *
+ * @code {.cpp}
+ * HapticA2DPSource mirror;
+ * int32_t getFrames(Frame *frames, int32_t count) {
+ *     return mirror.read((int16_t *)frames, count);
+ * }
+ * channels.applyDSP(1, mirror.dspTap(mirror.addTap(HapticSourceSide::LEFT), dspFunction));
+ * channels.applyDSP(2, mirror.dspTap(mirror.addTap(HapticSourceSide::RIGHT)));
+ * a2dp_source.set_data_callback_in_frames(getFrames);
+ * a2dp_source.start("Resonance Mirror");
+ * @endcode
+ */
+class HapticA2DPSource
+{
+    struct Tap
+    {
+        uint8_t storage[HAPTIC_SOURCE_RING_SIZE];
+        VH::RingBuffer<uint8_t> ring{storage, HAPTIC_SOURCE_RING_SIZE};
+        HapticSourceSide side = HapticSourceSide::BOTH;
+        int32_t previous = 0; /*!< Last two input samples, PCM scale */
+        int32_t current = 0;
+        std::atomic<uint32_t> overruns{0}; /*!< Written by the producer, read by getStats() */
+    };
+
+    Tap mTaps[HAPTIC_SOURCE_MAX_TAPS];
+    uint8_t mTapCount = 0;
+    uint32_t mInputRate;
+    uint32_t mOutputRate;
+    uint32_t mStepQ32 = 0;   /*!< Input samples per output frame, Q32 */
+    uint32_t mPhaseQ32 = 0;  /*!< Position between previous and current */
+    int32_t mIntegral = 0;   /*!< Sum of fill errors, samples * reads */
+    bool mPrefetching = true;
+    HapticSourceStats mStats;
+
+    size_t fullestFill() const;
+    void advance();
+
+public:
+    /**
+     * @brief Construct a new source.
+     *
+     * @param inputRate Rate at which the channels render, in Hz.
+     * @param outputRate A2DP sample rate, in Hz.
+     */
+    explicit HapticA2DPSource(uint32_t inputRate = HAPTIC_SOURCE_INPUT_RATE,
+                              uint32_t outputRate = HAPTIC_SOURCE_OUTPUT_RATE);
+    /**
+     * @brief Add a channel to the mix; call before streaming starts.
+     *
+     * @param side Audio channel(s) it is sent on.
+     * @return int Tap index for push() and dspTap(), -1 if all are in use.
+     */
+    int addTap(HapticSourceSide side);
+    /**
+     * @brief Producer: record one rendered value. Never blocks.
+     *
+     * @param tap Index from addTap().
+     * @param value Rendered value, 128 = rest.
+     * @return true if stored, false if the ring was full (counted as overrun).
+     */
+    bool push(int tap, uint8_t value);
+    /**
+     * @brief DSP hook for VHChannels::applyDSP() that records and passes through.
+     *
+     * @param tap Index from addTap().
+     * @param next DSP function the channel had before, or nullptr.
+     */
+    std::function<uint8_t(uint8_t)> dspTap(int tap, std::function<uint8_t(uint8_t)> next = nullptr)
+    {
+        return [this, tap, next](uint8_t value) {
+            if (next)
+                value = next(value);
+            push(tap, value);
+            return value;
+        };
+    }
+    /**
+     * @brief Consumer: render interleaved 16 bit stereo frames. Never blocks;
+     * missing input is rendered as rest.
+     *
+     * @param frames Output, 2 samples per frame (layout of the A2DP Frame).
+     * @param frameCount Number of frames requested.
+     * @return int32_t Number of frames written, always frameCount.
+     */
+    int32_t read(int16_t *frames, int32_t frameCount);
+    /**
+     * @brief Drop everything buffered and prefetch again.
+     *
+     * Only call while neither side is running.
+     */
+    void reset();
+    HapticSourceStats getStats() const;
+};
@@ -0,0 +1,173 @@
+#include "HapticMapper.h"
+
+static float clamp01(float v)
+{
+    return v < 0 ? 0 : v > 1 ? 1 : v;
+}
+
+void HapticMapper::reset()
+{
+    mHaveBeat = false;
+    mLastBeatMs = mPeriodMs = mNextBeatMs = 0;
+    mScheduledCount = 0;
+    mAlertUntilMs = 0;
+    mStress = mActivity = 0;
+    mAbsErrSum = 0;
+    mStats = HapticPhaseStats();
+    mAlertCount = 0;
+}
+
+float HapticMapper::beatIntensity() const
+{
+    float intensity = HAPTIC_MIN_INTENSITY + (HAPTIC_MAX_INTENSITY - HAPTIC_MIN_INTENSITY) * mStress;
+    intensity += HAPTIC_ACTIVITY_BOOST * mActivity;
+    return intensity > HAPTIC_MAX_INTENSITY ? HAPTIC_MAX_INTENSITY : intensity;
+}
+
+void HapticMapper::recordPhase(uint32_t beatMs)
+{
+    if (!mScheduledCount || !mPeriodMs)
+        return;
+    // compare against whichever recent cue is closest; the next one may
+    // already be out if detection latency exceeds period - lookahead
+    int32_t err = (int32_t)(mScheduled[0] - beatMs);
+    for (uint8_t i = 1; i < mScheduledCount; i++)
+    {
+        int32_t e = (int32_t)(mScheduled[i] - beatMs);
+        if ((e < 0 ? -e : e) < (err < 0 ? -err : err))
+            err = e;
+    }
+    uint32_t absErr = err < 0 ? -err : err;
+    if (absErr > mPeriodMs / 2)
+        return;
+    mStats.lastMs = (int16_t)err;
+    mStats.matched++;
+    mAbsErrSum += absErr;
+    mStats.meanAbsMs = (uint16_t)(mAbsErrSum / mStats.matched);
+    if (absErr > mStats.maxAbsMs)
+        mStats.maxAbsMs = (uint16_t)absErr;
+}
+
+void HapticMapper::onBeat(const HeartBeat &beat, uint32_t beatMs)
+{
+    recordPhase(beatMs);
+    mHaveBeat = true;
+    mLastBeatMs = beatMs;
+
+    if (beat.bpm)
+    {
+        mPeriodMs = 60000UL / beat.bpm;
+        mStress = clamp01((float)((int)beat.bpm - HAPTIC_REST_BPM) / (HAPTIC_STRESS_BPM - HAPTIC_REST_BPM));
+    }
+    else if (beat.ibiMs)
+        mPeriodMs = beat.ibiMs;
+    if (!mPeriodMs)
+        return;
+
+    // re-anchor the rhythm on the real beat, skipping a slot whose cue is
+    // already queued
+    uint32_t next = beatMs + mPeriodMs;
+    while (mScheduledCount && (int32_t)(next - mScheduled[0]) < (int32_t)(mPeriodMs / 2))
+        next += mPeriodMs;
+    mNextBeatMs = next;
+}
+
+void HapticMapper::onMotion(uint16_t peakMilliG)
+{
+    float excess = peakMilliG > 1000 ? (float)(peakMilliG - 1000) : 0;
+    mActivity += (clamp01(excess / HAPTIC_ACTIVE_MG) - mActivity) * 0.125f;
+}
+
+void HapticMapper::pushAlert(const HapticCue &cue)
+{
+    if (mAlertCount < HAPTIC_MAX_CUES)
+        mAlerts[mAlertCount++] = cue;
+}
+
+void HapticMapper::onImpact(const ImpactEvent &event, uint32_t nowMs)
+{
+    uint8_t level = (uint8_t)event.severity;
+    HapticCue cue;
+    cue.type = HapticCueType::SWEEP;
+    cue.preempt = true;
+    cue.startMs = nowMs;
+    cue.durationMs = 300 + 150 * level;
+    cue.intensity = HAPTIC_MAX_INTENSITY;
+    cue.endIntensity = 0.3f;
+    cue.frequency = HAPTIC_ALERT_FREQ;
+    cue.endFrequency = HAPTIC_CALM_FREQ;
+    cue.sharpness = 1.0f;
+    // an alert replaces anything still pending, alerts included
+    mAlertCount = 0;
+    pushAlert(cue);
+    uint32_t t = nowMs + cue.durationMs;
+
+    if (event.type == ImpactType::FALL || event.severity == ImpactSeverity::SEVERE)
+    {
+        for (uint8_t i = 0; i <= level; i++)
+        {
+            HapticCue burst;
+            burst.type = HapticCueType::VIBRATE;
+            burst.startMs = t + HAPTIC_BURST_GAP_MS;
+            burst.durationMs = HAPTIC_BURST_MS;
+            burst.intensity = HAPTIC_MAX_INTENSITY;
+            burst.frequency = HAPTIC_ALERT_FREQ;
+            burst.sharpness = 0.5f;
+            pushAlert(burst);
+            t = burst.startMs + burst.durationMs;
+        }
+    }
+    mAlertUntilMs = t;
+}
+
+size_t HapticMapper::update(uint32_t nowMs, HapticCue *cues, size_t maxCues)
+{
+    size_t n = 0;
+    uint8_t taken = 0;
+    while (taken < mAlertCount && n < maxCues)
+        cues[n++] = mAlerts[taken++];
+    for (uint8_t i = taken; i < mAlertCount; i++)
+        mAlerts[i - taken] = mAlerts[i];
+    mAlertCount -= taken;
+    if (mAlertCount)
+        return n;
+
+    if (!mHaveBeat || !mPeriodMs)
+        return n;
+    while ((int32_t)(mNextBeatMs - (nowMs + mLookaheadMs)) <= 0 && n + 2 <= maxCues)
+    {
+        uint32_t beatMs = mNextBeatMs;
+        // free-running prediction only bridges a few missed detections
+        if (beatMs - mLastBeatMs > HAPTIC_BEAT_TIMEOUT_MS)
+            break;
+        mNextBeatMs += mPeriodMs;
+        if ((int32_t)(beatMs - nowMs) < 0)
+        {
+            mStats.late++;
+            continue;
+        }
+        if ((int32_t)(beatMs - mAlertUntilMs) < 0)
+            continue;
+
+        float intensity = beatIntensity();
+        float sharpness = 0.3f + 0.6f * mStress;
+        HapticCue &lub = cues[n++];
+        lub = HapticCue();
+        lub.type = HapticCueType::PULSE;
+        lub.startMs = beatMs;
+        lub.durationMs = HAPTIC_LUB_MS;
+        lub.intensity = intensity;
+        lub.sharpness = sharpness;
+        HapticCue &dub = cues[n++];
+        dub = lub;
+        dub.startMs = beatMs + HAPTIC_DUB_DELAY_MS;
+        dub.durationMs = HAPTIC_DUB_MS;
+        dub.intensity = intensity * HAPTIC_DUB_GAIN;
+
+        mScheduled[1] = mScheduled[0];
+        mScheduled[0] = beatMs;
+        if (mScheduledCount < 2)
+            mScheduledCount++;
+    }
+    return n;
+}
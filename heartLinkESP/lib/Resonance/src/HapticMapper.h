@@ -0,0 +1,148 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include "HeartRateDetector.h"
+#include "ImpactDetector.h"
+
+#define HAPTIC_LOOKAHEAD_MS 250     /*!< How far ahead of now cues are handed out */
+#define HAPTIC_BEAT_TIMEOUT_MS 3000 /*!< Stop pulsing this long after the last real beat */
+#define HAPTIC_DUB_DELAY_MS 140     /*!< Second heart sound after the first */
+#define HAPTIC_LUB_MS 40
+#define HAPTIC_DUB_MS 25
+#define HAPTIC_DUB_GAIN 0.6f
+#define HAPTIC_REST_BPM 60
+#define HAPTIC_STRESS_BPM 140
+#define HAPTIC_MIN_INTENSITY 0.35f
+#define HAPTIC_MAX_INTENSITY 1.0f
+#define HAPTIC_ACTIVE_MG 1500       /*!< Excess over 1g at which the activity boost is full */
+#define HAPTIC_ACTIVITY_BOOST 0.2f
+#define HAPTIC_ALERT_FREQ 250.0f
+#define HAPTIC_CALM_FREQ 80.0f
+#define HAPTIC_BURST_MS 150
+#define HAPTIC_BURST_GAP_MS 100
+#define HAPTIC_MAX_CUES 8
+
+enum class HapticCueType : uint8_t
+{
+    PULSE,
+    VIBRATE,
+    SWEEP,
+    TICK,
+};
+
+/**
+ * @brief One scheduled haptic primitive on the mapper's millisecond clock.
+ */
+struct HapticCue
+{
+    HapticCueType type = HapticCueType::PULSE;
+    bool preempt = false;     /*!< Replace whatever is still queued (alerts) */
+    uint32_t startMs = 0;
+    uint16_t durationMs = 0;
+    float intensity = 0;      /*!< Start intensity for SWEEP */
+    float endIntensity = 0;   /*!< SWEEP only */
+    float frequency = 0;      /*!< VIBRATE, start frequency for SWEEP */
+    float endFrequency = 0;   /*!< SWEEP only */
+    float sharpness = 0;
+};
+
+/**
+ * @brief Phase of the emitted beat cues against the real beats.
+ */
+struct HapticPhaseStats
+{
+    int16_t lastMs = 0;       /*!< Cue time minus beat time; negative means the cue led */
+    uint16_t meanAbsMs = 0;
+    uint16_t maxAbsMs = 0;
+    uint32_t matched = 0;     /*!< Beats that had a cue within half a period */
+    uint32_t late = 0;        /*!< Beat cues dropped because update() ran after their start */
+};
+
+/**
+ * @brief Maps heart rate and motion to haptic cues ahead of time.
+ *
+ * Heart beats drive a lub-dub PULSE pair locked to the predicted next beat
+ * (last beat plus the averaged interval), so the output lands on the beat
+ * even though detection reports it after the fact. Intensity and sharpness
+ * track stress, taken as heart rate between HAPTIC_REST_BPM and
+ * HAPTIC_STRESS_BPM, with a boost while the wearer is moving. Impacts and
+ * falls pre-empt the rhythm with a SWEEP alert, followed by VIBRATE bursts
+ * for falls and severe impacts.
+ *
+ * Nothing here touches the haptics library: update() hands out every cue
+ * starting within HAPTIC_LOOKAHEAD_MS of now, in start order, and an output
+ * stage (ToneHapticOutput on the board) queues them. As long as update() runs
+ * at least once per lookahead, scheduling jitter doesn't move the cues.
+ * All times are milliseconds on the caller's clock.
+ */
+class HapticMapper
+{
+    uint32_t mLookaheadMs = HAPTIC_LOOKAHEAD_MS;
+    bool mHaveBeat = false;
+    uint32_t mLastBeatMs = 0;
+    uint32_t mPeriodMs = 0;
+    uint32_t mNextBeatMs = 0;
+    uint32_t mScheduled[2] = {0, 0}; /*!< Last two beat cue times, newest first */
+    uint8_t mScheduledCount = 0;
+    uint32_t mAlertUntilMs = 0;
+    float mStress = 0;
+    float mActivity = 0;
+    uint64_t mAbsErrSum = 0;
+    HapticPhaseStats mStats;
+
+    HapticCue mAlerts[HAPTIC_MAX_CUES];
+    uint8_t mAlertCount = 0;
+
+    float beatIntensity() const;
+    void recordPhase(uint32_t beatMs);
+    void pushAlert(const HapticCue &cue);
+
+public:
+    HapticMapper() = default;
+    /**
+     * @brief Forget the rhythm, pending alerts and phase statistics.
+     */
+    void reset();
+    /**
+     * @brief Set how far ahead of now update() schedules.
+     *
+     * @param ms Lookahead; must exceed the worst gap between update() calls.
+     */
+    void setLookahead(uint32_t ms) { mLookaheadMs = ms; }
+    /**
+     * @brief Feed a detected beat.
+     *
+     * @param beat Beat from HeartRateDetector / HeartRateMonitor.
+     * @param beatMs Time of the beat on the mapper's clock.
+     */
+    void onBeat(const HeartBeat &beat, uint32_t beatMs);
+    /**
+     * @brief Feed the current motion level.
+     *
+     * @param peakMilliG Recent peak total acceleration, e.g.
+     *                   ImpactDetector::getWindowPeakMilliG().
+     */
+    void onMotion(uint16_t peakMilliG);
+    /**
+     * @brief Feed an impact or fall; its alert goes out on the next update().
+     *
+     * @param event Event from ImpactDetector.
+     * @param nowMs Current time on the mapper's clock.
+     */
+    void onImpact(const ImpactEvent &event, uint32_t nowMs);
+    /**
+     * @brief Hand out the cues due within the lookahead.
+     *
+     * @param nowMs Current time on the mapper's clock.
+     * @param cues Output array.
+     * @param maxCues Capacity of the array; the rest stays pending.
+     * @return size_t Number of cues written, in start order.
+     */
+    size_t update(uint32_t nowMs, HapticCue *cues, size_t maxCues);
+    /**
+     * @brief Stress level 0..1 derived from the heart rate.
+     */
+    float getStress() const { return mStress; }
+    uint32_t getPeriodMs() const { return mPeriodMs; }
+    const HapticPhaseStats &getPhaseStats() const { return mStats; }
+};
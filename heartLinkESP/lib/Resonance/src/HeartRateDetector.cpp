@@ -0,0 +1,135 @@
+#include "HeartRateDetector.h"
+
+HeartRateDetector::HeartRateDetector(uint32_t sampleRate)
+    : mSampleRate(sampleRate ? sampleRate : HR_DEFAULT_SAMPLE_RATE)
+{
+    mHighPass.setHighPass((float)mSampleRate, HR_BAND_LOW_HZ);
+    mLowPass.setLowPass((float)mSampleRate, HR_BAND_HIGH_HZ);
+    // envelope time constant of roughly two seconds: 2^shift ~ 2 * sampleRate
+    mEnvDecayShift = 0;
+    while ((1UL << (mEnvDecayShift + 1)) <= 2 * mSampleRate)
+        mEnvDecayShift++;
+    mRefractorySamples = (uint32_t)((uint64_t)HR_MIN_IBI_MS * mSampleRate / 1000);
+    mMaxIbiSamples = (uint32_t)((uint64_t)HR_MAX_IBI_MS * mSampleRate / 1000);
+    setMinAmplitude(HR_DEFAULT_MIN_AMPLITUDE);
+    reset();
+}
+
+void HeartRateDetector::reset()
+{
+    mHighPass.reset();
+    mLowPass.reset();
+    mSampleCount = 0;
+    mFiltered = 0;
+    mEnvelope = 0;
+    mSlope = 0;
+    mPeakSlope = 0;
+    mPeakSample = 0;
+    mRising = false;
+    mHaveBeat = false;
+    mLastBeatSample = 0;
+    mIbiCount = mIbiIdx = 0;
+    mLastIbi = 0;
+    mBpm = 0;
+}
+
+void HeartRateDetector::setMinAmplitude(uint16_t adcCounts)
+{
+    // per-sample slope of a rise of adcCounts over HR_UPSTROKE_MS
+    uint32_t upstrokeSamples = (uint32_t)((uint64_t)HR_UPSTROKE_MS * mSampleRate / 1000);
+    mMinSlope = ((int32_t)adcCounts << HR_INPUT_SHIFT) / (int32_t)(upstrokeSamples ? upstrokeSamples : 1);
+}
+
+uint32_t HeartRateDetector::samplesToMs(uint32_t samples) const
+{
+    return (uint32_t)((uint64_t)samples * 1000 / mSampleRate);
+}
+
+uint16_t HeartRateDetector::updateBpm(uint16_t ibiMs)
+{
+    mIbis[mIbiIdx] = ibiMs;
+    mIbiIdx = (mIbiIdx + 1) % HR_IBI_HISTORY;
+    if (mIbiCount < HR_IBI_HISTORY)
+        mIbiCount++;
+    uint32_t sum = 0;
+    for (uint8_t i = 0; i < mIbiCount; i++)
+        sum += mIbis[i];
+    return (uint16_t)((60000UL * mIbiCount + sum / 2) / sum);
+}
+
+bool HeartRateDetector::process(uint16_t sample, HeartBeat &beat)
+{
+    int32_t x = (int32_t)sample << HR_INPUT_SHIFT;
+    if (mSampleCount == 0)
+        mHighPass.reset(x, 0);
+    int32_t y = mLowPass.process(mHighPass.process(x));
+    uint32_t now = mSampleCount++;
+    bool detected = false;
+
+    int32_t slope = y - mFiltered;
+    mEnvelope -= mEnvelope >> mEnvDecayShift;
+
+    if (slope > mSlope)
+    {
+        mRising = true;
+        mPeakSlope = slope;
+        mPeakSample = now;
+    }
+    else if (mRising)
+    {
+        // previous sample was the steepest point of a rise
+        mRising = false;
+        if (mPeakSlope > mEnvelope)
+            mEnvelope = mPeakSlope;
+        bool aboveThreshold = mPeakSlope >= mMinSlope && mPeakSlope >= ((mEnvelope * 5) >> 3);
+        // once a rate is known, a beat can't come sooner than half an interval
+        uint32_t refractory = mRefractorySamples;
+        if (mBpm)
+        {
+            uint32_t halfIbi = (uint32_t)(30ULL * mSampleRate / mBpm);
+            if (halfIbi > refractory)
+                refractory = halfIbi;
+        }
+        bool outsideRefractory = !mHaveBeat || (mPeakSample - mLastBeatSample) >= refractory;
+        if (aboveThreshold && outsideRefractory)
+        {
+            uint32_t interval = mPeakSample - mLastBeatSample;
+            beat.timeMs = samplesToMs(mPeakSample);
+            beat.ibiMs = 0;
+            if (mHaveBeat && interval <= mMaxIbiSamples)
+            {
+                beat.ibiMs = (uint16_t)samplesToMs(interval);
+                mLastIbi = beat.ibiMs;
+                mBpm = updateBpm(beat.ibiMs);
+            }
+            else if (mHaveBeat)
+            {
+                // long gap (sensor lifted, missed beats): restart the average
+                mIbiCount = mIbiIdx = 0;
+                mBpm = 0;
+            }
+            beat.bpm = mBpm;
+            mHaveBeat = true;
+            mLastBeatSample = mPeakSample;
+            detected = true;
+        }
+    }
+    mFiltered = y;
+    mSlope = slope;
+    return detected;
+}
+
+size_t HeartRateDetector::process(const uint16_t *samples, size_t count, HeartBeat &beat)
+{
+    size_t beats = 0;
+    HeartBeat tmp;
+    for (size_t i = 0; i < count; i++)
+    {
+        if (process(samples[i], tmp))
+        {
+            beat = tmp;
+            beats++;
+        }
+    }
+    return beats;
+}
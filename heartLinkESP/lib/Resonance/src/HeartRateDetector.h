@@ -0,0 +1,112 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include "BiquadFilter.h"
+
+#define HR_DEFAULT_SAMPLE_RATE 500
+#define HR_BAND_LOW_HZ 0.5f
+#define HR_BAND_HIGH_HZ 4.0f
+#define HR_MIN_IBI_MS 300   /*!< 200 bpm */
+#define HR_MAX_IBI_MS 2000  /*!< 30 bpm */
+#define HR_IBI_HISTORY 4
+#define HR_INPUT_SHIFT 8    /*!< 12-bit ADC counts -> 20-bit filter input */
+#define HR_DEFAULT_MIN_AMPLITUDE 8 /*!< ADC counts */
+#define HR_UPSTROKE_MS 100  /*!< Nominal systolic rise time used to scale the amplitude floor */
+
+/**
+ * @brief A detected heart beat.
+ */
+struct HeartBeat
+{
+    uint32_t timeMs = 0; /*!< Upstroke time on the sample clock (includes the filter delay) */
+    uint16_t ibiMs = 0;  /*!< Interval since the previous beat, 0 if out of range */
+    uint16_t bpm = 0;    /*!< Rate averaged over the last HR_IBI_HISTORY intervals, 0 until known */
+};
+
+/**
+ * @brief Streaming PPG beat detector.
+ *
+ * Raw ADC samples are band-passed (HR_BAND_LOW_HZ..HR_BAND_HIGH_HZ) with two
+ * fixed-point biquads. Beats are taken at the steepest point of each
+ * systolic upstroke: local maxima of the first difference that exceed 5/8
+ * of a decaying envelope of recent maxima, subject to a refractory period of
+ * HR_MIN_IBI_MS or half the current interval, whichever is longer. Working on
+ * the slope rather than the level keeps the dicrotic wave, baseline wander
+ * and filter undershoot well below threshold. Everything after construction
+ * is integer only and time comes from the sample count, so the detector
+ * behaves the same on the host as on the board.
+ *
+ * @code {.cpp}
+ * HeartRateDetector detector(500);
+ * HeartBeat beat;
+ * if (detector.process(analogSample, beat))
+ *     Serial.println(beat.bpm);
+ * @endcode
+ */
+class HeartRateDetector
+{
+    uint32_t mSampleRate;
+    BiquadFilter mHighPass, mLowPass;
+    int32_t mMinSlope;
+    uint8_t mEnvDecayShift;
+    uint32_t mRefractorySamples;
+    uint32_t mMaxIbiSamples;
+    uint32_t mSampleCount = 0;
+    int32_t mFiltered = 0;
+    int32_t mEnvelope = 0;
+    int32_t mSlope = 0;
+    int32_t mPeakSlope = 0;
+    uint32_t mPeakSample = 0;
+    bool mRising = false;
+    bool mHaveBeat = false;
+    uint32_t mLastBeatSample = 0;
+    uint16_t mIbis[HR_IBI_HISTORY] = {0};
+    uint8_t mIbiCount = 0, mIbiIdx = 0;
+    uint16_t mLastIbi = 0;
+    uint16_t mBpm = 0;
+
+    uint32_t samplesToMs(uint32_t samples) const;
+    uint16_t updateBpm(uint16_t ibiMs);
+
+public:
+    /**
+     * @brief Construct a new detector.
+     *
+     * @param sampleRate Rate at which process() will be called, in Hz.
+     */
+    explicit HeartRateDetector(uint32_t sampleRate = HR_DEFAULT_SAMPLE_RATE);
+    /**
+     * @brief Clear filter state, beat history and the sample clock.
+     */
+    void reset();
+    /**
+     * @brief Set the smallest pulse accepted as a beat.
+     *
+     * @param adcCounts Pulse amplitude in raw ADC counts, applied as a floor
+     *                  on the upstroke slope assuming a HR_UPSTROKE_MS rise.
+     *                  Below it the sensor is treated as off-body and no
+     *                  beats are reported.
+     */
+    void setMinAmplitude(uint16_t adcCounts);
+    /**
+     * @brief Feed one raw ADC sample.
+     *
+     * @param sample Raw 12-bit ADC value.
+     * @param beat Filled in when a beat is detected.
+     * @return true if this sample completed a beat.
+     */
+    bool process(uint16_t sample, HeartBeat &beat);
+    /**
+     * @brief Feed a block of raw ADC samples.
+     *
+     * @param samples Raw 12-bit ADC values.
+     * @param count Number of samples.
+     * @param beat Filled in with the last beat detected in the block.
+     * @return size_t Number of beats detected in the block.
+     */
+    size_t process(const uint16_t *samples, size_t count, HeartBeat &beat);
+    uint16_t getBpm() const { return mBpm; }
+    uint16_t getLastIbi() const { return mLastIbi; }
+    int32_t getFiltered() const { return mFiltered; }
+    uint32_t getSampleRate() const { return mSampleRate; }
+};
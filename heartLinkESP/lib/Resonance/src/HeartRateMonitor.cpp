@@ -0,0 +1,47 @@
+#include "HeartRateMonitor.h"
+
+HeartRateMonitor::HeartRateMonitor(uint32_t sampleRate)
+    : mDetector(sampleRate)
+{
+}
+
+HeartRateMonitor::~HeartRateMonitor()
+{
+    stop();
+}
+
+bool HeartRateMonitor::begin(IBoardAdc *adc, uint8_t pin)
+{
+    if (!adc)
+        return false;
+    stop();
+    mAdc = adc;
+    if (!mAdc->begin(pin, mDetector.getSampleRate()))
+        return false;
+    mDetector.reset();
+    mBpm = mLastIbi = 0;
+    mAdc->setCallback(&HeartRateMonitor::adcCallback, this);
+    mAdc->start();
+    return true;
+}
+
+void HeartRateMonitor::stop()
+{
+    if (mAdc)
+        mAdc->stop();
+}
+
+void HeartRateMonitor::adcCallback(const uint16_t *samples, size_t count, void *param)
+{
+    HeartRateMonitor *self = static_cast<HeartRateMonitor *>(param);
+    HeartBeat beat;
+    for (size_t i = 0; i < count; i++)
+    {
+        if (!self->mDetector.process(samples[i], beat))
+            continue;
+        self->mBpm = beat.bpm;
+        self->mLastIbi = beat.ibiMs;
+        if (self->mBeatCb)
+            self->mBeatCb(beat);
+    }
+}
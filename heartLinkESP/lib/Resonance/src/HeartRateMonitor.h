@@ -0,0 +1,60 @@
+#pragma once
+#include <functional>
+#include <BoardProfile.h>
+#include "HeartRateDetector.h"
+
+/**
+ * @brief Heart rate acquisition on top of a board ADC sampler.
+ *
+ * Samples the sensor at a fixed rate through a board ADC sampler and runs them through a HeartRateDetector as blocks arrive, so the main
+ * loop no longer polls the pin. The beat callback runs in the sampler's
+ * context: keep it short and hand work off (queue, flag) rather than print.
+ *
+ * @code {.cpp}
+ * Esp32Adc adc;
+ * HeartRateMonitor heart(500);
+ * heart.onBeat([](const HeartBeat &b) { lastBpm = b.bpm; });
+ * heart.begin(&adc, HEART_PIN);
+ * @endcode
+ */
+class HeartRateMonitor
+{
+    HeartRateDetector mDetector;
+    IBoardAdc *mAdc = nullptr;
+    std::function<void(const HeartBeat &)> mBeatCb = nullptr;
+    volatile uint16_t mBpm = 0;
+    volatile uint16_t mLastIbi = 0;
+
+    static void adcCallback(const uint16_t *samples, size_t count, void *param);
+
+public:
+    /**
+     * @brief Construct a new monitor.
+     *
+     * @param sampleRate ADC sample rate in Hz.
+     */
+    explicit HeartRateMonitor(uint32_t sampleRate = HR_DEFAULT_SAMPLE_RATE);
+    ~HeartRateMonitor();
+    /**
+     * @brief Start acquiring on a pin.
+     *
+     * @param adc Board ADC sampler; owned by the caller and used until stop().
+     * @param pin Analog pin the sensor is wired to.
+     * @return true if sampling started.
+     */
+    bool begin(IBoardAdc *adc, uint8_t pin);
+    /**
+     * @brief Stop sampling. begin() may be called again afterwards.
+     */
+    void stop();
+    /**
+     * @brief Register a function called for every detected beat.
+     */
+    void onBeat(std::function<void(const HeartBeat &)> cb) { mBeatCb = cb; }
+    /**
+     * @brief Forwarded to HeartRateDetector::setMinAmplitude().
+     */
+    void setMinAmplitude(uint16_t adcCounts) { mDetector.setMinAmplitude(adcCounts); }
+    uint16_t getBpm() const { return mBpm; }
+    uint16_t getLastIbi() const { return mLastIbi; }
+};
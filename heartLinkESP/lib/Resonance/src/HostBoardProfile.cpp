@@ -0,0 +1,193 @@
+#ifndef ARDUINO
+#include "HostBoardProfile.h"
+#include "HostTaskPlatform.h"
+#include <cstdio>
+#include <chrono>
+
+// on the board these come with the precompiled Vectorhaptics library
+BoardProfile *BoardProfile::_mBoard = nullptr;
+
+BoardProfile::BoardProfile() : mBoardI2sMan(nullptr), m_iErrorLogger(0)
+{
+    _mBoard = this;
+}
+
+BoardProfile::~BoardProfile()
+{
+    if (_mBoard == this)
+        _mBoard = nullptr;
+}
+
+void HostTimer::setCallback(TimerCb cb, void *param)
+{
+    mCb = cb;
+    mParam = param;
+}
+
+void HostTimer::fire()
+{
+    if (mRunning && mCb)
+        mCb(mParam);
+}
+
+void HostAlarm::setCallback(TimerCb cb, void *param)
+{
+    mCb = cb;
+    mParam = param;
+}
+
+HostAlarm::~HostAlarm()
+{
+    if (mBoard)
+        mBoard->mAlarms[mTimerNo] = nullptr;
+}
+
+uint64_t HostAlarm::nowUs()
+{
+    return mBoard ? mBoard->getTimeMicroseconds() : 0;
+}
+
+void HostAlarm::setAlarm(uint64_t at)
+{
+    atUs = at;
+    armed = true;
+}
+
+void HostAlarm::fire()
+{
+    armed = false;
+    if (mCb)
+        mCb(mParam);
+}
+
+bool HostMutex::take(uint32_t xBlockTime)
+{
+    if (xBlockTime == 0)
+        return mMutex.try_lock();
+    // portMAX_DELAY on the board; as a timeout it overflows the clock
+    if (xBlockTime == 0xFFFFFFFFUL)
+    {
+        mMutex.lock();
+        return true;
+    }
+    return mMutex.try_lock_for(std::chrono::milliseconds(xBlockTime));
+}
+
+HostBoardProfile::~HostBoardProfile()
+{
+    for (uint8_t i = 0; i < HOST_MAX_TIMERS; i++)
+    {
+        delete mTimers[i];
+        if (mAlarms[i])
+            mAlarms[i]->mBoard = nullptr;
+    }
+}
+
+void HostBoardProfile::record(const PinWrite *writes, size_t count)
+{
+    std::lock_guard<std::mutex> lock(mLogMutex);
+    mBatches.push_back({mTimeUs, mWrites.size(), count});
+    mWrites.insert(mWrites.end(), writes, writes + count);
+}
+
+void HostBoardProfile::writeSinglePin(unsigned char pin, unsigned char value)
+{
+    PinWrite w = {pin, value};
+    addWrites(&w, 1);
+}
+
+void HostBoardProfile::writeDualPin(unsigned char pin1, unsigned char pin2, unsigned char val1, unsigned char val2)
+{
+    PinWrite w[2] = {{pin1, val1}, {pin2, val2}};
+    addWrites(w, 2);
+}
+
+void HostBoardProfile::clearPinWrites()
+{
+    std::lock_guard<std::mutex> lock(mLogMutex);
+    mWrites.clear();
+    mBatches.clear();
+}
+
+void HostBoardProfile::logMessages(std::string msg, LOG_TYPE type)
+{
+    fprintf(type == ERROR_MSG ? stderr : stdout, "%s\n", msg.c_str());
+}
+
+void HostBoardProfile::logError(int line, const char *file, const char *msg)
+{
+    fprintf(stderr, "%s:%d: %s\n", file, line, msg);
+}
+
+IBoardQueue *HostBoardProfile::createQueueHandle()
+{
+    return new HostQueue();
+}
+
+int HostBoardProfile::createTask(void (*func)(void *), const char *name, int stackSize, void *param, int priority, void *)
+{
+    // like a FreeRTOS task made this way, the thread is never joined
+    TaskConfig config(name, stackSize, param, priority, func);
+    return createTask(&config) ? 0 : -1;
+}
+
+ITaskManager *HostBoardProfile::createTask(TaskConfig *config)
+{
+    // the caller owns the task; deleting it joins the thread
+    HostTask *task = new HostTask();
+    task->createTask(config);
+    return task;
+}
+
+IBoardTimer *HostBoardProfile::createTimerEvents(uint8_t timer, uint32_t freq, bool)
+{
+    if (timer >= HOST_MAX_TIMERS)
+        return nullptr;
+    if (mTimers[timer] == nullptr)
+        mTimers[timer] = new HostTimer();
+    mTimers[timer]->timerNo = timer;
+    mTimers[timer]->freq = freq;
+    return mTimers[timer];
+}
+
+HostAlarm *HostBoardProfile::createAlarm(uint8_t timer)
+{
+    if (timer >= HOST_MAX_TIMERS || mAlarms[timer] != nullptr)
+        return nullptr;
+    mAlarms[timer] = new HostAlarm(this, timer);
+    return mAlarms[timer];
+}
+
+void HostBoardProfile::advanceUs(unsigned long us)
+{
+    unsigned long end = mTimeUs + us;
+    for (;;)
+    {
+        // earliest armed alarm up to the end; it may re-arm itself for later
+        HostAlarm *next = nullptr;
+        for (uint8_t i = 0; i < HOST_MAX_TIMERS; i++)
+        {
+            HostAlarm *a = mAlarms[i];
+            if (a && a->armed && a->atUs <= end && (next == nullptr || a->atUs < next->atUs))
+                next = a;
+        }
+        if (next == nullptr)
+            break;
+        if (next->atUs > mTimeUs)
+            mTimeUs = (unsigned long)next->atUs;
+        mTimeUs += next->latencyUs;
+        next->fire();
+    }
+    if (mTimeUs < end)
+        mTimeUs = end;
+}
+
+bool HostBoardProfile::fireTimer(uint8_t timer)
+{
+    HostTimer *t = getTimer(timer);
+    if (t == nullptr)
+        return false;
+    t->fire();
+    return true;
+}
+#endif
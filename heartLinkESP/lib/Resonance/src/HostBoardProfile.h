@@ -0,0 +1,200 @@
+#pragma once
+#ifndef ARDUINO
+#include <vector>
+#include <mutex>
+#include <functional>
+#include <BoardProfile.h>
+
+#define HOST_MAX_TIMERS 4
+
+/**
+ * @brief Timer of the host profile; fire() stands in for the hardware alarm.
+ */
+class HostTimer final : public IBoardTimer
+{
+    TimerCb mCb = nullptr;
+    void *mParam = nullptr;
+    bool mRunning = false;
+
+public:
+    uint8_t timerNo = 0;
+    uint32_t freq = 0;
+
+    void setCallback(TimerCb cb, void *param = nullptr) override;
+    void startTimer() override { mRunning = true; }
+    void stopTimer() override { mRunning = false; }
+    bool isRunning() const { return mRunning; }
+    /**
+     * @brief Run the callback once if the timer is started.
+     */
+    void fire();
+};
+
+class HostBoardProfile;
+
+/**
+ * @brief Alarm of the host profile, on the board's simulated clock:
+ * advanceUs() fires it when the clock passes the alarm time. Owned by the
+ * caller of createAlarm(), like on the board.
+ */
+class HostAlarm final : public IBoardAlarm
+{
+    friend class HostBoardProfile;
+    HostBoardProfile *mBoard;
+    uint8_t mTimerNo;
+    TimerCb mCb = nullptr;
+    void *mParam = nullptr;
+    std::recursive_mutex mMutex;
+
+public:
+    bool armed = false;
+    uint64_t atUs = 0;
+    uint32_t latencyUs = 0; /*!< Added to the clock before each firing, like ISR entry time */
+
+    HostAlarm(HostBoardProfile *board, uint8_t timer) : mBoard(board), mTimerNo(timer) {}
+    ~HostAlarm();
+    void setCallback(TimerCb cb, void *param = nullptr) override;
+    uint64_t nowUs() override;
+    void setAlarm(uint64_t at) override;
+    void cancelAlarm() override { armed = false; }
+    void lock() override { mMutex.lock(); }
+    void unlock() override { mMutex.unlock(); }
+    void fire();
+};
+
+class HostMutex : public IBoardMutex
+{
+    std::timed_mutex mMutex;
+
+public:
+    void *createMutex() override { return this; }
+    bool take(uint32_t xBlockTime = 0) override;
+    void give() override { mMutex.unlock(); }
+};
+
+/**
+ * @brief One writePins() call as the board saw it.
+ */
+struct HostPinBatch
+{
+    unsigned long timeUs; /*!< getTimeMicroseconds() at the call */
+    size_t first;         /*!< Index of its first entry in getPinWrites() */
+    size_t count;
+};
+
+/**
+ * @brief BoardProfile for host builds and tests.
+ *
+ * Pin writes are recorded instead of driving anything: every
+ * writeSinglePin() is a batch of one and every writePins() call one batch,
+ * so a test can check both what was written and how many board calls it
+ * took; with setRecording(false) only the number of values is kept.
+ * writePins() is only reached with RESONANCE_BOARD_HOST (see BoardConfig.h);
+ * through BoardProfile the output classes write pin by pin.
+ * Time only moves with advanceUs(), and timers only fire when the test
+ * calls fireTimer(), so runs are repeatable; alarms fire from advanceUs()
+ * at their exact time plus their latencyUs. Tasks and queues are the
+ * std::thread ones of HostTaskPlatform. sendDataDMA() goes to the dma hook,
+ * false without one like the default board.
+ *
+ * @code {.cpp}
+ * HostBoardProfile board;
+ * MultiChannelOutput out(8000);
+ * out.addChannel(25, render);
+ * out.begin(&board, 0);
+ * for (int i = 0; i < 8000; i++)
+ *     board.fireTimer(0);
+ * printf("%zu board calls\n", board.getPinBatches().size());
+ * @endcode
+ */
+class HostBoardProfile : public BoardProfile
+{
+    friend class HostAlarm;
+    std::vector<PinWrite> mWrites;
+    std::vector<HostPinBatch> mBatches;
+    HostTimer *mTimers[HOST_MAX_TIMERS] = {};
+    HostAlarm *mAlarms[HOST_MAX_TIMERS] = {};
+    unsigned long mTimeUs = 0;
+    std::mutex mLogMutex;
+    bool mRecording = true;
+    size_t mWriteCount = 0;
+
+    void record(const PinWrite *writes, size_t count);
+    void addWrites(const PinWrite *writes, size_t count)
+    {
+        mWriteCount += count;
+        if (mRecording)
+            record(writes, count);
+    }
+
+public:
+    std::function<bool(uint8_t *data, size_t len)> dma = nullptr;
+
+    HostBoardProfile() = default;
+    ~HostBoardProfile();
+
+    void init(unsigned char = 0) override {}
+    void init(unsigned char, unsigned char, unsigned char = 0) override {}
+    void setOutput(unsigned char) override {}
+    void delay(unsigned int ms) override { advanceUs((unsigned long)ms * 1000); }
+    void delayMicroseconds(unsigned int us) override { advanceUs(us); }
+    void write(unsigned char) override {}
+    void writeSinglePin(unsigned char pin, unsigned char value) override;
+    void writeDualPin(unsigned char pin1, unsigned char pin2, unsigned char val1, unsigned char val2) override;
+    /**
+     * @brief One batch; not virtual, like ESP32Profile::writePins().
+     */
+    void writePins(const PinWrite *writes, size_t count) { addWrites(writes, count); }
+    std::string GetMacIdEndChars() override { return "HOST"; }
+    void logMessages(std::string msg, LOG_TYPE type = ERROR_MSG) override;
+    void logError(int line, const char *file, const char *msg) override;
+    void high(unsigned char pin) override { writeSinglePin(pin, 255); }
+    void low(unsigned char pin) override { writeSinglePin(pin, 0); }
+    IBoardMutex *createMutexHandle() override { return new HostMutex(); }
+    IBoardQueue *createQueueHandle() override;
+    unsigned long getTimeMicroseconds() override { return mTimeUs; }
+    unsigned long millis() override { return mTimeUs / 1000; }
+    int createTask(void (*func)(void *), const char *name, int stackSize, void *param, int priority, void *taskHandle) override;
+    ITaskManager *createTask(TaskConfig *config) override;
+    IBoardTimer *createTimerEvents(uint8_t timer, uint32_t freq, bool countup = true) override;
+    /**
+     * @brief Alarm on the simulated clock, the host's Esp32Alarm; nullptr if
+     * the timer has one already.
+     */
+    HostAlarm *createAlarm(uint8_t timer);
+    IBoardI2sMan *getI2sMan() override { return nullptr; }
+    void restart() override {}
+    bool sendDataDMA(uint8_t *data, size_t len) override { return dma ? dma(data, len) : false; }
+    void save(const char *, const char *) override {}
+    std::string read(const char *, const char *defaultVal) override { return defaultVal; }
+    void pinMode(int, int) override {}
+    void pinMode(int) override {}
+    void digitalWrite(int pin, int val) override { writeSinglePin((unsigned char)pin, val ? 255 : 0); }
+    int digitalRead(int) override { return 0; }
+
+    /**
+     * @brief Move the clock forward, stopping at each alarm on the way to
+     * fire it.
+     */
+    void advanceUs(unsigned long us);
+    /**
+     * @brief Fire a timer made by createTimerEvents(), if it is started.
+     *
+     * @return bool false if there is no such timer.
+     */
+    bool fireTimer(uint8_t timer);
+    HostTimer *getTimer(uint8_t timer) { return timer < HOST_MAX_TIMERS ? mTimers[timer] : nullptr; }
+    HostAlarm *getAlarm(uint8_t timer) { return timer < HOST_MAX_TIMERS ? mAlarms[timer] : nullptr; }
+    const std::vector<PinWrite> &getPinWrites() const { return mWrites; }
+    const std::vector<HostPinBatch> &getPinBatches() const { return mBatches; }
+    void clearPinWrites();
+    /**
+     * @brief Keep only the count of written values, for benchmarks.
+     */
+    void setRecording(bool enable) { mRecording = enable; }
+    /**
+     * @brief Values written since the start, recorded or not.
+     */
+    size_t getPinWriteCount() const { return mWriteCount; }
+};
+#endif
@@ -0,0 +1,101 @@
+#ifndef ARDUINO
+#include "HostTaskPlatform.h"
+
+int HostTask::createTask(TaskConfig *config)
+{
+    mTaskConfig.clone(config);
+    mThread = std::thread(mTaskConfig.func, mTaskConfig.param);
+    return 0;
+}
+
+void HostTask::deleteTask()
+{
+    if (mThread.joinable() && mThread.get_id() != std::this_thread::get_id())
+        mThread.join();
+}
+
+void HostQueue::createQueue(const unsigned int queueSize, const unsigned int size)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mItemSize = size;
+    mCapacity = queueSize;
+    mBuf.assign((size_t)queueSize * size, 0);
+    mHead = mCount = 0;
+}
+
+int HostQueue::receive(void *const pvBuffer, unsigned int xTicksToWait)
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    auto ready = [this] { return mCount > 0; };
+    if (xTicksToWait == TASK_WAIT_FOREVER)
+        mNotEmpty.wait(lock, ready);
+    else if (!mNotEmpty.wait_for(lock, std::chrono::milliseconds(xTicksToWait), ready))
+        return 0;
+    memcpy(pvBuffer, &mBuf[(size_t)mHead * mItemSize], mItemSize);
+    mHead = (mHead + 1) % mCapacity;
+    mCount--;
+    mNotFull.notify_one();
+    return 1;
+}
+
+int HostQueue::send(const void *const pvItemToQueue, unsigned int xTicksToWait)
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    auto ready = [this] { return mCount < mCapacity; };
+    if (xTicksToWait == TASK_WAIT_FOREVER)
+        mNotFull.wait(lock, ready);
+    else if (!mNotFull.wait_for(lock, std::chrono::milliseconds(xTicksToWait), ready))
+        return 0;
+    memcpy(&mBuf[(size_t)((mHead + mCount) % mCapacity) * mItemSize], pvItemToQueue, mItemSize);
+    mCount++;
+    mNotEmpty.notify_one();
+    return 1;
+}
+
+int HostQueue::receiveISR(void *const pvBuffer, int *pxTaskWoken)
+{
+    if (pxTaskWoken)
+        *pxTaskWoken = 0;
+    return receive(pvBuffer, 0);
+}
+
+int HostQueue::sendISR(const void *const pvItemToQueue, int *pxTaskWoken)
+{
+    if (pxTaskWoken)
+        *pxTaskWoken = 0;
+    return send(pvItemToQueue, 0);
+}
+
+int HostQueue::hasItems()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return (int)mCount;
+}
+
+ITaskManager *HostTaskPlatform::createTask(TaskConfig *config)
+{
+    HostTask *task = new HostTask();
+    task->createTask(config);
+    return task;
+}
+
+IBoardQueue *HostTaskPlatform::createQueue(unsigned int length, unsigned int itemSize)
+{
+    HostQueue *queue = new HostQueue();
+    queue->createQueue(length, itemSize);
+    return queue;
+}
+
+uint32_t HostTaskPlatform::millis()
+{
+    return (uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::steady_clock::now() - mStart)
+        .count();
+}
+
+bool HostTaskPlatform::join(ITaskManager *task)
+{
+    task->deleteTask();
+    return true;
+}
+#endif
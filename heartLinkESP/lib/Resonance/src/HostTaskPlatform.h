@@ -0,0 +1,69 @@
+#pragma once
+#ifndef ARDUINO
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <vector>
+#include "TaskFramework.h"
+
+/**
+ * @brief std::thread task for host builds. Priority and core are ignored.
+ */
+class HostTask : public ITaskManager
+{
+    std::thread mThread;
+
+public:
+    HostTask() = default;
+    ~HostTask() { deleteTask(); }
+    int createTask(TaskConfig *config) override;
+    /**
+     * @brief Join the thread; a no-op when called from the task itself.
+     */
+    void deleteTask() override;
+};
+
+/**
+ * @brief Bounded FIFO with blocking receive for host builds.
+ *
+ * Timeouts are in milliseconds; TASK_WAIT_FOREVER blocks indefinitely.
+ * Returns 1 on success and 0 on timeout or full, like FreeRTOS.
+ */
+class HostQueue : public IBoardQueue
+{
+    std::mutex mMutex;
+    std::condition_variable mNotEmpty, mNotFull;
+    std::vector<uint8_t> mBuf;
+    unsigned int mItemSize = 0, mCapacity = 0;
+    unsigned int mHead = 0, mCount = 0;
+
+public:
+    HostQueue() = default;
+    void createQueue(const unsigned int queueSize, const unsigned int size) override;
+    int receive(void *const pvBuffer, unsigned int xTicksToWait) override;
+    int send(const void *const pvItemToQueue, unsigned int xTicksToWait) override;
+    int receiveISR(void *const pvBuffer, int *pxTaskWoken) override;
+    int sendISR(const void *const pvItemToQueue, int *pxTaskWoken) override;
+    int hasItems() override;
+};
+
+/**
+ * @brief TaskFramework platform on std::thread, for host tests.
+ */
+class HostTaskPlatform : public ITaskPlatform
+{
+    std::chrono::steady_clock::time_point mStart = std::chrono::steady_clock::now();
+
+public:
+    ITaskManager *createTask(TaskConfig *config) override;
+    IBoardQueue *createQueue(unsigned int length, unsigned int itemSize) override;
+    uint32_t millis() override;
+    bool join(ITaskManager *task) override;
+    /**
+     * @brief Nothing to do: the thread ends when its function returns and
+     * join() frees the task.
+     */
+    void exit(ITaskManager *) override {}
+};
+#endif
@@ -0,0 +1,228 @@
+#include "ImpactDetector.h"
+
+static uint32_t isqrt(uint32_t v)
+{
+    uint32_t root = 0;
+    uint32_t bit = 1UL << 30;
+    while (bit > v)
+        bit >>= 2;
+    while (bit)
+    {
+        if (v >= root + bit)
+        {
+            v -= root + bit;
+            root = (root >> 1) + bit;
+        }
+        else
+            root >>= 1;
+        bit >>= 2;
+    }
+    return root;
+}
+
+static uint16_t capMilliG(uint32_t milliG, uint32_t limit)
+{
+    uint32_t capped = milliG < limit ? milliG : limit;
+    return capped > UINT16_MAX ? UINT16_MAX : (uint16_t)capped;
+}
+
+ImpactDetector::ImpactDetector(uint32_t sampleRate, uint16_t lsbPerG)
+    : mSampleRate(sampleRate ? sampleRate : IMPACT_DEFAULT_SAMPLE_RATE),
+      mLsbPerG(lsbPerG ? lsbPerG : IMPACT_DEFAULT_LSB_PER_G)
+{
+    uint32_t fs = fullScaleMilliG();
+    setFreeFall(IMPACT_FREE_FALL_MG, IMPACT_MIN_FREE_FALL_MS);
+    setSpikeThresholds(capMilliG(IMPACT_FALL_SPIKE_MG, fs * 5 / 8), capMilliG(IMPACT_SPIKE_MG, fs * 7 / 8));
+    mModerateSq = milliGToSquared(capMilliG(IMPACT_MODERATE_MG, fs * 15 / 16));
+    mSevereSq = milliGToSquared(capMilliG(IMPACT_SEVERE_MG, fs * 1414 / 1000));
+    mFallWindowSamples = msToSamples(IMPACT_FALL_WINDOW_MS);
+    mMergeSamples = msToSamples(IMPACT_MERGE_MS);
+    mLongFallSamples = msToSamples(IMPACT_LONG_FALL_MS);
+    mPeakWindowSamples = msToSamples(IMPACT_PEAK_WINDOW_MS);
+    if (mPeakWindowSamples > IMPACT_PEAK_WINDOW_MAX)
+        mPeakWindowSamples = IMPACT_PEAK_WINDOW_MAX;
+    if (mPeakWindowSamples == 0)
+        mPeakWindowSamples = 1;
+    reset();
+}
+
+void ImpactDetector::reset()
+{
+    mState = IDLE;
+    mSampleCount = 0;
+    mMagnitudeSq = 0;
+    mFreeFallStart = mFreeFallSamples = 0;
+    mArmedAt = 0;
+    mSpikeIsFall = false;
+    mSpikeThresholdSq = 0;
+    mSpikeStart = mSpikeLast = 0;
+    mSpikePeakSq = 0;
+    mWinHead = mWinCount = 0;
+}
+
+void ImpactDetector::setFreeFall(uint16_t milliG, uint16_t minMs)
+{
+    mFreeFallSq = milliGToSquared(milliG);
+    mMinFreeFallSamples = msToSamples(minMs);
+}
+
+void ImpactDetector::setSpikeThresholds(uint16_t fallMilliG, uint16_t impactMilliG)
+{
+    mFallSpikeSq = milliGToSquared(fallMilliG);
+    mSpikeSq = milliGToSquared(impactMilliG);
+}
+
+uint32_t ImpactDetector::msToSamples(uint32_t ms) const
+{
+    return (uint32_t)(((uint64_t)ms * mSampleRate + 999) / 1000);
+}
+
+uint32_t ImpactDetector::samplesToMs(uint32_t samples) const
+{
+    return (uint32_t)((uint64_t)samples * 1000 / mSampleRate);
+}
+
+uint32_t ImpactDetector::milliGToSquared(uint32_t milliG) const
+{
+    // thresholds beyond what three saturated axes can reach simply never fire
+    uint64_t counts = (uint64_t)milliG * mLsbPerG / 1000;
+    uint64_t sq = counts * counts;
+    return sq > UINT32_MAX ? UINT32_MAX : (uint32_t)sq;
+}
+
+uint32_t ImpactDetector::fullScaleMilliG() const
+{
+    return 32768UL * 1000 / mLsbPerG;
+}
+
+uint16_t ImpactDetector::squaredToMilliG(uint32_t magnitudeSq) const
+{
+    uint32_t milliG = (uint32_t)((uint64_t)isqrt(magnitudeSq) * 1000 / mLsbPerG);
+    return milliG > UINT16_MAX ? UINT16_MAX : (uint16_t)milliG;
+}
+
+void ImpactDetector::pushWindow(uint32_t magnitudeSq, uint32_t now)
+{
+    // drop the front once it has left the window
+    if (mWinCount && now - mWinSample[mWinHead] >= mPeakWindowSamples)
+    {
+        mWinHead = (mWinHead + 1) % IMPACT_PEAK_WINDOW_MAX;
+        mWinCount--;
+    }
+    // smaller values behind the new one can never be the peak again
+    while (mWinCount)
+    {
+        uint8_t back = (mWinHead + mWinCount - 1) % IMPACT_PEAK_WINDOW_MAX;
+        if (mWinMag[back] > magnitudeSq)
+            break;
+        mWinCount--;
+    }
+    uint8_t slot = (mWinHead + mWinCount) % IMPACT_PEAK_WINDOW_MAX;
+    mWinMag[slot] = magnitudeSq;
+    mWinSample[slot] = now;
+    mWinCount++;
+}
+
+void ImpactDetector::startSpike(bool fall, uint32_t now)
+{
+    mState = SPIKE;
+    mSpikeIsFall = fall;
+    mSpikeThresholdSq = fall ? mFallSpikeSq : mSpikeSq;
+    mSpikeStart = mSpikeLast = now;
+    mSpikePeakSq = mMagnitudeSq;
+    if (!fall)
+        mFreeFallSamples = 0;
+}
+
+void ImpactDetector::finishSpike(ImpactEvent &event) const
+{
+    event.type = mSpikeIsFall ? ImpactType::FALL : ImpactType::IMPACT;
+    event.timeMs = samplesToMs(mSpikeStart);
+    uint32_t duration = samplesToMs(mSpikeLast - mSpikeStart);
+    event.durationMs = duration > UINT16_MAX ? UINT16_MAX : (uint16_t)duration;
+    event.peakMilliG = squaredToMilliG(mSpikePeakSq);
+    uint32_t freeFall = samplesToMs(mFreeFallSamples);
+    event.freeFallMs = freeFall > UINT16_MAX ? UINT16_MAX : (uint16_t)freeFall;
+
+    uint8_t level = mSpikePeakSq >= mSevereSq ? 2 : mSpikePeakSq >= mModerateSq ? 1 : 0;
+    if (mSpikeIsFall && mFreeFallSamples >= mLongFallSamples && level < 2)
+        level++;
+    event.severity = (ImpactSeverity)level;
+}
+
+bool ImpactDetector::process(int16_t x, int16_t y, int16_t z, ImpactEvent &event)
+{
+    // 3 * 32768^2 still fits in 32 bits
+    uint32_t m2 = (uint32_t)((int32_t)x * x) + (uint32_t)((int32_t)y * y) + (uint32_t)((int32_t)z * z);
+    uint32_t now = mSampleCount++;
+    bool detected = false;
+    mMagnitudeSq = m2;
+    pushWindow(m2, now);
+
+    switch (mState)
+    {
+    case IDLE:
+        if (m2 >= mSpikeSq)
+            startSpike(false, now);
+        else if (m2 <= mFreeFallSq)
+        {
+            mState = FREE_FALL;
+            mFreeFallStart = now;
+        }
+        break;
+
+    case FREE_FALL:
+        if (m2 <= mFreeFallSq)
+            break;
+        mFreeFallSamples = now - mFreeFallStart;
+        if (mFreeFallSamples >= mMinFreeFallSamples)
+        {
+            // the landing can be the very sample that ends the fall
+            mState = ARMED;
+            mArmedAt = now;
+            if (m2 >= mFallSpikeSq)
+                startSpike(true, now);
+        }
+        else
+        {
+            mState = IDLE;
+            if (m2 >= mSpikeSq)
+                startSpike(false, now);
+        }
+        break;
+
+    case ARMED:
+        if (m2 >= mFallSpikeSq)
+            startSpike(true, now);
+        else if (m2 <= mFreeFallSq)
+        {
+            // tumbling: start over so the longest clean drop is the one reported
+            mState = FREE_FALL;
+            mFreeFallStart = now;
+        }
+        else if (now - mArmedAt > mFallWindowSamples)
+            mState = IDLE;
+        break;
+
+    case SPIKE:
+        if (m2 >= mSpikeThresholdSq)
+        {
+            mSpikeLast = now;
+            if (m2 > mSpikePeakSq)
+                mSpikePeakSq = m2;
+        }
+        else if (now - mSpikeLast >= mMergeSamples)
+        {
+            finishSpike(event);
+            detected = true;
+            mState = IDLE;
+            if (m2 <= mFreeFallSq)
+            {
+                mState = FREE_FALL;
+                mFreeFallStart = now;
+            }
+        }
+        break;
+    }
+    return detected;
+}
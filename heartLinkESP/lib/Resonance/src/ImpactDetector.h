@@ -0,0 +1,173 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+
+#define IMPACT_DEFAULT_SAMPLE_RATE 100
+#define IMPACT_DEFAULT_LSB_PER_G 8192 /*!< MPU6050 DMP accel packets (+1g = 8192) */
+#define IMPACT_FREE_FALL_MG 500       /*!< Below this total acceleration counts as free fall */
+#define IMPACT_MIN_FREE_FALL_MS 100   /*!< ~5 cm drop; shorter dips (gait, jumps) are ignored */
+#define IMPACT_FALL_WINDOW_MS 200     /*!< Spike must follow the end of free fall within this */
+#define IMPACT_FALL_SPIKE_MG 2500     /*!< Spike threshold after free fall, at most 5/8 of full scale */
+#define IMPACT_SPIKE_MG 6000          /*!< Spike threshold without free fall, at most 7/8 of full scale */
+#define IMPACT_MERGE_MS 50            /*!< Spikes closer than this are one event */
+#define IMPACT_LONG_FALL_MS 300       /*!< ~45 cm drop; raises fall severity one level */
+#define IMPACT_MODERATE_MG 4000       /*!< At most 15/16 of full scale: one axis near its clip */
+#define IMPACT_SEVERE_MG 8000         /*!< At most sqrt(2) x full scale: two axes at their clip */
+#define IMPACT_PEAK_WINDOW_MS 100
+#define IMPACT_PEAK_WINDOW_MAX 128    /*!< Sliding-window capacity in samples */
+
+enum class ImpactType : uint8_t
+{
+    IMPACT, /*!< Spike without preceding free fall */
+    FALL,   /*!< Free fall followed by a spike */
+};
+
+enum class ImpactSeverity : uint8_t
+{
+    LOW,
+    MODERATE,
+    SEVERE,
+};
+
+/**
+ * @brief A detected impact or fall.
+ */
+struct ImpactEvent
+{
+    ImpactType type = ImpactType::IMPACT;
+    ImpactSeverity severity = ImpactSeverity::LOW;
+    uint32_t timeMs = 0;      /*!< First sample above the spike threshold, on the sample clock */
+    uint16_t durationMs = 0;  /*!< From the first to the last sample above the threshold */
+    uint16_t peakMilliG = 0;  /*!< Largest total acceleration during the spike */
+    uint16_t freeFallMs = 0;  /*!< Length of the preceding free fall, 0 for IMPACT */
+};
+
+/**
+ * @brief Streaming impact and fall detector for raw accelerometer samples.
+ *
+ * Every sample is used: thresholds are compared against the squared total
+ * acceleration, so the per-sample path is a few multiplies and compares with
+ * no sqrt. A state machine recognises free fall (total below
+ * IMPACT_FREE_FALL_MG for at least IMPACT_MIN_FREE_FALL_MS) followed by a
+ * spike as a FALL, and a larger spike on its own as an IMPACT. Spikes are
+ * merged until the signal stays below threshold for IMPACT_MERGE_MS, then
+ * one event is reported with its peak and severity.
+ *
+ * Alongside, the peak of the last IMPACT_PEAK_WINDOW_MS is kept with a
+ * monotonic queue, so a reader polling slower than the sample rate (a
+ * display, a 10 Hz log) still sees short spikes.
+ *
+ * The thresholds are in milli-g, but an axis clips at 32768 / lsbPerG g:
+ * at the DMP's +-4 g a severe 8 g peak can never be read. The defaults are
+ * therefore capped against the full scale, keeping their order, and only
+ * the wider ranges (+-8 g and up) use them unchanged.
+ *
+ * Time comes from the sample count, as in HeartRateDetector.
+ *
+ * @code {.cpp}
+ * ImpactDetector impacts(100, 8192);
+ * ImpactEvent event;
+ * if (impacts.process(aa.x, aa.y, aa.z, event))
+ *     Serial.println(event.peakMilliG);
+ * @endcode
+ */
+class ImpactDetector
+{
+    enum State : uint8_t
+    {
+        IDLE,
+        FREE_FALL,
+        ARMED,
+        SPIKE,
+    };
+
+    uint32_t mSampleRate;
+    uint16_t mLsbPerG;
+    uint32_t mFreeFallSq, mFallSpikeSq, mSpikeSq;
+    uint32_t mModerateSq, mSevereSq;
+    uint32_t mMinFreeFallSamples, mFallWindowSamples, mMergeSamples, mLongFallSamples;
+    uint32_t mPeakWindowSamples;
+
+    State mState = IDLE;
+    uint32_t mSampleCount = 0;
+    uint32_t mMagnitudeSq = 0;
+    uint32_t mFreeFallStart = 0;
+    uint32_t mFreeFallSamples = 0;
+    uint32_t mArmedAt = 0;
+    bool mSpikeIsFall = false;
+    uint32_t mSpikeThresholdSq = 0;
+    uint32_t mSpikeStart = 0;
+    uint32_t mSpikeLast = 0;
+    uint32_t mSpikePeakSq = 0;
+
+    // monotonic (decreasing) queue of {magnitude^2, sample} for the window peak
+    uint32_t mWinMag[IMPACT_PEAK_WINDOW_MAX];
+    uint32_t mWinSample[IMPACT_PEAK_WINDOW_MAX];
+    uint8_t mWinHead = 0, mWinCount = 0;
+
+    uint32_t msToSamples(uint32_t ms) const;
+    uint32_t samplesToMs(uint32_t samples) const;
+    uint32_t milliGToSquared(uint32_t milliG) const;
+    uint32_t fullScaleMilliG() const;
+    uint16_t squaredToMilliG(uint32_t magnitudeSq) const;
+    void pushWindow(uint32_t magnitudeSq, uint32_t now);
+    void startSpike(bool fall, uint32_t now);
+    void finishSpike(ImpactEvent &event) const;
+
+public:
+    /**
+     * @brief Construct a new detector with the default thresholds, capped
+     * to what the accelerometer range can read.
+     *
+     * @param sampleRate Rate at which process() will be called, in Hz.
+     * @param lsbPerG Raw accelerometer counts per g at the configured range.
+     */
+    explicit ImpactDetector(uint32_t sampleRate = IMPACT_DEFAULT_SAMPLE_RATE,
+                            uint16_t lsbPerG = IMPACT_DEFAULT_LSB_PER_G);
+    /**
+     * @brief Clear the state machine, window and sample clock.
+     */
+    void reset();
+    /**
+     * @brief Override the free fall thresholds.
+     *
+     * @param milliG Total acceleration below which the device is falling.
+     * @param minMs Minimum free fall length before a spike counts as a fall.
+     */
+    void setFreeFall(uint16_t milliG, uint16_t minMs);
+    /**
+     * @brief Override the spike thresholds.
+     *
+     * @param fallMilliG Spike threshold after free fall.
+     * @param impactMilliG Spike threshold without free fall.
+     */
+    void setSpikeThresholds(uint16_t fallMilliG, uint16_t impactMilliG);
+    /**
+     * @brief Peak total acceleration rated SEVERE, after the full-scale cap.
+     */
+    uint16_t getSevereMilliG() const { return squaredToMilliG(mSevereSq); }
+    /**
+     * @brief Feed one raw accelerometer sample.
+     *
+     * @param x,y,z Raw axis readings in counts.
+     * @param event Filled in when an event completes.
+     * @return true if this sample completed an event.
+     */
+    bool process(int16_t x, int16_t y, int16_t z, ImpactEvent &event);
+    /**
+     * @brief Squared total acceleration of the last sample, in counts^2.
+     */
+    uint32_t getMagnitudeSquared() const { return mMagnitudeSq; }
+    /**
+     * @brief Peak squared total acceleration over the last IMPACT_PEAK_WINDOW_MS.
+     */
+    uint32_t getWindowPeakSquared() const { return mWinCount ? mWinMag[mWinHead] : 0; }
+    /**
+     * @brief Peak total acceleration over the last IMPACT_PEAK_WINDOW_MS.
+     *
+     * @return uint16_t Peak in milli-g (one integer square root per call).
+     */
+    uint16_t getWindowPeakMilliG() const { return squaredToMilliG(getWindowPeakSquared()); }
+    bool isFalling() const { return mState == FREE_FALL; }
+    uint32_t getSampleRate() const { return mSampleRate; }
+};
@@ -0,0 +1,264 @@
+#include "MultiChannelOutput.h"
+#include <cstring>
+#ifdef ARDUINO
+#include <ESP32Timer.h>
+#endif
+
+template <class BOARD>
+MultiChannelOutputT<BOARD>::MultiChannelOutputT(uint32_t sampleRate)
+    : mSampleRate(sampleRate ? sampleRate : MC_DEFAULT_SAMPLE_RATE)
+{
+    uint32_t period = MC_SYMBOL_CLOCK_HZ / (mSampleRate * MC_PWM_PERIODS_PER_SAMPLE);
+    if (period < 2)
+        period = 2;
+    if (period > 32767)
+        period = 32767; // each half of a symbol has 15 bits
+    mPeriodTicks = (uint16_t)period;
+    uint32_t waitMs = (uint32_t)MC_BLOCK_SAMPLES * 1000 / mSampleRate / 2;
+    mWaitMs = (uint16_t)(waitMs ? (waitMs > 1000 ? 1000 : waitMs) : 1);
+    mReady[0] = false;
+    mReady[1] = false;
+}
+
+template <class BOARD>
+MultiChannelOutputT<BOARD>::~MultiChannelOutputT()
+{
+    // IBoardTimer has no virtual destructor, so the timer is stopped but not deleted
+    stop();
+#ifdef ARDUINO
+    if (mClaimed != MC_NO_TIMER)
+        ESP32Timer::release(mClaimed, this);
+#endif
+}
+
+template <class BOARD>
+int MultiChannelOutputT<BOARD>::addChannel(uint8_t pin, McRenderFn render)
+{
+    if (mStarted || mCount >= MC_MAX_CHANNELS)
+        return -1;
+    mChannels[mCount].pin = pin;
+    mChannels[mCount].render = render;
+    mPins[mCount] = pin;
+    return mCount++;
+}
+
+template <class BOARD>
+McMode MultiChannelOutputT<BOARD>::begin(BOARD *board, uint8_t cpuTimer)
+{
+    mBoard = board;
+    mStarted = true;
+    mSymbolBuf = 0;
+
+    // the first block decides: boards without DMA output refuse it
+    render();
+    encode(mPlanar, mCount, mPeriodTicks, mSymbols[mSymbolBuf]);
+    if (mBoard->sendDataDMA((uint8_t *)mSymbols[mSymbolBuf], (size_t)mCount * MC_BLOCK_SYMBOLS * sizeof(uint32_t)))
+    {
+        mMode = McMode::DMA;
+        mSymbolBuf ^= 1;
+        return mMode;
+    }
+
+    if (mTimer == nullptr && !claimTimer(cpuTimer))
+    {
+        mMode = McMode::NONE;
+        mStarted = false;
+        return mMode;
+    }
+    mMode = McMode::CPU;
+    interleave(mPlanar, mCount, MC_BLOCK_SAMPLES, mFrames[0]);
+    mReady[0] = true;
+    mWriteBuf = 1;
+    mReadBuf = 0;
+    mReadPos = 0;
+    render();
+    send(mPlanar);
+    PinWrite zero[MC_MAX_CHANNELS];
+    for (uint8_t i = 0; i < mCount; i++)
+    {
+        mChannels[i].last = 0;
+        zero[i] = {mChannels[i].pin, 0};
+    }
+    BoardCall<BOARD>::writePins(mBoard, zero, mCount);
+    mTimer->setCallback(&MultiChannelOutputT::timerCallback, this);
+    mTimer->startTimer();
+    return mMode;
+}
+
+template <class BOARD>
+bool MultiChannelOutputT<BOARD>::claimTimer(uint8_t timer)
+{
+    if (timer == MC_NO_TIMER)
+        return false;
+#ifdef ARDUINO
+    // createTimerEvents() doesn't check the claims: fails if a VH driver
+    // already runs the timer or Esp32Alarm / Esp32Adc holds it
+    if (!ESP32Timer::claim(timer, this))
+        return false;
+    mClaimed = timer;
+#endif
+    mTimer = mBoard->createTimerEvents(timer, mSampleRate);
+    return mTimer != nullptr;
+}
+
+template <class BOARD>
+void MultiChannelOutputT<BOARD>::stop()
+{
+    if (mTimer != nullptr)
+        mTimer->stopTimer();
+}
+
+template <class BOARD>
+void MultiChannelOutputT<BOARD>::start()
+{
+    if (mStarted && mMode == McMode::CPU && mTimer != nullptr)
+        mTimer->startTimer();
+}
+
+template <class BOARD>
+void MultiChannelOutputT<BOARD>::render()
+{
+    for (uint8_t i = 0; i < mCount; i++)
+    {
+        if (mChannels[i].render)
+            mChannels[i].render(mPlanar[i], MC_BLOCK_SAMPLES);
+        else
+            memset(mPlanar[i], 0, MC_BLOCK_SAMPLES);
+    }
+    mBlocks++;
+}
+
+template <class BOARD>
+bool MultiChannelOutputT<BOARD>::send(const uint8_t planar[][MC_BLOCK_SAMPLES])
+{
+    if (mMode == McMode::CPU)
+    {
+        if (mReady[mWriteBuf].load(std::memory_order_acquire))
+            return false;
+        interleave(planar, mCount, MC_BLOCK_SAMPLES, mFrames[mWriteBuf]);
+        mReady[mWriteBuf].store(true, std::memory_order_release);
+        mWriteBuf ^= 1;
+        return true;
+    }
+
+    // the other buffer may still be going out: sendDataDMA() returns once it is done
+    encode(planar, mCount, mPeriodTicks, mSymbols[mSymbolBuf]);
+    mBoard->sendDataDMA((uint8_t *)mSymbols[mSymbolBuf], (size_t)mCount * MC_BLOCK_SYMBOLS * sizeof(uint32_t));
+    mSymbolBuf ^= 1;
+    return true;
+}
+
+template <class BOARD>
+bool MultiChannelOutputT<BOARD>::service()
+{
+    if (!mStarted || mCount == 0)
+        return false;
+    if (mMode == McMode::CPU && mReady[mWriteBuf].load(std::memory_order_acquire))
+    {
+        // nothing to do until the timer has played half of the queued frames
+        mBoard->delay(mWaitMs);
+        return false;
+    }
+    render();
+    return send(mPlanar);
+}
+
+template <class BOARD>
+bool MultiChannelOutputT<BOARD>::push(const uint8_t planar[][MC_BLOCK_SAMPLES])
+{
+    if (!mStarted || mCount == 0)
+        return false;
+    return send(planar);
+}
+
+template <class BOARD>
+void MultiChannelOutputT<BOARD>::timerCallback(void *param)
+{
+    static_cast<MultiChannelOutputT *>(param)->tick();
+}
+
+template <class BOARD>
+void MultiChannelOutputT<BOARD>::tick()
+{
+    if (!mReady[mReadBuf].load(std::memory_order_acquire))
+    {
+        // hold the last values until the renderer catches up
+        mUnderruns.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    const uint8_t *frame = &mFrames[mReadBuf][mReadPos * mCount];
+    PinWrite changed[MC_MAX_CHANNELS];
+    uint8_t n = 0;
+    for (uint8_t i = 0; i < mCount; i++)
+    {
+        if (frame[i] != mChannels[i].last)
+        {
+            mChannels[i].last = frame[i];
+            changed[n++] = {mChannels[i].pin, frame[i]};
+        }
+    }
+    if (n)
+    {
+        // one board call per tick, and the board latches the channels together
+        BoardCall<BOARD>::writePins(mBoard, changed, n);
+        mPinWrites.fetch_add(n, std::memory_order_relaxed);
+    }
+    if (++mReadPos == MC_BLOCK_SAMPLES)
+    {
+        mReadPos = 0;
+        mReady[mReadBuf].store(false, std::memory_order_release);
+        mReadBuf ^= 1;
+    }
+}
+
+void MultiChannelCodec::interleave(const uint8_t planar[][MC_BLOCK_SAMPLES], uint8_t channels, size_t count, uint8_t *frames)
+{
+    for (uint8_t c = 0; c < channels; c++)
+    {
+        const uint8_t *src = planar[c];
+        uint8_t *dst = frames + c;
+        for (size_t i = 0; i < count; i++, dst += channels)
+            *dst = src[i];
+    }
+}
+
+uint32_t MultiChannelCodec::encodePwm(uint8_t value, uint16_t periodTicks)
+{
+    if (value == 0 || value == 255)
+    {
+        uint32_t level = value ? 1 : 0;
+        uint32_t first = periodTicks / 2;
+        return first | (level << 15) | ((uint32_t)(periodTicks - first) << 16) | (level << 31);
+    }
+    uint32_t high = ((uint32_t)value * periodTicks + 127) / 255;
+    if (high < 1)
+        high = 1;
+    if (high > (uint32_t)periodTicks - 1)
+        high = periodTicks - 1;
+    return high | (1UL << 15) | ((uint32_t)(periodTicks - high) << 16);
+}
+
+void MultiChannelCodec::encode(const uint8_t planar[][MC_BLOCK_SAMPLES], uint8_t channels, uint16_t periodTicks, uint32_t *symbols)
+{
+    // symbols only depend on the value: cache the last one, haptic signals change slowly
+    for (uint8_t c = 0; c < channels; c++)
+    {
+        uint8_t lastValue = planar[c][0];
+        uint32_t lastSymbol = encodePwm(lastValue, periodTicks);
+        for (size_t i = 0; i < MC_BLOCK_SAMPLES; i++)
+        {
+            if (planar[c][i] != lastValue)
+            {
+                lastValue = planar[c][i];
+                lastSymbol = encodePwm(lastValue, periodTicks);
+            }
+            for (uint8_t p = 0; p < MC_PWM_PERIODS_PER_SAMPLE; p++)
+                *symbols++ = lastSymbol;
+        }
+    }
+}
+
+template class MultiChannelOutputT<BoardProfile>;
+#if RESONANCE_STATIC_BOARD
+template class MultiChannelOutputT<ResonanceBoard>;
+#endif
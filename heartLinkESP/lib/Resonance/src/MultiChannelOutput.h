@@ -0,0 +1,249 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <functional>
+#include "BoardConfig.h"
+
+#define MC_MAX_CHANNELS 8
+#define MC_BLOCK_SAMPLES 32             /*!< Samples rendered per channel and block */
+#define MC_DEFAULT_SAMPLE_RATE 8000
+#define MC_PWM_PERIODS_PER_SAMPLE 4     /*!< PWM runs at this multiple of the sample rate */
+#define MC_SYMBOL_CLOCK_HZ 10000000UL   /*!< Tick of the PWM symbols (RMT: 80 MHz APB / 8) */
+#define MC_NO_TIMER 0xFF                /*!< begin(): the CPU fallback has no hardware timer of its own */
+#define MC_BLOCK_SYMBOLS (MC_BLOCK_SAMPLES * MC_PWM_PERIODS_PER_SAMPLE)
+
+/**
+ * @brief How the rendered blocks reach the pins.
+ */
+enum class McMode : uint8_t
+{
+    DMA, /*!< Whole blocks through BoardProfile::sendDataDMA() */
+    CPU, /*!< One frame per timer tick through the board's writePins() */
+    NONE, /*!< Not started: the CPU fallback had no timer */
+};
+
+/**
+ * @brief Fills count samples (0 = off, 255 = full duty) for one channel.
+ */
+typedef std::function<void(uint8_t *samples, size_t count)> McRenderFn;
+
+struct MultiChannelStats
+{
+    uint32_t blocks = 0;     /*!< Blocks rendered */
+    uint32_t underruns = 0;  /*!< CPU ticks that found no rendered frame */
+    uint32_t pinWrites = 0;  /*!< Duty writes done by the CPU path */
+};
+
+/**
+ * @brief The block transforms of MultiChannelOutput; they don't depend on the board.
+ */
+class MultiChannelCodec
+{
+public:
+    /**
+     * @brief Interleave planar channel blocks into frames.
+     *
+     * @param planar channels x MC_BLOCK_SAMPLES samples.
+     * @param channels Number of channels.
+     * @param count Samples per channel.
+     * @param frames Output, count * channels values, one frame after the other.
+     */
+    static void interleave(const uint8_t planar[][MC_BLOCK_SAMPLES], uint8_t channels, size_t count, uint8_t *frames);
+    /**
+     * @brief Encode one PWM period as a symbol.
+     *
+     * @param value Duty, 0 = always low, 255 = always high.
+     * @param periodTicks Period length in ticks, 2 to 32767.
+     * @return uint32_t High part then low part; constant levels are split in
+     *         two equal halves, since a zero duration ends an RMT transmission.
+     */
+    static uint32_t encodePwm(uint8_t value, uint16_t periodTicks);
+    /**
+     * @brief Encode planar channel blocks into symbol blocks.
+     *
+     * @param planar channels x MC_BLOCK_SAMPLES samples.
+     * @param channels Number of channels.
+     * @param periodTicks Period length in ticks.
+     * @param symbols Output, MC_BLOCK_SYMBOLS symbols per channel, channel after channel.
+     */
+    static void encode(const uint8_t planar[][MC_BLOCK_SAMPLES], uint8_t channels, uint16_t periodTicks, uint32_t *symbols);
+};
+
+/**
+ * @brief Renders all haptic channels in blocks and streams them out by DMA.
+ *
+ * Writing the LEDC duty of every channel from the sample timer costs a
+ * register update per channel and sample. Here each channel renders
+ * MC_BLOCK_SAMPLES samples at a time instead, and the block goes out in one
+ * of two ways behind the same API:
+ *
+ * - DMA: every sample becomes MC_PWM_PERIODS_PER_SAMPLE PWM periods encoded
+ *   as 32 bit symbols (duration0:15, level0:1, duration1:15, level1:1 - the
+ *   RMT item layout) on the MC_SYMBOL_CLOCK_HZ clock, stored channel after
+ *   channel, and the whole block is handed to BoardProfile::sendDataDMA(),
+ *   which returns once the block is queued. Two symbol buffers alternate, so
+ *   one is rendered while the other is sent.
+ * - CPU: if the board's sendDataDMA() refuses the first block (the default
+ *   BoardProfile one does), the samples are interleaved into frames and a
+ *   timer writes one frame per sample with a single writePins() call,
+ *   leaving out channels whose value didn't change.
+ *
+ * The board's four hardware timers all have an owner already (WAVE_GEN_TIMER
+ * .. ADC_TIMER), so the CPU path takes none by default: give it a
+ * TimerService timer with setTimer(), or pass begin() a hardware timer the
+ * build leaves free. On the ESP32 begin() claims that timer first
+ * (ESP32Timer::claim()) and fails if a VH driver, Esp32Alarm or Esp32Adc
+ * has it.
+ *
+ * render, interleave and encode are plain functions of the samples, so the
+ * whole block path runs on a host profile as well.
+ *
+ * BOARD is the profile class the per-sample writePins() goes to, through
+ * BoardCall: a concrete profile's own inline one, or pin by pin through
+ * BoardProfile. MultiChannelOutput uses the board picked in BoardConfig.h.
+ *
+ * @code {.cpp}
+ * Esp32RmtProfile board;
+ * MultiChannelOutput out(8000);
+ * out.addChannel(25, [](uint8_t *s, size_t n) { left.render(s, n); });
+ * out.addChannel(26, [](uint8_t *s, size_t n) { right.render(s, n); });
+ * out.addChannel(27, [](uint8_t *s, size_t n) { chest.render(s, n); });
+ * board.beginRmt(out.getPins(), out.getChannelCount());
+ * out.setTimer(timers.createTimer(8000)); // only used if the RMT is missing
+ * out.begin(&board);
+ * for (;;)
+ *     out.service(); // in its own task: blocks while the RMT or the CPU path is busy
+ * @endcode
+ */
+template <class BOARD = ResonanceBoard>
+class MultiChannelOutputT : public MultiChannelCodec
+{
+    struct Channel
+    {
+        uint8_t pin = 0;
+        McRenderFn render = nullptr;
+        uint8_t last = 0; /*!< Last value written by the CPU path */
+    };
+
+    BOARD *mBoard = nullptr;
+    IBoardTimer *mTimer = nullptr;
+    Channel mChannels[MC_MAX_CHANNELS];
+    uint8_t mPins[MC_MAX_CHANNELS];
+    uint8_t mCount = 0;
+    uint32_t mSampleRate;
+    uint16_t mPeriodTicks;
+    uint16_t mWaitMs;       /*!< CPU path: sleep of service() while both buffers are full */
+    McMode mMode = McMode::DMA;
+    bool mStarted = false;
+    uint8_t mClaimed = MC_NO_TIMER; /*!< Hardware timer claimed by begin() */
+    uint32_t mBlocks = 0;
+    // written by the timer ISR, read by any task
+    std::atomic<uint32_t> mUnderruns{0};
+    std::atomic<uint32_t> mPinWrites{0};
+
+    uint8_t mPlanar[MC_MAX_CHANNELS][MC_BLOCK_SAMPLES];
+    // DMA path
+    uint32_t mSymbols[2][MC_MAX_CHANNELS * MC_BLOCK_SYMBOLS];
+    uint8_t mSymbolBuf = 0;
+    // CPU path: two frame blocks, the timer reads one while the other is rendered
+    uint8_t mFrames[2][MC_BLOCK_SAMPLES * MC_MAX_CHANNELS];
+    std::atomic<bool> mReady[2];
+    uint8_t mWriteBuf = 0;
+    uint8_t mReadBuf = 0;
+    uint16_t mReadPos = 0;
+
+    void render();
+    bool send(const uint8_t planar[][MC_BLOCK_SAMPLES]);
+    bool claimTimer(uint8_t timer);
+    static void timerCallback(void *param);
+
+public:
+    /**
+     * @brief Construct a new output.
+     *
+     * @param sampleRate Rate at which the channels render, in Hz.
+     */
+    explicit MultiChannelOutputT(uint32_t sampleRate = MC_DEFAULT_SAMPLE_RATE);
+    ~MultiChannelOutputT();
+    /**
+     * @brief Add a channel; only before begin().
+     *
+     * @param pin Output pin.
+     * @param render Fills the next samples of the channel; nullptr if the
+     *               blocks come from push() instead (they start silent).
+     * @return int Channel index, -1 if all MC_MAX_CHANNELS are in use.
+     */
+    int addChannel(uint8_t pin, McRenderFn render = nullptr);
+    /**
+     * @brief Start output: DMA if the board takes the first block, else the CPU timer.
+     *
+     * @param board Board profile doing the output.
+     * @param cpuTimer Hardware timer for the CPU fallback if setTimer() gave
+     *                 it none; it must be free, see the class description.
+     * @return McMode The path in use; NONE if the CPU fallback has no timer.
+     */
+    McMode begin(BOARD *board, uint8_t cpuTimer = MC_NO_TIMER);
+    /**
+     * @brief Pace the CPU path with this timer instead of creating one on
+     * cpuTimer, e.g. a TimerService::createTimer(); only before begin().
+     * It must run at the sample rate.
+     */
+    void setTimer(IBoardTimer *timer) { mTimer = timer; }
+    /**
+     * @brief Stop the CPU timer. The DMA path stops when service() isn't called.
+     */
+    void stop();
+    /**
+     * @brief Restart the CPU timer after stop(), e.g. when a PowerManager
+     * wakes the output; the frames still queued play first.
+     */
+    void start();
+    /**
+     * @brief Render and queue the next block where there is room; call in a loop
+     * from the output task. With DMA it blocks in sendDataDMA() while the
+     * previous block is still going out. With CPU and both frame buffers
+     * full it sleeps half a block in the board's delay() instead, so the
+     * loop never spins and the idle task keeps feeding the watchdog.
+     *
+     * @return bool true if a block was rendered.
+     */
+    bool service();
+    /**
+     * @brief Queue a block rendered elsewhere, e.g. by a RenderScheduler.
+     *
+     * @param planar getChannelCount() x MC_BLOCK_SAMPLES samples.
+     * @return bool false if both CPU frame buffers are still full.
+     */
+    bool push(const uint8_t planar[][MC_BLOCK_SAMPLES]);
+    /**
+     * @brief CPU path: write the next frame. Called by the timer at the sample rate.
+     */
+    void tick();
+
+    McMode getMode() const { return mMode; }
+    uint8_t getChannelCount() const { return mCount; }
+    const uint8_t *getPins() const { return mPins; }
+    /**
+     * @brief Length of one PWM period in MC_SYMBOL_CLOCK_HZ ticks.
+     */
+    uint16_t getPeriodTicks() const { return mPeriodTicks; }
+    MultiChannelStats getStats() const
+    {
+        MultiChannelStats stats;
+        stats.blocks = mBlocks;
+        stats.underruns = mUnderruns.load(std::memory_order_relaxed);
+        stats.pinWrites = mPinWrites.load(std::memory_order_relaxed);
+        return stats;
+    }
+};
+
+extern template class MultiChannelOutputT<BoardProfile>;
+#if RESONANCE_STATIC_BOARD
+extern template class MultiChannelOutputT<ResonanceBoard>;
+#endif
+/**
+ * @brief Output for the board of the build: statically dispatched with a
+ * RESONANCE_BOARD_* flag (see BoardConfig.h), through BoardProfile otherwise.
+ */
+typedef MultiChannelOutputT<ResonanceBoard> MultiChannelOutput;
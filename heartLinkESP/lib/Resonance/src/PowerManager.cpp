@@ -0,0 +1,234 @@
+#include "PowerManager.h"
+
+PowerManager::PowerManager(BoardProfile *board, uint8_t channels, int priority, int8_t coreId)
+    : FirmwareTask("power", priority, coreId, PM_POLL_MS, 1), mBoard(board),
+      mChannels(channels == 0 ? 1 : (channels > PM_MAX_CHANNELS ? PM_MAX_CHANNELS : channels))
+{
+    mAllMask = (uint8_t)((1u << mChannels) - 1);
+    for (uint8_t c = 0; c < PM_MAX_CHANNELS; c++)
+        mLastActiveMs[c].store(0, std::memory_order_relaxed);
+    mMutex = mBoard->createMutexHandle();
+    if (mMutex)
+        mMutex->createMutex();
+}
+
+PowerManager::~PowerManager()
+{
+    delete mMutex;
+}
+
+bool PowerManager::addEnablePin(uint8_t pin, uint8_t activeLevel, uint8_t channels)
+{
+    if (mPinCount >= PM_MAX_PINS)
+        return false;
+    mPins[mPinCount].pin = pin;
+    mPins[mPinCount].activeLevel = activeLevel ? 1 : 0;
+    mPins[mPinCount].channels = channels;
+    mPinCount++;
+    return true;
+}
+
+bool PowerManager::addTimer(IBoardTimer *timer)
+{
+    if (mTimerCount >= PM_MAX_TIMERS || !timer)
+        return false;
+    mTimers[mTimerCount++] = timer;
+    return true;
+}
+
+void PowerManager::begin()
+{
+    for (uint8_t i = 0; i < mPinCount; i++)
+    {
+        mBoard->pinMode(mPins[i].pin);
+        setPin(i, true);
+    }
+    uint32_t now = mBoard->millis();
+    for (uint8_t c = 0; c < mChannels; c++)
+        mLastActiveMs[c].store(now);
+    mRunning.store(true);
+    mPowered.store(poweredMask());
+}
+
+void PowerManager::onTick(uint32_t)
+{
+    // the board clock, the one wake() stamps with, not the task's tick time
+    update(mBoard->millis());
+}
+
+void PowerManager::setPin(uint8_t index, bool on)
+{
+    EnablePin &pin = mPins[index];
+    mBoard->digitalWrite(pin.pin, on ? pin.activeLevel : !pin.activeLevel);
+    if (on)
+        mPinsOn.fetch_or((uint8_t)(1u << index));
+    else
+        mPinsOn.fetch_and((uint8_t)~(1u << index));
+}
+
+uint8_t PowerManager::awakeMask(uint32_t nowMs)
+{
+    uint8_t busy = mBusy.load();
+    uint8_t awake = 0;
+    for (uint8_t c = 0; c < mChannels; c++)
+    {
+        // a stamp newer than nowMs gives a negative age: awake
+        if ((busy & (1u << c)) || (int32_t)(nowMs - mLastActiveMs[c].load()) < (int32_t)mIdleTimeoutMs)
+            awake |= 1u << c;
+    }
+    return awake;
+}
+
+uint8_t PowerManager::poweredMask()
+{
+    if (!mRunning.load(std::memory_order_relaxed))
+        return 0;
+    uint8_t powered = mAllMask;
+    for (uint8_t i = 0; i < mPinCount; i++)
+    {
+        if (!pinOn(i))
+            powered &= ~mPins[i].channels;
+    }
+    return powered;
+}
+
+uint32_t PowerManager::wake(uint8_t channel)
+{
+    uint8_t mask = channel == PM_ALL_CHANNELS ? mAllMask : (channel < mChannels ? (uint8_t)(1u << channel) : 0);
+    if (!mask)
+        return 0;
+    unsigned long startUs = mBoard->getTimeMicroseconds();
+    uint32_t now = mBoard->millis();
+    for (uint8_t c = 0; c < mChannels; c++)
+    {
+        if (mask & (1u << c))
+            mLastActiveMs[c].store(now);
+    }
+    // the stamp goes first: a shutdown either sees it or is seen here
+    if ((mPowered.load() & mask) == mask)
+        return 0;
+    return powerUp(mask, startUs);
+}
+
+uint32_t PowerManager::powerUp(uint8_t mask, unsigned long startUs)
+{
+    if (mMutex)
+        mMutex->take(TASK_WAIT_FOREVER);
+    bool switched = false;
+    for (uint8_t i = 0; i < mPinCount; i++)
+    {
+        if (!pinOn(i) && (mPins[i].channels & mask))
+        {
+            setPin(i, true);
+            switched = true;
+        }
+    }
+    if (switched && mSettleUs)
+        mBoard->delayMicroseconds(mSettleUs);
+    if (!mRunning.load(std::memory_order_relaxed))
+    {
+        if (mPowerCb)
+            mPowerCb(true);
+        if (mScheduler)
+            mScheduler->resume();
+        for (uint8_t i = 0; i < mTimerCount; i++)
+            mTimers[i]->startTimer();
+        mRunning.store(true);
+        mStats.sleepMs += mBoard->millis() - mSleepStartMs;
+        switched = true;
+    }
+    mPowered.store(poweredMask());
+
+    uint32_t took = (uint32_t)(mBoard->getTimeMicroseconds() - startUs);
+    if (switched)
+    {
+        mStats.wakeups++;
+        mStats.lastWakeUs = took;
+        if (took > mStats.maxWakeUs)
+            mStats.maxWakeUs = took;
+    }
+    if (mMutex)
+        mMutex->give();
+    return took;
+}
+
+void PowerManager::notify(uint8_t channel, CHANNEL_STATUS status)
+{
+    if (channel >= mChannels)
+        return;
+    uint8_t bit = 1u << channel;
+    if (status == CHANNEL_WAKE)
+    {
+        mBusy.fetch_or(bit);
+        wake(channel);
+        return;
+    }
+    if (status == CHANNEL_IDLE)
+    {
+        // the timeout runs from the idle report
+        mLastActiveMs[channel].store(mBoard->millis());
+        mBusy.fetch_and((uint8_t)~bit);
+    }
+}
+
+void PowerManager::update(uint32_t nowMs)
+{
+    if (mBusyCheck)
+    {
+        for (uint8_t c = 0; c < mChannels; c++)
+        {
+            if (mBusyCheck(c))
+                mLastActiveMs[c].store(nowMs);
+        }
+    }
+    if (!mRunning.load())
+        return;
+    uint8_t awake = awakeMask(nowMs);
+    bool release = awake == 0;
+    for (uint8_t i = 0; i < mPinCount && !release; i++)
+        release = pinOn(i) && !(mPins[i].channels & awake);
+    if (!release)
+        return;
+
+    if (mMutex)
+        mMutex->take(TASK_WAIT_FOREVER);
+    // retract first, then look again: a wake() in between is either seen
+    // here or sees the channel unpowered and waits for the lock
+    mPowered.store(mPowered.load() & awake);
+    awake = awakeMask(nowMs);
+    if (awake == 0 && mRunning.load(std::memory_order_relaxed))
+    {
+        // silence the output before its supply goes
+        for (uint8_t i = 0; i < mTimerCount; i++)
+            mTimers[i]->stopTimer();
+        if (mScheduler)
+            mScheduler->pause();
+        if (mPowerCb)
+            mPowerCb(false);
+        mRunning.store(false);
+        mSleepStartMs = mBoard->millis();
+        mStats.shutdowns++;
+    }
+    for (uint8_t i = 0; i < mPinCount; i++)
+    {
+        if (pinOn(i) && !(mPins[i].channels & awake))
+        {
+            setPin(i, false);
+            if (awake)
+                mStats.pinGates++;
+        }
+    }
+    mPowered.store(poweredMask());
+    if (mMutex)
+        mMutex->give();
+}
+
+PowerManagerStats PowerManager::getStats() const
+{
+    if (mMutex)
+        mMutex->take(TASK_WAIT_FOREVER);
+    PowerManagerStats stats = mStats;
+    if (mMutex)
+        mMutex->give();
+    return stats;
+}
@@ -0,0 +1,195 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <functional>
+#include <BoardProfile.h>
+#include <Utilities/VHUtilities.h>
+#include "TaskFramework.h"
+#include "RenderScheduler.h"
+
+#define PM_MAX_CHANNELS 8
+#define PM_MAX_PINS 4
+#define PM_MAX_TIMERS 4
+#define PM_ALL_CHANNELS 0xFF
+#define PM_IDLE_TIMEOUT_MS 500  /*!< Silence on every channel before the output shuts down */
+#define PM_SETTLE_US 100        /*!< Wait after an enable pin goes active, before output starts */
+#define PM_POLL_MS 10           /*!< Idle check period of the task */
+#define PM_DEFAULT_PRIORITY 2
+
+struct PowerManagerStats
+{
+    uint32_t wakeups = 0;    /*!< Power-ups from wake() that switched something on */
+    uint32_t shutdowns = 0;  /*!< Full shutdowns: timers stopped, every pin off */
+    uint32_t pinGates = 0;   /*!< Enable pins switched off while other channels played */
+    uint32_t lastWakeUs = 0; /*!< Time of the last power-up, from wake() to output running */
+    uint32_t maxWakeUs = 0;
+    uint32_t sleepMs = 0;    /*!< Time spent shut down, up to the last wake */
+};
+
+/**
+ * @brief Shuts the haptic output down while nothing plays.
+ *
+ * Amplifier and driver enable pins (PAM_SHDN_PIN, DRV_SHDN_PIN on the
+ * TITAN Core) are normally held active for good, and the audio-rate timers
+ * keep firing into silent channels; on a battery wearable that idle ISR is
+ * the largest drain. This task watches the channels and, once every one of
+ * them has been idle for the idle timeout, stops the registered timers,
+ * pauses the attached RenderScheduler, calls the power callback (e.g. to
+ * stop an I2S output) and releases the enable pins. An enable pin can serve only some channels:
+ * it is released as soon as those are idle, while the others play on.
+ *
+ * A channel counts as busy while notify() last reported CHANNEL_WAKE for it
+ * or the busy check returns true, and for the idle timeout after that.
+ * Whatever queues output calls wake() first: if the channel is powered that
+ * is one atomic load, otherwise it drives the pins of the channel active,
+ * waits the settle time, then calls the power callback, resumes the
+ * scheduler and restarts the timers before returning. The wait from wake() to a running output is
+ * measured on every power-up (getStats()); it is bounded by the settle time
+ * plus the callback and at most one idle pass of update() it has to wait
+ * for. wake() and update() can run in different tasks: a shutdown retracts
+ * the powered state before it looks at the channels a last time, so a
+ * wake() either sees the channel unpowered and powers it up, or refreshes
+ * it in time to keep it on.
+ *
+ * @code {.cpp}
+ * PowerManager power(&board, 2);
+ * power.addEnablePin(DRV_SHDN_PIN);
+ * power.addEnablePin(PAM_SHDN_PIN, HIGH, 1u << 1); // amplifier of channel 1 only
+ * power.addTimer(outputTimer);
+ * power.attachScheduler(&scheduler);
+ * scheduler.attachCallback([](uint8_t ch, CHANNEL_STATUS s) { power.notify(ch, s); });
+ * power.begin();
+ * tasks.add(&power);
+ * ...
+ * power.wake(0);
+ * shaper.pulse(1.0f, 20);
+ * @endcode
+ */
+class PowerManager : public FirmwareTask
+{
+    struct EnablePin
+    {
+        uint8_t pin = 0;
+        uint8_t activeLevel = 1;
+        uint8_t channels = PM_ALL_CHANNELS;
+    };
+
+    BoardProfile *mBoard;
+    IBoardMutex *mMutex = nullptr;
+    uint8_t mChannels;
+    uint8_t mAllMask;
+    EnablePin mPins[PM_MAX_PINS];
+    uint8_t mPinCount = 0;
+    IBoardTimer *mTimers[PM_MAX_TIMERS];
+    uint8_t mTimerCount = 0;
+    uint32_t mIdleTimeoutMs = PM_IDLE_TIMEOUT_MS;
+    uint32_t mSettleUs = PM_SETTLE_US;
+    RenderScheduler *mScheduler = nullptr;
+    std::function<void(bool on)> mPowerCb = nullptr;
+    std::function<bool(uint8_t channel)> mBusyCheck = nullptr;
+    // shared with wake() and notify() callers
+    std::atomic<uint32_t> mLastActiveMs[PM_MAX_CHANNELS];
+    std::atomic<uint8_t> mBusy{0};
+    std::atomic<uint8_t> mPowered{0};
+    std::atomic<uint8_t> mPinsOn{0}; /*!< Bit per enable pin */
+    std::atomic<bool> mRunning{false};
+    uint32_t mSleepStartMs = 0;
+    PowerManagerStats mStats;
+
+    uint8_t awakeMask(uint32_t nowMs);
+    uint8_t poweredMask();
+    void setPin(uint8_t index, bool on);
+    bool pinOn(uint8_t index) const { return mPinsOn.load(std::memory_order_relaxed) & (1u << index); }
+    uint32_t powerUp(uint8_t mask, unsigned long startUs);
+
+protected:
+    void onTick(uint32_t) override;
+
+public:
+    /**
+     * @brief Construct a new power manager task.
+     *
+     * @param board Board doing the pin writes, the clock and the settle wait.
+     * @param channels Number of channels, up to PM_MAX_CHANNELS.
+     * @param priority RTOS priority.
+     * @param coreId Core to pin to, -1 for any.
+     */
+    explicit PowerManager(BoardProfile *board, uint8_t channels = 1, int priority = PM_DEFAULT_PRIORITY, int8_t coreId = -1);
+    ~PowerManager();
+
+    /**
+     * @brief Add an amplifier or driver enable pin; only before begin().
+     *
+     * @param pin GPIO pin number.
+     * @param activeLevel Level that enables the part: HIGH for shutdown pins.
+     * @param channels Mask of the channels it powers.
+     * @return bool false if all PM_MAX_PINS are in use.
+     */
+    bool addEnablePin(uint8_t pin, uint8_t activeLevel = 1, uint8_t channels = PM_ALL_CHANNELS);
+    /**
+     * @brief Add an audio-rate timer to stop while shut down; only before begin().
+     *
+     * @return bool false if all PM_MAX_TIMERS are in use.
+     */
+    bool addTimer(IBoardTimer *timer);
+    /**
+     * @brief Pause the scheduler while shut down and resume it on a new time
+     * base at power-up; only before begin().
+     */
+    void attachScheduler(RenderScheduler *scheduler) { mScheduler = scheduler; }
+    /**
+     * @brief Called with false after the timers stop and the scheduler
+     * pauses, and with true before the scheduler resumes and the timers
+     * restart.
+     */
+    void onPower(std::function<void(bool on)> cb) { mPowerCb = cb; }
+    /**
+     * @brief Polled every update() for each channel, e.g. whether its
+     * VectorHaptics queue still has effects.
+     */
+    void setBusyCheck(std::function<bool(uint8_t channel)> busy) { mBusyCheck = busy; }
+    void setIdleTimeout(uint32_t ms) { mIdleTimeoutMs = ms; }
+    /**
+     * @brief Wait after enabling a pin, from the amplifier's or driver's
+     * start-up time.
+     */
+    void setSettleUs(uint32_t us) { mSettleUs = us; }
+
+    /**
+     * @brief Configure the pins and start powered, with the timers already
+     * running; the idle timeout starts now.
+     */
+    void begin();
+    /**
+     * @brief Power a channel up before queuing on it.
+     *
+     * @param channel Channel index, PM_ALL_CHANNELS for all.
+     * @return uint32_t Time it took in us, 0 if the channel was powered.
+     */
+    uint32_t wake(uint8_t channel = PM_ALL_CHANNELS);
+    /**
+     * @brief Feed a channel status callback (RenderScheduler or VHChannel):
+     * CHANNEL_WAKE marks the channel busy and wakes it, CHANNEL_IDLE starts
+     * its idle timeout.
+     */
+    void notify(uint8_t channel, CHANNEL_STATUS status);
+    /**
+     * @brief Release what idle channels no longer need. onTick() calls this
+     * every PM_POLL_MS; call it directly to drive the manager from another clock.
+     *
+     * @param nowMs Current board time.
+     */
+    void update(uint32_t nowMs);
+
+    /**
+     * @brief Whether the timers run; false while shut down.
+     */
+    bool isRunning() const { return mRunning.load(std::memory_order_relaxed); }
+    bool isPowered(uint8_t channel) const { return channel < PM_MAX_CHANNELS && (mPowered.load(std::memory_order_relaxed) & (1u << channel)); }
+    /**
+     * @brief Copy of the statistics, taken under the lock that wake() and
+     * update() write them with.
+     */
+    PowerManagerStats getStats() const;
+};
@@ -0,0 +1,199 @@
+#include "RenderScheduler.h"
+#include <cstring>
+
+uint32_t RenderScheduler::periodMs(uint32_t sampleRate)
+{
+    uint32_t period = sampleRate ? (uint32_t)MC_BLOCK_SAMPLES * 1000 / sampleRate : 0;
+    return period ? period : 1;
+}
+
+RenderScheduler::RenderScheduler(uint32_t sampleRate, int priority, int8_t coreId)
+    : FirmwareTask("render", priority, coreId, periodMs(sampleRate ? sampleRate : MC_DEFAULT_SAMPLE_RATE), 1),
+      mSampleRate(sampleRate ? sampleRate : MC_DEFAULT_SAMPLE_RATE)
+{
+    memset(mPlanar, 0, sizeof(mPlanar));
+}
+
+int RenderScheduler::addSource(uint8_t channel, McRenderFn render)
+{
+    if (mSourceCount >= RS_MAX_SOURCES || channel >= MC_MAX_CHANNELS || !render)
+        return -1;
+    mSources[mSourceCount].channel = channel;
+    mSources[mSourceCount].render = render;
+    if (channel >= mChannelCount)
+        mChannelCount = channel + 1;
+    return mSourceCount++;
+}
+
+void RenderScheduler::setMixing(uint8_t channel, MixingStrategy mixing)
+{
+    if (channel < MC_MAX_CHANNELS)
+        mState.update([&](VH::ChannelPlaySet &set) { set.mixing[channel] = (int8_t)mixing; });
+}
+
+void RenderScheduler::setIntensity(uint8_t channel, uint8_t intensity)
+{
+    if (channel < MC_MAX_CHANNELS)
+        mState.update([&](VH::ChannelPlaySet &set) { set.intensity[channel] = intensity; });
+}
+
+void RenderScheduler::setActive(uint8_t channel, bool active)
+{
+    if (channel >= MC_MAX_CHANNELS)
+        return;
+    mState.update([&](VH::ChannelPlaySet &set) {
+        if (active)
+            set.activeMask |= 1u << channel;
+        else
+            set.activeMask &= ~(1u << channel);
+    });
+}
+
+void RenderScheduler::onStart()
+{
+    mStartMs = framework()->millis();
+    mRendered = 0;
+    // one block ahead, so the output never waits for the first tick
+    renderBlock();
+}
+
+void RenderScheduler::onTick(uint32_t)
+{
+    if (mPaused.load())
+        return;
+    mStats.wakeups++;
+    if (mResync.exchange(false))
+    {
+        onStart();
+        return;
+    }
+    uint64_t due = (uint64_t)(framework()->millis() - mStartMs) * mSampleRate / 1000 + MC_BLOCK_SAMPLES;
+    uint8_t rendered = 0;
+    while (mRendered + MC_BLOCK_SAMPLES <= due && rendered < RS_MAX_CATCHUP)
+    {
+        // a full output is ahead, not stalled: retry next tick, skip nothing
+        if (!renderBlock())
+            return;
+        rendered++;
+    }
+    while (mRendered + MC_BLOCK_SAMPLES <= due)
+    {
+        mRendered += MC_BLOCK_SAMPLES;
+        mStats.skipped++;
+    }
+}
+
+bool RenderScheduler::renderBlock()
+{
+    if (mPending)
+    {
+        if (mOutput && !mOutput(mPlanar, mChannelCount))
+            return false;
+        mPending = false;
+        mRendered += MC_BLOCK_SAMPLES;
+        return true;
+    }
+    // one consistent version of the settings for the whole block
+    const VH::ChannelPlaySet play = mState.snapshot();
+    bool first[MC_MAX_CHANNELS];
+    for (uint8_t c = 0; c < mChannelCount; c++)
+        first[c] = true;
+
+    for (uint8_t i = 0; i < mSourceCount; i++)
+    {
+        Source &src = mSources[i];
+        if (!(play.activeMask & (1u << src.channel)))
+            continue;
+        if (first[src.channel])
+        {
+            src.render(mPlanar[src.channel], MC_BLOCK_SAMPLES);
+            first[src.channel] = false;
+            continue;
+        }
+        src.render(mScratch, MC_BLOCK_SAMPLES);
+        mix(mPlanar[src.channel], mScratch, (MixingStrategy)play.mixing[src.channel]);
+    }
+    for (uint8_t c = 0; c < mChannelCount; c++)
+    {
+        uint8_t *block = mPlanar[c];
+        if (first[c])
+            memset(block, 0, MC_BLOCK_SAMPLES); // stopped or without sources
+        uint8_t intensity = play.intensity[c];
+        uint8_t level = 0;
+        for (size_t i = 0; i < MC_BLOCK_SAMPLES; i++)
+        {
+            if (intensity != 255)
+                block[i] = (uint8_t)(((uint16_t)block[i] * intensity + 127) / 255);
+            if (block[i] > level)
+                level = block[i];
+        }
+        VH::ChannelRuntime &rt = mState.runtime(c);
+        rt.level.store(level, std::memory_order_relaxed);
+        rt.samples.fetch_add(MC_BLOCK_SAMPLES, std::memory_order_relaxed);
+        checkIdle(c, level);
+    }
+
+    mStats.blocks++;
+    if (mOutput && !mOutput(mPlanar, mChannelCount))
+    {
+        mStats.overflows++;
+        mPending = true;
+        return false;
+    }
+    mRendered += MC_BLOCK_SAMPLES;
+    return true;
+}
+
+void RenderScheduler::mix(uint8_t *dst, const uint8_t *src, MixingStrategy mixing)
+{
+    switch (mixing)
+    {
+    case ADDITIVE_MIX:
+        for (size_t i = 0; i < MC_BLOCK_SAMPLES; i++)
+        {
+            uint16_t sum = (uint16_t)dst[i] + src[i];
+            dst[i] = sum > 255 ? 255 : (uint8_t)sum;
+        }
+        break;
+    case LARGESTVAL_MIX:
+        for (size_t i = 0; i < MC_BLOCK_SAMPLES; i++)
+        {
+            if (src[i] > dst[i])
+                dst[i] = src[i];
+        }
+        break;
+    case INTERRUPT_MIX:
+        for (size_t i = 0; i < MC_BLOCK_SAMPLES; i++)
+        {
+            if (src[i])
+                dst[i] = src[i];
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+void RenderScheduler::checkIdle(uint8_t channel, uint8_t level)
+{
+    std::atomic<bool> &idle = mState.runtime(channel).idle;
+    if (level)
+    {
+        mSilentBlocks[channel] = 0;
+        if (idle.load(std::memory_order_relaxed))
+        {
+            idle.store(false, std::memory_order_relaxed);
+            if (mStatusCallback)
+                mStatusCallback(channel, CHANNEL_WAKE);
+        }
+        return;
+    }
+    if (mIdleBlocks == 0 || idle.load(std::memory_order_relaxed))
+        return;
+    if (++mSilentBlocks[channel] >= mIdleBlocks)
+    {
+        idle.store(true, std::memory_order_relaxed);
+        if (mStatusCallback)
+            mStatusCallback(channel, CHANNEL_IDLE);
+    }
+}
@@ -0,0 +1,192 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <functional>
+#include <Utilities/VHUtilities.h>
+#include <ChannelState.h>
+#include "MultiChannelOutput.h"
+#include "TaskFramework.h"
+
+#define RS_MAX_SOURCES 16
+#define RS_IDLE_BLOCKS 25       /*!< Silent blocks before a channel reports CHANNEL_IDLE (100 ms at 8 kHz) */
+#define RS_MAX_CATCHUP 4        /*!< Blocks rendered in one tick after a stall, the rest are skipped */
+#define RS_DEFAULT_PRIORITY 5
+#define RS_DEFAULT_CORE 1
+
+/**
+ * @brief Takes a rendered block: channels x MC_BLOCK_SAMPLES values.
+ *
+ * @return bool false if the output had no room for it.
+ */
+typedef std::function<bool(const uint8_t planar[][MC_BLOCK_SAMPLES], uint8_t channels)> RsOutputFn;
+
+struct RenderSchedulerStats
+{
+    uint32_t wakeups = 0;   /*!< Ticks of the scheduler task */
+    uint32_t blocks = 0;    /*!< Blocks rendered */
+    uint32_t skipped = 0;   /*!< Blocks dropped after a stall longer than RS_MAX_CATCHUP */
+    uint32_t overflows = 0; /*!< Blocks the output had no room for at first; they are handed over again */
+};
+
+/**
+ * @brief One audio-rate tick for all haptic channels.
+ *
+ * In the VH library every VHChannel has its own queues, mutex and idle
+ * handler task, and the wave generator, AudioStreaming and the mixer each run
+ * their own hardware timer at the sample rate (WAVE_GEN_TIMER, PCM_TIMER,
+ * MIXER_TIMER). This task replaces all of that for the channels it drives:
+ * it wakes once per MC_BLOCK_SAMPLES block, renders every source, mixes the
+ * sources of each channel with its MixingStrategy and checks for idle
+ * channels in the same pass, then hands the block to the output.
+ *
+ * The number of blocks due follows the sample count, not the tick count, so
+ * sample rates whose block isn't a whole number of ms don't drift; after a
+ * stall at most RS_MAX_CATCHUP blocks are rendered at once. A block the
+ * output refuses is kept and handed over again on the next tick before
+ * anything new is rendered, so no samples are lost. A channel whose
+ * blocks stay silent for RS_IDLE_BLOCKS reports CHANNEL_IDLE, and
+ * CHANNEL_WAKE on its first non-zero sample after that.
+ *
+ * Mixing, intensity and which channels play sit in a VH::ChannelStateTable:
+ * any task can change them while the scheduler runs, each block uses one
+ * complete version of them, and the render path takes no lock. The level
+ * and idle state of each channel are atomics other tasks can poll.
+ *
+ * @code {.cpp}
+ * MultiChannelOutput out(8000);
+ * out.addChannel(25);
+ * out.addChannel(26);
+ * RenderScheduler scheduler(8000);
+ * scheduler.addSource(0, [](uint8_t *s, size_t n) { pulses.render(s, n); });
+ * scheduler.addSource(0, [](uint8_t *s, size_t n) { pcm.render(s, n); });
+ * scheduler.addSource(1, [](uint8_t *s, size_t n) { pcm.render(s, n); });
+ * scheduler.setMixing(0, LARGESTVAL_MIX);
+ * scheduler.setOutput([](const uint8_t p[][MC_BLOCK_SAMPLES], uint8_t n) { return out.push(p); });
+ * out.setTimer(timers.createTimer(8000));
+ * out.begin(&board);
+ * tasks.add(&scheduler);
+ * tasks.start();
+ * @endcode
+ */
+class RenderScheduler : public FirmwareTask
+{
+    struct Source
+    {
+        uint8_t channel = 0;
+        McRenderFn render = nullptr;
+    };
+    typedef VH::ChannelStateTable<MC_MAX_CHANNELS> StateTable;
+
+    Source mSources[RS_MAX_SOURCES];
+    uint8_t mSourceCount = 0;
+    StateTable mState;
+    uint16_t mSilentBlocks[MC_MAX_CHANNELS] = {};
+    uint8_t mChannelCount = 0;
+    uint32_t mSampleRate;
+    uint16_t mIdleBlocks = RS_IDLE_BLOCKS;
+    uint32_t mStartMs = 0;
+    uint64_t mRendered = 0;  /*!< Samples delivered to the output */
+    bool mPending = false;   /*!< mPlanar holds a block the output refused */
+    RsOutputFn mOutput = nullptr;
+    std::function<void(uint8_t, CHANNEL_STATUS)> mStatusCallback = nullptr;
+    RenderSchedulerStats mStats;
+    std::atomic<bool> mPaused{false};
+    std::atomic<bool> mResync{false};
+
+    uint8_t mPlanar[MC_MAX_CHANNELS][MC_BLOCK_SAMPLES];
+    uint8_t mScratch[MC_BLOCK_SAMPLES];
+
+    void mix(uint8_t *dst, const uint8_t *src, MixingStrategy mixing);
+    void checkIdle(uint8_t channel, uint8_t level);
+
+protected:
+    void onStart() override;
+    void onTick(uint32_t) override;
+
+public:
+    /**
+     * @brief Construct a new scheduler task.
+     *
+     * @param sampleRate Rate at which the sources render, in Hz.
+     * @param priority RTOS priority.
+     * @param coreId Core to pin to, -1 for any.
+     */
+    explicit RenderScheduler(uint32_t sampleRate = MC_DEFAULT_SAMPLE_RATE, int priority = RS_DEFAULT_PRIORITY,
+                             int8_t coreId = RS_DEFAULT_CORE);
+    /**
+     * @brief Add a source to a channel; only before the task starts.
+     *
+     * @param channel Output channel index, below MC_MAX_CHANNELS.
+     * @param render Fills the next samples of the source.
+     * @return int Source index, -1 if all RS_MAX_SOURCES are in use.
+     */
+    int addSource(uint8_t channel, McRenderFn render);
+    /**
+     * @brief How the sources of a channel are combined; ADDITIVE_MIX by default.
+     * INTERRUPT_MIX lets the last added source override the others whenever it
+     * is non-zero, NO_MIX and CUSTOM_MIX keep only the first source.
+     */
+    void setMixing(uint8_t channel, MixingStrategy mixing);
+    /**
+     * @brief Scale a channel after mixing, 255 = 1.0 (the default).
+     */
+    void setIntensity(uint8_t channel, uint8_t intensity);
+    /**
+     * @brief Start or stop rendering a channel; a stopped channel outputs 0
+     * and its sources aren't called. All channels play by default.
+     */
+    void setActive(uint8_t channel, bool active);
+    /**
+     * @brief Shared channel state, for changing several settings at once
+     * with update().
+     */
+    StateTable &getState() { return mState; }
+    /**
+     * @brief Silent blocks before CHANNEL_IDLE, 0 to turn idle detection off.
+     */
+    void setIdleBlocks(uint16_t blocks) { mIdleBlocks = blocks; }
+    void setOutput(RsOutputFn output) { mOutput = output; }
+    /**
+     * @brief Stop rendering from the next tick, e.g. while a PowerManager
+     * has the output shut down; the task still wakes but does nothing.
+     */
+    void pause() { mPaused.store(true); }
+    /**
+     * @brief Render again from the next tick, on a new time base: the
+     * blocks due while paused are not caught up.
+     */
+    void resume()
+    {
+        mResync.store(true);
+        mPaused.store(false);
+    }
+    bool isPaused() const { return mPaused.load(std::memory_order_relaxed); }
+    /**
+     * @brief Called from the scheduler task when a channel goes idle or wakes up.
+     */
+    void attachCallback(std::function<void(uint8_t channel, CHANNEL_STATUS status)> statusCb) { mStatusCallback = statusCb; }
+    /**
+     * @brief Render, mix and idle-check one block of every channel and hand it
+     * to the output. onTick() calls this as often as blocks are due; call it
+     * directly to drive the scheduler from another clock.
+     *
+     * A block the output refused is handed over again instead, without
+     * rendering.
+     *
+     * @return bool false if the output had no room for the block; it is kept.
+     */
+    bool renderBlock();
+
+    uint8_t getChannelCount() const { return mChannelCount; }
+    bool isIdle(uint8_t channel) { return channel < MC_MAX_CHANNELS && mState.runtime(channel).idle.load(std::memory_order_relaxed); }
+    /**
+     * @brief Peak of the channel's last block.
+     */
+    uint8_t getLevel(uint8_t channel) { return channel < MC_MAX_CHANNELS ? mState.runtime(channel).level.load(std::memory_order_relaxed) : 0; }
+    /**
+     * @brief Task period in ms: one block, rounded down, at least 1.
+     */
+    static uint32_t periodMs(uint32_t sampleRate);
+    const RenderSchedulerStats &getStats() const { return mStats; }
+};
@@ -0,0 +1,235 @@
+#include "ResonanceTracker.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+ResonanceTracker::ResonanceTracker(uint8_t channel, float defaultHz)
+    : mChannel(channel), mFrequencyHz(defaultHz > 0 ? defaultHz : RESONANT_FREQ)
+{
+}
+
+ResonanceTracker::~ResonanceTracker()
+{
+    if (mAdc)
+        mAdc->stop();
+}
+
+bool ResonanceTracker::begin(IBoardAdc *adc, uint8_t pin, uint32_t sampleRate)
+{
+    if (!adc || mState.load() != State::IDLE)
+        return false;
+    mAdc = adc;
+    if (!mAdc->begin(pin, sampleRate))
+        return false;
+    mSampleRate = mAdc->getSampleRate();
+    mAdc->setCallback(&ResonanceTracker::adcCallback, this);
+    return true;
+}
+
+bool ResonanceTracker::measure()
+{
+    if (mState.load() != State::IDLE || !mDrive)
+        return false;
+    mCount = 0;
+    mBiasSum = 0;
+    mCaptureLen = 0;
+    mCaptureTarget = (size_t)RT_CAPTURE_MS * mSampleRate / 1000;
+    if (mCaptureTarget > RT_MAX_CAPTURE)
+        mCaptureTarget = RT_MAX_CAPTURE;
+    // the release store publishes the setup above to the sampler
+    mState.store(State::BIAS, std::memory_order_release);
+    if (mAdc)
+        mAdc->start();
+    return true;
+}
+
+void ResonanceTracker::adcCallback(const uint16_t *samples, size_t count, void *param)
+{
+    static_cast<ResonanceTracker *>(param)->addSamples(samples, count);
+}
+
+void ResonanceTracker::addSamples(const uint16_t *samples, size_t count)
+{
+    State state = mState.load(std::memory_order_acquire);
+    for (size_t i = 0; i < count; i++)
+    {
+        switch (state)
+        {
+        case State::BIAS:
+            mBiasSum += samples[i];
+            if (++mCount >= (uint32_t)RT_BIAS_MS * mSampleRate / 1000)
+            {
+                mBias = (uint16_t)(mBiasSum / mCount);
+                mCount = 0;
+                state = State::DRIVING;
+                mState.store(state);
+                mDrive(true, mFrequencyHz);
+            }
+            break;
+        case State::DRIVING:
+            if (++mCount >= (uint32_t)RT_BURST_MS * mSampleRate / 1000)
+            {
+                mDrive(false, mFrequencyHz);
+                mCount = 0;
+                state = State::SETTLING;
+                mState.store(state);
+            }
+            break;
+        case State::SETTLING:
+            if (++mCount >= (uint32_t)RT_SETTLE_MS * mSampleRate / 1000)
+            {
+                state = State::CAPTURING;
+                mState.store(state);
+            }
+            break;
+        case State::CAPTURING:
+            mCapture[mCaptureLen++] = (int16_t)((int32_t)samples[i] - mBias);
+            if (mCaptureLen >= mCaptureTarget)
+            {
+                finish();
+                return;
+            }
+            break;
+        case State::IDLE:
+        default:
+            return;
+        }
+    }
+}
+
+void ResonanceTracker::finish()
+{
+    if (mAdc)
+        mAdc->stop();
+
+    ResonanceEstimate e;
+    bool ok = estimate(mCapture, mCaptureLen, mSampleRate, e);
+    if (ok && mAccepted > 0 && fabsf(e.frequencyHz - mFrequencyHz) > RT_MAX_STEP * mFrequencyHz)
+        ok = false;
+    if (!ok)
+    {
+        mRejected++;
+        mState.store(State::IDLE, std::memory_order_release);
+        return;
+    }
+    mLast = e;
+    if (mAccepted == 0)
+    {
+        mFrequencyHz = e.frequencyHz;
+        mTimeConstantMs = e.timeConstantMs;
+    }
+    else
+    {
+        mFrequencyHz += (e.frequencyHz - mFrequencyHz) * RT_SMOOTHING;
+        mTimeConstantMs += (e.timeConstantMs - mTimeConstantMs) * RT_SMOOTHING;
+    }
+    mAccepted++;
+    if (mUpdateCb)
+        mUpdateCb(mChannel, e);
+    // last: measure() may start the next one as soon as it sees IDLE
+    mState.store(State::IDLE, std::memory_order_release);
+}
+
+bool ResonanceTracker::estimate(const int16_t *samples, size_t count, uint32_t sampleRate, ResonanceEstimate &out)
+{
+    if (count < 3 || sampleRate == 0)
+        return false;
+
+    // zero crossings, interpolated, and the peak of each half-cycle between them
+    float firstCross = -1.0f, lastCross = 0.0f, prevCross = 0.0f;
+    uint16_t crossings = 0;
+    int32_t halfPeak = 0;
+    // log-peak against time for the decay fit
+    float sx = 0, sy = 0, sxx = 0, sxy = 0;
+    uint16_t peaks = 0;
+    uint16_t firstPeak = 0;
+
+    for (size_t i = 1; i < count; i++)
+    {
+        int32_t a = samples[i - 1], b = samples[i];
+        int32_t mag = abs(b);
+        if (mag > halfPeak)
+            halfPeak = mag;
+        if ((a < 0) == (b < 0) || a == b)
+            continue;
+        float t = (float)(i - 1) + (float)a / (float)(a - b);
+        if (firstCross >= 0.0f)
+        {
+            // a half-cycle below the floor means the ringdown is over
+            if (halfPeak < RT_MIN_AMPLITUDE)
+                break;
+            float x = (prevCross + t) * 0.5f;
+            float y = logf((float)halfPeak);
+            sx += x;
+            sy += y;
+            sxx += x * x;
+            sxy += x * y;
+            if (peaks++ == 0)
+                firstPeak = (uint16_t)halfPeak;
+            lastCross = t;
+            crossings++;
+        }
+        else
+        {
+            firstCross = t;
+            crossings = 1;
+        }
+        prevCross = t;
+        halfPeak = 0;
+    }
+
+    uint16_t halfCycles = crossings ? crossings - 1 : 0;
+    if (halfCycles < 2 * RT_MIN_CYCLES)
+        return false;
+    float frequency = (float)halfCycles * 0.5f * (float)sampleRate / (lastCross - firstCross);
+    if (frequency < RT_MIN_HZ || frequency > RT_MAX_HZ)
+        return false;
+
+    float denom = peaks * sxx - sx * sx;
+    float slope = denom != 0.0f ? (peaks * sxy - sx * sy) / denom : 0.0f;
+    out.frequencyHz = frequency;
+    // envelope exp(-t / tau): slope is -1 / tau per sample
+    out.timeConstantMs = slope < 0.0f ? -1000.0f / (slope * (float)sampleRate) : 0.0f;
+    out.q = (float)M_PI * frequency * out.timeConstantMs / 1000.0f;
+    out.amplitude = firstPeak;
+    out.cycles = (uint8_t)(halfCycles / 2 > 255 ? 255 : halfCycles / 2);
+    return out.timeConstantMs > 0.0f;
+}
+
+ActuatorModel ResonanceTracker::applyTo(ActuatorModel model) const
+{
+    model.resonantHz = mFrequencyHz;
+    if (mTimeConstantMs > 0.0f)
+        model.timeConstantMs = mTimeConstantMs;
+    return model;
+}
+
+void ResonanceTracker::save(BoardProfile *board) const
+{
+    char key[12];
+    char value[16];
+    snprintf(key, sizeof(key), "res%uf", mChannel);
+    snprintf(value, sizeof(value), "%.2f", mFrequencyHz);
+    board->save(key, value);
+    snprintf(key, sizeof(key), "res%ut", mChannel);
+    snprintf(value, sizeof(value), "%.2f", mTimeConstantMs);
+    board->save(key, value);
+}
+
+bool ResonanceTracker::load(BoardProfile *board)
+{
+    char key[12];
+    snprintf(key, sizeof(key), "res%uf", mChannel);
+    float frequency = strtof(board->read(key, "0").c_str(), nullptr);
+    if (frequency < RT_MIN_HZ || frequency > RT_MAX_HZ)
+        return false;
+    snprintf(key, sizeof(key), "res%ut", mChannel);
+    float tau = strtof(board->read(key, "0").c_str(), nullptr);
+    mFrequencyHz = frequency;
+    if (tau > 0.0f)
+        mTimeConstantMs = tau;
+    // a stored value counts as a measurement, so the next one is step-limited
+    if (mAccepted == 0)
+        mAccepted = 1;
+    return true;
+}
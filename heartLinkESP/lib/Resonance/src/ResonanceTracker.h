@@ -0,0 +1,185 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <functional>
+#include <BoardProfile.h>
+#include <Utilities/VHUtilities.h>
+#include "ActuatorShaper.h"
+
+#define RT_SAMPLE_RATE 8000
+#define RT_MIN_HZ 100.0f
+#define RT_MAX_HZ 300.0f
+#define RT_BIAS_MS 8         /*!< ADC level before the burst, taken as the zero of the back-EMF */
+#define RT_BURST_MS 60       /*!< Drive long enough to build up most of the steady level */
+#define RT_SETTLE_MS 1       /*!< Skipped after the drive stops: driver switching transient */
+#define RT_CAPTURE_MS 40
+#define RT_MAX_CAPTURE 512   /*!< Capture buffer, RT_CAPTURE_MS at up to 12.8 kHz */
+#define RT_MIN_CYCLES 3      /*!< Full cycles a ringdown needs to count */
+#define RT_MIN_AMPLITUDE 20  /*!< ADC counts; half-cycles below this end the ringdown */
+#define RT_MAX_STEP 0.2f     /*!< Largest accepted change against the current estimate */
+#define RT_SMOOTHING 0.5f    /*!< Weight of a new measurement */
+
+/**
+ * @brief Resonance of an LRA measured from one ringdown.
+ */
+struct ResonanceEstimate
+{
+    float frequencyHz = 0;
+    float timeConstantMs = 0; /*!< Envelope decay, Q / (pi * f) */
+    float q = 0;
+    uint16_t amplitude = 0;   /*!< First half-cycle peak, ADC counts */
+    uint8_t cycles = 0;       /*!< Full cycles used */
+};
+
+/**
+ * @brief Switches the measuring burst on or off: drive the channel at
+ * frequencyHz when on, release it (coast, high impedance) when off.
+ */
+typedef std::function<void(bool on, float frequencyHz)> RtDriveFn;
+
+/**
+ * @brief Measures the resonance of one LRA channel from its back-EMF.
+ *
+ * RESONANT_FREQ is fixed at compile time, but actuators vary by about 10%
+ * and drift with temperature, and off resonance they lose acceleration and
+ * waste power. measure() drives a short burst, then lets the actuator ring
+ * down freely and samples the voltage across it through a board ADC
+ * sampler. The ringdown oscillates at the
+ * actuator's own resonance whatever the burst frequency was: estimate()
+ * times its zero crossings (interpolated between samples) for the
+ * frequency and fits the decay of its half-cycle peaks for the time
+ * constant, so one burst of about 100 ms gives both, with no sweep.
+ *
+ * A measurement is used only if it has RT_MIN_CYCLES clean cycles, lies
+ * within RT_MIN_HZ..RT_MAX_HZ and, once there is an estimate, within
+ * RT_MAX_STEP of it; accepted ones are averaged in with RT_SMOOTHING so
+ * the estimate follows temperature drift without jumping on one bad
+ * reading. save() and load() keep it in the board's key-value store, and
+ * applyTo() retunes an ActuatorModel or ActuatorShaper with it; use
+ * pulseDurationMs() and getFrequency() where PULSE_DEFAULT_DURATION and
+ * VIBRATE_DEFAULT_FREQUENCY would be.
+ *
+ * The board has one ADC sampler (Esp32Adc owns ADC_TIMER), so the tracker
+ * borrows it: measure at boot, before the heart rate monitor begins on the
+ * same sampler, or give it the samples through addSamples() from whoever
+ * owns the sampler.
+ *
+ * @code {.cpp}
+ * ResonanceTracker res(0);
+ * res.load(&board);
+ * res.setDrive([](bool on, float hz) { on ? startBurst(hz) : releaseActuator(); });
+ * res.onUpdate([&](uint8_t ch, const ResonanceEstimate &e) { res.applyTo(shaper); res.save(&board); });
+ * res.begin(&adc, BEMF_PIN);
+ * res.measure();
+ * @endcode
+ */
+class ResonanceTracker
+{
+    enum class State : uint8_t
+    {
+        IDLE,
+        BIAS,
+        DRIVING,
+        SETTLING,
+        CAPTURING,
+    };
+
+    uint8_t mChannel;
+    uint32_t mSampleRate = RT_SAMPLE_RATE;
+    IBoardAdc *mAdc = nullptr;
+    RtDriveFn mDrive = nullptr;
+    std::function<void(uint8_t channel, const ResonanceEstimate &estimate)> mUpdateCb = nullptr;
+    std::atomic<State> mState{State::IDLE}; /*!< Written by measure() and the sampler */
+    uint32_t mCount = 0;
+    uint32_t mBiasSum = 0;
+    uint16_t mBias = 0;
+    int16_t mCapture[RT_MAX_CAPTURE];
+    size_t mCaptureLen = 0;
+    size_t mCaptureTarget = 0;
+    float mFrequencyHz;
+    float mTimeConstantMs = ACT_LRA_TAU_MS;
+    uint32_t mAccepted = 0;
+    uint32_t mRejected = 0;
+    ResonanceEstimate mLast;
+
+    void finish();
+    static void adcCallback(const uint16_t *samples, size_t count, void *param);
+
+public:
+    /**
+     * @brief Construct a new tracker.
+     *
+     * @param channel Channel index, for the storage keys and callbacks.
+     * @param defaultHz Estimate until the first measurement.
+     */
+    explicit ResonanceTracker(uint8_t channel = 0, float defaultHz = RESONANT_FREQ);
+    ~ResonanceTracker();
+
+    /**
+     * @brief Set the board sampler up on the back-EMF pin.
+     *
+     * @param adc Board ADC sampler; owned by the caller and used until the
+     *            tracker is deleted or begin() is called again.
+     * @param pin Analog pin across the actuator (through a divider if needed).
+     * @param sampleRate ADC rate in Hz; at least 20 samples per cycle is plenty.
+     * @return true if the sampler accepted the pin and rate.
+     */
+    bool begin(IBoardAdc *adc, uint8_t pin, uint32_t sampleRate = RT_SAMPLE_RATE);
+    void setDrive(RtDriveFn drive) { mDrive = drive; }
+    /**
+     * @brief Called from the sampler's context after each accepted measurement.
+     */
+    void onUpdate(std::function<void(uint8_t channel, const ResonanceEstimate &estimate)> cb) { mUpdateCb = cb; }
+
+    /**
+     * @brief Start a measurement: bias, burst, ringdown.
+     *
+     * @return bool false if one is running or there is no sampler or drive.
+     */
+    bool measure();
+    bool isMeasuring() const { return mState.load() != State::IDLE; }
+    /**
+     * @brief Run the measurement on samples from another source; the ADC
+     * callback calls this.
+     */
+    void addSamples(const uint16_t *samples, size_t count);
+
+    /**
+     * @brief Analyse a ringdown.
+     *
+     * @param samples Back-EMF with its zero removed, starting after the drive stopped.
+     * @param count Number of samples.
+     * @param sampleRate Sample rate in Hz.
+     * @param out Filled when it returns true.
+     * @return bool false if there aren't RT_MIN_CYCLES cycles above RT_MIN_AMPLITUDE.
+     */
+    static bool estimate(const int16_t *samples, size_t count, uint32_t sampleRate, ResonanceEstimate &out);
+
+    float getFrequency() const { return mFrequencyHz; }
+    float getTimeConstantMs() const { return mTimeConstantMs; }
+    /**
+     * @brief One resonance period in ms, the tracked PULSE_DEFAULT_DURATION.
+     */
+    float pulseDurationMs() const { return 1000.0f / mFrequencyHz; }
+    const ResonanceEstimate &getLast() const { return mLast; }
+    uint32_t getAccepted() const { return mAccepted; }
+    uint32_t getRejected() const { return mRejected; }
+
+    /**
+     * @brief The model with the tracked frequency and time constant.
+     */
+    ActuatorModel applyTo(ActuatorModel model) const;
+    void applyTo(ActuatorShaper &shaper) const { shaper.setModel(applyTo(shaper.getModel())); }
+
+    /**
+     * @brief Store the estimate under "res<channel>f" and "res<channel>t".
+     */
+    void save(BoardProfile *board) const;
+    /**
+     * @brief Take a stored estimate, if there is one in range.
+     *
+     * @return bool true if one was loaded.
+     */
+    bool load(BoardProfile *board);
+};
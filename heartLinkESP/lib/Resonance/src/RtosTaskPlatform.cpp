@@ -0,0 +1,100 @@
+#ifdef ARDUINO
+#include "RtosTaskPlatform.h"
+
+int RtosTask::createTask(TaskConfig *config)
+{
+    mTaskConfig.clone(config);
+    BaseType_t core = mTaskConfig.coreId < 0 ? tskNO_AFFINITY : mTaskConfig.coreId;
+    if (xTaskCreatePinnedToCore(mTaskConfig.func, mTaskConfig.name, mTaskConfig.stackSize, mTaskConfig.param,
+                                mTaskConfig.priority, &mHandle, core) != pdPASS)
+    {
+        mHandle = nullptr;
+        return -1;
+    }
+    return 0;
+}
+
+void RtosTask::deleteTask()
+{
+    TaskHandle_t handle = mHandle;
+    mHandle = nullptr;
+    if (handle)
+        vTaskDelete(handle);
+}
+
+RtosQueue::~RtosQueue()
+{
+    if (mQueue)
+        vQueueDelete(mQueue);
+}
+
+void RtosQueue::createQueue(const unsigned int queueSize, const unsigned int size)
+{
+    if (mQueue)
+        vQueueDelete(mQueue);
+    mQueue = xQueueCreate(queueSize, size);
+}
+
+int RtosQueue::receive(void *const pvBuffer, unsigned int xTicksToWait)
+{
+    return mQueue && xQueueReceive(mQueue, pvBuffer, (TickType_t)xTicksToWait) == pdTRUE;
+}
+
+int RtosQueue::send(const void *const pvItemToQueue, unsigned int xTicksToWait)
+{
+    return mQueue && xQueueSend(mQueue, pvItemToQueue, (TickType_t)xTicksToWait) == pdTRUE;
+}
+
+int RtosQueue::receiveISR(void *const pvBuffer, int *pxTaskWoken)
+{
+    BaseType_t woken = pdFALSE;
+    int ok = mQueue && xQueueReceiveFromISR(mQueue, pvBuffer, &woken) == pdTRUE;
+    if (pxTaskWoken)
+        *pxTaskWoken = woken;
+    return ok;
+}
+
+int RtosQueue::sendISR(const void *const pvItemToQueue, int *pxTaskWoken)
+{
+    BaseType_t woken = pdFALSE;
+    int ok = mQueue && xQueueSendFromISR(mQueue, pvItemToQueue, &woken) == pdTRUE;
+    if (pxTaskWoken)
+        *pxTaskWoken = woken;
+    return ok;
+}
+
+int RtosQueue::hasItems()
+{
+    return mQueue ? (int)uxQueueMessagesWaiting(mQueue) : 0;
+}
+
+ITaskManager *RtosTaskPlatform::createTask(TaskConfig *config)
+{
+    RtosTask *task = new RtosTask();
+    if (task->createTask(config) != 0)
+    {
+        delete task;
+        return nullptr;
+    }
+    return task;
+}
+
+IBoardQueue *RtosTaskPlatform::createQueue(unsigned int length, unsigned int itemSize)
+{
+    RtosQueue *queue = new RtosQueue();
+    queue->createQueue(length, itemSize);
+    if (!queue->isCreated())
+    {
+        delete queue;
+        return nullptr;
+    }
+    return queue;
+}
+
+void RtosTaskPlatform::exit(ITaskManager *task)
+{
+    // the handle is only a holder; NULL deletes the calling task
+    delete task;
+    vTaskDelete(nullptr);
+}
+#endif
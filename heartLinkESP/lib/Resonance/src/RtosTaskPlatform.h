@@ -0,0 +1,57 @@
+#pragma once
+#ifdef ARDUINO
+#include <Arduino.h>
+#include "TaskFramework.h"
+
+/**
+ * @brief FreeRTOS task, pinned to TaskConfig::coreId when it is 0 or 1.
+ */
+class RtosTask : public ITaskManager
+{
+    TaskHandle_t mHandle = nullptr;
+
+public:
+    RtosTask() = default;
+    int createTask(TaskConfig *config) override;
+    /**
+     * @brief Delete the task; from the task itself this does not return.
+     */
+    void deleteTask() override;
+};
+
+/**
+ * @brief FreeRTOS queue. Timeouts are ticks, i.e. milliseconds with the
+ * Arduino core's 1 kHz tick; TASK_WAIT_FOREVER is portMAX_DELAY.
+ */
+class RtosQueue : public IBoardQueue
+{
+    QueueHandle_t mQueue = nullptr;
+
+public:
+    RtosQueue() = default;
+    ~RtosQueue();
+    void createQueue(const unsigned int queueSize, const unsigned int size) override;
+    bool isCreated() const { return mQueue != nullptr; }
+    int receive(void *const pvBuffer, unsigned int xTicksToWait) override;
+    int send(const void *const pvItemToQueue, unsigned int xTicksToWait) override;
+    int receiveISR(void *const pvBuffer, int *pxTaskWoken) override;
+    int sendISR(const void *const pvItemToQueue, int *pxTaskWoken) override;
+    int hasItems() override;
+};
+
+/**
+ * @brief TaskFramework platform straight on FreeRTOS, for firmware that
+ * doesn't run a BoardProfile.
+ */
+class RtosTaskPlatform : public ITaskPlatform
+{
+public:
+    ITaskManager *createTask(TaskConfig *config) override;
+    IBoardQueue *createQueue(unsigned int length, unsigned int itemSize) override;
+    uint32_t millis() override { return ::millis(); }
+    /**
+     * @brief Free the RtosTask and delete the calling task; doesn't return.
+     */
+    void exit(ITaskManager *task) override;
+};
+#endif
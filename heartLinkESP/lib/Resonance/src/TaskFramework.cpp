@@ -0,0 +1,143 @@
+#include "TaskFramework.h"
+
+FirmwareTask::FirmwareTask(const char *name, int priority, int8_t coreId, uint32_t periodMs,
+                           uint16_t queueLen, int stackSize)
+    : mConfig(name, stackSize, this, priority, &FirmwareTask::entry, coreId),
+      mPeriodMs(periodMs), mQueueLen(queueLen ? queueLen : 1)
+{
+}
+
+void FirmwareTask::entry(void *param)
+{
+    FirmwareTask *self = static_cast<FirmwareTask *>(param);
+    TaskFramework *fw = self->mFramework;
+    TaskMessage msg;
+    self->onStart();
+    uint32_t nextTick = fw->millis() + self->mPeriodMs;
+
+    while (fw->mRunning.load())
+    {
+        uint32_t wait = TASK_WAIT_FOREVER;
+        if (self->mPeriodMs)
+        {
+            int32_t remaining = (int32_t)(nextTick - fw->millis());
+            wait = remaining > 0 ? (uint32_t)remaining : 0;
+        }
+        if (self->mInbox->receive(&msg, wait))
+        {
+            if (msg.type == TASK_MSG_STOP)
+                continue;
+            uint32_t latency = fw->millis() - msg.timeMs;
+            if (latency > self->mMaxLatencyMs.load(std::memory_order_relaxed))
+                self->mMaxLatencyMs.store(latency, std::memory_order_relaxed);
+            self->onMessage(msg);
+            self->mHandled.fetch_add(1, std::memory_order_relaxed);
+        }
+        if (self->mPeriodMs && (int32_t)(fw->millis() - nextTick) >= 0)
+        {
+            self->onTick(nextTick);
+            // stay on the original grid; skip whole periods after a stall
+            nextTick += self->mPeriodMs;
+            if ((int32_t)(fw->millis() - nextTick) >= 0)
+                nextTick = fw->millis() + self->mPeriodMs;
+        }
+    }
+    // stop() may have handed mTask over already: take it before letting
+    // start() reuse the slot, then end through the platform
+    ITaskManager *handle = self->mTask;
+    self->mActive.store(false);
+    fw->mPlatform->exit(handle);
+}
+
+uint8_t TaskFramework::add(FirmwareTask *task)
+{
+    if (mRunning.load() || mCount >= TASK_MAX_TASKS || !task)
+        return 0xFF;
+    task->mId = mCount;
+    task->mFramework = this;
+    mTasks[mCount++] = task;
+    return task->mId;
+}
+
+bool TaskFramework::start()
+{
+    if (mRunning.load())
+        return true;
+    // every inbox exists before any task runs, so early posts land
+    for (uint8_t i = 0; i < mCount; i++)
+    {
+        FirmwareTask *task = mTasks[i];
+        if (task->mActive.load())
+            return false;
+        task->mTask = nullptr;
+        if (!task->mInbox)
+        {
+            task->mInbox = mPlatform->createQueue(task->mQueueLen, sizeof(TaskMessage));
+            if (!task->mInbox)
+                return false;
+        }
+    }
+    mRunning.store(true);
+    for (uint8_t i = 0; i < mCount; i++)
+    {
+        FirmwareTask *task = mTasks[i];
+        task->mActive.store(true);
+        task->mTask = mPlatform->createTask(&task->mConfig);
+        if (!task->mTask)
+        {
+            task->mActive.store(false);
+            stop();
+            return false;
+        }
+    }
+    return true;
+}
+
+void TaskFramework::stop()
+{
+    if (!mRunning.exchange(false))
+        return;
+    TaskMessage wake;
+    wake.type = TASK_MSG_STOP;
+    for (uint8_t i = 0; i < mCount; i++)
+    {
+        FirmwareTask *task = mTasks[i];
+        if (!task->mTask)
+            continue;
+        task->mInbox->send(&wake, 0);
+        // otherwise the task still runs and frees it in ITaskPlatform::exit()
+        if (mPlatform->join(task->mTask))
+        {
+            delete task->mTask;
+            task->mTask = nullptr;
+        }
+    }
+}
+
+bool TaskFramework::post(uint8_t dst, TaskMessage &msg)
+{
+    if (dst >= mCount || !mTasks[dst]->mInbox)
+        return false;
+    FirmwareTask *task = mTasks[dst];
+    msg.timeMs = mPlatform->millis();
+    if (task->mInbox->send(&msg, 0))
+        return true;
+    task->mDropped.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+bool TaskFramework::postISR(uint8_t dst, uint8_t type, int *pxTaskWoken)
+{
+    if (pxTaskWoken)
+        *pxTaskWoken = 0;
+    if (dst >= mCount || !mTasks[dst]->mInbox)
+        return false;
+    FirmwareTask *task = mTasks[dst];
+    TaskMessage msg;
+    msg.type = type;
+    msg.timeMs = mPlatform->millis();
+    if (task->mInbox->sendISR(&msg, pxTaskWoken))
+        return true;
+    task->mDropped.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
@@ -0,0 +1,229 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <atomic>
+#include <BoardProfile.h>
+
+#define TASK_MAX_TASKS 8
+#define TASK_MSG_PAYLOAD 48    /*!< Fits a raw 42-byte DMP packet */
+#define TASK_DEFAULT_QUEUE_LEN 8
+#define TASK_DEFAULT_STACK 4096
+#define TASK_WAIT_FOREVER 0xFFFFFFFFUL
+#define TASK_MSG_STOP 0xFF     /*!< Reserved: wakes a task so it can exit */
+
+/**
+ * @brief Fixed-size message passed by value through a task inbox.
+ */
+struct TaskMessage
+{
+    uint8_t type = 0;
+    uint8_t source = 0xFF;  /*!< Sending task id, 0xFF from outside the framework */
+    uint16_t len = 0;
+    uint32_t timeMs = 0;    /*!< Post time, used for queue latency stats */
+    uint8_t data[TASK_MSG_PAYLOAD];
+
+    /**
+     * @brief Copy of the payload posted as T; the buffer has no alignment
+     * for T, so it isn't read in place.
+     */
+    template <typename T>
+    T as() const
+    {
+        static_assert(sizeof(T) <= TASK_MSG_PAYLOAD, "payload too large for TaskMessage");
+        T value;
+        memcpy(&value, data, sizeof(T));
+        return value;
+    }
+};
+
+/**
+ * @brief What the framework needs from the platform.
+ *
+ * Tasks and queues come from the usual board interfaces (ITaskManager,
+ * IBoardQueue); queue timeouts are in milliseconds, which matches FreeRTOS
+ * ticks with the Arduino core's 1 kHz tick. BoardTaskPlatform adapts a
+ * BoardProfile, RtosTaskPlatform goes straight to FreeRTOS and
+ * HostTaskPlatform runs the same tasks on std::thread.
+ */
+class ITaskPlatform
+{
+public:
+    virtual ~ITaskPlatform() {}
+    virtual ITaskManager *createTask(TaskConfig *config) = 0;
+    /**
+     * @brief Create a queue of length items of itemSize bytes.
+     *
+     * @return IBoardQueue* The queue, nullptr if it couldn't be allocated.
+     */
+    virtual IBoardQueue *createQueue(unsigned int length, unsigned int itemSize) = 0;
+    virtual uint32_t millis() = 0;
+    /**
+     * @brief Wait for a task whose loop has returned.
+     *
+     * @return true if the task is gone and its ITaskManager can be deleted.
+     *         Boards return false: their tasks delete themselves, see exit().
+     */
+    virtual bool join(ITaskManager *) { return false; }
+    /**
+     * @brief Last call of a task whose loop has returned, from the task
+     * itself. Where join() returns false the task owns its ITaskManager from
+     * here on: free it and end the task. FreeRTOS tasks must not return, so
+     * on a board this doesn't. The default ends the task through
+     * deleteTask(), which can't also free the object.
+     */
+    virtual void exit(ITaskManager *task) { task->deleteTask(); }
+};
+
+class TaskFramework;
+
+/**
+ * @brief A firmware task with its own bounded inbox.
+ *
+ * Derive and override onMessage() for event-driven work and/or onTick() for
+ * periodic work. The task blocks on its inbox until a message arrives or
+ * its next tick is due, so an idle task costs nothing and a busy one never
+ * holds up the others beyond its priority.
+ */
+class FirmwareTask
+{
+    friend class TaskFramework;
+
+    TaskConfig mConfig;
+    uint32_t mPeriodMs;
+    uint16_t mQueueLen;
+    uint8_t mId = 0xFF;
+    TaskFramework *mFramework = nullptr;
+    IBoardQueue *mInbox = nullptr;
+    ITaskManager *mTask = nullptr;
+    // set by start(), cleared by the task once it no longer reads mTask
+    std::atomic<bool> mActive{false};
+    // mDropped is counted by every poster, the others by the task itself
+    std::atomic<uint32_t> mDropped{0};
+    std::atomic<uint32_t> mHandled{0};
+    std::atomic<uint32_t> mMaxLatencyMs{0};
+
+    static void entry(void *param);
+
+protected:
+    /**
+     * @brief Called once in the task's own context before the first message.
+     */
+    virtual void onStart() {}
+    /**
+     * @brief Called for every message delivered to the inbox.
+     */
+    virtual void onMessage(const TaskMessage &) {}
+    /**
+     * @brief Called every period, if the task has one.
+     *
+     * @param nowMs Current time; ticks don't drift even if one runs late.
+     */
+    virtual void onTick(uint32_t) {}
+    TaskFramework *framework() { return mFramework; }
+
+public:
+    /**
+     * @brief Construct a new task description.
+     *
+     * @param name Task name.
+     * @param priority RTOS priority; higher runs first.
+     * @param coreId Core to pin to, -1 for any.
+     * @param periodMs onTick() period, 0 for purely event-driven tasks.
+     * @param queueLen Inbox capacity; posts to a full inbox are dropped and counted.
+     * @param stackSize Stack size in bytes.
+     */
+    FirmwareTask(const char *name, int priority, int8_t coreId = -1, uint32_t periodMs = 0,
+                 uint16_t queueLen = TASK_DEFAULT_QUEUE_LEN, int stackSize = TASK_DEFAULT_STACK);
+    virtual ~FirmwareTask() {}
+    uint8_t getId() const { return mId; }
+    const char *getName() const { return mConfig.name; }
+    uint32_t getDropped() const { return mDropped.load(std::memory_order_relaxed); }
+    uint32_t getHandled() const { return mHandled.load(std::memory_order_relaxed); }
+    /**
+     * @brief Longest time a message waited in the inbox, in ms.
+     */
+    uint32_t getMaxLatencyMs() const { return mMaxLatencyMs.load(std::memory_order_relaxed); }
+};
+
+/**
+ * @brief Runs a fixed set of FirmwareTasks connected by bounded queues.
+ *
+ * @code {.cpp}
+ * BoardTaskPlatform platform(&board);
+ * TaskFramework tasks(&platform);
+ * tasks.add(&sensorTask);
+ * tasks.add(&hapticTask);
+ * tasks.start();
+ * tasks.post(hapticTask.getId(), MSG_CUE, cue);
+ * @endcode
+ */
+class TaskFramework
+{
+    ITaskPlatform *mPlatform;
+    FirmwareTask *mTasks[TASK_MAX_TASKS];
+    uint8_t mCount = 0;
+    std::atomic<bool> mRunning{false};
+
+    friend class FirmwareTask;
+
+public:
+    explicit TaskFramework(ITaskPlatform *platform) : mPlatform(platform) {}
+    ~TaskFramework() { stop(); }
+    /**
+     * @brief Register a task. Only valid before start().
+     *
+     * @return uint8_t Task id used to post to it, 0xFF if full or running.
+     */
+    uint8_t add(FirmwareTask *task);
+    /**
+     * @brief Create every inbox and task.
+     *
+     * @return true if all tasks were created; false if an inbox or task
+     *         couldn't be, or a task of an earlier stop() is still exiting.
+     */
+    bool start();
+    /**
+     * @brief Ask every task to leave its loop and wait for them where the
+     * platform supports it. Mainly for host tests; firmware never stops, and
+     * on a board the task handles are left for the tasks to clean up.
+     */
+    void stop();
+    bool isRunning() const { return mRunning.load(); }
+    /**
+     * @brief Post a message without blocking.
+     *
+     * @param dst Destination task id.
+     * @param msg Message; timeMs is stamped here.
+     * @return true if queued, false if the inbox was full (counted as dropped).
+     */
+    bool post(uint8_t dst, TaskMessage &msg);
+    /**
+     * @brief Post a message without payload from an interrupt, e.g. to wake
+     * a task on a data-ready pin.
+     *
+     * @param dst Destination task id.
+     * @param type Message type.
+     * @param pxTaskWoken Set if the post woke a higher priority task; yield
+     * from the ISR then.
+     * @return true if queued, false if the inbox was full (counted as dropped).
+     */
+    bool postISR(uint8_t dst, uint8_t type, int *pxTaskWoken);
+    /**
+     * @brief Post a typed payload without blocking.
+     */
+    template <typename T>
+    bool post(uint8_t dst, uint8_t type, const T &payload, uint8_t source = 0xFF)
+    {
+        static_assert(sizeof(T) <= TASK_MSG_PAYLOAD, "payload too large for TaskMessage");
+        TaskMessage msg;
+        msg.type = type;
+        msg.source = source;
+        msg.len = sizeof(T);
+        memcpy(msg.data, &payload, sizeof(T));
+        return post(dst, msg);
+    }
+    uint32_t millis() { return mPlatform->millis(); }
+    uint8_t getTaskCount() const { return mCount; }
+    FirmwareTask *getTask(uint8_t id) { return id < mCount ? mTasks[id] : nullptr; }
+};
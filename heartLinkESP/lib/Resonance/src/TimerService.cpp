@@ -0,0 +1,348 @@
+#include "TimerService.h"
+
+void TimerService::VirtualTimer::setCallback(TimerCb cb, void *param)
+{
+    mService->mAlarm->lock();
+    mService->mSlots[mId].cb = cb;
+    mService->mSlots[mId].param = param;
+    mService->mAlarm->unlock();
+}
+
+void TimerService::VirtualTimer::startTimer()
+{
+    mService->start(mId);
+}
+
+void TimerService::VirtualTimer::stopTimer()
+{
+    mService->stop(mId);
+}
+
+TimerService::TimerService()
+{
+    for (uint8_t i = 0; i < TS_MAX_TIMERS; i++)
+    {
+        mTimers[i].mService = this;
+        mTimers[i].mId = i;
+    }
+}
+
+TimerService::~TimerService()
+{
+    if (mAlarm == nullptr)
+        return;
+    mAlarm->cancelAlarm();
+    mAlarm->setCallback(nullptr);
+}
+
+bool TimerService::begin(IBoardAlarm *alarm)
+{
+    if (alarm == nullptr)
+        return false;
+    mAlarm = alarm;
+    mAlarm->setCallback(&TimerService::onAlarm, this);
+    mAlarm->lock();
+    arm();
+    mAlarm->unlock();
+    return true;
+}
+
+int TimerService::allocate(uint32_t num, uint32_t den, bool periodic, TimerCb cb, void *param)
+{
+    if (mAlarm == nullptr || num == 0 || den == 0)
+        return -1;
+    mAlarm->lock();
+    for (uint8_t i = 0; i < TS_MAX_TIMERS; i++)
+    {
+        Slot &slot = mSlots[i];
+        if (slot.used)
+            continue;
+        slot = Slot();
+        slot.used = true;
+        slot.periodic = periodic;
+        slot.num = num;
+        slot.den = den;
+        slot.cb = cb;
+        slot.param = param;
+        mAlarm->unlock();
+        return i;
+    }
+    mAlarm->unlock();
+    return -1;
+}
+
+int TimerService::add(uint32_t freq, TimerCb cb, void *param)
+{
+    if (freq == 0 || freq > 1000000)
+        return -1;
+    int id = allocate(1000000, freq, true, cb, param);
+    if (id >= 0)
+        start(id);
+    return id;
+}
+
+int TimerService::addPeriodUs(uint32_t periodUs, TimerCb cb, void *param)
+{
+    int id = allocate(periodUs, 1, true, cb, param);
+    if (id >= 0)
+        start(id);
+    return id;
+}
+
+int TimerService::addOneShot(uint32_t delayUs, TimerCb cb, void *param)
+{
+    // 0 would make num 0; run it at the next alarm instead
+    int id = allocate(delayUs ? delayUs : 1, 1, false, cb, param);
+    if (id >= 0)
+        start(id);
+    return id;
+}
+
+IBoardTimer *TimerService::createTimer(uint32_t freq)
+{
+    if (freq == 0 || freq > 1000000)
+        return nullptr;
+    int id = allocate(1000000, freq, true, nullptr, nullptr);
+    return id >= 0 ? &mTimers[id] : nullptr;
+}
+
+bool TimerService::start(int id)
+{
+    if (id < 0 || id >= TS_MAX_TIMERS || mAlarm == nullptr)
+        return false;
+    mAlarm->lock();
+    Slot &slot = mSlots[id];
+    if (!slot.used)
+    {
+        mAlarm->unlock();
+        return false;
+    }
+    unschedule(id);
+    schedule(id, mAlarm->nowUs());
+    arm();
+    mAlarm->unlock();
+    return true;
+}
+
+bool TimerService::stop(int id)
+{
+    if (id < 0 || id >= TS_MAX_TIMERS || mAlarm == nullptr)
+        return false;
+    mAlarm->lock();
+    bool used = mSlots[id].used;
+    if (used)
+    {
+        unschedule(id);
+        arm();
+    }
+    mAlarm->unlock();
+    return used;
+}
+
+void TimerService::remove(int id)
+{
+    if (!stop(id))
+        return;
+    mAlarm->lock();
+    mSlots[id].used = false;
+    mAlarm->unlock();
+}
+
+bool TimerService::setFrequency(int id, uint32_t freq)
+{
+    if (id < 0 || id >= TS_MAX_TIMERS || mAlarm == nullptr || freq == 0 || freq > 1000000)
+        return false;
+    mAlarm->lock();
+    Slot &slot = mSlots[id];
+    bool ok = slot.used && slot.periodic;
+    if (ok)
+    {
+        // the pending period keeps its due time, the new rate counts from it
+        if (slot.heapPos >= 0)
+        {
+            slot.baseUs = slot.dueUs;
+            slot.periods = 0;
+        }
+        slot.num = 1000000;
+        slot.den = freq;
+    }
+    mAlarm->unlock();
+    return ok;
+}
+
+bool TimerService::isRunning(int id)
+{
+    if (id < 0 || id >= TS_MAX_TIMERS || mAlarm == nullptr)
+        return false;
+    mAlarm->lock();
+    bool running = mSlots[id].heapPos >= 0;
+    mAlarm->unlock();
+    return running;
+}
+
+TimerJitter TimerService::getJitter(int id)
+{
+    TimerJitter jitter;
+    if (id < 0 || id >= TS_MAX_TIMERS || mAlarm == nullptr)
+        return jitter;
+    mAlarm->lock();
+    jitter = mSlots[id].jitter;
+    mAlarm->unlock();
+    return jitter;
+}
+
+TimerServiceStats TimerService::getStats()
+{
+    TimerServiceStats stats;
+    if (mAlarm == nullptr)
+        return stats;
+    mAlarm->lock();
+    stats = mStats;
+    stats.active = mHeapSize;
+    mAlarm->unlock();
+    return stats;
+}
+
+void TimerService::resetStats()
+{
+    if (mAlarm == nullptr)
+        return;
+    mAlarm->lock();
+    mStats = TimerServiceStats();
+    for (uint8_t i = 0; i < TS_MAX_TIMERS; i++)
+        mSlots[i].jitter = TimerJitter();
+    mAlarm->unlock();
+}
+
+void TimerService::onAlarm(void *param)
+{
+    static_cast<TimerService *>(param)->dispatch();
+}
+
+void TimerService::dispatch()
+{
+    mAlarm->lock();
+    mStats.alarms++;
+    while (mHeapSize)
+    {
+        uint64_t now = mAlarm->nowUs();
+        uint8_t id = mHeap[0];
+        Slot &slot = mSlots[id];
+        if (slot.dueUs > now + TS_GROUP_US)
+            break;
+        record(slot, now);
+        TimerCb cb = slot.cb;
+        void *param = slot.param;
+        if (slot.periodic)
+        {
+            // exact average rate: due times come from the period count, not a
+            // rounded period added up
+            do
+            {
+                slot.periods++;
+                slot.dueUs = slot.baseUs + slot.periods * slot.num / slot.den;
+                if (slot.dueUs < now)
+                    slot.jitter.missed++;
+            } while (slot.dueUs < now);
+            siftDown(0);
+        }
+        else
+        {
+            unschedule(id);
+            slot.used = false;
+        }
+        mStats.dispatches++;
+        // callbacks may add, start or stop timers
+        mAlarm->unlock();
+        if (cb)
+            cb(param);
+        mAlarm->lock();
+    }
+    arm();
+    mAlarm->unlock();
+}
+
+void TimerService::record(Slot &slot, uint64_t nowUs)
+{
+    int32_t late = (int32_t)(int64_t)(nowUs - slot.dueUs);
+    TimerJitter &j = slot.jitter;
+    if (j.count == 0 || late < j.minLateUs)
+        j.minLateUs = late;
+    if (j.count == 0 || late > j.maxLateUs)
+        j.maxLateUs = late;
+    j.sumLateUs += late;
+    j.count++;
+}
+
+void TimerService::schedule(uint8_t id, uint64_t nowUs)
+{
+    Slot &slot = mSlots[id];
+    slot.baseUs = nowUs;
+    slot.periods = 1;
+    slot.dueUs = nowUs + (uint64_t)slot.num / slot.den;
+    slot.heapPos = mHeapSize;
+    mHeap[mHeapSize++] = id;
+    siftUp(slot.heapPos);
+}
+
+void TimerService::unschedule(uint8_t id)
+{
+    int8_t pos = mSlots[id].heapPos;
+    if (pos < 0)
+        return;
+    mSlots[id].heapPos = -1;
+    mHeapSize--;
+    if (pos == mHeapSize)
+        return;
+    mHeap[pos] = mHeap[mHeapSize];
+    mSlots[mHeap[pos]].heapPos = pos;
+    siftUp(pos);
+    siftDown(mSlots[mHeap[pos]].heapPos);
+}
+
+void TimerService::arm()
+{
+    if (mHeapSize)
+        mAlarm->setAlarm(mSlots[mHeap[0]].dueUs);
+    else
+        mAlarm->cancelAlarm();
+}
+
+void TimerService::heapSwap(uint8_t a, uint8_t b)
+{
+    uint8_t id = mHeap[a];
+    mHeap[a] = mHeap[b];
+    mHeap[b] = id;
+    mSlots[mHeap[a]].heapPos = a;
+    mSlots[mHeap[b]].heapPos = b;
+}
+
+void TimerService::siftUp(uint8_t pos)
+{
+    while (pos > 0)
+    {
+        uint8_t parent = (pos - 1) / 2;
+        if (mSlots[mHeap[parent]].dueUs <= mSlots[mHeap[pos]].dueUs)
+            break;
+        heapSwap(pos, parent);
+        pos = parent;
+    }
+}
+
+void TimerService::siftDown(uint8_t pos)
+{
+    for (;;)
+    {
+        uint8_t smallest = pos;
+        uint8_t left = 2 * pos + 1;
+        uint8_t right = left + 1;
+        if (left < mHeapSize && mSlots[mHeap[left]].dueUs < mSlots[mHeap[smallest]].dueUs)
+            smallest = left;
+        if (right < mHeapSize && mSlots[mHeap[right]].dueUs < mSlots[mHeap[smallest]].dueUs)
+            smallest = right;
+        if (smallest == pos)
+            return;
+        heapSwap(pos, smallest);
+        pos = smallest;
+    }
+}
@@ -0,0 +1,191 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <BoardProfile.h>
+
+#define TS_MAX_TIMERS 16
+#define TS_HW_TIMER ADC_TIMER /*!< Hardware timer of the service, from the board's allocation; Esp32Adc can't run next to it */
+#define TS_GROUP_US 2   /*!< Timers due this close to now run in the same alarm instead of re-arming */
+
+/**
+ * @brief How late a virtual timer's callbacks ran.
+ */
+struct TimerJitter
+{
+    uint32_t count = 0;     /*!< Callbacks run */
+    int32_t minLateUs = 0;  /*!< Smallest delay after the due time; negative: run early, within TS_GROUP_US */
+    int32_t maxLateUs = 0;  /*!< Largest delay after the due time */
+    int64_t sumLateUs = 0;
+    uint32_t missed = 0;    /*!< Periods dropped because their time had passed */
+
+    /**
+     * @brief Spread of the delays in us.
+     */
+    uint32_t jitterUs() const { return (uint32_t)(maxLateUs - minLateUs); }
+    float meanLateUs() const { return count ? (float)sumLateUs / count : 0.0f; }
+};
+
+struct TimerServiceStats
+{
+    uint32_t alarms = 0;     /*!< Hardware alarms handled */
+    uint32_t dispatches = 0; /*!< Callbacks run */
+    uint8_t active = 0;      /*!< Timers waiting to fire */
+};
+
+/**
+ * @brief Any number of timers on one hardware timer.
+ *
+ * The ESP32 has four hardware timers and the VH library already claims them
+ * all (WAVE_GEN_TIMER, PCM_TIMER, MIXER_TIMER, ADC_TIMER). This service runs
+ * a single IBoardAlarm and keeps up to TS_MAX_TIMERS virtual timers in a
+ * min-heap ordered by their next due time: the alarm is always armed for the
+ * top of the heap, and its ISR runs every callback that is due, reschedules
+ * the periodic ones and re-arms for the next. Adding, stopping or firing a
+ * timer is O(log n) and nothing is allocated after construction.
+ *
+ * Periodic due times are computed from the start time and the number of
+ * periods, not by adding a rounded period, so rates like 44.1 kHz keep their
+ * exact average. A period whose time has already passed when the previous
+ * one ran is dropped and counted as missed rather than run late. Callbacks
+ * run in the alarm ISR, like IBoardTimer callbacks, and each timer records
+ * how late they ran (TimerJitter).
+ *
+ * createTimer() hands out a timer with the IBoardTimer interface, so code
+ * written for createTimerEvents() can run on the service unchanged.
+ *
+ * With a HostBoardProfile::createAlarm() the alarm runs on the simulated
+ * clock, so the service can be tested on the host.
+ *
+ * @code {.cpp}
+ * TimerService timers;
+ * Esp32Alarm alarm;
+ * alarm.begin(TS_HW_TIMER);
+ * timers.begin(&alarm);
+ * int sensor = timers.add(1000, [](void *) { readSensor(); });
+ * int display = timers.addPeriodUs(33333, [](void *) { refreshDisplay(); });
+ * MultiChannelOutput out(8000);
+ * out.setTimer(timers.createTimer(8000));
+ * out.begin(&board);
+ * ...
+ * TimerJitter j = timers.getJitter(sensor);
+ * printf("max late %d us, jitter %u us\n", j.maxLateUs, j.jitterUs());
+ * @endcode
+ */
+class TimerService
+{
+public:
+    /**
+     * @brief Virtual timer with the IBoardTimer interface; owned by the service.
+     */
+    class VirtualTimer final : public IBoardTimer
+    {
+        friend class TimerService;
+        TimerService *mService = nullptr;
+        uint8_t mId = 0;
+
+    public:
+        void setCallback(TimerCb cb, void *param = nullptr) override;
+        void startTimer() override;
+        void stopTimer() override;
+        int getId() const { return mId; }
+    };
+
+private:
+    struct Slot
+    {
+        TimerCb cb = nullptr;
+        void *param = nullptr;
+        uint64_t baseUs = 0;  /*!< Time of period 0 */
+        uint64_t periods = 0; /*!< Index of the next period */
+        uint64_t dueUs = 0;
+        uint32_t num = 0;     /*!< Period in us is num / den */
+        uint32_t den = 1;
+        int8_t heapPos = -1;  /*!< -1: not scheduled */
+        bool used = false;
+        bool periodic = false;
+        TimerJitter jitter;
+    };
+
+    IBoardAlarm *mAlarm = nullptr;
+    Slot mSlots[TS_MAX_TIMERS];
+    VirtualTimer mTimers[TS_MAX_TIMERS];
+    uint8_t mHeap[TS_MAX_TIMERS];
+    uint8_t mHeapSize = 0;
+    TimerServiceStats mStats;
+
+    int allocate(uint32_t num, uint32_t den, bool periodic, TimerCb cb, void *param);
+    void schedule(uint8_t id, uint64_t nowUs);
+    void unschedule(uint8_t id);
+    void arm();
+    void heapSwap(uint8_t a, uint8_t b);
+    void siftUp(uint8_t pos);
+    void siftDown(uint8_t pos);
+    void record(Slot &slot, uint64_t nowUs);
+    static void onAlarm(void *param);
+
+public:
+    TimerService();
+    ~TimerService();
+    TimerService(const TimerService &) = delete;
+    TimerService &operator=(const TimerService &) = delete;
+
+    /**
+     * @brief Run on an alarm the caller owns, e.g. an Esp32Alarm begun on
+     * TS_HW_TIMER.
+     */
+    bool begin(IBoardAlarm *alarm);
+
+    /**
+     * @brief Add a running periodic timer.
+     *
+     * @param freq Rate in Hz, up to 1 MHz.
+     * @param cb Called from the alarm ISR.
+     * @return int Timer id, -1 if all TS_MAX_TIMERS are in use.
+     */
+    int add(uint32_t freq, TimerCb cb, void *param = nullptr);
+    /**
+     * @brief Add a running periodic timer with a period in us.
+     */
+    int addPeriodUs(uint32_t periodUs, TimerCb cb, void *param = nullptr);
+    /**
+     * @brief Run a callback once after delayUs; its id is free again once it
+     * has run.
+     */
+    int addOneShot(uint32_t delayUs, TimerCb cb, void *param = nullptr);
+    /**
+     * @brief A stopped periodic timer used through IBoardTimer, the
+     * counterpart of BoardProfile::createTimerEvents().
+     *
+     * @return IBoardTimer* nullptr if all TS_MAX_TIMERS are in use.
+     */
+    IBoardTimer *createTimer(uint32_t freq);
+
+    /**
+     * @brief (Re)start a timer; the first callback is one period from now.
+     */
+    bool start(int id);
+    bool stop(int id);
+    /**
+     * @brief Stop a timer and free its id.
+     */
+    void remove(int id);
+    /**
+     * @brief Change the rate of a periodic timer, from its next period on.
+     */
+    bool setFrequency(int id, uint32_t freq);
+    bool isRunning(int id);
+
+    /**
+     * @brief Delay statistics of one timer since it was added or reset.
+     */
+    TimerJitter getJitter(int id);
+    TimerServiceStats getStats();
+    void resetStats();
+    uint64_t nowUs() { return mAlarm ? mAlarm->nowUs() : 0; }
+
+    /**
+     * @brief Run every callback that is due and re-arm the alarm; the alarm
+     * ISR calls this.
+     */
+    void dispatch();
+};
@@ -0,0 +1,98 @@
+#include "ToneHapticOutput.h"
+
+void ToneHapticOutput::drive(float frequency, float intensity)
+{
+    if (intensity <= 0.0f)
+    {
+        intensity = 0.0f;
+        frequency = mFrequency;
+    }
+    if (frequency == mFrequency && intensity == mIntensity)
+        return;
+    mFrequency = frequency;
+    mIntensity = intensity;
+    if (mDrive)
+        mDrive(frequency, intensity);
+}
+
+size_t ToneHapticOutput::submit(const HapticCue *cues, size_t count, uint32_t nowMs)
+{
+    size_t queued = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        const HapticCue &cue = cues[i];
+        if (cue.preempt)
+            mCount = 0;
+        // already over: nothing left to play
+        if ((int32_t)(cue.startMs + cue.durationMs - nowMs) <= 0)
+            continue;
+        if (mCount == TONE_MAX_CUES)
+        {
+            mDropped++;
+            continue;
+        }
+        mCues[(mHead + mCount) % TONE_MAX_CUES] = cue;
+        mCount++;
+        queued++;
+    }
+    return queued;
+}
+
+void ToneHapticOutput::render(uint32_t nowMs)
+{
+    // cues are in start order: the last one started is the one playing
+    int active = -1;
+    for (uint8_t i = 0; i < mCount; i++)
+    {
+        if ((int32_t)(nowMs - at(i).startMs) < 0)
+            break;
+        active = i;
+    }
+    // everything before it is over or taken over
+    if (active > 0)
+    {
+        mHead = (mHead + active) % TONE_MAX_CUES;
+        mCount -= active;
+        active = 0;
+    }
+    if (active < 0)
+    {
+        drive(0, 0);
+        return;
+    }
+    const HapticCue &cue = at(0);
+    uint32_t elapsed = nowMs - cue.startMs;
+    if (elapsed >= cue.durationMs)
+    {
+        mHead = (mHead + 1) % TONE_MAX_CUES;
+        mCount--;
+        drive(0, 0);
+        return;
+    }
+
+    float t = (float)elapsed / (float)cue.durationMs;
+    switch (cue.type)
+    {
+    case HapticCueType::VIBRATE:
+        drive(cue.frequency, cue.intensity);
+        break;
+    case HapticCueType::SWEEP:
+    {
+        float eased = 1.0f - (1.0f - t) * (1.0f - t);
+        drive(cue.frequency + (cue.endFrequency - cue.frequency) * t,
+              cue.intensity + (cue.endIntensity - cue.intensity) * eased);
+        break;
+    }
+    case HapticCueType::TICK:
+    case HapticCueType::PULSE:
+    default:
+        drive(TONE_CARRIER_HZ, cue.intensity);
+        break;
+    }
+}
+
+void ToneHapticOutput::clear()
+{
+    mCount = 0;
+    drive(0, 0);
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include <Utilities/VHUtilities.h>
+#include "HapticMapper.h"
+
+#define TONE_MAX_CUES 16            /*!< Cues waiting to start; a full queue drops new ones */
+#define TONE_CARRIER_HZ RESONANT_FREQ /*!< Drive frequency of PULSE and TICK */
+
+/**
+ * @brief Sets the drive: a square wave at frequencyHz with its level scaled
+ * by intensity (0..1), silent at 0.
+ */
+typedef std::function<void(float frequencyHz, float intensity)> ToneDriveFn;
+
+/**
+ * @brief Plays HapticMapper cues on a single tone output, such as an LEDC
+ * channel on the actuator pin.
+ *
+ * The firmware's haptic output stage; it needs no haptics library. Cues
+ * wait in a short queue until their start time on the mapper's clock;
+ * render() finds the cue playing at that time and sets the drive only when
+ * its frequency or level changes. PULSE and TICK drive at TONE_CARRIER_HZ,
+ * VIBRATE at the cue frequency, and SWEEP eases the intensity out
+ * (quadratic) and moves the frequency linearly from start to end.
+ * Sharpness isn't rendered. A cue that starts while another still plays
+ * takes over; alerts (HapticCue::preempt) drop everything queued. The
+ * resolution is the render() period.
+ *
+ * @code {.cpp}
+ * ToneHapticOutput output([](float hz, float level) { setTone(hz, level); });
+ * size_t n = mapper.update(millis(), cues, HAPTIC_MAX_CUES);
+ * output.submit(cues, n, millis());
+ * output.render(millis());
+ * @endcode
+ */
+class ToneHapticOutput
+{
+    ToneDriveFn mDrive;
+    HapticCue mCues[TONE_MAX_CUES];
+    uint8_t mHead = 0;
+    uint8_t mCount = 0;
+    float mFrequency = 0;
+    float mIntensity = 0;
+    uint32_t mDropped = 0;
+
+    const HapticCue &at(uint8_t i) const { return mCues[(mHead + i) % TONE_MAX_CUES]; }
+    void drive(float frequency, float intensity);
+
+public:
+    explicit ToneHapticOutput(ToneDriveFn drive) : mDrive(drive) {}
+    /**
+     * @brief Queue cues returned by HapticMapper::update().
+     *
+     * @param cues Cues in start order.
+     * @param count Number of cues.
+     * @param nowMs Current time on the mapper's clock.
+     * @return size_t Number of cues queued; the rest didn't fit.
+     */
+    size_t submit(const HapticCue *cues, size_t count, uint32_t nowMs);
+    /**
+     * @brief Set the drive for the cue playing now and drop finished ones.
+     *
+     * @param nowMs Current time on the mapper's clock.
+     */
+    void render(uint32_t nowMs);
+    /**
+     * @brief Drop every queued cue and silence the drive.
+     */
+    void clear();
+    bool isPlaying() const { return mIntensity > 0; }
+    size_t getQueued() const { return mCount; }
+    uint32_t getDropped() const { return mDropped; }
+};
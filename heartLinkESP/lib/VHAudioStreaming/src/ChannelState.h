@@ -0,0 +1,174 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <Utilities/VHUtilities.h>
+
+#ifdef ARDUINO
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#define VH_CACHE_LINE 32 /*!< ESP32 cache line (flash / PSRAM cache) */
+#define VH_STATE_WAIT() vTaskDelay(1) /*!< Lets a lower priority reader task finish */
+#else
+#include <thread>
+#define VH_CACHE_LINE 64
+#define VH_STATE_WAIT() std::this_thread::yield()
+#endif
+#define VH_STATE_MAX_CHANNELS 8
+
+namespace VH
+{
+    /**
+     * @brief What the render path reports about one channel, shared with
+     * other tasks.
+     *
+     * Every field is a single atomic word, so a timer ISR and a task can both
+     * write and read them without a mutex. Each channel gets its own cache
+     * line, so two cores working on neighbouring channels don't share one.
+     */
+    struct alignas(VH_CACHE_LINE) ChannelRuntime
+    {
+        std::atomic<uint8_t> level{0};    /*!< Peak of the last rendered block */
+        std::atomic<bool> idle{false};
+        std::atomic<uint32_t> samples{0}; /*!< Samples rendered */
+    };
+
+    /**
+     * @brief Playback configuration of every channel, swapped as a whole.
+     */
+    struct ChannelPlaySet
+    {
+        uint8_t intensity[VH_STATE_MAX_CHANNELS];    /*!< 0-255, 255 = 1.0 */
+        int8_t mixing[VH_STATE_MAX_CHANNELS];        /*!< MixingStrategy */
+        uint32_t activeMask;                         /*!< Bit n set: channel n plays */
+        uint32_t generation;                         /*!< Counts published updates */
+    };
+
+    /**
+     * @brief Fixed, lock-free channel state for the audio-rate path.
+     *
+     * Replaces per-channel std::vectors guarded by an IBoardMutex. The
+     * per-channel values live in a fixed array of ChannelRuntime. The playback
+     * configuration, where several fields and channels change together (a
+     * play() call), is double buffered: a writer copies the current
+     * ChannelPlaySet, edits the copy and publishes it with one atomic index
+     * store, so a reader always sees one complete update, never half of one,
+     * and nothing is ever reallocated under it.
+     *
+     * Readers (the timer ISR, the render task) never wait: they mark the set
+     * they use in a per-set reader count and retry only if a publish happened
+     * in between. Writers run in task context, are serialized by a flag, and
+     * wait for readers to leave the set they are about to overwrite. An ISR
+     * leaves it within microseconds; a reader task might be preempted by the
+     * writer, so writers sleep a tick while they wait, and task readers that
+     * do real work should take a snapshot() instead of holding a Reader.
+     *
+     * @code {.cpp}
+     * VH::ChannelStateTable<4> state;
+     * // task
+     * state.update([](VH::ChannelPlaySet &s) {
+     *     s.intensity[1] = 200;
+     *     s.activeMask |= 1u << 1;
+     * });
+     * // timer ISR
+     * VH::ChannelStateTable<4>::Reader play(state);
+     * if (play->activeMask & (1u << 1))
+     *     out = (uint8_t)(sample * play->intensity[1] / 255);
+     * @endcode
+     */
+    template <uint8_t CHANNELS = VH_STATE_MAX_CHANNELS>
+    class ChannelStateTable
+    {
+        static_assert(CHANNELS > 0 && CHANNELS <= VH_STATE_MAX_CHANNELS, "too many channels for ChannelPlaySet");
+
+    public:
+        /**
+         * @brief Holds the current play set for as long as it is in scope.
+         * Keep it short: writers wait for it.
+         */
+        class Reader
+        {
+            ChannelStateTable &mTable;
+            uint8_t mIndex;
+
+        public:
+            explicit Reader(ChannelStateTable &table) : mTable(table), mIndex(table.acquire()) {}
+            ~Reader() { mTable.mReaders[mIndex].fetch_sub(1, std::memory_order_release); }
+            Reader(const Reader &) = delete;
+            Reader &operator=(const Reader &) = delete;
+            const ChannelPlaySet &operator*() const { return mTable.mSets[mIndex]; }
+            const ChannelPlaySet *operator->() const { return &mTable.mSets[mIndex]; }
+        };
+
+        ChannelStateTable()
+        {
+            for (uint8_t s = 0; s < 2; s++)
+            {
+                ChannelPlaySet &set = mSets[s];
+                for (uint8_t i = 0; i < VH_STATE_MAX_CHANNELS; i++)
+                {
+                    set.intensity[i] = 255;
+                    set.mixing[i] = ADDITIVE_MIX;
+                }
+                set.activeMask = (CHANNELS >= 32) ? 0xFFFFFFFFu : ((1u << CHANNELS) - 1);
+                set.generation = 0;
+            }
+        }
+        ChannelStateTable(const ChannelStateTable &) = delete;
+        ChannelStateTable &operator=(const ChannelStateTable &) = delete;
+
+        ChannelRuntime &runtime(uint8_t channel) { return mRuntime[channel]; }
+        static constexpr uint8_t channels() { return CHANNELS; }
+
+        /**
+         * @brief Edit a copy of the current play set and publish it; task context only.
+         *
+         * @param edit Called with the copy, e.g. a lambda taking ChannelPlaySet &.
+         */
+        template <typename F>
+        void update(F edit)
+        {
+            while (mWriting.test_and_set(std::memory_order_acquire))
+                VH_STATE_WAIT();
+            uint8_t front = mFront.load(std::memory_order_relaxed);
+            uint8_t back = front ^ 1;
+            // a reader that took back before the last publish is still on it
+            while (mReaders[back].load() != 0)
+                VH_STATE_WAIT();
+            mSets[back] = mSets[front];
+            edit(mSets[back]);
+            mSets[back].generation = mSets[front].generation + 1;
+            mFront.store(back);
+            mWriting.clear(std::memory_order_release);
+        }
+
+        /**
+         * @brief Copy of the current play set, for tasks that want to keep it.
+         */
+        ChannelPlaySet snapshot()
+        {
+            Reader reader(*this);
+            return *reader;
+        }
+
+    private:
+        uint8_t acquire()
+        {
+            for (;;)
+            {
+                uint8_t index = mFront.load();
+                mReaders[index].fetch_add(1);
+                if (mFront.load() == index)
+                    return index;
+                mReaders[index].fetch_sub(1, std::memory_order_release);
+            }
+        }
+
+        ChannelRuntime mRuntime[CHANNELS];
+        ChannelPlaySet mSets[2];
+        std::atomic<uint8_t> mFront{0};
+        std::atomic<uint16_t> mReaders[2] = {};
+        std::atomic_flag mWriting = ATOMIC_FLAG_INIT;
+    };
+}
@@ -0,0 +1,222 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+#define DRIFT_DEFAULT_CHANNELS 2
+#define DRIFT_MAX_CORRECTION_PPM 2000 /*!< Largest rate correction applied */
+#define DRIFT_FILL_SMOOTHING 6        /*!< Fill level EWMA weight 1/2^n per block */
+#define DRIFT_KP_PPM 3                /*!< Proportional gain in ppm per sample of fill error */
+#define DRIFT_KI_SHIFT 3              /*!< Integral gain: 2^-n ppm/65536 per 1/256 sample of error and block */
+
+namespace VH
+{
+    /**
+     * @brief Holds the fill level of the streaming ring buffer at a target latency.
+     *
+     * The sender's sample clock and the haptic output timer never run at exactly
+     * the same rate, so the ring buffer behind AudioStreaming slowly fills up
+     * (growing latency, then dropped samples) or runs dry (silence). This
+     * controller sits between the A2DP stream reader and AudioStreaming::write():
+     * per block it smooths the observed fill level, runs a PI controller on the
+     * error to a rate correction in ppm, and applies it by dropping or
+     * repeating single input frames at the quietest frame of the block, where
+     * the edit is inaudible (and imperceptible on an actuator).
+     *
+     * No samples are copied: the block is handed to the sink in up to two
+     * segments around the edited frame.
+     */
+    class DriftCompensator
+    {
+    public:
+        /**
+         * @brief Construct a new Drift Compensator object
+         *
+         * @param targetFill Fill level of the output ring buffer to hold, in its own samples.
+         * @param channels Interleaved channels per input frame. Default is 2 (stereo).
+         */
+        DriftCompensator(size_t targetFill, uint8_t channels = DRIFT_DEFAULT_CHANNELS)
+            : mTarget((int32_t)targetFill), mChannels(channels ? channels : 1)
+        {
+        }
+
+        /**
+         * @brief Change the target fill level and restart the controller.
+         *
+         * @param targetFill Fill level of the output ring buffer to hold.
+         */
+        void setTarget(size_t targetFill)
+        {
+            mTarget = (int32_t)targetFill;
+            reset();
+        }
+
+        /**
+         * @brief Restart the controller, e.g. after the stream was paused.
+         */
+        void reset()
+        {
+            mHasFill = false;
+            mIntegralQ16 = 0;
+            mPpm = 0;
+            mPending = 0;
+        }
+
+        /**
+         * @brief Pass one block of interleaved 16 bit samples to the sink with the drift correction applied.
+         *
+         * @param samples Interleaved input samples.
+         * @param sampleCount Number of samples (frames * channels).
+         * @param fill Current fill level of the output ring buffer, e.g. RingBuffer::size().
+         * @param sink Callable taking (const int16_t *samples, size_t sampleCount), e.g. a lambda calling AudioStreaming::write().
+         */
+        template <typename Sink>
+        void write(const int16_t *samples, size_t sampleCount, size_t fill, Sink &&sink)
+        {
+            size_t frames = sampleCount / mChannels;
+            if (frames == 0)
+            {
+                return;
+            }
+            update(frames, (int32_t)fill);
+
+            int edit = 0;
+            if (mPending >= 1000000)
+            {
+                edit = -1; // output is too full: drop a frame
+                mPending -= 1000000;
+                mDropped++;
+            }
+            else if (mPending <= -1000000)
+            {
+                edit = 1; // output is running dry: repeat a frame
+                mPending += 1000000;
+                mInserted++;
+            }
+            if (edit == 0)
+            {
+                sink(samples, frames * mChannels);
+                return;
+            }
+
+            size_t at = quietestFrame(samples, frames) * mChannels;
+            if (edit < 0)
+            {
+                if (at > 0)
+                {
+                    sink(samples, at);
+                }
+                if (at + mChannels < frames * mChannels)
+                {
+                    sink(samples + at + mChannels, frames * mChannels - at - mChannels);
+                }
+            }
+            else
+            {
+                sink(samples, at + mChannels);
+                sink(samples + at, frames * mChannels - at);
+            }
+        }
+
+        /**
+         * @brief Get the current rate correction.
+         *
+         * @return int32_t ppm, positive when frames are being dropped.
+         */
+        int32_t getCorrectionPpm() const { return mPpm; }
+
+        /**
+         * @brief Get the smoothed fill level the controller works on.
+         *
+         * @return int32_t Fill level in output samples.
+         */
+        int32_t getSmoothedFill() const { return mFillQ8 >> 8; }
+
+        /**
+         * @brief Get the number of input frames dropped so far.
+         */
+        uint32_t getDropped() const { return mDropped; }
+
+        /**
+         * @brief Get the number of input frames repeated so far.
+         */
+        uint32_t getInserted() const { return mInserted; }
+
+    private:
+        int32_t mTarget;
+        uint8_t mChannels;
+        bool mHasFill = false;
+        int32_t mFillSum = 0;     /* smoothed fill level, Q8 scaled by 2^DRIFT_FILL_SMOOTHING */
+        int32_t mFillQ8 = 0;      /* smoothed fill level, Q8 */
+        int32_t mIntegralQ16 = 0; /* integral term of the controller, ppm in Q16 */
+        int32_t mPpm = 0;         /* last correction */
+        int64_t mPending = 0;     /* accumulated correction in ppm * frames */
+        uint32_t mDropped = 0;
+        uint32_t mInserted = 0;
+
+        static int32_t clampPpm(int32_t ppm)
+        {
+            if (ppm > DRIFT_MAX_CORRECTION_PPM)
+                return DRIFT_MAX_CORRECTION_PPM;
+            if (ppm < -DRIFT_MAX_CORRECTION_PPM)
+                return -DRIFT_MAX_CORRECTION_PPM;
+            return ppm;
+        }
+
+        void update(size_t frames, int32_t fill)
+        {
+            // kept as a running sum, so a steady level is reached exactly: a
+            // rounded average stalls up to a sample short of it, and the
+            // integral then walks on that error until frames are edited
+            if (!mHasFill)
+            {
+                mFillSum = fill << (8 + DRIFT_FILL_SMOOTHING);
+                mHasFill = true;
+            }
+            else
+            {
+                mFillSum += (fill << 8) - (mFillSum >> DRIFT_FILL_SMOOTHING);
+            }
+            mFillQ8 = mFillSum >> DRIFT_FILL_SMOOTHING;
+            // error in 1/256 samples; positive when the buffer is too full.
+            // The terms round toward zero: a shift would floor any residue
+            // below zero to -1 ppm and keep repeating frames at the target
+            int32_t errorQ8 = mFillQ8 - (mTarget << 8);
+            int32_t proportional = errorQ8 * DRIFT_KP_PPM / 256;
+            mIntegralQ16 += errorQ8 / (1 << DRIFT_KI_SHIFT);
+            if (mIntegralQ16 > (DRIFT_MAX_CORRECTION_PPM << 16))
+                mIntegralQ16 = DRIFT_MAX_CORRECTION_PPM << 16;
+            if (mIntegralQ16 < -(DRIFT_MAX_CORRECTION_PPM << 16))
+                mIntegralQ16 = -(DRIFT_MAX_CORRECTION_PPM << 16);
+            mPpm = clampPpm(proportional + mIntegralQ16 / 65536);
+            mPending += (int64_t)mPpm * (int64_t)frames;
+            // never more than one edit per block
+            if (mPending > 2000000)
+                mPending = 2000000;
+            if (mPending < -2000000)
+                mPending = -2000000;
+        }
+
+        size_t quietestFrame(const int16_t *samples, size_t frames) const
+        {
+            size_t best = 0;
+            int32_t bestLevel = INT32_MAX;
+            for (size_t i = 0; i < frames; i++)
+            {
+                // per channel: opposite samples don't cancel out
+                int32_t level = 0;
+                for (uint8_t c = 0; c < mChannels; c++)
+                {
+                    int32_t s = samples[i * mChannels + c];
+                    level += s < 0 ? -s : s;
+                }
+                if (level < bestLevel)
+                {
+                    bestLevel = level;
+                    best = i;
+                }
+            }
+            return best;
+        }
+    };
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <new>
+#include "RingBuffer.h"
+
+#define STREAM_DEFAULT_LATENCY_MS 50   /*!< Latency held by the DriftCompensator */
+#define STREAM_DEFAULT_OUTPUT_RATE 14700 /*!< 44.1 kHz input decimated by 3 (16 kHz cap) */
+
+namespace VH
+{
+    /**
+     * @brief Buffer sizes derived from a single latency target.
+     *
+     * The DriftCompensator holds the ring at targetFill(), so each ring gets
+     * twice that (plus the slot a RingBuffer always keeps free) as headroom for
+     * the packet jitter of the A2DP stream, and nothing more.
+     */
+    struct StreamBufferPlan
+    {
+        /**
+         * @brief Samples per channel the ring is held at.
+         *
+         * @param latencyMs Latency target in ms.
+         * @param outputRate Rate at which the haptic output consumes samples, in Hz.
+         */
+        static constexpr size_t targetFill(uint32_t latencyMs, uint32_t outputRate)
+        {
+            return (size_t)(((uint64_t)latencyMs * outputRate + 999) / 1000);
+        }
+        /**
+         * @brief Ring slots per channel for a latency target.
+         */
+        static constexpr size_t ringSlots(uint32_t latencyMs, uint32_t outputRate)
+        {
+            return 2 * targetFill(latencyMs, outputRate) + 1;
+        }
+    };
+
+    /**
+     * @brief All ring buffers of an AudioStreaming setup in one static block.
+     *
+     * Instead of one hand sized array and RingBuffer per audio channel, the
+     * storage of all CHANNELS rings is a single array sized from the latency
+     * target with StreamBufferPlan, and the RingBuffer objects are built in
+     * place in it. totalBytes() is a compile-time constant, so a build can
+     * static_assert its RAM budget.
+     *
+     * To keep the rest of the path small, feed the rings straight from the A2DP
+     * stream reader with the I2S output off (set_stream_reader(reader, false)):
+     * BluetoothA2DPSinkQueued then doesn't create its I2S ringbuffer and task.
+     *
+     * @code {.cpp}
+     * VH::StreamBuffers<int16_t, 50, 14700, 2> buffers;
+     * static_assert(decltype(buffers)::totalBytes() < 4096, "haptic stream RAM budget");
+     * VH::DriftCompensator drift(buffers.targetFill());
+     * void read_data_stream(const uint8_t *data, uint32_t length) {
+     *     drift.write((const int16_t *)data, length / 2, buffers.ring(0).size(),
+     *                 [](const int16_t *s, size_t n) { audioStream.write(s, n); });
+     * }
+     * audioStream.init(buffers.rings(), 2);
+     * a2dp_sink.set_stream_reader(read_data_stream, false);
+     * @endcode
+     */
+    template <typename T,
+              uint32_t LATENCY_MS = STREAM_DEFAULT_LATENCY_MS,
+              uint32_t OUTPUT_RATE = STREAM_DEFAULT_OUTPUT_RATE,
+              uint16_t CHANNELS = 1>
+    class StreamBuffers
+    {
+    public:
+        static constexpr size_t SLOTS = StreamBufferPlan::ringSlots(LATENCY_MS, OUTPUT_RATE);
+
+        StreamBuffers()
+        {
+            for (uint16_t i = 0; i < CHANNELS; i++)
+            {
+                mRings[i] = new (&mRingMemory[i * sizeof(RingBuffer<T>)]) RingBuffer<T>(&mStorage[i * SLOTS], SLOTS);
+            }
+        }
+        StreamBuffers(const StreamBuffers &) = delete;
+        StreamBuffers &operator=(const StreamBuffers &) = delete;
+
+        /**
+         * @brief Ring of one audio channel.
+         */
+        RingBuffer<T> &ring(uint16_t channel) { return *mRings[channel]; }
+        /**
+         * @brief All rings, as taken by AudioStreaming::init(buffs, numChannels).
+         */
+        RingBuffer<T> **rings() { return mRings; }
+        /**
+         * @brief Fill level to hold, for the DriftCompensator.
+         */
+        static constexpr size_t targetFill() { return StreamBufferPlan::targetFill(LATENCY_MS, OUTPUT_RATE); }
+        /**
+         * @brief RAM used by the rings, their storage and the pointer table.
+         */
+        static constexpr size_t totalBytes() { return sizeof(StreamBuffers); }
+        /**
+         * @brief Empty all rings; only call while nothing is streaming.
+         */
+        void reset()
+        {
+            for (uint16_t i = 0; i < CHANNELS; i++)
+                mRings[i]->reset();
+        }
+
+    private:
+        T mStorage[CHANNELS * SLOTS];
+        alignas(RingBuffer<T>) uint8_t mRingMemory[CHANNELS * sizeof(RingBuffer<T>)];
+        RingBuffer<T> *mRings[CHANNELS];
+    };
+}
@@ -2,11 +2,14 @@
 
 #include <Arduino.h>
 #include <vector>
+#include <driver/ledc.h>
+#include <soc/ledc_struct.h>
 #include <BoardProfile.h>
 
 #define CHNL_LEFT 25
 #define CHNL_RIGHT 26
 #define DEFAULT_PIN_CHNL 3
+#define LEDC_CHANNELS 16 /*!< 8 high speed + 8 low speed */
 
 class Esp32Channel
 {
@@ -67,4 +70,37 @@ public:
     void digitalWrite(int pin, int val) override;
     int digitalRead(int pin) override;
     void changePwmFrequency(const unsigned char pin, const unsigned long freq) override;
+    /**
+     * @brief Set the LEDC duty of every pin first, then latch them all, so
+     * they switch together at the next PWM period. Pins without an LEDC
+     * channel go through writeSinglePin().
+     *
+     * Not virtual: the vtable of this class is in the precompiled library.
+     * Generic code reaches it through BoardCall (Resonance BoardConfig.h),
+     * and it is inline so the per-sample path can inline it.
+     */
+    void writePins(const PinWrite *writes, size_t count)
+    {
+        uint8_t pending[LEDC_CHANNELS];
+        size_t n = 0;
+        for (size_t i = 0; i < count; i++)
+        {
+            uint8_t chan = getChannelFromPin(writes[i].pin);
+            if (chan >= LEDC_CHANNELS || n == LEDC_CHANNELS)
+            {
+                writeSinglePin(writes[i].pin, writes[i].value);
+                continue;
+            }
+            ledc_mode_t group = (ledc_mode_t)(chan / 8);
+            ledc_channel_t channel = (ledc_channel_t)(chan % 8);
+            uint32_t timer = LEDC.channel_group[group].channel[channel].conf0.timer_sel;
+            uint32_t bits = LEDC.timer_group[group].timer[timer].conf.duty_resolution;
+            // same duty as ledcWrite(): 255 maps to fully on
+            ledc_set_duty(group, channel, ((uint32_t)writes[i].value << bits) / 255);
+            pending[n++] = chan;
+        }
+        // the new duties only take effect once latched; do it for all channels back to back
+        for (size_t i = 0; i < n; i++)
+            ledc_update_duty((ledc_mode_t)(pending[i] / 8), (ledc_channel_t)(pending[i] % 8));
+    }
 };
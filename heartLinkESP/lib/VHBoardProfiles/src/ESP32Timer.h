@@ -1,6 +1,7 @@
 #pragma once
 
 #include <Arduino.h>
+#include <atomic>
 #include <BoardProfile.h>
 
 class ESP32Timer : public IBoardTimer
@@ -17,6 +18,36 @@ public:
     void *getUserParam() const;
     TimerCb getCallBack() const;
 
+    /**
+     * @brief Claim a hardware timer for a driver that runs it directly
+     * (Esp32Alarm, Esp32Adc) rather than through createTimerEvents().
+     *
+     * Fails while createTimerEvents() has an ESP32Timer on it or another
+     * owner holds it, so two drivers can't program the same timer. Use the
+     * indexes of the board's allocation (WAVE_GEN_TIMER .. ADC_TIMER) and
+     * don't create board timers on a claimed one.
+     *
+     * @param timer Timer index, 0-3.
+     * @param owner Claiming object.
+     * @return true if the timer is now held by owner.
+     */
+    static bool claim(uint8_t timer, const void *owner)
+    {
+        if (timer > 3 || sTimers[timer] != nullptr)
+            return false;
+        const void *expected = nullptr;
+        return claims()[timer].compare_exchange_strong(expected, owner) || expected == owner;
+    }
+    /**
+     * @brief Give back a timer taken with claim().
+     */
+    static void release(uint8_t timer, const void *owner)
+    {
+        const void *expected = owner;
+        if (timer <= 3)
+            claims()[timer].compare_exchange_strong(expected, nullptr);
+    }
+
 private:
     void init();
 
@@ -28,6 +59,11 @@ private:
     uint64_t mTimerAlarmVal = 0;
 private:
     static ESP32Timer *sTimers[4];
+    static std::atomic<const void *> *claims()
+    {
+        static std::atomic<const void *> owners[4];
+        return owners;
+    }
     static void IRAM_ATTR onTimer0();
     static void IRAM_ATTR onTimer1();
     static void IRAM_ATTR onTimer2();
@@ -0,0 +1,124 @@
+#include "Esp32Adc.h"
+#include "ESP32Timer.h"
+
+Esp32Adc *Esp32Adc::sInstance = nullptr;
+
+Esp32Adc::~Esp32Adc()
+{
+    stop();
+    if (mTaskHandle)
+    {
+        vTaskDelete(mTaskHandle);
+        mTaskHandle = nullptr;
+    }
+    if (mTimerHandle)
+    {
+        timerEnd(mTimerHandle);
+        mTimerHandle = nullptr;
+        ESP32Timer::release(ADC_TIMER, this);
+    }
+    if (sInstance == this)
+        sInstance = nullptr;
+}
+
+bool Esp32Adc::begin(uint8_t pin, uint32_t sampleRate)
+{
+    // 1 MHz timer tick; the sampler task must keep up with the alarm rate
+    if (sampleRate == 0 || sampleRate > 10000)
+        return false;
+    if (sInstance && sInstance != this)
+        return false;
+    // the board's table: a TimerService alarm may hold ADC_TIMER
+    if (!mTimerHandle && !ESP32Timer::claim(ADC_TIMER, this))
+        return false;
+
+    mPin = pin;
+    mSampleRate = sampleRate;
+    ::pinMode(mPin, INPUT);
+    sInstance = this;
+
+    if (!mTaskHandle)
+    {
+        if (xTaskCreatePinnedToCore(samplerTask, "adc_sampler", ADC_TASK_STACK, this,
+                                    ADC_TASK_PRIORITY, &mTaskHandle, ADC_TASK_CORE) != pdPASS)
+        {
+            mTaskHandle = nullptr;
+            return false;
+        }
+    }
+    if (!mTimerHandle)
+    {
+        mTimerHandle = timerBegin(ADC_TIMER, 80, true);
+        if (!mTimerHandle)
+        {
+            ESP32Timer::release(ADC_TIMER, this);
+            return false;
+        }
+        timerAttachInterrupt(mTimerHandle, &Esp32Adc::onTimer, true);
+    }
+    timerAlarmWrite(mTimerHandle, 1000000UL / mSampleRate, true);
+    return true;
+}
+
+void Esp32Adc::setCallback(AdcSampleCb cb, void *param)
+{
+    mCb = cb;
+    mUserParam = param;
+}
+
+void Esp32Adc::start()
+{
+    if (!mTimerHandle || mRunning)
+        return;
+    mBlockLen = 0;
+    mRunning = true;
+    timerAlarmEnable(mTimerHandle);
+}
+
+void Esp32Adc::stop()
+{
+    if (!mTimerHandle || !mRunning)
+        return;
+    timerAlarmDisable(mTimerHandle);
+    mRunning = false;
+}
+
+bool Esp32Adc::isRunning()
+{
+    return mRunning;
+}
+
+uint32_t Esp32Adc::getSampleRate()
+{
+    return mSampleRate;
+}
+
+void IRAM_ATTR Esp32Adc::onTimer()
+{
+    BaseType_t woken = pdFALSE;
+    if (sInstance && sInstance->mTaskHandle)
+        vTaskNotifyGiveFromISR(sInstance->mTaskHandle, &woken);
+    if (woken)
+        portYIELD_FROM_ISR();
+}
+
+void Esp32Adc::samplerTask(void *param)
+{
+    Esp32Adc *self = static_cast<Esp32Adc *>(param);
+    for (;;)
+    {
+        // a count above one means ticks were missed; the consumer keeps time
+        // by counting samples, so take one per tick, late rather than never
+        uint32_t ticks = ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        while (ticks-- && self->mRunning)
+        {
+            self->mBlock[self->mBlockLen++] = (uint16_t)analogRead(self->mPin);
+            if (self->mBlockLen == ADC_BLOCK_SAMPLES)
+            {
+                if (self->mCb)
+                    self->mCb(self->mBlock, self->mBlockLen, self->mUserParam);
+                self->mBlockLen = 0;
+            }
+        }
+    }
+}
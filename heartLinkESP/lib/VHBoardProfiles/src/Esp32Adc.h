@@ -0,0 +1,47 @@
+#pragma once
+
+#include <Arduino.h>
+#include <BoardProfile.h>
+
+#define ADC_BLOCK_SAMPLES 4
+#define ADC_TASK_STACK 3072
+#define ADC_TASK_PRIORITY (configMAX_PRIORITIES - 2)
+#define ADC_TASK_CORE 0
+
+/**
+ * @brief Fixed-rate ADC sampler for ESP32.
+ *
+ * Hardware timer ADC_TIMER paces the conversions: its ISR only notifies a
+ * high-priority sampler task, which reads the pin and hands blocks of
+ * ADC_BLOCK_SAMPLES samples to the callback. Only one instance can run at a
+ * time because it owns ADC_TIMER, claimed through ESP32Timer::claim().
+ */
+class Esp32Adc : public IBoardAdc
+{
+public:
+    Esp32Adc() = default;
+    ~Esp32Adc();
+
+    bool begin(uint8_t pin, uint32_t sampleRate) override;
+    void setCallback(AdcSampleCb cb, void *param = nullptr) override;
+    void start() override;
+    void stop() override;
+    bool isRunning() override;
+    uint32_t getSampleRate() override;
+
+private:
+    hw_timer_t *mTimerHandle = nullptr;
+    TaskHandle_t mTaskHandle = nullptr;
+    uint8_t mPin = 0;
+    uint32_t mSampleRate = 0;
+    AdcSampleCb mCb = nullptr;
+    void *mUserParam = nullptr;
+    bool mRunning = false;
+    uint16_t mBlock[ADC_BLOCK_SAMPLES];
+    size_t mBlockLen = 0;
+
+private:
+    static Esp32Adc *sInstance;
+    static void IRAM_ATTR onTimer();
+    static void samplerTask(void *param);
+};
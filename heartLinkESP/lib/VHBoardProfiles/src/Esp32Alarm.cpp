@@ -0,0 +1,105 @@
+#include "Esp32Alarm.h"
+#include "ESP32Timer.h"
+
+Esp32Alarm *Esp32Alarm::sAlarms[4] = {nullptr, nullptr, nullptr, nullptr};
+
+Esp32Alarm::~Esp32Alarm()
+{
+    if (mTimerHandle)
+    {
+        timerAlarmDisable(mTimerHandle);
+        timerDetachInterrupt(mTimerHandle);
+        timerEnd(mTimerHandle);
+        mTimerHandle = nullptr;
+        sAlarms[mTimerNo] = nullptr;
+        ESP32Timer::release(mTimerNo, this);
+    }
+}
+
+bool Esp32Alarm::begin(uint8_t timer)
+{
+    if (mTimerHandle)
+        return timer == mTimerNo;
+    // the board's table: fails if createTimerEvents() or another driver has it
+    if (!ESP32Timer::claim(timer, this))
+        return false;
+
+    static void (*const isr[4])() = {&Esp32Alarm::onAlarm0, &Esp32Alarm::onAlarm1,
+                                     &Esp32Alarm::onAlarm2, &Esp32Alarm::onAlarm3};
+    mTimerHandle = timerBegin(timer, 80, true);
+    if (!mTimerHandle)
+    {
+        ESP32Timer::release(timer, this);
+        return false;
+    }
+    mTimerNo = timer;
+    sAlarms[timer] = this;
+    timerAttachInterrupt(mTimerHandle, isr[timer], true);
+    return true;
+}
+
+void Esp32Alarm::setCallback(TimerCb cb, void *param)
+{
+    mCb = cb;
+    mUserParam = param;
+}
+
+uint64_t IRAM_ATTR Esp32Alarm::nowUs()
+{
+    return timerRead(mTimerHandle);
+}
+
+void IRAM_ATTR Esp32Alarm::setAlarm(uint64_t atUs)
+{
+    portENTER_CRITICAL_SAFE(&mMux);
+    // the comparator only fires on reaching the value, not for one already passed
+    uint64_t earliest = timerRead(mTimerHandle) + ALARM_MIN_LEAD_US;
+    timerAlarmWrite(mTimerHandle, atUs > earliest ? atUs : earliest, false);
+    timerAlarmEnable(mTimerHandle);
+    portEXIT_CRITICAL_SAFE(&mMux);
+}
+
+void IRAM_ATTR Esp32Alarm::cancelAlarm()
+{
+    timerAlarmDisable(mTimerHandle);
+}
+
+void IRAM_ATTR Esp32Alarm::lock()
+{
+    portENTER_CRITICAL_SAFE(&mMux);
+}
+
+void IRAM_ATTR Esp32Alarm::unlock()
+{
+    portEXIT_CRITICAL_SAFE(&mMux);
+}
+
+void IRAM_ATTR Esp32Alarm::onAlarm()
+{
+    if (mCb)
+        mCb(mUserParam);
+}
+
+void IRAM_ATTR Esp32Alarm::onAlarm0()
+{
+    if (sAlarms[0])
+        sAlarms[0]->onAlarm();
+}
+
+void IRAM_ATTR Esp32Alarm::onAlarm1()
+{
+    if (sAlarms[1])
+        sAlarms[1]->onAlarm();
+}
+
+void IRAM_ATTR Esp32Alarm::onAlarm2()
+{
+    if (sAlarms[2])
+        sAlarms[2]->onAlarm();
+}
+
+void IRAM_ATTR Esp32Alarm::onAlarm3()
+{
+    if (sAlarms[3])
+        sAlarms[3]->onAlarm();
+}
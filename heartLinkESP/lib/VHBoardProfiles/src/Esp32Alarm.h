@@ -0,0 +1,55 @@
+#pragma once
+
+#include <Arduino.h>
+#include <BoardProfile.h>
+
+#define ALARM_MIN_LEAD_US 4 /*!< Alarms closer than this are moved out so the counter can't pass them while they are written */
+
+/**
+ * @brief One-shot alarm on an ESP32 hardware timer.
+ *
+ * The timer counts microseconds (divider 80 on the 80 MHz APB clock) and is
+ * never reloaded, so nowUs() is a 64 bit monotonic clock. setAlarm() only
+ * rewrites the alarm value; the counter keeps running. lock() is a spinlock
+ * critical section, so it works from tasks on either core and from the
+ * callback.
+ */
+class Esp32Alarm : public IBoardAlarm
+{
+public:
+    Esp32Alarm() = default;
+    ~Esp32Alarm();
+
+    /**
+     * @brief Claim a hardware timer from the board (ESP32Timer::claim()) and
+     * start its counter.
+     *
+     * @param timer Timer index of the board's allocation, e.g. ADC_TIMER.
+     * @return true on success, false if the index is invalid or the timer is
+     *         in use by a board timer or another driver.
+     */
+    bool begin(uint8_t timer);
+
+    void setCallback(TimerCb cb, void *param = nullptr) override;
+    uint64_t nowUs() override;
+    void setAlarm(uint64_t atUs) override;
+    void cancelAlarm() override;
+    void lock() override;
+    void unlock() override;
+
+private:
+    void onAlarm();
+
+    hw_timer_t *mTimerHandle = nullptr;
+    uint8_t mTimerNo = 0;
+    TimerCb mCb = nullptr;
+    void *mUserParam = nullptr;
+    portMUX_TYPE mMux = portMUX_INITIALIZER_UNLOCKED;
+
+private:
+    static Esp32Alarm *sAlarms[4];
+    static void IRAM_ATTR onAlarm0();
+    static void IRAM_ATTR onAlarm1();
+    static void IRAM_ATTR onAlarm2();
+    static void IRAM_ATTR onAlarm3();
+};
@@ -0,0 +1,190 @@
+#include "Esp32I2SRing.h"
+
+Esp32I2SRing::Esp32I2SRing(i2s_port_t port) : mPort(port), mRing(mStorage, sizeof(mStorage))
+{
+}
+
+Esp32I2SRing::~Esp32I2SRing()
+{
+    stop();
+    if (mTaskHandle)
+    {
+        parkFeeder();
+        vTaskDelete(mTaskHandle);
+        mTaskHandle = nullptr;
+    }
+    if (mInstalled)
+    {
+        i2s_driver_uninstall(mPort);
+        mInstalled = false;
+    }
+}
+
+void Esp32I2SRing::begin(I2sInfo &info)
+{
+    if (mInstalled)
+    {
+        stop();
+        // the feeder may be in i2s_write() on the old driver
+        parkFeeder();
+        i2s_driver_uninstall(mPort);
+        mInstalled = false;
+    }
+    mRing.reset();
+    mRing.setFormat(info.bitpersample, 2);
+
+    i2s_config_t config = {};
+    config.mode = (i2s_mode_t)(I2S_MODE_MASTER | I2S_MODE_TX);
+    config.sample_rate = info.samplerate;
+    // 24 bit samples go out left-justified in 32 bit slots
+    config.bits_per_sample = mRing.frameBytes() == 4 ? I2S_BITS_PER_SAMPLE_16BIT : I2S_BITS_PER_SAMPLE_32BIT;
+    config.channel_format = I2S_CHANNEL_FMT_RIGHT_LEFT;
+    config.communication_format = I2S_COMM_FORMAT_STAND_I2S;
+    config.intr_alloc_flags = ESP_INTR_FLAG_LEVEL1;
+    config.dma_buf_count = I2S_RING_DMA_BUFS;
+    config.dma_buf_len = I2S_RING_DMA_FRAMES;
+    config.use_apll = false;
+    config.tx_desc_auto_clear = true;
+    // no event queue: nothing is posted per DMA buffer
+    if (i2s_driver_install(mPort, &config, 0, nullptr) != ESP_OK)
+    {
+        log_e("I2S driver install failed");
+        return;
+    }
+    i2s_pin_config_t pins = {};
+    pins.mck_io_num = info.mck_io_num >= 0 ? info.mck_io_num : I2S_PIN_NO_CHANGE;
+    pins.bck_io_num = info.bck_io_num;
+    pins.ws_io_num = info.ws_io_num;
+    pins.data_out_num = info.data_out_num;
+    pins.data_in_num = I2S_PIN_NO_CHANGE;
+    i2s_set_pin(mPort, &pins);
+    i2s_stop(mPort);
+    mInstalled = true;
+
+    if (!mTaskHandle)
+    {
+        if (xTaskCreatePinnedToCore(feederTask, "i2s_ring", I2S_RING_TASK_STACK, this,
+                                    I2S_RING_TASK_PRIORITY, &mTaskHandle, I2S_RING_TASK_CORE) != pdPASS)
+            mTaskHandle = nullptr;
+    }
+    else
+    {
+        unparkFeeder();
+    }
+}
+
+void Esp32I2SRing::start()
+{
+    if (!mInstalled || mRunning)
+        return;
+    i2s_zero_dma_buffer(mPort);
+    i2s_start(mPort);
+    mRunning = true;
+    wakeFeeder();
+}
+
+void Esp32I2SRing::stop()
+{
+    if (!mRunning)
+        return;
+    mRunning = false;
+    i2s_stop(mPort);
+}
+
+bool Esp32I2SRing::IsRunning()
+{
+    return mRunning;
+}
+
+void IRAM_ATTR Esp32I2SRing::write(void *data, size_t size)
+{
+    mRing.write(data, size);
+    wakeFeeder();
+}
+
+void IRAM_ATTR Esp32I2SRing::write(uint8_t val)
+{
+    mRing.writeSample(val);
+    wakeFeeder();
+}
+
+size_t Esp32I2SRing::writeSamples(const uint8_t *vals, size_t count)
+{
+    size_t n = mRing.writeSamples(vals, count);
+    wakeFeeder();
+    return n;
+}
+
+void IRAM_ATTR Esp32I2SRing::wakeFeeder()
+{
+    // only the write that finds the feeder waiting pays for a notification
+    if (!mTaskHandle || !mFeederIdle.exchange(false))
+        return;
+    if (xPortInIsrContext())
+    {
+        BaseType_t woken = pdFALSE;
+        vTaskNotifyGiveFromISR(mTaskHandle, &woken);
+        if (woken)
+            portYIELD_FROM_ISR();
+    }
+    else
+    {
+        xTaskNotifyGive(mTaskHandle);
+    }
+}
+
+void Esp32I2SRing::parkFeeder()
+{
+    if (!mTaskHandle)
+        return;
+    mPark.store(true);
+    xTaskNotifyGive(mTaskHandle);
+    // at most one bounded i2s_write() away; the feeder looks at mPark again
+    // before it touches the driver, so a stale mParked is harmless
+    while (!mParked.load())
+        vTaskDelay(1);
+}
+
+void Esp32I2SRing::unparkFeeder()
+{
+    if (!mTaskHandle || !mPark.load())
+        return;
+    mPark.store(false);
+    xTaskNotifyGive(mTaskHandle);
+}
+
+void Esp32I2SRing::feederTask(void *param)
+{
+    Esp32I2SRing *self = static_cast<Esp32I2SRing *>(param);
+    for (;;)
+    {
+        if (self->mPark.load())
+        {
+            self->mParked.store(true);
+            while (self->mPark.load())
+                ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            self->mParked.store(false);
+            continue;
+        }
+        size_t len = 0;
+        const uint8_t *data = self->mRunning ? self->mRing.readPtr(len) : nullptr;
+        if (len == 0)
+        {
+            // announce the wait before looking again, so a write in between
+            // isn't missed; the timeout covers start() and stop()
+            self->mFeederIdle.store(true);
+            if (self->mRunning && self->mRing.available())
+            {
+                self->mFeederIdle.store(false, std::memory_order_relaxed);
+                continue;
+            }
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(10));
+            continue;
+        }
+        size_t written = 0;
+        // blocks until the DMA interrupt frees a buffer; bounded, so a park
+        // request is seen even while the output is stopped
+        i2s_write(self->mPort, data, len, &written, pdMS_TO_TICKS(I2S_RING_WRITE_TIMEOUT_MS));
+        self->mRing.readAdvance(written);
+    }
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+#include <driver/i2s.h>
+#include <BoardProfile.h>
+#include "I2sRing.h"
+
+#define I2S_RING_BYTES 4096      /*!< Ring size, power of two: 1024 stereo 16 bit frames */
+#define I2S_RING_DMA_BUFS 4
+#define I2S_RING_DMA_FRAMES 128  /*!< Frames per DMA buffer */
+#define I2S_RING_TASK_STACK 2048
+#define I2S_RING_TASK_PRIORITY (configMAX_PRIORITIES - 2)
+#define I2S_RING_TASK_CORE 0
+#define I2S_RING_WRITE_TIMEOUT_MS 50 /*!< Longest the feeder stays in i2s_write(), e.g. while stopped */
+
+/**
+ * @brief I2S output fed from a lock-free ring instead of a queue and a timer.
+ *
+ * Esp32I2S sends every sample through a FreeRTOS queue and pops it again in
+ * a hardware timer ISR at the sample rate. Here write() only packs into an
+ * I2sRing, so a whole block costs one copy and a single sample a few
+ * stores. A feeder task hands the ring's bytes to i2s_write() without
+ * copying them; i2s_write() blocks until the I2S DMA interrupt frees a
+ * buffer, so the DMA sets the pace and no timer is needed. The driver is
+ * installed without an event queue, and when the ring runs dry the DMA
+ * sends silence (tx_desc_auto_clear).
+ *
+ * begin() again and the destructor park the feeder outside i2s_write()
+ * before they uninstall the driver; it gets there within
+ * I2S_RING_WRITE_TIMEOUT_MS.
+ *
+ * One writer at a time, task or ISR. It takes an I2S port of its own, so it
+ * replaces Esp32I2S rather than running next to it on the same port: return
+ * it from getI2sMan() of a profile derived from ESP32Profile.
+ *
+ * @code {.cpp}
+ * class MyProfile : public ESP32Profile
+ * {
+ *     Esp32I2SRing mI2s;
+ * public:
+ *     IBoardI2sMan *getI2sMan() override { return &mI2s; }
+ * };
+ * @endcode
+ */
+class Esp32I2SRing : public IBoardI2sMan
+{
+public:
+    explicit Esp32I2SRing(i2s_port_t port = I2S_NUM_0);
+    ~Esp32I2SRing();
+
+    void begin(I2sInfo &info) override;
+    void stop() override;
+    void start() override;
+    /**
+     * @brief Queue bytes already in the frame layout (bitpersample, two
+     * slots); only whole frames that fit are taken.
+     */
+    void write(void *data, size_t size) override;
+    /**
+     * @brief Queue one 8 bit value as a frame.
+     */
+    void write(uint8_t val) override;
+    bool IsRunning() override;
+
+    /**
+     * @brief Queue a block of 8 bit values.
+     *
+     * @return size_t Values taken.
+     */
+    size_t writeSamples(const uint8_t *vals, size_t count);
+    const I2sRing &getRing() const { return mRing; }
+
+private:
+    void wakeFeeder();
+    void parkFeeder();
+    void unparkFeeder();
+    static void feederTask(void *param);
+
+    i2s_port_t mPort;
+    uint8_t mStorage[I2S_RING_BYTES];
+    I2sRing mRing;
+    TaskHandle_t mTaskHandle = nullptr;
+    bool mInstalled = false;
+    volatile bool mRunning = false;
+    std::atomic<bool> mFeederIdle{false};
+    std::atomic<bool> mPark{false};   /*!< Asks the feeder to stop touching the driver */
+    std::atomic<bool> mParked{false}; /*!< Feeder is waiting in the park */
+};
@@ -0,0 +1,179 @@
+#include "Esp32RmtProfile.h"
+#include <hal/rmt_ll.h>
+#include <soc/rmt_struct.h>
+
+Esp32RmtProfile::~Esp32RmtProfile()
+{
+    endRmt();
+}
+
+bool Esp32RmtProfile::beginRmt(const uint8_t *pins, uint8_t count)
+{
+    if (mRunning || count == 0 || count > RMT_MAX_OUTPUTS)
+        return false;
+    // the 8 RAM blocks are shared: more blocks per channel means fewer refills
+    mMemBlocks = RMT_MAX_OUTPUTS / count;
+    if (mMemBlocks > RMT_MAX_MEM_BLOCKS)
+        mMemBlocks = RMT_MAX_MEM_BLOCKS;
+    mHalfItems = mMemBlocks * RMT_MEM_ITEM_NUM / 2;
+    for (uint8_t i = 0; i < count; i++)
+    {
+        // rmt_config() leaves the transmitter wrapping around its RAM
+        rmt_config_t config = RMT_DEFAULT_CONFIG_TX((gpio_num_t)pins[i], channel(i));
+        config.clk_div = RMT_CLOCK_DIVIDER;
+        config.mem_block_num = mMemBlocks;
+        config.tx_config.idle_output_en = true;
+        config.tx_config.idle_level = RMT_IDLE_LEVEL_LOW;
+        if (rmt_config(&config) != ESP_OK)
+        {
+            endRmt();
+            return false;
+        }
+        mOutputs = i + 1;
+    }
+    mTaken = xSemaphoreCreateBinary();
+    // no driver: the refill has to come from our own interrupt
+    if (mTaken == nullptr || rmt_isr_register(&Esp32RmtProfile::isr, this, ESP_INTR_FLAG_IRAM, &mIsr) != ESP_OK)
+    {
+        mIsr = nullptr;
+        endRmt();
+        return false;
+    }
+    mRunning = true;
+    return true;
+}
+
+void Esp32RmtProfile::endRmt()
+{
+    if (mStreaming)
+    {
+        rmt_set_tx_thr_intr_en(channel(0), false, mHalfItems);
+        for (uint8_t i = 0; i < mOutputs; i++)
+            rmt_tx_stop(channel(i));
+        mStreaming = false;
+    }
+    if (mIsr)
+    {
+        rmt_isr_deregister(mIsr);
+        mIsr = nullptr;
+    }
+    if (mTaken)
+    {
+        vSemaphoreDelete(mTaken);
+        mTaken = nullptr;
+    }
+    mCurrent = nullptr;
+    mNext = nullptr;
+    mOutputs = 0;
+    mRunning = false;
+}
+
+void Esp32RmtProfile::startStreaming(const rmt_item32_t *block)
+{
+    // the idle period has the length of the others, so the channels keep their pace
+    uint32_t period = block[0].duration0 + block[0].duration1;
+    rmt_item32_t idle;
+    idle.val = 0;
+    idle.duration0 = period / 2;
+    idle.duration1 = period - period / 2;
+    mIdleItem = idle.val;
+
+    mCurrent = block;
+    mNext = nullptr;
+    mPos = 0;
+    mHalf = 0;
+    refill();
+    refill();
+    rmt_set_tx_thr_intr_en(channel(0), true, mHalfItems);
+    // back to back with interrupts off: the channels start a few APB cycles apart
+    portENTER_CRITICAL(&mMux);
+    for (uint8_t i = 0; i < mOutputs; i++)
+        rmt_ll_tx_reset_pointer(&RMT, channel(i));
+    for (uint8_t i = 0; i < mOutputs; i++)
+        rmt_ll_tx_start(&RMT, channel(i));
+    portEXIT_CRITICAL(&mMux);
+    mStreaming = true;
+}
+
+bool IRAM_ATTR Esp32RmtProfile::refill()
+{
+    bool took = false;
+    uint16_t offset = mHalf * mHalfItems;
+    mHalf ^= 1;
+    for (uint16_t k = 0; k < mHalfItems; k++)
+    {
+        if (mCurrent == nullptr || mPos == mItems)
+        {
+            portENTER_CRITICAL_ISR(&mMux);
+            const rmt_item32_t *next = mNext;
+            mNext = nullptr;
+            portEXIT_CRITICAL_ISR(&mMux);
+            took |= next != nullptr;
+            mCurrent = next;
+            mPos = 0;
+        }
+        const rmt_item32_t *current = mCurrent;
+        for (uint8_t i = 0; i < mOutputs; i++)
+        {
+            volatile uint32_t *ram = (volatile uint32_t *)&RMTMEM.chan[channel(i)].data32[0];
+            ram[offset + k] = current ? current[i * mItems + mPos].val : mIdleItem;
+        }
+        if (current)
+            mPos++;
+        else
+            mUnderruns.fetch_add(1, std::memory_order_relaxed);
+    }
+    return took;
+}
+
+void IRAM_ATTR Esp32RmtProfile::isr(void *param)
+{
+    Esp32RmtProfile *self = static_cast<Esp32RmtProfile *>(param);
+    // only the first channel raises the threshold: the others are in lockstep with it
+    uint32_t thresholds = rmt_ll_get_tx_thres_interrupt_status(&RMT);
+    if (!(thresholds & (1u << self->channel(0))))
+        return;
+    rmt_ll_clear_tx_thres_interrupt(&RMT, self->channel(0));
+    if (self->refill())
+    {
+        BaseType_t woken = pdFALSE;
+        xSemaphoreGiveFromISR(self->mTaken, &woken);
+        if (woken)
+            portYIELD_FROM_ISR();
+    }
+}
+
+bool Esp32RmtProfile::sendDataDMA(uint8_t *data, size_t len)
+{
+    if (!mRunning || len == 0 || len % (mOutputs * sizeof(rmt_item32_t)) != 0)
+        return false;
+    size_t items = len / sizeof(rmt_item32_t) / mOutputs;
+    const rmt_item32_t *block = (const rmt_item32_t *)data;
+    if (!mStreaming)
+    {
+        mItems = items;
+        startStreaming(block);
+        return true;
+    }
+    if (items != mItems)
+        return false;
+
+    portENTER_CRITICAL(&mMux);
+    mNext = block;
+    portEXIT_CRITICAL(&mMux);
+    // returns once the previous block is copied out and this one is current
+    if (xSemaphoreTake(mTaken, pdMS_TO_TICKS(RMT_SEND_TIMEOUT_MS)) == pdTRUE)
+        return true;
+    portENTER_CRITICAL(&mMux);
+    bool pending = mNext == block;
+    if (pending)
+        mNext = nullptr;
+    portEXIT_CRITICAL(&mMux);
+    if (!pending)
+    {
+        // taken just as the wait ended
+        xSemaphoreTake(mTaken, 0);
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+#include <driver/rmt.h>
+#include "ESP32Profiles.h"
+
+#define RMT_MAX_OUTPUTS 8
+#define RMT_CLOCK_DIVIDER 8   /*!< 80 MHz APB / 8 = the 10 MHz symbol clock of MultiChannelOutput */
+#define RMT_MAX_MEM_BLOCKS 2  /*!< RAM blocks per channel: 128 items, one MultiChannelOutput block */
+#define RMT_SEND_TIMEOUT_MS 100
+
+/**
+ * @brief ESP32Profile whose sendDataDMA() streams PWM symbol blocks through
+ * the RMT peripheral, without gaps.
+ *
+ * Each output pin gets an RMT channel, and the data given to sendDataDMA()
+ * holds one block of 32 bit items per pin, pin after pin. The channel RAM
+ * is used as a ring: the transmitter wraps around it and never meets an end
+ * marker, so the output runs continuously. Every time the first channel has
+ * sent half of its RAM, an interrupt copies the next items of every channel
+ * into that half, from the current block and then from the queued one.
+ * Since every item is one PWM period of the same length, the channels stay
+ * in lockstep once started, and they are started together with interrupts
+ * off, a few APB cycles apart. If no block is queued in time the channels
+ * output 0 duty periods (counted in getUnderruns()) until one is.
+ *
+ * sendDataDMA() queues a block and returns once the interrupt has moved on
+ * to it, i.e. once the block before it has been copied out completely. The
+ * caller has to keep a block alive until the next call returns, so two
+ * alternating buffers are enough. The driver is not installed: this class
+ * owns the RMT interrupt. Call beginRmt() after VectorHaptics::init(), since
+ * it takes the pins over from LEDC.
+ */
+class Esp32RmtProfile : public ESP32Profile
+{
+    uint8_t mOutputs = 0;
+    uint8_t mMemBlocks = 1;
+    bool mRunning = false;
+    bool mStreaming = false;
+    rmt_isr_handle_t mIsr = nullptr;
+    SemaphoreHandle_t mTaken = nullptr; /*!< Given when the queued block becomes current */
+    portMUX_TYPE mMux = portMUX_INITIALIZER_UNLOCKED;
+    // shared with the interrupt
+    size_t mItems = 0;      /*!< Items per channel and block */
+    uint16_t mHalfItems = 0;
+    uint8_t mHalf = 0;      /*!< RAM half the next refill goes to */
+    size_t mPos = 0;        /*!< Next item of the current block */
+    const rmt_item32_t *volatile mCurrent = nullptr;
+    const rmt_item32_t *volatile mNext = nullptr;
+    uint32_t mIdleItem = 0;
+    std::atomic<uint32_t> mUnderruns{0};
+
+    rmt_channel_t channel(uint8_t output) const { return (rmt_channel_t)(output * mMemBlocks); }
+    bool refill(); /*!< true if it moved on to the queued block */
+    void startStreaming(const rmt_item32_t *block);
+    static void isr(void *param);
+
+public:
+    Esp32RmtProfile() = default;
+    ~Esp32RmtProfile();
+    /**
+     * @brief Route pins to RMT channels and set them up. Output i uses
+     * channel i * memBlocks, memBlocks = min(RMT_MAX_OUTPUTS / count,
+     * RMT_MAX_MEM_BLOCKS), since a channel's RAM takes the blocks of the
+     * channels after it.
+     *
+     * @param pins Output pins.
+     * @param count Number of pins, up to RMT_MAX_OUTPUTS.
+     * @return true if every channel was set up.
+     */
+    bool beginRmt(const uint8_t *pins, uint8_t count);
+    /**
+     * @brief Stop the RMT channels and release the interrupt. Not while
+     * another task is in sendDataDMA().
+     */
+    void endRmt();
+    /**
+     * @brief Queue one block per output pin; the first one starts the output.
+     *
+     * @param data rmt_item32_t items, len / 4 / outputs per pin, pin after pin.
+     * @param len Length in bytes; the same for every block.
+     * @return bool false if the RMT isn't running, len doesn't split evenly or
+     * the previous block wasn't taken within RMT_SEND_TIMEOUT_MS.
+     */
+    bool sendDataDMA(uint8_t *data, size_t len) override;
+    /**
+     * @brief Periods sent as 0 duty because no block was queued in time.
+     */
+    uint32_t getUnderruns() const { return mUnderruns.load(std::memory_order_relaxed); }
+    /**
+     * @brief CPU fallback of MultiChannelOutput: the LEDC write of ESP32Profile.
+     */
+    void writePins(const PinWrite *writes, size_t count) { ESP32Profile::writePins(writes, count); }
+};
@@ -0,0 +1,192 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <atomic>
+
+/**
+ * @brief Lock-free byte ring of I2S frames, one writer and one reader.
+ *
+ * The writer adds whole frames, either raw (write(const void *, size_t)) or
+ * packed from 8 bit haptic values (writeSample()); the reader takes
+ * contiguous runs of bytes straight out of the storage with readPtr() and
+ * readAdvance(), so they can be handed to the I2S driver without a copy.
+ * Head and tail are free-running counters, so the whole storage is usable
+ * and neither side ever waits for the other. The writer may be an ISR.
+ *
+ * A frame holds the same value in every slot. Up to 16 bits per sample the
+ * slots are 16 bit, above that 32 bit with the sample left-justified, which
+ * is how the ESP32 I2S takes 24 bit data. The 8 bit value is scaled to the
+ * full signed range, 0 = most negative, 255 = most positive.
+ *
+ * @code {.cpp}
+ * static uint8_t storage[1024];
+ * I2sRing ring(storage, sizeof(storage)); // size must be a power of two
+ * ring.setFormat(16, 2);
+ * ring.writeSample(200);                  // one stereo frame, 4 bytes
+ * size_t len;
+ * const uint8_t *p = ring.readPtr(len);
+ * i2s_write(I2S_NUM_0, p, len, &written, portMAX_DELAY);
+ * ring.readAdvance(written);
+ * @endcode
+ */
+class I2sRing
+{
+    uint8_t *mBuf;
+    size_t mMask;
+    std::atomic<size_t> mHead{0}; /*!< Bytes written, free running */
+    std::atomic<size_t> mTail{0}; /*!< Bytes read, free running */
+    uint8_t mSlotBytes = 2;
+    uint8_t mSlots = 2;
+    uint8_t mBits = 16;
+    std::atomic<uint32_t> mDropped{0};
+
+    void copyIn(size_t head, const uint8_t *src, size_t len)
+    {
+        size_t pos = head & mMask;
+        size_t first = mMask + 1 - pos;
+        if (first > len)
+            first = len;
+        memcpy(mBuf + pos, src, first);
+        memcpy(mBuf, src + first, len - first);
+    }
+
+public:
+    /**
+     * @param storage Ring memory; size must be a power of two.
+     */
+    I2sRing(uint8_t *storage, size_t size) : mBuf(storage), mMask(size - 1) {}
+
+    /**
+     * @brief Frame layout; only while the ring is empty.
+     *
+     * @param bitsPerSample 8-32; 8 is sent as 16.
+     * @param slots Slots per frame, 2 for stereo.
+     */
+    void setFormat(uint8_t bitsPerSample, uint8_t slots = 2)
+    {
+        mBits = bitsPerSample <= 16 ? 16 : (bitsPerSample > 32 ? 32 : bitsPerSample);
+        mSlotBytes = mBits <= 16 ? 2 : 4;
+        mSlots = slots ? slots : 1;
+    }
+
+    size_t frameBytes() const { return (size_t)mSlotBytes * mSlots; }
+    size_t capacity() const { return mMask + 1; }
+    size_t available() const { return mHead.load(std::memory_order_acquire) - mTail.load(std::memory_order_relaxed); }
+    size_t space() const { return capacity() - (mHead.load(std::memory_order_relaxed) - mTail.load(std::memory_order_acquire)); }
+    /**
+     * @brief Bytes the writer had to drop because the ring was full.
+     */
+    uint32_t getDropped() const { return mDropped.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Pack one 8 bit value into a frame.
+     *
+     * @param frame At least frameBytes() bytes.
+     * @return size_t frameBytes().
+     */
+    size_t pack(uint8_t val, uint8_t *frame) const
+    {
+        // full-scale signed, like map(val, 0, 255, min, max)
+        int64_t range = ((int64_t)1 << mBits) - 1;
+        int32_t sample = (int32_t)((int64_t)val * range / 255 - ((int64_t)1 << (mBits - 1)));
+        uint32_t word = (uint32_t)sample << (mSlotBytes * 8 - mBits);
+        for (uint8_t s = 0; s < mSlots; s++)
+        {
+            for (uint8_t b = 0; b < mSlotBytes; b++)
+                frame[s * mSlotBytes + b] = (uint8_t)(word >> (8 * b));
+        }
+        return frameBytes();
+    }
+
+    /**
+     * @brief Add one value as a frame.
+     *
+     * @return bool false if the ring is full.
+     */
+    bool writeSample(uint8_t val)
+    {
+        uint8_t frame[8];
+        size_t len = pack(val, frame);
+        size_t head = mHead.load(std::memory_order_relaxed);
+        if (capacity() - (head - mTail.load(std::memory_order_acquire)) < len)
+        {
+            mDropped.fetch_add((uint32_t)len, std::memory_order_relaxed);
+            return false;
+        }
+        copyIn(head, frame, len);
+        mHead.store(head + len, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Add values as frames, as many as fit.
+     *
+     * @return size_t Values taken.
+     */
+    size_t writeSamples(const uint8_t *vals, size_t count)
+    {
+        size_t head = mHead.load(std::memory_order_relaxed);
+        size_t fit = (capacity() - (head - mTail.load(std::memory_order_acquire))) / frameBytes();
+        size_t n = count < fit ? count : fit;
+        uint8_t frame[8];
+        for (size_t i = 0; i < n; i++)
+        {
+            size_t len = pack(vals[i], frame);
+            copyIn(head, frame, len);
+            head += len;
+        }
+        mHead.store(head, std::memory_order_release);
+        if (n < count)
+            mDropped.fetch_add((uint32_t)((count - n) * frameBytes()), std::memory_order_relaxed);
+        return n;
+    }
+
+    /**
+     * @brief Add bytes already in the frame layout; only whole frames that
+     * fit are taken.
+     *
+     * @return size_t Bytes taken.
+     */
+    size_t write(const void *data, size_t len)
+    {
+        size_t head = mHead.load(std::memory_order_relaxed);
+        size_t room = capacity() - (head - mTail.load(std::memory_order_acquire));
+        size_t n = (len < room ? len : room) / frameBytes() * frameBytes();
+        copyIn(head, (const uint8_t *)data, n);
+        mHead.store(head + n, std::memory_order_release);
+        if (n < len)
+            mDropped.fetch_add((uint32_t)(len - n), std::memory_order_relaxed);
+        return n;
+    }
+
+    /**
+     * @brief Next contiguous run of bytes to send; len 0 if the ring is empty.
+     */
+    const uint8_t *readPtr(size_t &len) const
+    {
+        size_t tail = mTail.load(std::memory_order_relaxed);
+        size_t avail = mHead.load(std::memory_order_acquire) - tail;
+        size_t pos = tail & mMask;
+        size_t run = mMask + 1 - pos;
+        len = avail < run ? avail : run;
+        return mBuf + pos;
+    }
+
+    /**
+     * @brief Release bytes returned by readPtr() once they are sent.
+     */
+    void readAdvance(size_t len)
+    {
+        mTail.store(mTail.load(std::memory_order_relaxed) + len, std::memory_order_release);
+    }
+
+    /**
+     * @brief Drop everything queued; only while the writer is idle.
+     */
+    void reset()
+    {
+        mTail.store(mHead.load(std::memory_order_acquire), std::memory_order_release);
+    }
+};
@@ -4,6 +4,17 @@
 #define PWM_FREQ 30000
 
 typedef void (*TimerCb)(void *param);
+typedef void (*AdcSampleCb)(const uint16_t *samples, size_t count, void *param);
+
+/**
+ * @brief One pin and the 8 bit value to write to it, for a board's batched
+ * pin write (see ESP32Profile::writePins()).
+ */
+struct PinWrite
+{
+    unsigned char pin;
+    unsigned char value;
+};
 
 #define vhconstrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
 
@@ -296,6 +307,113 @@ public:
     virtual void stopTimer() = 0;
 };
 
+/**
+ * @brief Interface for a board-specific one-shot alarm on a free-running
+ * microsecond counter.
+ *
+ * Inherit this class when one hardware timer should be shared by several
+ * users through a scheduler that re-arms it for the next deadline. Alarms
+ * are constructed directly (Esp32Alarm), not through BoardProfile.
+ */
+class IBoardAlarm
+{
+public:
+    virtual ~IBoardAlarm() {}
+
+    /**
+     * @brief Set the function called, from the timer ISR, when the alarm fires.
+     *
+     * @param cb Alarm callback function.
+     * @param param Optional user parameter passed to the callback.
+     */
+    virtual void setCallback(TimerCb cb, void *param = nullptr) = 0;
+
+    /**
+     * @brief Current counter value in microseconds; never wraps in practice.
+     */
+    virtual uint64_t nowUs() = 0;
+
+    /**
+     * @brief Fire the callback once when the counter reaches atUs. A time
+     * already passed fires as soon as possible. Replaces an earlier alarm.
+     *
+     * @param atUs Counter value in microseconds.
+     */
+    virtual void setAlarm(uint64_t atUs) = 0;
+
+    /**
+     * @brief Cancel a pending alarm.
+     */
+    virtual void cancelAlarm() = 0;
+
+    /**
+     * @brief Enter a section the alarm callback can't run in, from a task or
+     * from the callback itself. Keep it short: it may block interrupts.
+     */
+    virtual void lock() = 0;
+
+    /**
+     * @brief Leave the section entered with lock().
+     */
+    virtual void unlock() = 0;
+};
+
+/**
+ * @brief Interface for board-specific fixed-rate ADC sampling.
+ *
+ * Inherit this class when implementing APIs that sample an analog pin
+ * continuously at a fixed rate (hardware timer, continuous ADC/DMA, ...).
+ * Samples are delivered in blocks from task context, never from an ISR.
+ * Samplers are constructed directly (Esp32Adc), not through BoardProfile:
+ * the vtable of the precompiled profiles can't take new entries.
+ */
+class IBoardAdc
+{
+public:
+    virtual ~IBoardAdc() {}
+
+    /**
+     * @brief Configure sampling of an analog pin.
+     *
+     * @param pin GPIO pin number of the analog input.
+     * @param sampleRate Requested sample rate in Hz.
+     * @return true if the board can sample the pin at that rate, false otherwise.
+     */
+    virtual bool begin(uint8_t pin, uint32_t sampleRate) = 0;
+
+    /**
+     * @brief Set the callback receiving blocks of raw samples.
+     *
+     * @param cb Sample block callback.
+     * @param param Optional user parameter passed to the callback.
+     */
+    virtual void setCallback(AdcSampleCb cb, void *param = nullptr) = 0;
+
+    /**
+     * @brief Start sampling.
+     */
+    virtual void start() = 0;
+
+    /**
+     * @brief Stop sampling.
+     */
+    virtual void stop() = 0;
+
+    /**
+     * @brief Check if sampling is currently running.
+     *
+     * @return true if running, false otherwise.
+     */
+    virtual bool isRunning() = 0;
+
+    /**
+     * @brief Get the effective sample rate, which may differ from the requested one.
+     *
+     * @return uint32_t Sample rate in Hz.
+     */
+    virtual uint32_t getSampleRate() = 0;
+};
+
 /**
  * @brief Base class for all embedded board profiles.
  *
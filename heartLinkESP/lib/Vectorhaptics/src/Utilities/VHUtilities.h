@@ -37,6 +37,7 @@
 #define WAVE_GEN_TIMER 0
 #define PCM_TIMER 1
 #define MIXER_TIMER 2
+#define ADC_TIMER 3
 
 // Timer scalar values
 #define PCM_SCALER 2
@@ -0,0 +1,4 @@
+Import("env")
+
+# build_flags only reach the compiler; the sanitizer runtime has to be linked too
+env.Append(LINKFLAGS=[f for f in env.get("CCFLAGS", []) if str(f).startswith("-fsanitize")])
@@ -51,6 +51,13 @@ THE SOFTWARE.
 #include <Wire.h>
 
 #include "MPU6050_6Axis_MotionApps20.h"
+#include <HeartRateMonitor.h>
+#include <ImpactDetector.h>
+#include <HapticMapper.h>
+#include <ToneHapticOutput.h>
+#include <TaskFramework.h>
+#include <RtosTaskPlatform.h>
+#include <Esp32Adc.h>
 //#include "MPU6050.h" // not necessary if using MotionApps include file
 
 // Arduino Wire library is required if I2Cdev I2CDEV_ARDUINO_WIRE implementation
@@ -137,10 +144,32 @@ uint8_t fifoBuffer[64]; // FIFO storage buffer
 
 #define sdaPIN 21
 #define sclPIN 22
-#define heartPin 2
+#define heartPin 34      // ADC1; pin 2 is the MPU interrupt and ADC2 is taken by the radio
+#define heartSampleRate 500
 #define accelAddress 0x68
 
-int heartVal = 0;
+// heart rate is sampled on a hardware timer and processed off the main loop
+Esp32Adc heartAdc;
+HeartRateMonitor heart(heartSampleRate);
+uint32_t heartStartMs = 0;              // millis() when sampling started; beat times are relative to it
+
+// biometrics -> haptics: cues are scheduled ahead and played as a tone on one LEDC channel
+#define hapticPin 25
+#define hapticLedc 0
+#define hapticLedcBits 8
+HapticMapper mapper;
+ToneHapticOutput hapticOut([](float hz, float level) {
+    // half duty is the strongest square wave
+    if (level > 0)
+        ledcChangeFrequency(hapticLedc, (uint32_t)hz, hapticLedcBits);
+    ledcWrite(hapticLedc, (uint32_t)(level * (1 << (hapticLedcBits - 1))));
+});
+HapticCue hapticCues[HAPTIC_MAX_CUES];
+
+// every DMP packet goes through the impact detector (100 Hz, +1g = 8192)
+#define dmpSampleRate 100
+ImpactDetector impacts(dmpSampleRate, 8192);
+uint32_t lastPrintMs = 0;
 
 // orientation/motion vars
 Quaternion q;           // [w, x, y, z]         quaternion container
@@ -160,9 +189,259 @@ uint8_t teapotPacket[14] = { '$', 0x02, 0,0, 0,0, 0,0, 0,0, 0x00, 0x00, '\r', '\
 // ===               INTERRUPT DETECTION ROUTINE                ===
 // ================================================================
 
-volatile bool mpuInterrupt = false;     // indicates whether MPU interrupt pin has gone high
-void dmpDataReady() {
-    mpuInterrupt = true;
+void dmpDataReady();
+
+
+
+// ================================================================
+// ===                      FIRMWARE TASKS                      ===
+// ================================================================
+
+// sensor -> fusion -> haptic, with telemetry on the side. Only the telemetry
+// task touches Serial, and its short inbox drops when the terminal can't
+// keep up, so printing never delays haptics. Haptics own core 1.
+
+enum MsgType : uint8_t {
+    MSG_MPU_INT = 1,        // no payload; the DMP has packets in its FIFO
+    MSG_DMP_PACKET,         // DmpPacket
+    MSG_HEART_BEAT,         // HeartBeat
+    MSG_IMPACT,             // ImpactEvent
+    MSG_HAPTIC_CUE,         // HapticCue
+};
+
+struct DmpPacket {
+    uint8_t bytes[42];
+};
+
+RtosTaskPlatform taskPlatform;
+TaskFramework tasks(&taskPlatform);
+
+// drains the DMP FIFO whenever the MPU interrupt fires; every packet is one
+// detector sample, so none may be skipped. The slow tick only picks up
+// after a missed edge.
+class SensorTask : public FirmwareTask {
+public:
+    SensorTask() : FirmwareTask("sensor", 3, 0, 100) {}
+protected:
+    void onMessage(const TaskMessage &msg) override;
+    void onTick(uint32_t nowMs) override;
+private:
+    void drainFifo();
+};
+
+// impact detection and the biometric -> haptic mapping
+class FusionTask : public FirmwareTask {
+public:
+    // room for the packets of one late drain
+    FusionTask() : FirmwareTask("fusion", 2, 0, 20, 16) {}
+protected:
+    void onMessage(const TaskMessage &msg) override;
+    void onTick(uint32_t nowMs) override;
+};
+
+// queues cues as they arrive and steps the haptic queue
+class HapticTask : public FirmwareTask {
+public:
+    HapticTask() : FirmwareTask("haptic", 4, 1, 5) {}
+protected:
+    void onMessage(const TaskMessage &msg) override;
+    void onTick(uint32_t nowMs) override;
+};
+
+// everything that goes to Serial
+class TelemetryTask : public FirmwareTask {
+public:
+    TelemetryTask() : FirmwareTask("telemetry", 1, 0, 0, 4) {}
+protected:
+    void onMessage(const TaskMessage &msg) override;
+};
+
+SensorTask sensorTask;
+FusionTask fusionTask;
+HapticTask hapticTask;
+TelemetryTask telemetryTask;
+
+void IRAM_ATTR dmpDataReady() {
+    int woken = 0;
+    tasks.postISR(sensorTask.getId(), MSG_MPU_INT, &woken);
+    if (woken)
+        portYIELD_FROM_ISR();
+}
+
+void SensorTask::onMessage(const TaskMessage &msg) {
+    if (msg.type == MSG_MPU_INT)
+        drainFifo();
+}
+
+void SensorTask::onTick(uint32_t nowMs) {
+    drainFifo();
+}
+
+void SensorTask::drainFifo() {
+    // if programming failed, don't try to do anything
+    if (!dmpReady) return;
+    // reading the status also clears the MPU's interrupt
+    mpuIntStatus = mpu.getIntStatus();
+    fifoCount = mpu.getFIFOCount();
+    // after an overflow the FIFO no longer starts on a packet
+    if ((mpuIntStatus & (1 << MPU6050_INTERRUPT_FIFO_OFLOW_BIT)) || fifoCount >= 1024) {
+        mpu.resetFIFO();
+        return;
+    }
+    // oldest first, every whole packet; a packet still being written stays
+    // in the FIFO for the next interrupt
+    while (fifoCount >= packetSize) {
+        mpu.getFIFOBytes(fifoBuffer, packetSize);
+        fifoCount -= packetSize;
+        DmpPacket packet;
+        memcpy(packet.bytes, fifoBuffer, sizeof(packet.bytes));
+        tasks.post(fusionTask.getId(), MSG_DMP_PACKET, packet, getId());
+        tasks.post(telemetryTask.getId(), MSG_DMP_PACKET, packet, getId());
+
+        // blink LED to indicate activity
+        blinkState = !blinkState;
+        digitalWrite(LED_PIN, blinkState);
+    }
+}
+
+void FusionTask::onMessage(const TaskMessage &msg) {
+    if (msg.type == MSG_DMP_PACKET) {
+        // run impact detection on every packet
+        VectorInt16 accel;
+        ImpactEvent impact;
+        DmpPacket packet = msg.as<DmpPacket>();
+        mpu.dmpGetAccel(&accel, packet.bytes);
+        mapper.onMotion(impacts.getWindowPeakMilliG());
+        if (impacts.process(accel.x, accel.y, accel.z, impact)) {
+            mapper.onImpact(impact, tasks.millis());
+            tasks.post(telemetryTask.getId(), MSG_IMPACT, impact, getId());
+        }
+    } else if (msg.type == MSG_HEART_BEAT) {
+        HeartBeat beat = msg.as<HeartBeat>();
+        mapper.onBeat(beat, heartStartMs + beat.timeMs);
+        tasks.post(telemetryTask.getId(), MSG_HEART_BEAT, beat, getId());
+    }
+}
+
+void FusionTask::onTick(uint32_t nowMs) {
+    // hand out whatever is due within the lookahead; the queue keeps the timing
+    size_t cueCount = mapper.update(nowMs, hapticCues, HAPTIC_MAX_CUES);
+    for (size_t i = 0; i < cueCount; i++)
+        tasks.post(hapticTask.getId(), MSG_HAPTIC_CUE, hapticCues[i], getId());
+}
+
+void HapticTask::onMessage(const TaskMessage &msg) {
+    if (msg.type == MSG_HAPTIC_CUE) {
+        HapticCue cue = msg.as<HapticCue>();
+        hapticOut.submit(&cue, 1, tasks.millis());
+    }
+}
+
+void HapticTask::onTick(uint32_t nowMs) {
+    hapticOut.render(nowMs);
+}
+
+void TelemetryTask::onMessage(const TaskMessage &msg) {
+    if (msg.type == MSG_HEART_BEAT) {
+        Serial.print("bpm\t");
+        Serial.println(msg.as<HeartBeat>().bpm);
+        return;
+    }
+    if (msg.type == MSG_IMPACT) {
+        ImpactEvent impact = msg.as<ImpactEvent>();
+        Serial.print(impact.type == ImpactType::FALL ? "FALL\t" : "IMPACT\t");
+        Serial.print(impact.peakMilliG);
+        Serial.print("mg\tseverity ");
+        Serial.println((int)impact.severity);
+        return;
+    }
+    if (msg.type != MSG_DMP_PACKET) return;
+    if (millis() - lastPrintMs < 1000) return;
+    lastPrintMs = millis();
+    DmpPacket packet = msg.as<DmpPacket>();
+    const uint8_t *fifoBuffer = packet.bytes;
+
+    #ifdef OUTPUT_READABLE_QUATERNION
+        // display quaternion values in easy matrix form: w x y z
+        mpu.dmpGetQuaternion(&q, fifoBuffer);
+        Serial.print("quat\t");
+        Serial.print(q.w);
+        Serial.print("\t");
+        Serial.print(q.x);
+        Serial.print("\t");
+        Serial.print(q.y);
+        Serial.print("\t");
+        Serial.println(q.z);
+    #endif
+
+    #ifdef OUTPUT_READABLE_EULER
+        // display Euler angles in degrees
+        mpu.dmpGetQuaternion(&q, fifoBuffer);
+        mpu.dmpGetEuler(euler, &q);
+        Serial.print("euler\t");
+        Serial.print(euler[0] * 180/M_PI);
+        Serial.print("\t");
+        Serial.print(euler[1] * 180/M_PI);
+        Serial.print("\t");
+        Serial.println(euler[2] * 180/M_PI);
+    #endif
+
+    #ifdef OUTPUT_READABLE_YAWPITCHROLL
+        // display Euler angles in degrees
+        mpu.dmpGetQuaternion(&q, fifoBuffer);
+        mpu.dmpGetGravity(&gravity, &q);
+        mpu.dmpGetYawPitchRoll(ypr, &q, &gravity);
+        Serial.print("ypr\t");
+        Serial.print(ypr[0] * 180/M_PI);
+        Serial.print("\t");
+        Serial.print(ypr[1] * 180/M_PI);
+        Serial.print("\t");
+        Serial.println(ypr[2] * 180/M_PI);
+    #endif
+
+    #ifdef OUTPUT_READABLE_REALACCEL
+        // display real acceleration, adjusted to remove gravity
+        mpu.dmpGetQuaternion(&q, fifoBuffer);
+        mpu.dmpGetAccel(&aa, fifoBuffer);
+        mpu.dmpGetGravity(&gravity, &q);
+        mpu.dmpGetLinearAccel(&aaReal, &aa, &gravity);
+        Serial.print("areal\t");
+        Serial.print(aaReal.x);
+        Serial.print("\t");
+        Serial.print(aaReal.y);
+        Serial.print("\t");
+        Serial.println(aaReal.z);
+    #endif
+
+    #ifdef OUTPUT_READABLE_WORLDACCEL
+        // display initial world-frame acceleration, adjusted to remove gravity
+        // and rotated based on known orientation from quaternion
+        mpu.dmpGetQuaternion(&q, fifoBuffer);
+        mpu.dmpGetAccel(&aa, fifoBuffer);
+        mpu.dmpGetGravity(&gravity, &q);
+        mpu.dmpGetLinearAccel(&aaReal, &aa, &gravity);
+        mpu.dmpGetLinearAccelInWorld(&aaWorld, &aaReal, &q);
+        Serial.print("aworld\t");
+        Serial.print(aaWorld.x);
+        Serial.print("\t");
+        Serial.print(aaWorld.y);
+        Serial.print("\t");
+        Serial.println(aaWorld.z);
+    #endif
+
+    #ifdef OUTPUT_TEAPOT
+        // display quaternion values in InvenSense Teapot demo format:
+        teapotPacket[2] = fifoBuffer[0];
+        teapotPacket[3] = fifoBuffer[1];
+        teapotPacket[4] = fifoBuffer[4];
+        teapotPacket[5] = fifoBuffer[5];
+        teapotPacket[6] = fifoBuffer[8];
+        teapotPacket[7] = fifoBuffer[9];
+        teapotPacket[8] = fifoBuffer[12];
+        teapotPacket[9] = fifoBuffer[13];
+        Serial.write(teapotPacket, 14);
+        teapotPacket[11]++; // packetCount, loops at 0xFF on purpose
+    #endif
 }
 
 
@@ -174,7 +453,6 @@ void dmpDataReady() {
 void setup() {
     Serial.begin(115200);
     Wire.begin(sdaPIN, sclPIN);
-    pinMode(heartPin, INPUT);
     // join I2C bus (I2Cdev library doesn't do this automatically)
     #if I2CDEV_IMPLEMENTATION == I2CDEV_ARDUINO_WIRE
         Wire.begin();
@@ -237,12 +515,12 @@ void setup() {
         attachInterrupt(digitalPinToInterrupt(INTERRUPT_PIN), dmpDataReady, RISING);
         mpuIntStatus = mpu.getIntStatus();
 
-        // set our DMP Ready flag so the main loop() function knows it's okay to use it
-        Serial.println(F("DMP ready! Waiting for first interrupt..."));
-        dmpReady = true;
-
         // get expected DMP packet size for later comparison
         packetSize = mpu.dmpGetFIFOPacketSize();
+
+        // set our DMP Ready flag so the sensor task knows it's okay to use it
+        Serial.println(F("DMP ready! Waiting for first interrupt..."));
+        dmpReady = true;
     } else {
         // ERROR!
         // 1 = initial memory load failed
@@ -255,6 +533,24 @@ void setup() {
 
     // configure LED for output
     pinMode(LED_PIN, OUTPUT);
+
+    ledcSetup(hapticLedc, (uint32_t)TONE_CARRIER_HZ, hapticLedcBits);
+    ledcAttachPin(hapticPin, hapticLedc);
+    ledcWrite(hapticLedc, 0);
+
+    tasks.add(&sensorTask);
+    tasks.add(&fusionTask);
+    tasks.add(&hapticTask);
+    tasks.add(&telemetryTask);
+    if (!tasks.start())
+        Serial.println(F("Task start failed"));
+
+    heart.onBeat([](const HeartBeat &b) {
+        tasks.post(fusionTask.getId(), MSG_HEART_BEAT, b);
+    });
+    heartStartMs = millis();
+    if (!heart.begin(&heartAdc, heartPin))
+        Serial.println(F("Heart rate sampler failed to start"));
 }
 
 
@@ -264,98 +560,6 @@ void setup() {
 // ================================================================
 
 void loop() {
-    heartVal = analogRead(heartPin);
-    Serial.println(heartVal);
-    delay(250);
-    // if programming failed, don't try to do anything
-    if (!dmpReady) return;
-    // read a packet from FIFO
-    if (mpu.dmpGetCurrentFIFOPacket(fifoBuffer)) { // Get the Latest packet 
-        #ifdef OUTPUT_READABLE_QUATERNION
-            // display quaternion values in easy matrix form: w x y z
-            mpu.dmpGetQuaternion(&q, fifoBuffer);
-            Serial.print("quat\t");
-            Serial.print(q.w);
-            Serial.print("\t");
-            Serial.print(q.x);
-            Serial.print("\t");
-            Serial.print(q.y);
-            Serial.print("\t");
-            Serial.println(q.z);
-        #endif
-
-        #ifdef OUTPUT_READABLE_EULER
-            // display Euler angles in degrees
-            mpu.dmpGetQuaternion(&q, fifoBuffer);
-            mpu.dmpGetEuler(euler, &q);
-            Serial.print("euler\t");
-            Serial.print(euler[0] * 180/M_PI);
-            Serial.print("\t");
-            Serial.print(euler[1] * 180/M_PI);
-            Serial.print("\t");
-            Serial.println(euler[2] * 180/M_PI);
-        #endif
-
-        #ifdef OUTPUT_READABLE_YAWPITCHROLL
-            // display Euler angles in degrees
-            mpu.dmpGetQuaternion(&q, fifoBuffer);
-            mpu.dmpGetGravity(&gravity, &q);
-            mpu.dmpGetYawPitchRoll(ypr, &q, &gravity);
-            Serial.print("ypr\t");
-            Serial.print(ypr[0] * 180/M_PI);
-            Serial.print("\t");
-            Serial.print(ypr[1] * 180/M_PI);
-            Serial.print("\t");
-            Serial.println(ypr[2] * 180/M_PI);
-            delay(1000);
-        #endif
-
-        #ifdef OUTPUT_READABLE_REALACCEL
-            // display real acceleration, adjusted to remove gravity
-            mpu.dmpGetQuaternion(&q, fifoBuffer);
-            mpu.dmpGetAccel(&aa, fifoBuffer);
-            mpu.dmpGetGravity(&gravity, &q);
-            mpu.dmpGetLinearAccel(&aaReal, &aa, &gravity);
-            Serial.print("areal\t");
-            Serial.print(aaReal.x);
-            Serial.print("\t");
-            Serial.print(aaReal.y);
-            Serial.print("\t");
-            Serial.println(aaReal.z);
-        #endif
-
-        #ifdef OUTPUT_READABLE_WORLDACCEL
-            // display initial world-frame acceleration, adjusted to remove gravity
-            // and rotated based on known orientation from quaternion
-            mpu.dmpGetQuaternion(&q, fifoBuffer);
-            mpu.dmpGetAccel(&aa, fifoBuffer);
-            mpu.dmpGetGravity(&gravity, &q);
-            mpu.dmpGetLinearAccel(&aaReal, &aa, &gravity);
-            mpu.dmpGetLinearAccelInWorld(&aaWorld, &aaReal, &q);
-            Serial.print("aworld\t");
-            Serial.print(aaWorld.x);
-            Serial.print("\t");
-            Serial.print(aaWorld.y);
-            Serial.print("\t");
-            Serial.println(aaWorld.z);
-        #endif
-    
-        #ifdef OUTPUT_TEAPOT
-            // display quaternion values in InvenSense Teapot demo format:
-            teapotPacket[2] = fifoBuffer[0];
-            teapotPacket[3] = fifoBuffer[1];
-            teapotPacket[4] = fifoBuffer[4];
-            teapotPacket[5] = fifoBuffer[5];
-            teapotPacket[6] = fifoBuffer[8];
-            teapotPacket[7] = fifoBuffer[9];
-            teapotPacket[8] = fifoBuffer[12];
-            teapotPacket[9] = fifoBuffer[13];
-            Serial.write(teapotPacket, 14);
-            teapotPacket[11]++; // packetCount, loops at 0xFF on purpose
-        #endif
-
-        // blink LED to indicate activity
-        blinkState = !blinkState;
-        digitalWrite(LED_PIN, blinkState);
-    }
+    // everything runs in the firmware tasks; free the Arduino loop task
+    vTaskDelete(NULL);
 }
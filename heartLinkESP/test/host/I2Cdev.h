@@ -0,0 +1,60 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+
+// Host stand-in for I2Cdev, for the native test env: there is no bus, every
+// read fails and every write is dropped. Like the real header it brings in
+// the Arduino calls the MPU6050 driver uses, so the driver builds on the host
+// and its packet math can be tested.
+#define I2CDEV_DEFAULT_READ_TIMEOUT 1000
+#define I2CDEVLIB_WIRE_BUFFER_LENGTH 32
+#ifndef PI
+#define PI 3.1415926535897932384626433832795
+#endif
+#define PROGMEM
+#define pgm_read_byte(addr) (*(const unsigned char *)(addr))
+#define DEC 10
+#define HEX 16
+
+static inline void delay(unsigned long) {}
+static inline unsigned long micros() { return 0; }
+static inline long map(long x, long inMin, long inMax, long outMin, long outMax)
+{
+    return (x - inMin) * (outMax - outMin) / (inMax - inMin) + outMin;
+}
+
+struct HostSerial
+{
+    template <typename T>
+    void print(T, int = DEC) {}
+    template <typename T>
+    void println(T, int = DEC) {}
+    void println() {}
+    void write(char) {}
+};
+static HostSerial Serial;
+
+class I2Cdev
+{
+public:
+    static int8_t readBit(uint8_t, uint8_t, uint8_t, uint8_t *, uint16_t = 0, void * = 0) { return -1; }
+    static int8_t readBitW(uint8_t, uint8_t, uint8_t, uint16_t *, uint16_t = 0, void * = 0) { return -1; }
+    static int8_t readBits(uint8_t, uint8_t, uint8_t, uint8_t, uint8_t *, uint16_t = 0, void * = 0) { return -1; }
+    static int8_t readBitsW(uint8_t, uint8_t, uint8_t, uint8_t, uint16_t *, uint16_t = 0, void * = 0) { return -1; }
+    static int8_t readByte(uint8_t, uint8_t, uint8_t *, uint16_t = 0, void * = 0) { return -1; }
+    static int8_t readWord(uint8_t, uint8_t, uint16_t *, uint16_t = 0, void * = 0) { return -1; }
+    static int8_t readBytes(uint8_t, uint8_t, uint8_t, uint8_t *, uint16_t = 0, void * = 0) { return -1; }
+    static int8_t readWords(uint8_t, uint8_t, uint8_t, uint16_t *, uint16_t = 0, void * = 0) { return -1; }
+
+    static bool writeBit(uint8_t, uint8_t, uint8_t, uint8_t, void * = 0) { return false; }
+    static bool writeBitW(uint8_t, uint8_t, uint8_t, uint16_t, void * = 0) { return false; }
+    static bool writeBits(uint8_t, uint8_t, uint8_t, uint8_t, uint8_t, void * = 0) { return false; }
+    static bool writeBitsW(uint8_t, uint8_t, uint8_t, uint8_t, uint16_t, void * = 0) { return false; }
+    static bool writeByte(uint8_t, uint8_t, uint8_t, void * = 0) { return false; }
+    static bool writeWord(uint8_t, uint8_t, uint16_t, void * = 0) { return false; }
+    static bool writeBytes(uint8_t, uint8_t, uint8_t, uint8_t *, void * = 0) { return false; }
+    static bool writeWords(uint8_t, uint8_t, uint8_t, uint16_t *, void * = 0) { return false; }
+
+    static inline uint16_t readTimeout = I2CDEV_DEFAULT_READ_TIMEOUT;
+};
@@ -0,0 +1,200 @@
+// Host test of the A2DP sink telemetry counters and of CommandDevTools, which
+// serves them as a dev-tools command.
+#include <unity.h>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <A2DPSinkTelemetry.h>
+#include <VectorHaptics.h>
+#include "CommandDevTools.h"
+
+// VectorHaptics' implementation is not part of the host build; replies of a
+// CommandDevTools without a VectorHaptics are never logged, so this only links
+void VectorHaptics::logMessages(std::string, LOG_TYPE) {}
+
+// what CommandDevTools::addTelemetryCommand() needs of a sink
+struct FakeSink
+{
+    A2DPTelemetryCounter counter;
+    int resets = 0;
+    A2DPSinkTelemetry get_telemetry() { return counter.snapshot(0); }
+    void reset_telemetry()
+    {
+        counter.reset();
+        resets++;
+    }
+};
+
+struct InnerDevTools : IDevTools
+{
+    std::string received;
+    bool initialised = false;
+    void init() override { initialised = true; }
+    int parseCommandList(std::string &commands) override
+    {
+        received += commands;
+        return VH_SUCCESS;
+    }
+};
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_histogram_bins_double(void)
+{
+    TEST_ASSERT_EQUAL(0, A2DPTelemetryCounter::histogram_bin(0));
+    TEST_ASSERT_EQUAL(0, A2DPTelemetryCounter::histogram_bin(A2DP_TELEMETRY_HISTOGRAM_MIN_US - 1));
+    TEST_ASSERT_EQUAL(1, A2DPTelemetryCounter::histogram_bin(A2DP_TELEMETRY_HISTOGRAM_MIN_US));
+    TEST_ASSERT_EQUAL(1, A2DPTelemetryCounter::histogram_bin(2 * A2DP_TELEMETRY_HISTOGRAM_MIN_US - 1));
+    TEST_ASSERT_EQUAL(2, A2DPTelemetryCounter::histogram_bin(2 * A2DP_TELEMETRY_HISTOGRAM_MIN_US));
+    TEST_ASSERT_EQUAL(A2DP_TELEMETRY_HISTOGRAM_BINS - 1, A2DPTelemetryCounter::histogram_bin(0xFFFFFFFF));
+    TEST_ASSERT_EQUAL_UINT32(0, A2DPSinkTelemetry::histogram_limit_us(A2DP_TELEMETRY_HISTOGRAM_BINS - 1));
+}
+
+void test_counters_and_snapshot(void)
+{
+    A2DPTelemetryCounter counter;
+    for (int i = 0; i < 100; i++)
+    {
+        counter.on_packet(4096);
+        counter.on_callback(i * 10);
+    }
+    counter.on_drop(4096);
+    counter.on_underflow();
+    counter.on_fill(1000, 30000);
+    counter.on_fill(500, 30000);
+    A2DPSinkTelemetry t = counter.snapshot(5);
+    TEST_ASSERT_FALSE(t.rssi_valid);
+    TEST_ASSERT_EQUAL_UINT32(0, t.rssi_age_ms);
+
+    counter.on_rssi(-3, 100);
+    t = counter.snapshot(350);
+    TEST_ASSERT_EQUAL_UINT32(100, t.packets);
+    TEST_ASSERT_EQUAL_UINT32(409600, t.bytes);
+    TEST_ASSERT_EQUAL_UINT32(1, t.dropped_packets);
+    TEST_ASSERT_EQUAL_UINT32(4096, t.dropped_bytes);
+    TEST_ASSERT_EQUAL_UINT32(1, t.underflows);
+    TEST_ASSERT_EQUAL_UINT32(30000, t.ringbuffer_size);
+    TEST_ASSERT_EQUAL_UINT32(1000, t.ringbuffer_high_water);
+    TEST_ASSERT_EQUAL_UINT32(100, t.callback_count);
+    TEST_ASSERT_EQUAL_UINT32(990, t.callback_max_us);
+    TEST_ASSERT_TRUE(t.rssi_valid);
+    TEST_ASSERT_EQUAL_INT8(-3, t.rssi_delta);
+    TEST_ASSERT_EQUAL_UINT32(250, t.rssi_age_ms);
+    uint32_t sum = 0;
+    for (uint32_t count : t.callback_histogram)
+        sum += count;
+    TEST_ASSERT_EQUAL_UINT32(100, sum);
+
+    counter.reset();
+    t = counter.snapshot(0);
+    TEST_ASSERT_EQUAL_UINT32(0, t.packets);
+    TEST_ASSERT_EQUAL_UINT32(0, t.ringbuffer_high_water);
+    TEST_ASSERT_FALSE(t.rssi_valid);
+    // the capacity is configuration, not a counter
+    TEST_ASSERT_EQUAL_UINT32(30000, t.ringbuffer_size);
+}
+
+void test_print_to_truncates_safely(void)
+{
+    A2DPTelemetryCounter counter;
+    counter.on_packet(10);
+    counter.on_rssi(2, 0);
+    A2DPSinkTelemetry t = counter.snapshot(10);
+    char line[300];
+    int n = t.print_to(line, sizeof(line));
+    TEST_ASSERT_EQUAL((int)strlen(line), n);
+    TEST_ASSERT_EQUAL(0, strncmp(line, "packets=1 ", 10));
+    char small[20];
+    n = t.print_to(small, sizeof(small));
+    TEST_ASSERT_EQUAL(19, n);
+    TEST_ASSERT_EQUAL(19, (int)strlen(small));
+}
+
+void test_commands_are_split_from_the_inner_tools(void)
+{
+    InnerDevTools inner;
+    CommandDevTools devTools(&inner);
+    devTools.init();
+    TEST_ASSERT_TRUE(inner.initialised);
+
+    std::string args;
+    int calls = 0;
+    TEST_ASSERT_TRUE(devTools.addCommand("a2dp", [&](const std::string &a) {
+        args += "[" + a + "]";
+        calls++;
+        return std::string();
+    }));
+    std::string commands = "p 1 10;a2dp  reset ;t 1 10;a2dp;";
+    TEST_ASSERT_EQUAL(VH_SUCCESS, devTools.parseCommandList(commands));
+    TEST_ASSERT_EQUAL_STRING("p 1 10;t 1 10;", inner.received.c_str());
+    TEST_ASSERT_EQUAL_STRING("[reset][]", args.c_str());
+    TEST_ASSERT_EQUAL(2, calls);
+
+    // only own commands: the inner tools are not called
+    inner.received.clear();
+    commands = "a2dp";
+    TEST_ASSERT_EQUAL(VH_SUCCESS, devTools.parseCommandList(commands));
+    TEST_ASSERT_TRUE(inner.received.empty());
+
+    TEST_ASSERT_FALSE(devTools.addCommand("", [](const std::string &) { return std::string(); }));
+    TEST_ASSERT_FALSE(devTools.addCommand("x", nullptr));
+}
+
+void test_unknown_command_without_inner_tools(void)
+{
+    CommandDevTools devTools(nullptr);
+    devTools.init();
+    std::string commands = "nope 1";
+    TEST_ASSERT_EQUAL(VH_ERROR, devTools.parseCommandList(commands));
+}
+
+void test_telemetry_command_resets_the_sink(void)
+{
+    FakeSink sink;
+    sink.counter.on_packet(10);
+    CommandDevTools devTools(nullptr);
+    TEST_ASSERT_FALSE(devTools.addTelemetryCommand((FakeSink *)nullptr));
+    TEST_ASSERT_TRUE(devTools.addTelemetryCommand(&sink));
+    std::string commands = "a2dp;a2dp reset;a2dp";
+    TEST_ASSERT_EQUAL(VH_SUCCESS, devTools.parseCommandList(commands));
+    TEST_ASSERT_EQUAL(1, sink.resets);
+    TEST_ASSERT_EQUAL_UINT32(0, sink.get_telemetry().packets);
+}
+
+// run under env:native_tsan: reset() and snapshot() race with the audio task
+void test_reset_while_counting(void)
+{
+    A2DPTelemetryCounter counter;
+    std::atomic<bool> stop{false};
+    std::thread audio([&] {
+        while (!stop)
+        {
+            counter.on_packet(4);
+            counter.on_callback(100);
+            counter.on_fill(50, 100);
+        }
+    });
+    for (int i = 0; i < 2000; i++)
+    {
+        A2DPSinkTelemetry t = counter.snapshot(0);
+        TEST_ASSERT_TRUE(t.ringbuffer_high_water <= 100);
+        if (i % 10 == 0)
+            counter.reset();
+    }
+    stop = true;
+    audio.join();
+}
+
+int main(int, char **)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_histogram_bins_double);
+    RUN_TEST(test_counters_and_snapshot);
+    RUN_TEST(test_print_to_truncates_safely);
+    RUN_TEST(test_commands_are_split_from_the_inner_tools);
+    RUN_TEST(test_unknown_command_without_inner_tools);
+    RUN_TEST(test_telemetry_command_resets_the_sink);
+    RUN_TEST(test_reset_while_counting);
+    return UNITY_END();
+}
@@ -0,0 +1,162 @@
+// Host test of the Q15 volume stage: bit exact with the old divide path
+// whenever no ramp is active, for every volume and buffer alignment.
+#include <unity.h>
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <A2DPFramePipeline.h>
+
+#define FRAMES 512
+
+// exposes the factor the old path divided by
+template <class Control>
+struct Probe : Control
+{
+    void setVolume(uint8_t volume) { this->set_volume(volume); }
+    int32_t factor() { return this->volumeFactor; }
+    int32_t factorMax() { return this->volumeFactorMax; }
+};
+
+static int32_t clipRef(int32_t v)
+{
+    if (v < -32768)
+        return -32768;
+    if (v > 32767)
+        return 32767;
+    return v;
+}
+
+// update_audio_data() before the Q15 gain
+static void reference(Frame *frames, int count, bool mono, int32_t factor, int32_t factorMax)
+{
+    for (int i = 0; i < count; i++)
+    {
+        int32_t l = frames[i].channel1, r = frames[i].channel2;
+        if (mono)
+            r = l = (l + r) / 2;
+        frames[i].channel1 = clipRef(l * factor / factorMax);
+        frames[i].channel2 = clipRef(r * factor / factorMax);
+    }
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_clip16_saturates(void)
+{
+    for (int32_t v = -70000; v <= 70000; v++)
+        TEST_ASSERT_EQUAL_INT32(clipRef(v), A2DPVolumeControl::clip16(v));
+}
+
+void test_gain_rounds_like_the_division(void)
+{
+    // every sample at unity, half and the lowest gains of a 4096 scale
+    const int32_t factors[] = {4096, 4095, 2048, 1000, 3, 1, 0};
+    for (int32_t factor : factors)
+    {
+        int32_t gain = factor << 3;
+        for (int32_t pcm = -32768; pcm <= 32767; pcm++)
+            TEST_ASSERT_EQUAL_INT32(clipRef(pcm * factor / 4096), A2DPVolumeControl::apply_gain_q15(pcm, gain));
+    }
+}
+
+template <class Control>
+static int mismatches()
+{
+    int bad = 0;
+    std::vector<uint8_t> raw(FRAMES * 4 + 8);
+    std::vector<Frame> expect(FRAMES);
+    uint32_t seed = 7;
+    for (int volume = 0; volume <= 127; volume++)
+    {
+        for (int mono = 0; mono < 2; mono++)
+        {
+            // offset 2: a buffer that is only 16 bit aligned
+            for (int offset = 0; offset <= 2; offset += 2)
+            {
+                Probe<Control> control;
+                control.setVolume(volume);
+                control.set_enabled(true);
+                control.set_mono_downmix(mono);
+                Frame *frames = (Frame *)(raw.data() + offset);
+                for (int i = 0; i < FRAMES; i++)
+                {
+                    seed = seed * 1664525 + 1013904223;
+                    Frame f((int16_t)(seed >> 16), (int16_t)seed);
+                    if (i < 4)
+                        f = Frame(i & 1 ? 32767 : -32768, i & 2 ? -32768 : 32767);
+                    memcpy(&frames[i], &f, sizeof(f));
+                    expect[i] = f;
+                }
+                control.update_audio_data(frames, FRAMES);
+                reference(expect.data(), FRAMES, mono, control.factor(), control.factorMax());
+                bad += memcmp(frames, expect.data(), FRAMES * 4) != 0;
+
+                // the same gain through the fused pipeline
+                for (int i = 0; i < FRAMES; i++)
+                {
+                    Frame f(i * 97 - 20000, -i * 61 + 15000);
+                    memcpy(&frames[i], &f, sizeof(f));
+                    expect[i] = f;
+                }
+                A2DPFramePipeline pipeline;
+                pipeline.configure(false, &control, false);
+                pipeline.run(frames, FRAMES);
+                reference(expect.data(), FRAMES, mono, control.factor(), control.factorMax());
+                bad += memcmp(frames, expect.data(), FRAMES * 4) != 0;
+            }
+        }
+    }
+    return bad;
+}
+
+void test_default_control_is_bit_exact(void)
+{
+    TEST_ASSERT_EQUAL(0, mismatches<A2DPDefaultVolumeControl>());
+}
+
+void test_exponential_control_is_bit_exact(void)
+{
+    TEST_ASSERT_EQUAL(0, mismatches<A2DPSimpleExponentialVolumeControl>());
+}
+
+void test_linear_control_is_bit_exact(void)
+{
+    TEST_ASSERT_EQUAL(0, mismatches<A2DPLinearVolumeControl>());
+}
+
+// a volume change ramps over one block and then lands on the old value
+void test_volume_change_ramps(void)
+{
+    Probe<A2DPDefaultVolumeControl> control;
+    control.set_enabled(true);
+    control.setVolume(127);
+    std::vector<Frame> block(FRAMES, Frame(20000));
+    control.update_audio_data(block.data(), FRAMES);
+    int32_t before = block[FRAMES - 1].channel1;
+
+    control.setVolume(40);
+    std::fill(block.begin(), block.end(), Frame(20000));
+    control.update_audio_data(block.data(), FRAMES);
+    int32_t maxStep = abs(block[0].channel1 - before);
+    for (int i = 1; i < FRAMES; i++)
+        maxStep = std::max<int32_t>(maxStep, abs(block[i].channel1 - block[i - 1].channel1));
+    TEST_ASSERT_LESS_THAN(64, maxStep);
+
+    std::fill(block.begin(), block.end(), Frame(20000));
+    control.update_audio_data(block.data(), FRAMES);
+    TEST_ASSERT_EQUAL_INT32(20000 * control.factor() / control.factorMax(), block[0].channel1);
+}
+
+int main(int, char **)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_clip16_saturates);
+    RUN_TEST(test_gain_rounds_like_the_division);
+    RUN_TEST(test_default_control_is_bit_exact);
+    RUN_TEST(test_exponential_control_is_bit_exact);
+    RUN_TEST(test_linear_control_is_bit_exact);
+    RUN_TEST(test_volume_change_ramps);
+    return UNITY_END();
+}
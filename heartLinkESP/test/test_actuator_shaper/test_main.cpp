@@ -0,0 +1,192 @@
+// Host test of ActuatorShaper against simulated actuators: a resonant LRA and
+// a first-order ERM, with and without overdrive and braking.
+#include <unity.h>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <thread>
+#include <vector>
+#include "ActuatorShaper.h"
+
+#define FS 8000
+#define PULSE_MS 250
+
+// x'' + w/Q x' + w^2 x = w^2 F; the level is the velocity amplitude
+struct Lra
+{
+    double w, q, x = 0, v = 0;
+    Lra(double hz, double tauMs) : w(2 * M_PI * hz), q(M_PI * hz * tauMs / 1000) {}
+    double step(double f)
+    {
+        const double dt = 1.0 / FS / 8;
+        for (int k = 0; k < 8; k++)
+        {
+            v += (w * w * (f - x) - w / q * v) * dt;
+            x += v * dt;
+        }
+        return v / w;
+    }
+};
+
+// motor speed follows the drive with one time constant, reversed when braking
+struct Erm
+{
+    double a, s = 0;
+    explicit Erm(double tauMs) : a(1 - exp(-1000.0 / (tauMs * FS))) {}
+    double step(double f) { return s += (f - s) * a; }
+};
+
+struct Response
+{
+    double steady = 0;
+    double riseMs = 0; // pulse start to 90 % of the steady level
+    double fallMs = 0; // pulse end to 10 %
+};
+
+template <class A>
+static Response measure(A actuator, const ActuatorModel &model, bool shaping)
+{
+    ActuatorShaper shaper(model, FS);
+    shaper.setShaping(shaping);
+    shaper.setBraking(shaping);
+    shaper.pulse(1.0f, PULSE_MS);
+    const int n = FS * 2 * PULSE_MS / 1000, end = FS * PULSE_MS / 1000;
+    std::vector<double> level(n);
+    for (int i = 0; i < n; i++)
+    {
+        int16_t drive;
+        shaper.render(&drive, 1);
+        level[i] = fabs(actuator.step(drive / 255.0));
+    }
+    // envelope: the peak over the last carrier period
+    const int period = FS / 100;
+    std::vector<double> env(n);
+    for (int i = 0; i < n; i++)
+        env[i] = *std::max_element(level.begin() + std::max(0, i - period + 1), level.begin() + i + 1);
+    Response r;
+    r.steady = env[end - period];
+    int i = 0;
+    while (i < end && env[i] < 0.9 * r.steady)
+        i++;
+    r.riseMs = i * 1000.0 / FS;
+    for (i = end; i < n && env[i] > 0.1 * r.steady; i++)
+        ;
+    r.fallMs = (i - end) * 1000.0 / FS;
+    return r;
+}
+
+template <class A>
+static void checkFaster(A actuator, const ActuatorModel &model, double maxRiseMs, double maxFallMs)
+{
+    Response plain = measure(actuator, model, false);
+    Response shaped = measure(actuator, model, true);
+    // the same level, reached and left much sooner
+    TEST_ASSERT_FLOAT_WITHIN(0.1 * plain.steady, plain.steady, shaped.steady);
+    TEST_ASSERT_TRUE(shaped.riseMs < maxRiseMs);
+    TEST_ASSERT_TRUE(shaped.fallMs < maxFallMs);
+    TEST_ASSERT_TRUE(shaped.riseMs < plain.riseMs / 2);
+    TEST_ASSERT_TRUE(shaped.fallMs < plain.fallMs / 3);
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_lra_with_overdrive_headroom(void)
+{
+    checkFaster(Lra(160, 25), ActuatorModel::lra(160, 25, 0.6f), 25, 20);
+}
+
+void test_lra_driven_at_full_scale_still_brakes(void)
+{
+    // no headroom for overdrive: the onset is the plain one
+    Response plain = measure(Lra(160, 25), ActuatorModel::lra(160, 25, 1.0f), false);
+    Response shaped = measure(Lra(160, 25), ActuatorModel::lra(160, 25, 1.0f), true);
+    TEST_ASSERT_FLOAT_WITHIN(1, plain.riseMs, shaped.riseMs);
+    TEST_ASSERT_TRUE(shaped.fallMs < plain.fallMs / 2);
+}
+
+void test_erm(void)
+{
+    checkFaster(Erm(40), ActuatorModel::erm(40, 0.6f), 40, 30);
+}
+
+void test_pin_mappings(void)
+{
+    const int16_t drive[5] = {-255, -1, 0, 1, 255};
+    uint8_t pins[5], reverse[5];
+    ActuatorShaper::toPins(drive, 5, ActuatorOutput::CENTERED, pins);
+    TEST_ASSERT_EQUAL_UINT8(0, pins[0]);
+    TEST_ASSERT_EQUAL_UINT8(128, pins[2]);
+    TEST_ASSERT_EQUAL_UINT8(255, pins[4]);
+    ActuatorShaper::toPins(drive, 5, ActuatorOutput::BRIDGE, pins, reverse);
+    TEST_ASSERT_EQUAL_UINT8(0, pins[0]);
+    TEST_ASSERT_EQUAL_UINT8(255, reverse[0]);
+    TEST_ASSERT_EQUAL_UINT8(0, pins[2]);
+    TEST_ASSERT_EQUAL_UINT8(0, reverse[2]);
+    TEST_ASSERT_EQUAL_UINT8(255, pins[4]);
+    TEST_ASSERT_EQUAL_UINT8(0, reverse[4]);
+}
+
+void test_unipolar_source_never_brakes(void)
+{
+    ActuatorShaper braked(ActuatorModel::erm(40, 0.6f), FS);
+    braked.pulse(1.0f, 20);
+    int16_t drive[400];
+    braked.render(drive, 400);
+    TEST_ASSERT_TRUE(*std::min_element(drive, drive + 400) < 0);
+
+    ActuatorShaper shaper(ActuatorModel::erm(40, 0.6f), FS);
+    McRenderFn source = shaper.source(ActuatorOutput::UNIPOLAR);
+    shaper.pulse(1.0f, 20);
+    uint8_t out[400];
+    source(out, 400);
+    // overdrive at the onset, then nothing while the motor coasts
+    TEST_ASSERT_EQUAL_UINT8(255, out[0]);
+    TEST_ASSERT_EQUAL_UINT8(0, out[399]);
+}
+
+void test_only_pulse_and_tick_cues_are_shaped(void)
+{
+    ActuatorShaper shaper;
+    HapticCue cue;
+    cue.type = HapticCueType::VIBRATE;
+    TEST_ASSERT_FALSE(shaper.play(cue));
+    cue.type = HapticCueType::TICK;
+    cue.intensity = 0.5f;
+    cue.durationMs = 10;
+    TEST_ASSERT_TRUE(shaper.play(cue));
+}
+
+// run under env:native_tsan: cues come from another task than render()
+void test_cues_while_rendering(void)
+{
+    ActuatorShaper shaper(ActuatorModel::erm(40, 0.6f), FS);
+    McRenderFn source = shaper.source(ActuatorOutput::UNIPOLAR);
+    std::atomic<bool> stop{false};
+    std::thread output([&] {
+        uint8_t block[32];
+        while (!stop)
+            source(block, 32);
+    });
+    for (int i = 0; i < 200000; i++)
+        shaper.pulse((i % 7) / 6.0f, i % 50);
+    stop = true;
+    output.join();
+    shaper.pulse(0.5f, 10);
+    int16_t drive;
+    shaper.render(&drive, 1);
+    TEST_ASSERT_TRUE(drive > 0);
+}
+
+int main(int, char **)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_lra_with_overdrive_headroom);
+    RUN_TEST(test_lra_driven_at_full_scale_still_brakes);
+    RUN_TEST(test_erm);
+    RUN_TEST(test_pin_mappings);
+    RUN_TEST(test_unipolar_source_never_brakes);
+    RUN_TEST(test_only_pulse_and_tick_cues_are_shaped);
+    RUN_TEST(test_cues_while_rendering);
+    return UNITY_END();
+}
@@ -0,0 +1,193 @@
+// Host test of BeatTracker on generated music: kick on every beat, snare on
+// two and four, hi-hat eighths, a bass line, a pad and noise.
+#include <unity.h>
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+#include "BeatTracker.h"
+
+#define FS 44100
+
+struct Track
+{
+    std::vector<int16_t> pcm; /*!< Interleaved stereo */
+    std::vector<double> beatsMs;
+};
+
+static Track makeTrack(double bpm, double seconds, double jitterMs)
+{
+    int n = (int)(FS * seconds);
+    std::vector<double> l(n, 0), r(n, 0);
+    std::mt19937 rng(1);
+    std::normal_distribution<double> g(0, 1);
+    std::uniform_real_distribution<double> u(-1, 1);
+    double period = 60.0 / bpm;
+    Track track;
+    for (int b = 0; b * period < seconds; b++)
+    {
+        double t0 = std::max(0.0, b * period + jitterMs / 1000 * u(rng));
+        track.beatsMs.push_back(t0 * 1000);
+        int s0 = (int)(t0 * FS);
+        for (int i = 0; i < FS * 0.3 && s0 + i < n; i++)
+        {
+            double t = (double)i / FS;
+            double v = 0.6 * exp(-t * 8) * sin(2 * M_PI * (50 * t + 100 * (1 - exp(-t * 30)) / 30));
+            l[s0 + i] += v;
+            r[s0 + i] += v;
+        }
+        if (b % 2)
+        {
+            for (int i = 0; i < FS * 0.2 && s0 + i < n; i++)
+            {
+                double t = (double)i / FS;
+                double v = 0.25 * exp(-t * 20) * g(rng) + 0.15 * exp(-t * 15) * sin(2 * M_PI * 200 * t);
+                l[s0 + i] += v;
+                r[s0 + i] += v;
+            }
+        }
+        for (int h = 0; h < 2; h++)
+        {
+            int s = (int)((t0 + h * period / 2) * FS);
+            for (int i = 0; i < FS * 0.05 && s + i < n; i++)
+            {
+                double v = 0.08 * exp(-i * 80.0 / FS) * g(rng);
+                l[s + i] += v;
+                r[s + i] += v * 0.8;
+            }
+        }
+    }
+    for (int i = 0; i < n; i++)
+    {
+        double t = (double)i / FS;
+        double note = fmod(t, 4 * period) < 2 * period ? 55 : 41.2;
+        l[i] += 0.12 * sin(2 * M_PI * note * t) + 0.05 * sin(2 * M_PI * 220 * t) * sin(2 * M_PI * 0.25 * t) + 0.003 * g(rng);
+        r[i] += 0.12 * sin(2 * M_PI * note * t) + 0.05 * sin(2 * M_PI * 330 * t);
+    }
+    auto pcm = [](double v) { return (int16_t)lrint(std::max(-1.0, std::min(1.0, v * 0.8)) * 32767); };
+    for (int i = 0; i < n; i++)
+    {
+        track.pcm.push_back(pcm(l[i]));
+        track.pcm.push_back(pcm(r[i]));
+    }
+    return track;
+}
+
+struct Result
+{
+    std::vector<HapticCue> cues;
+    uint16_t bpm = 0; /*!< 1 s before the end, clear of the cut at the end of the track */
+    bool locked = false;
+    uint32_t dropped = 0;
+};
+
+static Result track(const std::vector<int16_t> &pcm, uint8_t channels, size_t block)
+{
+    BeatTracker tracker(FS, channels);
+    HapticCue cues[HAPTIC_MAX_CUES];
+    Result result;
+    size_t frames = pcm.size() / channels;
+    for (size_t i = 0; i < frames; i += block)
+    {
+        size_t n = tracker.process(&pcm[i * channels], std::min(block, frames - i), cues, HAPTIC_MAX_CUES);
+        result.cues.insert(result.cues.end(), cues, cues + n);
+        if (i + FS <= frames)
+        {
+            result.bpm = tracker.getBpm();
+            result.locked = tracker.isLocked();
+        }
+    }
+    result.dropped = tracker.getStats().droppedCues;
+    return result;
+}
+
+static void checkBeats(double bpm, double jitterMs, int maxMissed, int maxMeanMs)
+{
+    Track t = makeTrack(bpm, 30, jitterMs);
+    Result r = track(t.pcm, 2, 512);
+    TEST_ASSERT_TRUE(r.locked);
+    TEST_ASSERT_INT_WITHIN(2, (int)bpm, r.bpm);
+    TEST_ASSERT_EQUAL_UINT32(0, r.dropped);
+
+    // the beats after the first 5 s get a PULSE within 100 ms
+    int hit = 0, beats = 0;
+    double errorSum = 0;
+    for (double beat : t.beatsMs)
+    {
+        if (beat < 5000 || beat > 29800)
+            continue;
+        beats++;
+        double best = 1e9;
+        for (const HapticCue &cue : r.cues)
+            if (cue.type == HapticCueType::PULSE && fabs(cue.startMs - beat) < fabs(best))
+                best = cue.startMs - beat;
+        if (fabs(best) < 100)
+        {
+            hit++;
+            errorSum += fabs(best);
+        }
+    }
+    TEST_ASSERT_GREATER_OR_EQUAL(beats - maxMissed, hit);
+    TEST_ASSERT_LESS_OR_EQUAL(maxMeanMs, (int)(errorSum / hit));
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_locks_to_95_bpm(void) { checkBeats(95, 0, 0, 20); }
+void test_locks_to_120_bpm(void) { checkBeats(120, 0, 0, 20); }
+void test_locks_to_128_bpm(void) { checkBeats(128, 0, 0, 20); }
+void test_locks_to_150_bpm(void) { checkBeats(150, 0, 0, 20); }
+// +/-15 ms of jitter: about one beat in ten may be missed
+void test_follows_a_loose_drummer(void) { checkBeats(110, 15, 4, 25); }
+
+void test_cues_are_in_start_order(void)
+{
+    Result r = track(makeTrack(120, 15, 0).pcm, 2, 512);
+    TEST_ASSERT_TRUE(r.cues.size() > 20);
+    for (size_t i = 1; i < r.cues.size(); i++)
+        TEST_ASSERT_TRUE(r.cues[i].startMs >= r.cues[i - 1].startMs);
+}
+
+void test_block_size_does_not_change_the_tempo(void)
+{
+    Track t = makeTrack(128, 20, 0);
+    Result small = track(t.pcm, 2, 128), large = track(t.pcm, 2, 2048);
+    TEST_ASSERT_EQUAL_UINT16(small.bpm, large.bpm);
+    TEST_ASSERT_INT_WITHIN(2, (int)small.cues.size(), (int)large.cues.size());
+}
+
+void test_mono_stream(void)
+{
+    Track t = makeTrack(120, 20, 0);
+    std::vector<int16_t> mono;
+    for (size_t i = 0; i < t.pcm.size(); i += 2)
+        mono.push_back((int16_t)((t.pcm[i] + t.pcm[i + 1]) / 2));
+    Result r = track(mono, 1, 256);
+    TEST_ASSERT_TRUE(r.locked);
+    TEST_ASSERT_INT_WITHIN(2, 120, r.bpm);
+}
+
+void test_silence_is_no_beat(void)
+{
+    std::vector<int16_t> pcm(FS * 10 * 2, 0);
+    Result r = track(pcm, 2, 512);
+    TEST_ASSERT_EQUAL(0, (int)r.cues.size());
+    TEST_ASSERT_FALSE(r.locked);
+    TEST_ASSERT_EQUAL_UINT16(0, r.bpm);
+}
+
+int main(int, char **)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_locks_to_95_bpm);
+    RUN_TEST(test_locks_to_120_bpm);
+    RUN_TEST(test_locks_to_128_bpm);
+    RUN_TEST(test_locks_to_150_bpm);
+    RUN_TEST(test_follows_a_loose_drummer);
+    RUN_TEST(test_cues_are_in_start_order);
+    RUN_TEST(test_block_size_does_not_change_the_tempo);
+    RUN_TEST(test_mono_stream);
+    RUN_TEST(test_silence_is_no_beat);
+    return UNITY_END();
+}
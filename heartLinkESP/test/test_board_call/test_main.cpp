@@ -0,0 +1,172 @@
+// Host test of BoardCall: with a board picked at compile time a tick is one
+// writePins() batch, through BoardProfile it is one writeSinglePin() per pin;
+// and a benchmark of the CPU output path both ways.
+#include <unity.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+#include "BoardConfig.h"
+#include "HostBoardProfile.h"
+#include "MultiChannelOutput.h"
+
+#define OUT_TIMER 0 // any host timer: no VH driver runs on the host board
+#define CHANNELS 8
+#define BLOCKS 2000
+#define ROUNDS 5
+
+#if defined(__SANITIZE_ADDRESS__) || defined(__SANITIZE_THREAD__)
+#define TIMED 0
+#else
+#define TIMED 1
+#endif
+
+// a ramp from start, one step per sample, so every pin changes every tick
+static McRenderFn ramp(uint8_t start)
+{
+    return [start, v = (uint8_t)0](uint8_t *s, size_t n) mutable {
+        for (size_t i = 0; i < n; i++)
+            s[i] = (uint8_t)(start + ++v);
+    };
+}
+
+// CHANNELS ramps on pins 10.., playing on OUT_TIMER
+template <class BOARD>
+static void start(MultiChannelOutputT<BOARD> &out, HostBoardProfile &board)
+{
+    for (int c = 0; c < CHANNELS; c++)
+        TEST_ASSERT_EQUAL(c, out.addChannel(10 + c, ramp((uint8_t)(c * 30))));
+    TEST_ASSERT_TRUE(out.begin(&board, OUT_TIMER) == McMode::CPU);
+    board.clearPinWrites();
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_static_board_batches_a_tick(void)
+{
+    static_assert(RESONANCE_STATIC_BOARD && std::is_same<ResonanceBoard, HostBoardProfile>::value,
+                  "the native env builds with RESONANCE_BOARD_HOST");
+    HostBoardProfile board;
+    MultiChannelOutputT<HostBoardProfile> out(8000);
+    start(out, board);
+    for (int i = 0; i < MC_BLOCK_SAMPLES; i++)
+        board.fireTimer(OUT_TIMER);
+
+    // one board call per tick, with every pin of the frame in it
+    const std::vector<HostPinBatch> &batches = board.getPinBatches();
+    const std::vector<PinWrite> &writes = board.getPinWrites();
+    TEST_ASSERT_EQUAL(MC_BLOCK_SAMPLES, (int)batches.size());
+    for (int i = 0; i < MC_BLOCK_SAMPLES; i++)
+    {
+        TEST_ASSERT_EQUAL(i * CHANNELS, (int)batches[i].first);
+        TEST_ASSERT_EQUAL(CHANNELS, (int)batches[i].count);
+        for (int c = 0; c < CHANNELS; c++)
+        {
+            TEST_ASSERT_EQUAL_UINT8(10 + c, writes[i * CHANNELS + c].pin);
+            TEST_ASSERT_EQUAL_UINT8(c * 30 + i + 1, writes[i * CHANNELS + c].value);
+        }
+    }
+    TEST_ASSERT_EQUAL_UINT32(MC_BLOCK_SAMPLES * CHANNELS, out.getStats().pinWrites);
+}
+
+void test_board_profile_writes_pin_by_pin(void)
+{
+    // the same board, reached through the vtable only
+    HostBoardProfile board;
+    MultiChannelOutputT<BoardProfile> out(8000);
+    start(out, board);
+    for (int i = 0; i < MC_BLOCK_SAMPLES; i++)
+        board.fireTimer(OUT_TIMER);
+
+    const std::vector<HostPinBatch> &batches = board.getPinBatches();
+    TEST_ASSERT_EQUAL(MC_BLOCK_SAMPLES * CHANNELS, (int)batches.size());
+    for (size_t i = 0; i < batches.size(); i++)
+    {
+        TEST_ASSERT_EQUAL((int)i, (int)batches[i].first);
+        TEST_ASSERT_EQUAL(1, (int)batches[i].count);
+    }
+
+    // and it writes the same pins and values in the same order
+    HostBoardProfile reference;
+    MultiChannelOutputT<HostBoardProfile> batched(8000);
+    start(batched, reference);
+    for (int i = 0; i < MC_BLOCK_SAMPLES; i++)
+        reference.fireTimer(OUT_TIMER);
+    TEST_ASSERT_EQUAL(reference.getPinWrites().size(), board.getPinWrites().size());
+    for (size_t i = 0; i < board.getPinWrites().size(); i++)
+    {
+        TEST_ASSERT_EQUAL_UINT8(reference.getPinWrites()[i].pin, board.getPinWrites()[i].pin);
+        TEST_ASSERT_EQUAL_UINT8(reference.getPinWrites()[i].value, board.getPinWrites()[i].value);
+    }
+}
+
+void test_board_call_direct(void)
+{
+    const PinWrite writes[3] = {{25, 1}, {26, 2}, {27, 3}};
+    HostBoardProfile board;
+    BoardCall<HostBoardProfile>::writePins(&board, writes, 3);
+    TEST_ASSERT_EQUAL(1, (int)board.getPinBatches().size());
+    TEST_ASSERT_EQUAL(3, (int)board.getPinBatches()[0].count);
+
+    board.clearPinWrites();
+    BoardCall<BoardProfile>::writePins(&board, writes, 3);
+    TEST_ASSERT_EQUAL(3, (int)board.getPinBatches().size());
+    TEST_ASSERT_EQUAL_UINT8(27, board.getPinWrites()[2].pin);
+    TEST_ASSERT_EQUAL_UINT8(3, board.getPinWrites()[2].value);
+
+    // nothing to write is no board call
+    board.clearPinWrites();
+    BoardCall<HostBoardProfile>::writePins(&board, writes, 0);
+    BoardCall<BoardProfile>::writePins(&board, writes, 0);
+    TEST_ASSERT_EQUAL(0, (int)board.getPinWrites().size());
+}
+
+// best of ROUNDS runs of BLOCKS blocks, rendered and played, in ns per tick
+template <class BOARD>
+static double timePerTick(MultiChannelOutputT<BOARD> &out, HostBoardProfile &board)
+{
+    double best = 1e12;
+    for (int round = 0; round < ROUNDS; round++)
+    {
+        auto begin = std::chrono::steady_clock::now();
+        for (int b = 0; b < BLOCKS; b++)
+        {
+            out.service();
+            for (int i = 0; i < MC_BLOCK_SAMPLES; i++)
+                board.fireTimer(OUT_TIMER);
+        }
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count();
+        best = std::min(best, ns / (BLOCKS * MC_BLOCK_SAMPLES));
+    }
+    return best;
+}
+
+void test_cpu_output_benchmark(void)
+{
+    HostBoardProfile virtualBoard, staticBoard;
+    MultiChannelOutputT<BoardProfile> virtualOut(8000);
+    MultiChannelOutputT<HostBoardProfile> staticOut(8000);
+    start(virtualOut, virtualBoard);
+    start(staticOut, staticBoard);
+    virtualBoard.setRecording(false);
+    staticBoard.setRecording(false);
+    double virtualNs = timePerTick(virtualOut, virtualBoard);
+    double staticNs = timePerTick(staticOut, staticBoard);
+    printf("%d channels   BoardProfile ns/tick  HostBoardProfile ns/tick\n", CHANNELS);
+    printf("%28.1f %25.1f\n", virtualNs, staticNs);
+    TEST_ASSERT_TRUE(virtualBoard.getPinWriteCount() == staticBoard.getPinWriteCount());
+    TEST_ASSERT_EQUAL_UINT32(0, virtualOut.getStats().underruns + staticOut.getStats().underruns);
+    if (TIMED)
+        TEST_ASSERT_TRUE(staticNs < virtualNs);
+}
+
+int main(int, char **)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_static_board_batches_a_tick);
+    RUN_TEST(test_board_profile_writes_pin_by_pin);
+    RUN_TEST(test_board_call_direct);
+    RUN_TEST(test_cpu_output_benchmark);
+    return UNITY_END();
+}
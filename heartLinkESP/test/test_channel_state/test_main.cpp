@@ -0,0 +1,118 @@
+// Host test of VH::ChannelStateTable and its use in RenderScheduler; run it
+// under ThreadSanitizer too: pio test -e native_tsan -f test_channel_state
+#include <unity.h>
+#include <atomic>
+#include <cstring>
+#include <thread>
+#include <ChannelState.h>
+#include "RenderScheduler.h"
+
+#define UPDATES 100000
+
+void setUp(void) {}
+void tearDown(void) {}
+
+// every update writes the same value everywhere, so a reader sees it or not at all
+void test_reader_never_sees_half_an_update(void)
+{
+    VH::ChannelStateTable<8> table;
+    std::atomic<bool> run{true};
+    std::atomic<uint32_t> torn{0};
+    std::thread writer([&] {
+        for (uint32_t g = 1; g <= UPDATES; g++)
+        {
+            table.update([&](VH::ChannelPlaySet &s) {
+                for (int i = 0; i < 8; i++)
+                {
+                    s.intensity[i] = (uint8_t)g;
+                    s.mixing[i] = (int8_t)(g >> 8);
+                }
+                s.activeMask = g;
+            });
+        }
+        run = false;
+    });
+    std::thread levels([&] {
+        while (run)
+            table.runtime(3).level.store(7, std::memory_order_relaxed);
+    });
+    uint32_t last = 0;
+    while (run)
+    {
+        VH::ChannelStateTable<8>::Reader play(table);
+        uint32_t g = play->activeMask;
+        for (int i = 0; i < 8; i++)
+        {
+            if (play->intensity[i] != (uint8_t)g || play->mixing[i] != (int8_t)(g >> 8))
+                torn++;
+        }
+        if (g < last)
+            torn++;
+        last = g;
+        (void)table.runtime(3).level.load(std::memory_order_relaxed);
+    }
+    writer.join();
+    levels.join();
+    TEST_ASSERT_EQUAL_UINT32(0, torn.load());
+    TEST_ASSERT_EQUAL_UINT32(UPDATES, table.snapshot().generation);
+}
+
+// settings changed from another task while the scheduler renders
+void test_scheduler_settings_from_another_task(void)
+{
+    RenderScheduler scheduler(8000);
+    static uint8_t out[MC_MAX_CHANNELS][MC_BLOCK_SAMPLES];
+    scheduler.addSource(0, [](uint8_t *p, size_t n) { memset(p, 100, n); });
+    scheduler.addSource(0, [](uint8_t *p, size_t n) { memset(p, 50, n); });
+    scheduler.addSource(1, [](uint8_t *p, size_t n) { memset(p, 200, n); });
+    scheduler.setOutput([](const uint8_t p[][MC_BLOCK_SAMPLES], uint8_t n) {
+        memcpy(out, p, n * MC_BLOCK_SAMPLES);
+        return true;
+    });
+    std::atomic<bool> run{true};
+    uint32_t bad = 0;
+    std::thread control([&] {
+        for (int i = 0; i < 10000; i++)
+        {
+            scheduler.setMixing(0, (i & 1) ? LARGESTVAL_MIX : ADDITIVE_MIX);
+            scheduler.setIntensity(1, (i & 2) ? 255 : 0);
+            scheduler.setActive(1, true);
+        }
+        run = false;
+    });
+    std::thread poll([&] {
+        while (run)
+        {
+            (void)scheduler.getLevel(0);
+            (void)scheduler.isIdle(1);
+        }
+    });
+    while (run)
+    {
+        scheduler.renderBlock();
+        if (!(out[0][0] == 150 || out[0][0] == 100))
+            bad++;
+        if (!(out[1][0] == 200 || out[1][0] == 0))
+            bad++;
+    }
+    control.join();
+    poll.join();
+    TEST_ASSERT_EQUAL_UINT32(0, bad);
+
+    scheduler.setActive(0, false);
+    scheduler.renderBlock();
+    TEST_ASSERT_EQUAL_UINT8(0, out[0][5]);
+    TEST_ASSERT_EQUAL_UINT8(0, scheduler.getLevel(0));
+    TEST_ASSERT_EQUAL_UINT8(200, scheduler.getLevel(1));
+    scheduler.setIntensity(1, 128);
+    scheduler.renderBlock();
+    TEST_ASSERT_EQUAL_UINT8(100, out[1][0]);
+}
+
+int main(int, char **)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_reader_never_sees_half_an_update);
+    RUN_TEST(test_scheduler_settings_from_another_task);
+    return UNITY_END();
+}
@@ -0,0 +1,202 @@
+// Host simulation of DriftCompensator: a sender clock skewed by some ppm
+// against the output timer, the PI controller converging on it, and the
+// drop/repeat edits landing on the quietest frame of a block.
+#include <unity.h>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "DriftCompensator.h"
+
+#define FRAMES 128
+#define TARGET 735        // 50 ms at 14.7 kHz, as StreamBuffers plans it
+#define BLOCKS_PER_S 345  // 44.1 kHz in FRAMES
+
+// the output ring as a fill level: the sink adds every frame it is handed,
+// the output timer takes FRAMES per block of its own clock
+struct Output
+{
+    int64_t fill = TARGET;
+    int64_t skewPpm = 0;
+    int64_t due = 0;
+
+    void take()
+    {
+        // the sender makes FRAMES * (1 + skew) frames in the time the
+        // output plays FRAMES
+        due += (int64_t)FRAMES * 1000000;
+        int64_t n = due / (1000000 + skewPpm);
+        due -= n * (1000000 + skewPpm);
+        fill -= n;
+    }
+};
+
+struct Run
+{
+    uint32_t dropped, inserted;
+    int32_t minFill, maxFill;
+};
+
+// plays blocks at the given skew; the result covers the last half only,
+// once the controller has settled
+static Run play(VH::DriftCompensator &drift, Output &out, int blocks)
+{
+    std::vector<int16_t> block(2 * FRAMES, 100);
+    Run result = {0, 0, INT32_MAX, INT32_MIN};
+    for (int b = 0; b < blocks; b++)
+    {
+        if (b == blocks / 2)
+        {
+            result.dropped = drift.getDropped();
+            result.inserted = drift.getInserted();
+        }
+        drift.write(block.data(), block.size(), (size_t)out.fill, [&](const int16_t *, size_t n) { out.fill += n / 2; });
+        out.take();
+        if (b >= blocks / 2)
+        {
+            result.minFill = out.fill < result.minFill ? (int32_t)out.fill : result.minFill;
+            result.maxFill = out.fill > result.maxFill ? (int32_t)out.fill : result.maxFill;
+        }
+    }
+    result.dropped = drift.getDropped() - result.dropped;
+    result.inserted = drift.getInserted() - result.inserted;
+    return result;
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_matched_clocks_never_edit(void)
+{
+    VH::DriftCompensator drift(TARGET, 2);
+    Output out;
+    play(drift, out, 60 * BLOCKS_PER_S);
+    TEST_ASSERT_EQUAL_UINT32(0, drift.getDropped());
+    TEST_ASSERT_EQUAL_UINT32(0, drift.getInserted());
+    TEST_ASSERT_EQUAL_INT32(0, drift.getCorrectionPpm());
+    TEST_ASSERT_EQUAL_INT32(TARGET, drift.getSmoothedFill());
+
+    // started off the target it settles back on it, and then stays put
+    VH::DriftCompensator late(TARGET, 2);
+    Output behind;
+    behind.fill = TARGET - 40;
+    Run settled = play(late, behind, 180 * BLOCKS_PER_S);
+    TEST_ASSERT_TRUE(late.getInserted() > 0);
+    TEST_ASSERT_EQUAL_UINT32(0, settled.dropped + settled.inserted);
+    TEST_ASSERT_EQUAL_INT32(TARGET, late.getSmoothedFill());
+    TEST_ASSERT_EQUAL_INT32(0, late.getCorrectionPpm());
+}
+
+void test_skewed_clocks_converge(void)
+{
+    const int32_t skews[] = {100, -100, 500, -500, 1500, -1500};
+    for (int32_t skew : skews)
+    {
+        VH::DriftCompensator drift(TARGET, 2);
+        Output out;
+        out.skewPpm = skew;
+        // 2 min, judged on the last one
+        Run settled = play(drift, out, 120 * BLOCKS_PER_S);
+        size_t halfFrames = (size_t)60 * BLOCKS_PER_S * FRAMES;
+        int32_t expect = (int32_t)((int64_t)abs(skew) * halfFrames / 1000000);
+        char message[32];
+        snprintf(message, sizeof(message), "skew %d ppm", (int)skew);
+        // the correction cancels the skew and edits in one direction only
+        TEST_ASSERT_INT32_WITHIN_MESSAGE(abs(skew) / 20 + 5, skew, drift.getCorrectionPpm(), message);
+        TEST_ASSERT_INT32_WITHIN_MESSAGE(expect / 20 + 2, expect, skew > 0 ? settled.dropped : settled.inserted, message);
+        TEST_ASSERT_EQUAL_UINT32_MESSAGE(0, skew > 0 ? settled.inserted : settled.dropped, message);
+        // and the latency holds: within a block of the target
+        TEST_ASSERT_TRUE_MESSAGE(settled.minFill > TARGET - FRAMES && settled.maxFill < TARGET + FRAMES, message);
+        TEST_ASSERT_INT32_WITHIN_MESSAGE(8, TARGET, drift.getSmoothedFill(), message);
+    }
+}
+
+void test_skew_beyond_the_limit_saturates(void)
+{
+    VH::DriftCompensator drift(TARGET, 2);
+    Output out;
+    out.skewPpm = 3 * DRIFT_MAX_CORRECTION_PPM;
+    play(drift, out, 60 * BLOCKS_PER_S);
+    TEST_ASSERT_EQUAL_INT32(DRIFT_MAX_CORRECTION_PPM, drift.getCorrectionPpm());
+    TEST_ASSERT_TRUE(out.fill > TARGET + 10 * FRAMES);
+
+    // reset() restarts it from the level it sees then
+    drift.reset();
+    TEST_ASSERT_EQUAL_INT32(0, drift.getCorrectionPpm());
+}
+
+// a loud block with one quiet frame; its channels are kept apart so that a
+// frame whose channels cancel in a sum is not taken for quiet
+static std::vector<int16_t> loudBlock(size_t quiet)
+{
+    std::vector<int16_t> block(2 * FRAMES);
+    for (size_t i = 0; i < FRAMES; i++)
+    {
+        block[2 * i] = (int16_t)(4000 + i);
+        block[2 * i + 1] = (int16_t)(-4000 - i);
+    }
+    block[2 * 20] = 30000;
+    block[2 * 20 + 1] = -30000;
+    block[2 * quiet] = 3;
+    block[2 * quiet + 1] = -5;
+    return block;
+}
+
+// writes the block until the first edit and returns what the sink got
+static std::vector<int16_t> firstEdit(VH::DriftCompensator &drift, const std::vector<int16_t> &block, size_t fill)
+{
+    std::vector<int16_t> got;
+    for (int b = 0; b < 1000 && drift.getDropped() + drift.getInserted() == 0; b++)
+    {
+        got.clear();
+        drift.write(block.data(), block.size(), fill, [&](const int16_t *s, size_t n) { got.insert(got.end(), s, s + n); });
+    }
+    return got;
+}
+
+void test_edits_land_on_the_quietest_frame(void)
+{
+    const size_t quiet = 77;
+    std::vector<int16_t> block = loudBlock(quiet);
+
+    // too full: the quiet frame is left out, the rest is in order
+    VH::DriftCompensator full(TARGET, 2);
+    std::vector<int16_t> got = firstEdit(full, block, TARGET + 200);
+    TEST_ASSERT_EQUAL_UINT32(1, full.getDropped());
+    TEST_ASSERT_EQUAL(2 * (FRAMES - 1), (int)got.size());
+    TEST_ASSERT_EQUAL_INT16_ARRAY(block.data(), got.data(), 2 * quiet);
+    TEST_ASSERT_EQUAL_INT16_ARRAY(block.data() + 2 * (quiet + 1), got.data() + 2 * quiet, 2 * (FRAMES - quiet - 1));
+
+    // running dry: the quiet frame is played twice
+    VH::DriftCompensator dry(TARGET, 2);
+    got = firstEdit(dry, block, TARGET - 200);
+    TEST_ASSERT_EQUAL_UINT32(1, dry.getInserted());
+    TEST_ASSERT_EQUAL(2 * (FRAMES + 1), (int)got.size());
+    TEST_ASSERT_EQUAL_INT16_ARRAY(block.data(), got.data(), 2 * (quiet + 1));
+    TEST_ASSERT_EQUAL_INT16_ARRAY(block.data() + 2 * quiet, got.data() + 2 * (quiet + 1), 2 * (FRAMES - quiet));
+
+    // at either end of the block
+    for (size_t at : {(size_t)0, (size_t)FRAMES - 1})
+    {
+        std::vector<int16_t> edge = loudBlock(at);
+        VH::DriftCompensator drop(TARGET, 2);
+        got = firstEdit(drop, edge, TARGET + 200);
+        TEST_ASSERT_EQUAL(2 * (FRAMES - 1), (int)got.size());
+        TEST_ASSERT_EQUAL_INT16(at ? edge[0] : edge[2], got[0]);
+        TEST_ASSERT_EQUAL_INT16(at ? edge[2 * FRAMES - 4] : edge[2 * FRAMES - 2], got[2 * FRAMES - 4]);
+        VH::DriftCompensator repeat(TARGET, 2);
+        got = firstEdit(repeat, edge, TARGET - 200);
+        TEST_ASSERT_EQUAL(2 * (FRAMES + 1), (int)got.size());
+        TEST_ASSERT_EQUAL_INT16(edge[2 * at], got[2 * at + 2]);
+    }
+}
+
+int main(int, char **)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_matched_clocks_never_edit);
+    RUN_TEST(test_skewed_clocks_converge);
+    RUN_TEST(test_skew_beyond_the_limit_saturates);
+    RUN_TEST(test_edits_land_on_the_quietest_frame);
+    return UNITY_END();
+}
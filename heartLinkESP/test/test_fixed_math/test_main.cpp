@@ -0,0 +1,197 @@
+// Host test of the Q14 quaternion helpers in helper_3dmath.h and of the
+// MotionApps20 fixed-point DMP path against the float versions they replace.
+#include <unity.h>
+#include <cmath>
+#include <cstdint>
+#include <random>
+// the driver is not part of the host build; it builds against test/host/I2Cdev.h
+#include <MPU6050_6Axis_MotionApps20.cpp>
+#include <MPU6050.cpp>
+
+#define ROUNDS 20000
+
+static std::mt19937 rng(1);
+
+static QuaternionQ14 randomUnit(Quaternion &asFloat)
+{
+    std::normal_distribution<float> n(0, 1);
+    float w = n(rng), x = n(rng), y = n(rng), z = n(rng);
+    float m = sqrtf(w * w + x * x + y * y + z * z);
+    QuaternionQ14 q((int16_t)lrintf(w / m * Q14_ONE), (int16_t)lrintf(x / m * Q14_ONE),
+                    (int16_t)lrintf(y / m * Q14_ONE), (int16_t)lrintf(z / m * Q14_ONE));
+    asFloat = Quaternion(q.w / 16384.f, q.x / 16384.f, q.y / 16384.f, q.z / 16384.f);
+    return q;
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_sqrt_is_the_floor(void)
+{
+    for (uint32_t v = 0; v < 5000000; v += 7)
+    {
+        uint32_t r = fixedSqrt(v);
+        TEST_ASSERT_TRUE(r * r <= v && (r + 1) * (r + 1) > v);
+    }
+    TEST_ASSERT_EQUAL_UINT32(65535, fixedSqrt(0xFFFFFFFFu));
+}
+
+void test_atan2_within_2_mrad(void)
+{
+    std::uniform_real_distribution<double> u(-1, 1);
+    TEST_ASSERT_EQUAL_INT16(0, fixedAtan2(0, 0));
+    for (int i = 0; i < ROUNDS; i++)
+    {
+        int32_t y = (int32_t)(u(rng) * 1e9), x = (int32_t)(u(rng) * 1e9);
+        TEST_ASSERT_FLOAT_WITHIN(0.002, atan2((double)y, (double)x), fixedAtan2(y, x) / 8192.0);
+    }
+    TEST_ASSERT_INT_WITHIN(2, Q13_HALF_PI, fixedAtan2(1000, 0));
+    TEST_ASSERT_INT_WITHIN(2, Q13_PI, fixedAtan2(0, -1000));
+}
+
+void test_rotate_matches_float(void)
+{
+    std::uniform_real_distribution<float> u(-1, 1);
+    for (int i = 0; i < ROUNDS; i++)
+    {
+        Quaternion qf;
+        QuaternionQ14 qi = randomUnit(qf);
+        VectorInt16 v((int16_t)(u(rng) * 16000), (int16_t)(u(rng) * 16000), (int16_t)(u(rng) * 16000));
+        VectorInt16 a = v.getRotated(&qi);
+        VectorInt16 b = v.getRotated(&qf);
+        TEST_ASSERT_INT_WITHIN(6, b.x, a.x);
+        TEST_ASSERT_INT_WITHIN(6, b.y, a.y);
+        TEST_ASSERT_INT_WITHIN(6, b.z, a.z);
+    }
+}
+
+static void checkNormalize(QuaternionQ14 q)
+{
+    Quaternion f(q.w, q.x, q.y, q.z);
+    f.normalize();
+    q.normalize();
+    TEST_ASSERT_INT_WITHIN(4, lrintf(f.w * Q14_ONE), q.w);
+    TEST_ASSERT_INT_WITHIN(4, lrintf(f.x * Q14_ONE), q.x);
+    TEST_ASSERT_INT_WITHIN(4, lrintf(f.y * Q14_ONE), q.y);
+    TEST_ASSERT_INT_WITHIN(4, lrintf(f.z * Q14_ONE), q.z);
+}
+
+void test_normalize_restores_unit_length(void)
+{
+    std::uniform_real_distribution<float> u(0.05f, 1.99f);
+    for (int i = 0; i < ROUNDS; i++)
+    {
+        Quaternion qf;
+        QuaternionQ14 qi = randomUnit(qf);
+        float s = u(rng);
+        checkNormalize(QuaternionQ14((int16_t)(qi.w * s), (int16_t)(qi.x * s), (int16_t)(qi.y * s), (int16_t)(qi.z * s)));
+    }
+    // the edges: far off unit length, and the largest an int16 quaternion gets
+    for (float s : {0.05f, 0.6f, 1.6f, 1.99f})
+        checkNormalize(QuaternionQ14((int16_t)(8192 * s), (int16_t)(8192 * s), (int16_t)(8192 * s), (int16_t)(8192 * s)));
+    checkNormalize(QuaternionQ14(32767, 32767, 32767, 32767));
+    checkNormalize(QuaternionQ14(-32768, 0, 0, 0));
+    checkNormalize(QuaternionQ14(2, 0, 0, 0));
+    QuaternionQ14 zero(0, 0, 0, 0);
+    zero.normalize();
+    TEST_ASSERT_EQUAL_INT16(0, zero.w);
+}
+
+void test_product_matches_float(void)
+{
+    for (int i = 0; i < ROUNDS; i++)
+    {
+        Quaternion af, bf;
+        QuaternionQ14 a = randomUnit(af), b = randomUnit(bf);
+        QuaternionQ14 p = a.getProduct(b);
+        Quaternion pf = af.getProduct(bf);
+        TEST_ASSERT_INT_WITHIN(3, lrintf(pf.w * Q14_ONE), p.w);
+        TEST_ASSERT_INT_WITHIN(3, lrintf(pf.x * Q14_ONE), p.x);
+        TEST_ASSERT_INT_WITHIN(3, lrintf(pf.y * Q14_ONE), p.y);
+        TEST_ASSERT_INT_WITHIN(3, lrintf(pf.z * Q14_ONE), p.z);
+    }
+}
+
+// a DMP FIFO packet: Q30 quaternion words, then gyro, then accel words
+static void makePacket(const QuaternionQ14 &q, const VectorInt16 &accel, uint8_t *packet)
+{
+    memset(packet, 0, 42);
+    const int16_t words[7] = {q.w, q.x, q.y, q.z, accel.x, accel.y, accel.z};
+    const uint8_t offsets[7] = {0, 4, 8, 12, 28, 32, 36};
+    for (int i = 0; i < 7; i++)
+    {
+        packet[offsets[i]] = (uint8_t)((uint16_t)words[i] >> 8);
+        packet[offsets[i] + 1] = (uint8_t)words[i];
+    }
+}
+
+// difference of two angles, wrapped into -PI..PI
+static double angleError(double a, double b)
+{
+    return remainder(a - b, 2 * M_PI);
+}
+
+void test_dmp_path_matches_float(void)
+{
+    MPU6050 mpu;
+    std::uniform_real_distribution<float> u(-1, 1);
+    for (int i = 0; i < ROUNDS; i++)
+    {
+        Quaternion unused;
+        QuaternionQ14 random = randomUnit(unused);
+        VectorInt16 raw((int16_t)(u(rng) * 16000), (int16_t)(u(rng) * 16000), (int16_t)(u(rng) * 16000));
+        uint8_t packet[42];
+        makePacket(random, raw, packet);
+
+        Quaternion qf;
+        VectorFloat gf;
+        VectorInt16 af, linf, worldf;
+        float yprf[3];
+        mpu.dmpGetQuaternion(&qf, packet);
+        mpu.dmpGetAccel(&af, packet);
+        mpu.dmpGetGravity(&gf, &qf);
+        mpu.dmpGetYawPitchRoll(yprf, &qf, &gf);
+        mpu.dmpGetLinearAccel(&linf, &af, &gf);
+        mpu.dmpGetLinearAccelInWorld(&worldf, &linf, &qf);
+
+        QuaternionQ14 q;
+        VectorInt16 g, a, lin, world;
+        int16_t ypr[3];
+        mpu.dmpGetQuaternion(&q, packet);
+        mpu.dmpGetAccel(&a, packet);
+        mpu.dmpGetGravity(&g, &q);
+        mpu.dmpGetYawPitchRoll(ypr, &q, &g);
+        mpu.dmpGetLinearAccel(&lin, &a, &g);
+        mpu.dmpGetLinearAccelInWorld(&world, &lin, &q);
+
+        // gravity in accel units, +1g = 8192
+        TEST_ASSERT_INT_WITHIN(1, lrintf(gf.x * 8192), g.x);
+        TEST_ASSERT_INT_WITHIN(1, lrintf(gf.y * 8192), g.y);
+        TEST_ASSERT_INT_WITHIN(1, lrintf(gf.z * 8192), g.z);
+        TEST_ASSERT_INT_WITHIN(2, linf.x, lin.x);
+        TEST_ASSERT_INT_WITHIN(2, linf.y, lin.y);
+        TEST_ASSERT_INT_WITHIN(2, linf.z, lin.z);
+        TEST_ASSERT_INT_WITHIN(8, worldf.x, world.x);
+        TEST_ASSERT_INT_WITHIN(8, worldf.y, world.y);
+        TEST_ASSERT_INT_WITHIN(8, worldf.z, world.z);
+
+        // yaw and roll are undefined at the pitch singularity
+        if (fabs(gf.x) > 0.99f)
+            continue;
+        TEST_ASSERT_FLOAT_WITHIN(0.003, 0, angleError(yprf[0], ypr[0] / 8192.0));
+        TEST_ASSERT_FLOAT_WITHIN(0.003, 0, angleError(yprf[1], ypr[1] / 8192.0));
+        TEST_ASSERT_FLOAT_WITHIN(0.003, 0, angleError(yprf[2], ypr[2] / 8192.0));
+    }
+}
+
+int main(int, char **)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_sqrt_is_the_floor);
+    RUN_TEST(test_atan2_within_2_mrad);
+    RUN_TEST(test_rotate_matches_float);
+    RUN_TEST(test_normalize_restores_unit_length);
+    RUN_TEST(test_product_matches_float);
+    RUN_TEST(test_dmp_path_matches_float);
+    return UNITY_END();
+}
@@ -0,0 +1,162 @@
+// Host benchmark of A2DPFramePipeline against the split path it replaced
+// (a swap pass, then the volume control's divide pass) over a canned decoded
+// stream: 44.1 kHz stereo PCM in 512 frame packets, as the SBC decoder hands
+// it to audio_data_callback. Output must match for every stage combination;
+// the timings are printed and, outside the sanitizer builds, checked.
+// The ESP32 has no vector unit, so neither path is auto-vectorized here.
+#pragma GCC optimize("no-tree-vectorize")
+#include <unity.h>
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <A2DPFramePipeline.h>
+
+#define FRAMES 512
+#define PACKETS 860 // 10 s
+#define ROUNDS 5
+
+#if defined(__SANITIZE_ADDRESS__) || defined(__SANITIZE_THREAD__)
+#define TIMED 0
+#else
+#define TIMED 1
+#endif
+
+// exposes the factor the split path divided by
+struct Control : A2DPDefaultVolumeControl
+{
+    void setVolume(uint8_t volume) { set_volume(volume); }
+    int32_t factor() { return volumeFactor; }
+    int32_t factorMax() { return volumeFactorMax; }
+};
+
+static std::vector<Frame> stream;
+
+// music-like: a few partials with a beat envelope, and some noise
+static void makeStream()
+{
+    stream.resize((size_t)FRAMES * PACKETS);
+    uint32_t seed = 11;
+    for (size_t i = 0; i < stream.size(); i++)
+    {
+        double t = i / 44100.0;
+        double beat = 0.5 + 0.5 * exp(-fmod(t, 0.5) * 8);
+        double l = beat * (0.4 * sin(2 * M_PI * 55 * t) + 0.2 * sin(2 * M_PI * 440 * t));
+        double r = beat * (0.4 * sin(2 * M_PI * 55 * t + 0.3) + 0.2 * sin(2 * M_PI * 660 * t));
+        seed = seed * 1664525 + 1013904223;
+        double noise = ((int32_t)seed >> 16) / 32768.0 * 0.05;
+        stream[i] = Frame((int16_t)lrint((l + noise) * 32767), (int16_t)lrint((r - noise) * 32767));
+    }
+}
+
+static int16_t clip(int32_t v)
+{
+    return (int16_t)std::max<int32_t>(-32768, std::min<int32_t>(32767, v));
+}
+
+// audio_data_callback before the pipeline: swap, then update_audio_data()
+static void split(Frame *frames, uint32_t count, bool swap, bool mono, bool volume, Control &control)
+{
+    if (swap)
+        for (uint32_t i = 0; i < count; i++)
+        {
+            int16_t temp = frames[i].channel1;
+            frames[i].channel1 = frames[i].channel2;
+            frames[i].channel2 = temp;
+        }
+    if (!mono && !volume)
+        return;
+    int32_t factor = volume ? control.factor() : 1, factorMax = volume ? control.factorMax() : 1;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        int32_t l = frames[i].channel1, r = frames[i].channel2;
+        if (mono)
+            l = r = (l + r) / 2;
+        frames[i].channel1 = clip(l * factor / factorMax);
+        frames[i].channel2 = clip(r * factor / factorMax);
+    }
+}
+
+static std::vector<uint8_t> haptic;
+
+static void onHaptic(const uint8_t *data, uint32_t len)
+{
+    haptic.insert(haptic.end(), data, data + len);
+}
+
+// best of ROUNDS passes over the whole stream, in ns per frame
+template <class Fn>
+static double timePerFrame(std::vector<Frame> &work, Fn fn)
+{
+    double best = 1e9;
+    for (int round = 0; round < ROUNDS; round++)
+    {
+        std::copy(stream.begin(), stream.end(), work.begin());
+        auto start = std::chrono::steady_clock::now();
+        for (int p = 0; p < PACKETS; p++)
+            fn(&work[(size_t)p * FRAMES]);
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        best = std::min(best, ns / stream.size());
+    }
+    return best;
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_fused_matches_and_beats_the_split_path(void)
+{
+    makeStream();
+    std::vector<Frame> expect(stream.size()), work(stream.size());
+    printf("swap mono volume   split ns/frame   fused ns/frame\n");
+    for (int stages = 1; stages < 8; stages++)
+    {
+        bool swap = stages & 1, mono = stages & 2, volume = stages & 4;
+        Control control;
+        control.setVolume(90);
+        control.set_enabled(volume);
+        control.set_mono_downmix(mono);
+        A2DPFramePipeline pipeline;
+        TEST_ASSERT_TRUE(pipeline.configure(swap, &control, false));
+
+        double splitNs = timePerFrame(expect, [&](Frame *f) { split(f, FRAMES, swap, mono, volume, control); });
+        double fusedNs = timePerFrame(work, [&](Frame *f) { pipeline.run(f, FRAMES); });
+        TEST_ASSERT_EQUAL_MEMORY(expect.data(), work.data(), stream.size() * sizeof(Frame));
+        printf("%4d %4d %6d   %14.2f   %14.2f\n", swap, mono, volume, splitNs, fusedNs);
+        // the mono downmix is where a second pass costs most; the volume
+        // stage trades the divide for a ramped multiply, a gain that
+        // depends on the divider and is only printed
+        if (TIMED && mono)
+            TEST_ASSERT_TRUE(fusedNs < splitNs * 0.8);
+    }
+}
+
+void test_haptic_tap_cost(void)
+{
+    makeStream();
+    std::vector<Frame> work(stream.size());
+    Control control;
+    control.setVolume(90);
+    control.set_enabled(true);
+    A2DPFramePipeline pipeline;
+    pipeline.set_haptic_reader(onHaptic, 44);
+    pipeline.configure(true, &control, false);
+    double plain = timePerFrame(work, [&](Frame *f) { pipeline.run(f, FRAMES); });
+    pipeline.configure(true, &control, true);
+    haptic.clear();
+    double tapped = timePerFrame(work, [&](Frame *f) { pipeline.run(f, FRAMES); });
+    printf("swap + volume %.2f ns/frame, with the haptic tap %.2f\n", plain, tapped);
+    // one 8 bit sample per 44 frames, ~1 kHz
+    TEST_ASSERT_UINT32_WITHIN(A2DP_HAPTIC_BUFFER_SIZE * ROUNDS, stream.size() * ROUNDS / 44, haptic.size());
+}
+
+int main(int, char **)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_fused_matches_and_beats_the_split_path);
+    RUN_TEST(test_haptic_tap_cost);
+    return UNITY_END();
+}
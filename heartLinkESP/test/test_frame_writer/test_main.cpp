@@ -0,0 +1,290 @@
+// Host test of A2DPFrameWriter for every output format: the mono downmix,
+// the 32 bit widening at full scale, whole DMA buffer writes and partial
+// writes; and a benchmark into A2DPNullOutput against a runtime format switch.
+// The ESP32 has no vector unit, so neither path is auto-vectorized here.
+#pragma GCC optimize("no-tree-vectorize")
+#include <unity.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <A2DPFrameFormat.h>
+
+#define PACKET_BYTES 4096 // 1024 frames, a few decoded SBC frames
+#define PACKETS 2000
+#define ROUNDS 5
+
+#if defined(__SANITIZE_ADDRESS__) || defined(__SANITIZE_THREAD__)
+#define TIMED 0
+#else
+#define TIMED 1
+#endif
+
+// keeps every write, and accepts at most `limit` bytes in total
+struct RecordingOutput
+{
+    std::vector<uint8_t> data;
+    std::vector<size_t> sizes;
+    std::vector<const uint8_t *> pointers;
+    size_t limit = SIZE_MAX;
+
+    size_t write(const uint8_t *in, size_t len)
+    {
+        size_t n = std::min(len, limit - data.size());
+        data.insert(data.end(), in, in + n);
+        sizes.push_back(len);
+        pointers.push_back(in);
+        return n;
+    }
+};
+
+// full scale, both signs and odd sums, then a ramp
+static std::vector<int16_t> makePacket(size_t frames)
+{
+    static const int16_t edges[][2] = {
+        {32767, 32767}, {-32768, -32768}, {32767, -32768}, {-32768, 32767},
+        {-1, 0}, {1, 0}, {-1, -2}, {0, 0}, {12345, -54}, {-3, 3},
+    };
+    std::vector<int16_t> in(2 * frames);
+    for (size_t i = 0; i < frames; i++)
+    {
+        size_t e = i % (sizeof(edges) / sizeof(edges[0]));
+        in[2 * i] = i < 64 ? edges[e][0] : (int16_t)(i * 97);
+        in[2 * i + 1] = i < 64 ? edges[e][1] : (int16_t)(-(int32_t)i * 131);
+    }
+    return in;
+}
+
+// what each format has to hold, worked out in 64 bits
+template <typename T, int CHANNELS>
+static std::vector<T> expected(const std::vector<int16_t> &in)
+{
+    std::vector<T> out;
+    for (size_t i = 0; i < in.size(); i += 2)
+    {
+        int64_t l = in[i], r = in[i + 1];
+        if (CHANNELS == 2)
+        {
+            out.push_back((T)(sizeof(T) == 2 ? l : l * 65536));
+            out.push_back((T)(sizeof(T) == 2 ? r : r * 65536));
+        }
+        else
+        {
+            // floor of the mean; 32 bits keep the half bit
+            int64_t floorMean = (l + r - ((l + r) < 0 && (l + r) % 2 ? 1 : 0)) / 2;
+            out.push_back((T)(sizeof(T) == 2 ? floorMean : (l + r) * 32768));
+        }
+    }
+    return out;
+}
+
+template <typename T, int CHANNELS>
+static void checkFormat(size_t frames)
+{
+    typedef A2DPFrameWriter<T, CHANNELS> Writer;
+    std::vector<int16_t> in = makePacket(frames);
+    std::vector<T> expect = expected<T, CHANNELS>(in);
+    Writer writer;
+    RecordingOutput out;
+    TEST_ASSERT_EQUAL(frames * 4, writer.write(out, (const uint8_t *)in.data(), frames * 4));
+    TEST_ASSERT_EQUAL(expect.size() * sizeof(T), out.data.size());
+    TEST_ASSERT_EQUAL_MEMORY(expect.data(), out.data.data(), out.data.size());
+
+    // whole DMA buffers per write, the rest in the last one
+    size_t chunks = (frames + Writer::chunk_frames - 1) / Writer::chunk_frames;
+    TEST_ASSERT_EQUAL(chunks, out.sizes.size());
+    for (size_t i = 0; i + 1 < chunks; i++)
+        TEST_ASSERT_EQUAL(Writer::chunk_frames * Writer::frame_bytes, out.sizes[i]);
+    TEST_ASSERT_EQUAL((frames - (chunks - 1) * Writer::chunk_frames) * Writer::frame_bytes, out.sizes.back());
+    TEST_ASSERT_EQUAL(Writer::chunk_frames * 4, Writer::input_chunk_bytes());
+    TEST_ASSERT_EQUAL((int)sizeof(T) * 8, Writer::bits_per_sample());
+    TEST_ASSERT_EQUAL(CHANNELS, Writer::channels());
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_stereo16_is_written_unchanged(void)
+{
+    checkFormat<int16_t, 2>(1024);
+    checkFormat<int16_t, 2>(300);
+    // straight from the packet, without a copy
+    std::vector<int16_t> in = makePacket(600);
+    A2DPFrameWriterStereo16 writer;
+    RecordingOutput out;
+    writer.write(out, (const uint8_t *)in.data(), in.size() * 2);
+    TEST_ASSERT_TRUE(out.pointers[0] == (const uint8_t *)in.data());
+    TEST_ASSERT_TRUE(out.pointers[1] == (const uint8_t *)(in.data() + 2 * A2DPFrameWriterStereo16::chunk_frames));
+}
+
+void test_mono16_downmix(void)
+{
+    checkFormat<int16_t, 1>(1024);
+    checkFormat<int16_t, 1>(300);
+    // the mean of two full scale samples does not wrap
+    int16_t in[] = {32767, 32767, -32768, -32768, 32767, -32768, -1, 0};
+    int16_t expect[] = {32767, -32768, -1, -1};
+    A2DPFrameWriterMono16 writer;
+    RecordingOutput out;
+    writer.write(out, (const uint8_t *)in, sizeof(in));
+    TEST_ASSERT_EQUAL_MEMORY(expect, out.data.data(), sizeof(expect));
+}
+
+void test_stereo32_widening(void)
+{
+    checkFormat<int32_t, 2>(1024);
+    checkFormat<int32_t, 2>(300);
+    int16_t in[] = {32767, -32768, -1, 1};
+    int32_t expect[] = {0x7FFF0000, INT32_MIN, -65536, 65536};
+    A2DPFrameWriterStereo32 writer;
+    RecordingOutput out;
+    writer.write(out, (const uint8_t *)in, sizeof(in));
+    TEST_ASSERT_EQUAL_MEMORY(expect, out.data.data(), sizeof(expect));
+}
+
+void test_mono32_keeps_the_sum(void)
+{
+    checkFormat<int32_t, 1>(1024);
+    checkFormat<int32_t, 1>(300);
+    // the full sum fits the upper 17 bits: no saturation is needed, the
+    // extremes land on the ends of the range
+    int16_t in[] = {32767, 32767, -32768, -32768, -1, 0};
+    int32_t expect[] = {0x7FFF0000, INT32_MIN, -32768};
+    A2DPFrameWriter<int32_t, 1> writer;
+    RecordingOutput out;
+    writer.write(out, (const uint8_t *)in, sizeof(in));
+    TEST_ASSERT_EQUAL_MEMORY(expect, out.data.data(), sizeof(expect));
+}
+
+void test_partial_writes_count_whole_frames(void)
+{
+    std::vector<int16_t> in = makePacket(1024);
+    // a full output stops the packet after what it took
+    A2DPFrameWriterStereo32 writer;
+    RecordingOutput out;
+    out.limit = 8 * 300 + 5;
+    TEST_ASSERT_EQUAL(4 * 300, writer.write(out, (const uint8_t *)in.data(), in.size() * 2));
+    TEST_ASSERT_EQUAL(2, (int)out.sizes.size());
+
+    A2DPFrameWriterMono16 mono;
+    RecordingOutput none;
+    none.limit = 1;
+    TEST_ASSERT_EQUAL(0, mono.write(none, (const uint8_t *)in.data(), in.size() * 2));
+    TEST_ASSERT_EQUAL(1, (int)none.sizes.size());
+
+    // and a trailing half frame of the packet is left out
+    A2DPFrameWriterMono16 odd;
+    RecordingOutput all;
+    TEST_ASSERT_EQUAL(40, odd.write(all, (const uint8_t *)in.data(), 42));
+    TEST_ASSERT_EQUAL(20, (int)all.data.size());
+}
+
+// the path the writer replaced: the format is looked up per sample and the
+// packet goes out in pieces of the sink's max_write_size
+struct RuntimeFormat
+{
+    int bits;
+    int channels;
+    uint8_t buffer[PACKET_BYTES * 2];
+
+    template <class OUTPUT>
+    size_t write(OUTPUT &output, const uint8_t *data, size_t len)
+    {
+        const int16_t *in = (const int16_t *)data;
+        size_t frames = len / 4, pos = 0;
+        for (size_t j = 0; j < frames; j++)
+            for (int c = 0; c < channels; c++)
+            {
+                int32_t sample = channels == 1 ? ((int32_t)in[2 * j] + in[2 * j + 1]) : in[2 * j + c];
+                if (bits == 16)
+                {
+                    int16_t v = (int16_t)(channels == 1 ? sample >> 1 : sample);
+                    memcpy(buffer + pos, &v, 2);
+                    pos += 2;
+                }
+                else
+                {
+                    int32_t v = (int32_t)((uint32_t)sample << (channels == 1 ? 15 : 16));
+                    memcpy(buffer + pos, &v, 4);
+                    pos += 4;
+                }
+            }
+        for (size_t done = 0; done < pos; done += std::min<size_t>(pos - done, 1024))
+            output.write(buffer + done, std::min<size_t>(pos - done, 1024));
+        return len;
+    }
+};
+
+// best of ROUNDS runs of PACKETS packets, in ns per packet
+template <class Fn>
+static double timePerPacket(Fn fn)
+{
+    double best = 1e12;
+    for (int round = 0; round < ROUNDS; round++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (int p = 0; p < PACKETS; p++)
+            fn();
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        best = std::min(best, ns / PACKETS);
+    }
+    return best;
+}
+
+template <typename T, int CHANNELS>
+static void benchmark(const char *name, const std::vector<int16_t> &packet)
+{
+    A2DPFrameWriter<T, CHANNELS> writer;
+    RuntimeFormat runtime;
+    // read back through volatiles, as the format comes from the config
+    volatile int bits = sizeof(T) * 8, channels = CHANNELS;
+    runtime.bits = bits;
+    runtime.channels = channels;
+    const uint8_t *data = (const uint8_t *)packet.data();
+
+    // the same bytes reach the output
+    RecordingOutput a, b;
+    writer.write(a, data, PACKET_BYTES);
+    runtime.write(b, data, PACKET_BYTES);
+    TEST_ASSERT_TRUE(a.data == b.data);
+
+    A2DPNullOutput templated, switched;
+    double templatedNs = timePerPacket([&] { writer.write(templated, data, PACKET_BYTES); });
+    double switchedNs = timePerPacket([&] { runtime.write(switched, data, PACKET_BYTES); });
+    printf("%-9s %12.0f %12.0f\n", name, switchedNs, templatedNs);
+    TEST_ASSERT_TRUE(templated.bytes == switched.bytes);
+    if (TIMED)
+        TEST_ASSERT_TRUE(templatedNs < switchedNs);
+}
+
+void test_null_output_benchmark(void)
+{
+    std::vector<int16_t> packet = makePacket(PACKET_BYTES / 4);
+    printf("format    switch ns/pkt  writer ns/pkt\n");
+    benchmark<int16_t, 2>("stereo16", packet);
+    benchmark<int16_t, 1>("mono16", packet);
+    benchmark<int32_t, 2>("stereo32", packet);
+    benchmark<int32_t, 1>("mono32", packet);
+
+    A2DPNullOutput out;
+    A2DPFrameWriterStereo16 writer;
+    writer.write(out, (const uint8_t *)packet.data(), PACKET_BYTES);
+    TEST_ASSERT_EQUAL_UINT32(PACKET_BYTES / (A2DPFrameWriterStereo16::chunk_frames * 4), out.writes);
+    out.reset();
+    TEST_ASSERT_EQUAL_UINT32(0, out.writes);
+    TEST_ASSERT_TRUE(out.bytes == 0);
+}
+
+int main(int, char **)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_stereo16_is_written_unchanged);
+    RUN_TEST(test_mono16_downmix);
+    RUN_TEST(test_stereo32_widening);
+    RUN_TEST(test_mono32_keeps_the_sum);
+    RUN_TEST(test_partial_writes_count_whole_frames);
+    RUN_TEST(test_null_output_benchmark);
+    return UNITY_END();
+}
@@ -0,0 +1,121 @@
+// Host test of HapticMapper on a simulated heart: a 60 to 120 bpm ramp over
+// two minutes, beats reported 60-140 ms late, update() called at random gaps.
+#include <unity.h>
+#include <deque>
+#include <random>
+#include <utility>
+#include "HapticMapper.h"
+
+struct Run
+{
+    int beats = 0;
+    int cues = 0;
+    int alerts = 0;
+    bool inOrder = true;
+    HapticPhaseStats stats;
+};
+
+static Run simulate(double hrvSpread, int maxGapMs, bool fall)
+{
+    HapticMapper mapper;
+    std::mt19937 rng(5);
+    std::normal_distribution<double> hrv(0, hrvSpread);
+    std::uniform_int_distribution<int> gap(5, maxGapMs), latency(60, 140);
+    std::deque<std::pair<uint32_t, uint32_t>> pending; // reported at, beat at
+    std::deque<uint32_t> ibis;
+    HapticCue out[16];
+    Run run;
+    double nextBeat = 1000;
+    uint32_t now = 0, lastBeat = 0, lastStart = 0;
+    while (now < 120000)
+    {
+        while (nextBeat < now + 2000)
+        {
+            double bpm = 60 + 60 * nextBeat / 120000.0;
+            pending.push_back({(uint32_t)(nextBeat + latency(rng)), (uint32_t)nextBeat});
+            nextBeat += 60000 / bpm * (1 + (hrvSpread > 0 ? hrv(rng) : 0));
+        }
+        while (!pending.empty() && pending.front().first <= now)
+        {
+            uint32_t at = pending.front().second;
+            pending.pop_front();
+            HeartBeat beat;
+            beat.timeMs = at;
+            if (lastBeat)
+            {
+                beat.ibiMs = at - lastBeat;
+                ibis.push_back(beat.ibiMs);
+                if (ibis.size() > 4)
+                    ibis.pop_front();
+                uint32_t sum = 0;
+                for (uint32_t ibi : ibis)
+                    sum += ibi;
+                beat.bpm = (uint16_t)((60000 * ibis.size() + sum / 2) / sum);
+            }
+            lastBeat = at;
+            mapper.onBeat(beat, at);
+            run.beats++;
+        }
+        if (fall && now >= 60000 && run.alerts == 0)
+        {
+            ImpactEvent event;
+            event.type = ImpactType::FALL;
+            event.severity = ImpactSeverity::MODERATE;
+            mapper.onImpact(event, now);
+        }
+        size_t n = mapper.update(now, out, 16);
+        for (size_t i = 0; i < n; i++)
+        {
+            if (out[i].preempt)
+                run.alerts++;
+            else if (out[i].startMs < lastStart)
+                run.inOrder = false;
+            lastStart = out[i].startMs;
+            run.cues++;
+        }
+        now += gap(rng);
+    }
+    run.stats = mapper.getPhaseStats();
+    return run;
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_steady_heart_is_followed_closely(void)
+{
+    Run run = simulate(0.0, 100, false);
+    TEST_ASSERT_TRUE(run.inOrder);
+    TEST_ASSERT_EQUAL_UINT32(0, run.stats.late);
+    TEST_ASSERT_GREATER_OR_EQUAL(run.beats - 3, (int)run.stats.matched);
+    TEST_ASSERT_LESS_OR_EQUAL(30, run.stats.maxAbsMs);
+    TEST_ASSERT_LESS_OR_EQUAL(10, run.stats.meanAbsMs);
+}
+
+void test_variable_heart_and_slow_updates(void)
+{
+    Run run = simulate(0.03, 200, false);
+    TEST_ASSERT_TRUE(run.inOrder);
+    TEST_ASSERT_EQUAL_UINT32(0, run.stats.late);
+    TEST_ASSERT_GREATER_OR_EQUAL(run.beats - 4, (int)run.stats.matched);
+    TEST_ASSERT_LESS_OR_EQUAL(120, run.stats.maxAbsMs);
+    TEST_ASSERT_LESS_OR_EQUAL(25, run.stats.meanAbsMs);
+}
+
+void test_fall_alert_preempts_and_beats_resume(void)
+{
+    Run run = simulate(0.03, 100, true);
+    TEST_ASSERT_GREATER_OR_EQUAL(1, run.alerts);
+    TEST_ASSERT_TRUE(run.inOrder);
+    TEST_ASSERT_EQUAL_UINT32(0, run.stats.late);
+    TEST_ASSERT_GREATER_OR_EQUAL(run.beats - 6, (int)run.stats.matched);
+}
+
+int main(int, char **)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_steady_heart_is_followed_closely);
+    RUN_TEST(test_variable_heart_and_slow_updates);
+    RUN_TEST(test_fall_alert_preempts_and_beats_resume);
+    return UNITY_END();
+}
@@ -0,0 +1,194 @@
+// Host test of HapticA2DPSource: rendered 8 kHz channels against a 44.1 kHz
+// reader whose clock drifts, idle channels, the DSP chain and two threads.
+#include <unity.h>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <thread>
+#include <vector>
+#include "HapticA2DPSource.h"
+
+#define OUT_RATE 44100
+#define BLOCK 512
+
+struct Fit
+{
+    double amplitude = 0;
+    double snrDb = 0;
+};
+
+// least squares sine of a known frequency over the interleaved channel
+static Fit fitSine(const std::vector<int16_t> &out, int channel, double hz, size_t from)
+{
+    size_t frames = out.size() / 2;
+    double c = 0, s = 0;
+    for (size_t i = from; i < frames; i++)
+    {
+        double phase = 2 * M_PI * hz * i / OUT_RATE;
+        c += out[2 * i + channel] * cos(phase);
+        s += out[2 * i + channel] * sin(phase);
+    }
+    c *= 2.0 / (frames - from);
+    s *= 2.0 / (frames - from);
+    double error = 0, power = 0;
+    for (size_t i = from; i < frames; i++)
+    {
+        double phase = 2 * M_PI * hz * i / OUT_RATE;
+        double ideal = c * cos(phase) + s * sin(phase);
+        error += pow(out[2 * i + channel] - ideal, 2);
+        power += ideal * ideal;
+    }
+    Fit fit;
+    fit.amplitude = sqrt(c * c + s * s);
+    fit.snrDb = 10 * log10(power / error);
+    return fit;
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static void checkDrift(double drift, double minSnrDb)
+{
+    HapticA2DPSource source;
+    int left = source.addTap(HapticSourceSide::LEFT);
+    int right = source.addTap(HapticSourceSide::RIGHT);
+    double inRate = HAPTIC_SOURCE_INPUT_RATE * (1 + drift), t = 0;
+    long pushed = 0;
+    std::vector<int16_t> out;
+    int16_t block[BLOCK * 2];
+    HapticSourceStats settled;
+    const int blocks = OUT_RATE * 20 / BLOCK;
+    for (int b = 0; b < blocks; b++)
+    {
+        t += (double)BLOCK / OUT_RATE;
+        // the channels render in ticks of 8 samples
+        while (pushed / inRate < t)
+        {
+            for (int k = 0; k < 8; k++, pushed++)
+            {
+                double ts = pushed / inRate;
+                source.push(left, (uint8_t)lrint(128 + 100 * sin(2 * M_PI * 150 * ts)));
+                source.push(right, (uint8_t)lrint(128 + 60 * sin(2 * M_PI * 60 * ts)));
+            }
+        }
+        TEST_ASSERT_EQUAL(BLOCK, source.read(block, BLOCK));
+        out.insert(out.end(), block, block + BLOCK * 2);
+        if (b == OUT_RATE * 5 / BLOCK)
+            settled = source.getStats();
+    }
+    HapticSourceStats stats = source.getStats();
+    TEST_ASSERT_EQUAL_UINT32(settled.underruns, stats.underruns);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.overruns);
+    TEST_ASSERT_INT_WITHIN(400, (int)(drift * 1e6), stats.correctionPpm);
+    TEST_ASSERT_UINT16_WITHIN(8, HAPTIC_SOURCE_RING_SIZE * HAPTIC_SOURCE_TARGET_PERCENT / 100, stats.fill);
+
+    // the reader runs at the producer's pace, so the last 5 s hold the
+    // input's frequency and amplitude
+    size_t from = out.size() / 2 - OUT_RATE * 5;
+    Fit l = fitSine(out, 0, 150, from);
+    Fit r = fitSine(out, 1, 60, from);
+    TEST_ASSERT_FLOAT_WITHIN(300, 100 * 256, l.amplitude);
+    TEST_ASSERT_FLOAT_WITHIN(300, 60 * 256, r.amplitude);
+    TEST_ASSERT_GREATER_THAN(minSnrDb, l.snrDb);
+    TEST_ASSERT_GREATER_THAN(minSnrDb, r.snrDb);
+}
+
+void test_matched_clocks(void) { checkDrift(0, 35); }
+void test_fast_producer(void) { checkDrift(500e-6, 35); }
+void test_slow_producer(void) { checkDrift(-3000e-6, 28); }
+void test_producer_1_percent_fast(void) { checkDrift(10000e-6, 24); }
+
+void test_idle_output_is_at_rest(void)
+{
+    HapticA2DPSource source;
+    int tap = source.addTap(HapticSourceSide::BOTH);
+    int16_t block[256 * 2];
+    long n = 0;
+    int maxIdle = 0;
+    auto run = [&](double seconds, bool produce) {
+        for (int b = 0; b < seconds * OUT_RATE / 256; b++)
+        {
+            if (produce)
+                for (int k = 0; k < (int)(256 * 8000 / (double)OUT_RATE + 0.5); k++, n++)
+                    source.push(tap, (uint8_t)(128 + 100 * sin(2 * M_PI * 150 * n / 8000.0)));
+            source.read(block, 256);
+            // once what was buffered has played out
+            if (!produce && b > 8)
+                for (int i = 0; i < 512; i++)
+                    maxIdle = std::max(maxIdle, abs(block[i]));
+        }
+    };
+    run(2, true);
+    run(1, false);
+    run(2, true);
+    HapticSourceStats stats = source.getStats();
+    TEST_ASSERT_EQUAL(0, maxIdle);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.underruns);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.overruns);
+}
+
+void test_dsp_tap_chains_and_records(void)
+{
+    HapticA2DPSource source;
+    int tap = source.addTap(HapticSourceSide::LEFT);
+    auto halve = source.dspTap(tap, [](uint8_t v) { return (uint8_t)(v / 2); });
+    auto plain = source.dspTap(tap);
+    TEST_ASSERT_EQUAL_UINT8(100, halve(200));
+    TEST_ASSERT_EQUAL_UINT8(7, plain(7));
+    for (int i = 0; i < 2 * HAPTIC_SOURCE_RING_SIZE; i++)
+        plain(128);
+    TEST_ASSERT_TRUE(source.getStats().overruns > 0);
+    TEST_ASSERT_EQUAL(-1, [] {
+        HapticA2DPSource full;
+        for (int i = 0; i < HAPTIC_SOURCE_MAX_TAPS; i++)
+            full.addTap(HapticSourceSide::BOTH);
+        return full.addTap(HapticSourceSide::BOTH);
+    }());
+}
+
+// run under env:native_tsan for the data race check
+void test_producer_and_reader_threads(void)
+{
+    HapticA2DPSource source;
+    int tap = source.addTap(HapticSourceSide::LEFT);
+    std::atomic<bool> stop{false};
+    std::thread producer([&] {
+        auto start = std::chrono::steady_clock::now();
+        long n = 0;
+        while (!stop)
+        {
+            long due = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count() * 8 / 1000;
+            for (; n < due; n++)
+                source.push(tap, (uint8_t)(n & 255));
+            std::this_thread::sleep_for(std::chrono::microseconds(500));
+        }
+    });
+    int16_t block[BLOCK * 2];
+    long frames = 0;
+    auto start = std::chrono::steady_clock::now();
+    while (std::chrono::steady_clock::now() - start < std::chrono::seconds(2))
+    {
+        long due = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count() * 441 / 10000;
+        for (; frames + BLOCK <= due; frames += BLOCK)
+            source.read(block, BLOCK);
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    stop = true;
+    producer.join();
+    HapticSourceStats stats = source.getStats();
+    TEST_ASSERT_TRUE(frames > OUT_RATE);
+    TEST_ASSERT_TRUE(stats.fill <= HAPTIC_SOURCE_RING_SIZE);
+}
+
+int main(int, char **)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_matched_clocks);
+    RUN_TEST(test_fast_producer);
+    RUN_TEST(test_slow_producer);
+    RUN_TEST(test_producer_1_percent_fast);
+    RUN_TEST(test_idle_output_is_at_rest);
+    RUN_TEST(test_dsp_tap_chains_and_records);
+    RUN_TEST(test_producer_and_reader_threads);
+    return UNITY_END();
+}
@@ -0,0 +1,90 @@
+// Host test of HeartRateDetector on a synthetic PPG: systolic and dicrotic
+// waves, amplitude modulation, baseline wander and sensor noise.
+#include <unity.h>
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+#include "HeartRateDetector.h"
+
+static uint16_t ppgSample(double t, double bpm, std::mt19937 &rng)
+{
+    std::normal_distribution<double> noise(0, 6);
+    double period = 60.0 / bpm;
+    double phase = fmod(t, period) / period;
+    double am = 1 + 0.2 * sin(2 * M_PI * 0.25 * t);
+    double ppg = am * 200 * exp(-pow((phase - 0.15) / 0.06, 2)) + 70 * exp(-pow((phase - 0.45) / 0.08, 2));
+    return (uint16_t)lrint(2000 + ppg + 150 * sin(2 * M_PI * 0.2 * t) + noise(rng));
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_counts_every_beat_and_the_rate(void)
+{
+    const double rates[] = {45, 60, 72, 100, 150, 180};
+    const uint32_t sampleRates[] = {250, 500};
+    for (double bpm : rates)
+    {
+        for (uint32_t fs : sampleRates)
+        {
+            HeartRateDetector detector(fs);
+            std::mt19937 rng(3);
+            HeartBeat beat;
+            int beats = 0;
+            double maxError = 0;
+            for (uint32_t i = 0; i < fs * 60; i++)
+            {
+                double t = (double)i / fs;
+                if (!detector.process(ppgSample(t, bpm, rng), beat))
+                    continue;
+                beats++;
+                // once the interval history has filled
+                if (beat.bpm && t > 10)
+                    maxError = fmax(maxError, fabs(beat.bpm - bpm));
+            }
+            TEST_ASSERT_INT_WITHIN(1, (int)bpm, beats);
+            TEST_ASSERT_FLOAT_WITHIN(1.0, 0.0, maxError);
+        }
+    }
+}
+
+void test_block_input_matches_single_samples(void)
+{
+    const uint32_t fs = 500;
+    std::mt19937 rng(5);
+    std::vector<uint16_t> samples(fs * 20);
+    for (size_t i = 0; i < samples.size(); i++)
+        samples[i] = ppgSample((double)i / fs, 72, rng);
+
+    HeartRateDetector single(fs), blocks(fs);
+    HeartBeat beat;
+    size_t singleBeats = 0, blockBeats = 0;
+    for (uint16_t s : samples)
+        singleBeats += single.process(s, beat);
+    for (size_t i = 0; i < samples.size(); i += 32)
+        blockBeats += blocks.process(&samples[i], std::min<size_t>(32, samples.size() - i), beat);
+    TEST_ASSERT_EQUAL(singleBeats, blockBeats);
+    TEST_ASSERT_EQUAL_UINT16(single.getBpm(), blocks.getBpm());
+}
+
+void test_noise_alone_is_no_beat(void)
+{
+    HeartRateDetector detector(500);
+    HeartBeat beat;
+    std::mt19937 rng(1);
+    std::normal_distribution<double> noise(0, 3);
+    int beats = 0;
+    for (int i = 0; i < 30000; i++)
+        beats += detector.process((uint16_t)lrint(2000 + noise(rng)), beat);
+    TEST_ASSERT_EQUAL(0, beats);
+}
+
+int main(int, char **)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_counts_every_beat_and_the_rate);
+    RUN_TEST(test_block_input_matches_single_samples);
+    RUN_TEST(test_noise_alone_is_no_beat);
+    return UNITY_END();
+}
@@ -0,0 +1,137 @@
+// Host test of I2sRing, the lock-free frame ring behind Esp32I2SRing.
+#include <unity.h>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <thread>
+#include <I2sRing.h>
+
+static uint8_t storage[1024];
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_pack_scales_to_the_signed_range(void)
+{
+    I2sRing ring(storage, sizeof(storage));
+    uint8_t f[8];
+    ring.setFormat(16, 2);
+    TEST_ASSERT_EQUAL(4, ring.frameBytes());
+    ring.pack(0, f);
+    const uint8_t low16[4] = {0x00, 0x80, 0x00, 0x80};
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(low16, f, 4);
+    ring.pack(255, f);
+    TEST_ASSERT_EQUAL_UINT8(0xFF, f[0]);
+    TEST_ASSERT_EQUAL_UINT8(0x7F, f[1]);
+
+    // above 16 bits: 32 bit slots, left-justified
+    ring.setFormat(24, 2);
+    TEST_ASSERT_EQUAL(8, ring.frameBytes());
+    ring.pack(255, f);
+    const uint8_t high24[4] = {0x00, 0xFF, 0xFF, 0x7F};
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(high24, f, 4);
+    ring.pack(0, f);
+    const uint8_t low24[4] = {0x00, 0x00, 0x00, 0x80};
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(low24, f, 4);
+
+    ring.setFormat(32, 1);
+    TEST_ASSERT_EQUAL(4, ring.frameBytes());
+    ring.setFormat(8, 2);
+    TEST_ASSERT_EQUAL(4, ring.frameBytes());
+}
+
+void test_fill_wrap_and_whole_frames(void)
+{
+    I2sRing ring(storage, sizeof(storage));
+    ring.setFormat(16, 2);
+    int n = 0;
+    while (ring.writeSample((uint8_t)n))
+        n++;
+    // the whole storage is usable: 1024 bytes = 256 frames
+    TEST_ASSERT_EQUAL(256, n);
+    TEST_ASSERT_EQUAL_UINT32(4, ring.getDropped());
+    TEST_ASSERT_EQUAL(0, ring.space());
+
+    size_t len;
+    const uint8_t *p = ring.readPtr(len);
+    TEST_ASSERT_EQUAL(1024, len);
+    ring.readAdvance(10 * 4);
+    uint8_t block[64] = {};
+    TEST_ASSERT_EQUAL(40, ring.write(block, 43));
+    p = ring.readPtr(len);
+    TEST_ASSERT_EQUAL(1024 - 40, len);
+    ring.readAdvance(len);
+    // the rest is contiguous again from the start of the storage
+    p = ring.readPtr(len);
+    TEST_ASSERT_EQUAL(40, len);
+    TEST_ASSERT_TRUE(p == storage);
+    ring.readAdvance(40);
+    TEST_ASSERT_EQUAL(0, ring.available());
+}
+
+// one writer mixing single samples and blocks, one reader checking the sequence
+void test_writer_and_reader_threads(void)
+{
+    I2sRing ring(storage, sizeof(storage));
+    ring.setFormat(16, 2);
+    const uint32_t total = 500000;
+    uint32_t got = 0;
+    bool bad = false;
+    std::thread reader([&] {
+        uint8_t expect = 0, frame[4], want[4];
+        size_t off = 0;
+        while (got < total)
+        {
+            size_t len;
+            const uint8_t *q = ring.readPtr(len);
+            if (!len)
+            {
+                std::this_thread::yield();
+                continue;
+            }
+            for (size_t i = 0; i < len; i++)
+            {
+                frame[off++] = q[i];
+                if (off < 4)
+                    continue;
+                off = 0;
+                ring.pack(expect++, want);
+                bad |= memcmp(want, frame, 4) != 0;
+                got++;
+            }
+            ring.readAdvance(len);
+        }
+    });
+    uint32_t sent = 0;
+    uint8_t vals[32];
+    while (sent < total)
+    {
+        size_t taken;
+        if (sent % 3 == 0)
+        {
+            taken = ring.writeSample((uint8_t)sent) ? 1 : 0;
+        }
+        else
+        {
+            uint32_t k = std::min<uint32_t>(32, total - sent);
+            for (uint32_t i = 0; i < k; i++)
+                vals[i] = (uint8_t)(sent + i);
+            taken = ring.writeSamples(vals, k);
+        }
+        sent += taken;
+        if (!taken)
+            std::this_thread::yield();
+    }
+    reader.join();
+    TEST_ASSERT_EQUAL_UINT32(total, got);
+    TEST_ASSERT_FALSE(bad);
+}
+
+int main(int, char **)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_pack_scales_to_the_signed_range);
+    RUN_TEST(test_fill_wrap_and_whole_frames);
+    RUN_TEST(test_writer_and_reader_threads);
+    return UNITY_END();
+}
@@ -0,0 +1,183 @@
+// Host test of ImpactDetector on synthetic accelerometer traces: walking,
+// a drop, a hit, a one-sample spike, a short dip of a jump and the severity
+// at the +-16 g raw range and the +-4 g DMP range.
+#include <unity.h>
+#include <cmath>
+#include <random>
+#include <vector>
+#include "ImpactDetector.h"
+
+#define LSB_PER_G 2048
+
+struct Accel
+{
+    double x, y, z; /*!< g */
+};
+
+struct Result
+{
+    int events = 0;
+    ImpactEvent last;
+    uint16_t maxPolledPeak = 0;
+};
+
+static Result run(uint32_t fs, const std::vector<Accel> &trace, uint16_t lsbPerG = LSB_PER_G)
+{
+    ImpactDetector detector(fs, lsbPerG);
+    Result result;
+    // the axes clip at the full scale, as the sensor does
+    auto raw = [&](double g) { return (int16_t)lrint(fmax(-32768, fmin(32767, g * lsbPerG))); };
+    for (size_t i = 0; i < trace.size(); i++)
+    {
+        ImpactEvent event;
+        if (detector.process(raw(trace[i].x), raw(trace[i].y), raw(trace[i].z), event))
+        {
+            result.events++;
+            result.last = event;
+        }
+        // polled at 10 Hz, as the telemetry does
+        if (i % (fs / 10) == 0 && detector.getWindowPeakMilliG() > result.maxPolledPeak)
+            result.maxPolledPeak = detector.getWindowPeakMilliG();
+    }
+    return result;
+}
+
+static std::vector<Accel> walk(uint32_t fs)
+{
+    std::mt19937 rng(1);
+    std::normal_distribution<double> noise(0, 0.03);
+    std::vector<Accel> trace;
+    for (uint32_t i = 0; i < fs * 5; i++)
+        trace.push_back({noise(rng), noise(rng), 1 + 0.4 * sin(2 * M_PI * 2 * i / fs) + noise(rng)});
+    return trace;
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_walking_is_no_event(void)
+{
+    TEST_ASSERT_EQUAL(0, run(100, walk(100)).events);
+    TEST_ASSERT_EQUAL(0, run(1000, walk(1000)).events);
+}
+
+void test_drop_is_a_fall(void)
+{
+    const uint32_t rates[] = {100, 1000};
+    for (uint32_t fs : rates)
+    {
+        std::vector<Accel> trace = walk(fs);
+        // 350 ms of free fall, then 20 ms of landing
+        for (uint32_t i = fs; i < fs + fs * 35 / 100; i++)
+            trace[i] = {0, 0, 0.05};
+        for (uint32_t i = fs + fs * 35 / 100; i <= fs + fs * 37 / 100; i++)
+            trace[i] = {0.5, 1.0, 5.0};
+        Result r = run(fs, trace);
+        TEST_ASSERT_EQUAL(1, r.events);
+        TEST_ASSERT_TRUE(r.last.type == ImpactType::FALL);
+        TEST_ASSERT_UINT32_WITHIN(20, 350, r.last.freeFallMs);
+        TEST_ASSERT_UINT32_WITHIN(100, 5123, r.last.peakMilliG);
+        TEST_ASSERT_EQUAL_UINT32(1350, r.last.timeMs);
+    }
+}
+
+void test_hit_is_an_impact(void)
+{
+    const uint32_t rates[] = {100, 1000};
+    for (uint32_t fs : rates)
+    {
+        std::vector<Accel> trace = walk(fs);
+        for (uint32_t i = 2 * fs; i <= 2 * fs + fs / 50; i++)
+            trace[i] = {7.0, 1, 1};
+        Result r = run(fs, trace);
+        TEST_ASSERT_EQUAL(1, r.events);
+        TEST_ASSERT_TRUE(r.last.type == ImpactType::IMPACT);
+        TEST_ASSERT_EQUAL_UINT16(0, r.last.freeFallMs);
+        TEST_ASSERT_EQUAL_UINT32(2000, r.last.timeMs);
+        // the 100 ms peak window holds it long enough for a 10 Hz poll
+        TEST_ASSERT_UINT32_WITHIN(100, 7141, r.maxPolledPeak);
+    }
+}
+
+void test_single_sample_spike_is_seen(void)
+{
+    const uint32_t rates[] = {100, 1000};
+    for (uint32_t fs : rates)
+    {
+        std::vector<Accel> trace = walk(fs);
+        trace[3 * fs + 3] = {0.5, 6.5, 1};
+        Result r = run(fs, trace);
+        TEST_ASSERT_EQUAL(1, r.events);
+        TEST_ASSERT_TRUE(r.last.type == ImpactType::IMPACT);
+        TEST_ASSERT_UINT32_WITHIN(100, 6595, r.maxPolledPeak);
+    }
+}
+
+void test_jump_dip_is_no_fall(void)
+{
+    const uint32_t rates[] = {100, 1000};
+    for (uint32_t fs : rates)
+    {
+        std::vector<Accel> trace = walk(fs);
+        // 30 ms near zero g, then a 3 g landing: below both thresholds
+        for (uint32_t i = fs; i < fs + fs * 3 / 100; i++)
+            trace[i] = {0, 0, 0.1};
+        for (uint32_t i = fs + fs * 3 / 100; i < fs + fs * 5 / 100; i++)
+            trace[i] = {0, 0, 3.0};
+        TEST_ASSERT_EQUAL(0, run(fs, trace).events);
+    }
+}
+
+static Result hit(uint32_t fs, Accel peak, uint16_t lsbPerG)
+{
+    std::vector<Accel> trace = walk(fs);
+    for (uint32_t i = 2 * fs; i <= 2 * fs + fs / 50; i++)
+        trace[i] = peak;
+    return run(fs, trace, lsbPerG);
+}
+
+void test_severity_at_full_range(void)
+{
+    TEST_ASSERT_EQUAL_UINT16(8000, ImpactDetector(100, LSB_PER_G).getSevereMilliG());
+    Result r = hit(100, {9.0, 1, 1}, LSB_PER_G);
+    TEST_ASSERT_EQUAL(1, r.events);
+    TEST_ASSERT_TRUE(r.last.severity == ImpactSeverity::SEVERE);
+    r = hit(100, {6.5, 1, 1}, LSB_PER_G);
+    TEST_ASSERT_TRUE(r.last.severity == ImpactSeverity::MODERATE);
+}
+
+void test_severe_is_reachable_at_the_dmp_range(void)
+{
+    // +-4 g: three clipped axes read 6.9 g at most, so 8 g can't be the bar
+    const uint16_t dmpLsbPerG = 8192;
+    uint16_t severe = ImpactDetector(100, dmpLsbPerG).getSevereMilliG();
+    TEST_ASSERT_TRUE(severe < 6928);
+    const uint32_t rates[] = {100, 1000};
+    for (uint32_t fs : rates)
+    {
+        // a hard hit clips two axes
+        Result r = hit(fs, {9.0, -6.0, 1}, dmpLsbPerG);
+        TEST_ASSERT_EQUAL(1, r.events);
+        TEST_ASSERT_TRUE(r.last.type == ImpactType::IMPACT);
+        TEST_ASSERT_TRUE(r.last.severity == ImpactSeverity::SEVERE);
+        TEST_ASSERT_TRUE(r.last.peakMilliG >= severe);
+        // one clipped axis is still an impact, but not a severe one
+        r = hit(fs, {7.0, 1, 1}, dmpLsbPerG);
+        TEST_ASSERT_EQUAL(1, r.events);
+        TEST_ASSERT_TRUE(r.last.severity == ImpactSeverity::MODERATE);
+        TEST_ASSERT_EQUAL(0, run(fs, walk(fs), dmpLsbPerG).events);
+    }
+}
+
+int main(int, char **)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_walking_is_no_event);
+    RUN_TEST(test_drop_is_a_fall);
+    RUN_TEST(test_hit_is_an_impact);
+    RUN_TEST(test_single_sample_spike_is_seen);
+    RUN_TEST(test_jump_dip_is_no_fall);
+    RUN_TEST(test_severity_at_full_range);
+    RUN_TEST(test_severe_is_reachable_at_the_dmp_range);
+    return UNITY_END();
+}
@@ -0,0 +1,190 @@
+// Host test of MultiChannelOutput: the block codec (interleave, the PWM
+// symbols at their edges), the DMA path through HostBoardProfile::dma, and
+// the CPU fallback with and without a timer.
+#include <unity.h>
+#include <cstring>
+#include <vector>
+#include "HostBoardProfile.h"
+#include "MultiChannelOutput.h"
+
+#define OUT_TIMER 0 // any host timer: no VH driver runs on the host board
+
+// the fields of one RMT item
+struct Symbol
+{
+    uint32_t duration0, level0, duration1, level1;
+};
+
+static Symbol split(uint32_t s)
+{
+    return {s & 0x7FFF, (s >> 15) & 1, (s >> 16) & 0x7FFF, s >> 31};
+}
+
+// a ramp from start, one step per sample
+static McRenderFn ramp(uint8_t start)
+{
+    return [start, v = (uint8_t)0](uint8_t *s, size_t n) mutable {
+        for (size_t i = 0; i < n; i++)
+            s[i] = (uint8_t)(start + v++);
+    };
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_interleave(void)
+{
+    uint8_t planar[3][MC_BLOCK_SAMPLES];
+    for (int c = 0; c < 3; c++)
+        for (int i = 0; i < MC_BLOCK_SAMPLES; i++)
+            planar[c][i] = (uint8_t)(c * 100 + i);
+    uint8_t frames[3 * MC_BLOCK_SAMPLES + 1];
+    frames[3 * MC_BLOCK_SAMPLES] = 0xAA;
+    MultiChannelCodec::interleave(planar, 3, MC_BLOCK_SAMPLES, frames);
+    for (int i = 0; i < MC_BLOCK_SAMPLES; i++)
+        for (int c = 0; c < 3; c++)
+            TEST_ASSERT_EQUAL_UINT8(c * 100 + i, frames[i * 3 + c]);
+    TEST_ASSERT_EQUAL_UINT8(0xAA, frames[3 * MC_BLOCK_SAMPLES]);
+
+    // part of a block, and a single channel
+    memset(frames, 0, sizeof(frames));
+    MultiChannelCodec::interleave(planar, 1, 5, frames);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(planar[0], frames, 5);
+    TEST_ASSERT_EQUAL_UINT8(0, frames[5]);
+}
+
+void test_encode_pwm_edges(void)
+{
+    // constant levels: two halves, neither zero, even for an odd period
+    Symbol off = split(MultiChannelCodec::encodePwm(0, 25));
+    TEST_ASSERT_EQUAL_UINT32(12, off.duration0);
+    TEST_ASSERT_EQUAL_UINT32(13, off.duration1);
+    TEST_ASSERT_EQUAL_UINT32(0, off.level0 | off.level1);
+    Symbol on = split(MultiChannelCodec::encodePwm(255, 25));
+    TEST_ASSERT_EQUAL_UINT32(12, on.duration0);
+    TEST_ASSERT_EQUAL_UINT32(13, on.duration1);
+    TEST_ASSERT_EQUAL_UINT32(1, on.level0 & on.level1);
+    Symbol shortest = split(MultiChannelCodec::encodePwm(0, 2));
+    TEST_ASSERT_EQUAL_UINT32(1, shortest.duration0);
+    TEST_ASSERT_EQUAL_UINT32(1, shortest.duration1);
+
+    // a duty: high then low, rounded, the whole period long
+    Symbol half = split(MultiChannelCodec::encodePwm(128, 312));
+    TEST_ASSERT_EQUAL_UINT32(157, half.duration0);
+    TEST_ASSERT_EQUAL_UINT32(155, half.duration1);
+    TEST_ASSERT_EQUAL_UINT32(1, half.level0);
+    TEST_ASSERT_EQUAL_UINT32(0, half.level1);
+    for (uint32_t value = 1; value < 255; value++)
+        for (uint16_t period : {2, 3, 100, 312, 32767})
+        {
+            Symbol s = split(MultiChannelCodec::encodePwm((uint8_t)value, period));
+            // a zero duration would end the RMT transmission
+            TEST_ASSERT_TRUE(s.duration0 >= 1 && s.duration1 >= 1);
+            TEST_ASSERT_EQUAL_UINT32(period, s.duration0 + s.duration1);
+        }
+    // the smallest and largest duties are clamped to one tick
+    TEST_ASSERT_EQUAL_UINT32(1, split(MultiChannelCodec::encodePwm(1, 100)).duration0);
+    TEST_ASSERT_EQUAL_UINT32(99, split(MultiChannelCodec::encodePwm(254, 100)).duration0);
+}
+
+void test_period_is_clamped(void)
+{
+    // 8 kHz: 10 MHz / 32 kHz periods
+    TEST_ASSERT_EQUAL_UINT16(312, MultiChannelOutput(8000).getPeriodTicks());
+    // too fast for two ticks, and too slow for 15 bits
+    TEST_ASSERT_EQUAL_UINT16(2, MultiChannelOutput(2000000).getPeriodTicks());
+    TEST_ASSERT_EQUAL_UINT16(32767, MultiChannelOutput(50).getPeriodTicks());
+    TEST_ASSERT_EQUAL_UINT16(312, MultiChannelOutput(0).getPeriodTicks());
+}
+
+void test_dma_blocks(void)
+{
+    HostBoardProfile board;
+    std::vector<std::vector<uint32_t>> sent;
+    std::vector<uint8_t *> buffers;
+    board.dma = [&](uint8_t *data, size_t len) {
+        sent.emplace_back((uint32_t *)data, (uint32_t *)(data + len));
+        buffers.push_back(data);
+        return true;
+    };
+    MultiChannelOutput out(8000);
+    TEST_ASSERT_EQUAL(0, out.addChannel(25, ramp(0)));
+    TEST_ASSERT_EQUAL(1, out.addChannel(26, ramp(100)));
+    TEST_ASSERT_EQUAL(2, out.addChannel(27));
+    TEST_ASSERT_TRUE(out.begin(&board) == McMode::DMA);
+    // no channels once started, and no timer or pin writes for DMA
+    TEST_ASSERT_EQUAL(-1, out.addChannel(28));
+    TEST_ASSERT_NULL(board.getTimer(OUT_TIMER));
+    TEST_ASSERT_TRUE(out.service());
+    TEST_ASSERT_TRUE(out.service());
+    TEST_ASSERT_EQUAL(0, (int)board.getPinWrites().size());
+
+    // the first block went out in begin(), through two alternating buffers
+    TEST_ASSERT_EQUAL(3, (int)sent.size());
+    TEST_ASSERT_TRUE(buffers[0] != buffers[1]);
+    TEST_ASSERT_TRUE(buffers[0] == buffers[2]);
+    uint16_t period = out.getPeriodTicks();
+    for (size_t b = 0; b < sent.size(); b++)
+    {
+        TEST_ASSERT_EQUAL(3 * MC_BLOCK_SYMBOLS, (int)sent[b].size());
+        for (int c = 0; c < 3; c++)
+            for (int i = 0; i < MC_BLOCK_SAMPLES; i++)
+            {
+                // MC_PWM_PERIODS_PER_SAMPLE copies of the sample's symbol,
+                // channel after channel
+                uint8_t value = c == 2 ? 0 : (uint8_t)(c * 100 + b * MC_BLOCK_SAMPLES + i);
+                for (int p = 0; p < MC_PWM_PERIODS_PER_SAMPLE; p++)
+                    TEST_ASSERT_EQUAL_UINT32(MultiChannelCodec::encodePwm(value, period),
+                                             sent[b][c * MC_BLOCK_SYMBOLS + i * MC_PWM_PERIODS_PER_SAMPLE + p]);
+            }
+    }
+    TEST_ASSERT_EQUAL_UINT32(3, out.getStats().blocks);
+
+    // pushed blocks go out as they are
+    uint8_t planar[3][MC_BLOCK_SAMPLES];
+    memset(planar, 255, sizeof(planar));
+    TEST_ASSERT_TRUE(out.push(planar));
+    TEST_ASSERT_EQUAL_UINT32(MultiChannelCodec::encodePwm(255, period), sent.back()[0]);
+    TEST_ASSERT_EQUAL_UINT32(3, out.getStats().blocks);
+}
+
+void test_cpu_fallback_needs_a_timer(void)
+{
+    // the board refuses DMA and no timer was given or named
+    HostBoardProfile board;
+    MultiChannelOutput out(8000);
+    out.addChannel(25, ramp(0));
+    TEST_ASSERT_TRUE(out.begin(&board) == McMode::NONE);
+    TEST_ASSERT_TRUE(out.getMode() == McMode::NONE);
+    TEST_ASSERT_FALSE(out.service());
+    uint8_t planar[1][MC_BLOCK_SAMPLES] = {};
+    TEST_ASSERT_FALSE(out.push(planar));
+    TEST_ASSERT_EQUAL(0, (int)board.getPinWrites().size());
+
+    // on a named timer it plays a frame per tick
+    MultiChannelOutput timed(8000);
+    timed.addChannel(25, ramp(0));
+    timed.addChannel(26);
+    TEST_ASSERT_TRUE(timed.begin(&board, OUT_TIMER) == McMode::CPU);
+    TEST_ASSERT_TRUE(board.getTimer(OUT_TIMER)->isRunning());
+    TEST_ASSERT_EQUAL_UINT32(8000, board.getTimer(OUT_TIMER)->freq);
+    board.clearPinWrites();
+    for (int i = 0; i < MC_BLOCK_SAMPLES; i++)
+        board.fireTimer(OUT_TIMER);
+    // only the ramp changes; the silent channel was zeroed in begin()
+    TEST_ASSERT_EQUAL(MC_BLOCK_SAMPLES - 1, (int)board.getPinWrites().size());
+    TEST_ASSERT_EQUAL_UINT32(0, timed.getStats().underruns);
+    timed.stop();
+    TEST_ASSERT_FALSE(board.getTimer(OUT_TIMER)->isRunning());
+}
+
+int main(int, char **)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_interleave);
+    RUN_TEST(test_encode_pwm_edges);
+    RUN_TEST(test_period_is_clamped);
+    RUN_TEST(test_dma_blocks);
+    RUN_TEST(test_cpu_fallback_needs_a_timer);
+    return UNITY_END();
+}
@@ -0,0 +1,236 @@
+// Host test of the PowerManager state machine on the simulated clock, and of
+// wake() against update() on a real clock for the race checks.
+#include <unity.h>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <thread>
+#include "HostBoardProfile.h"
+#include "PowerManager.h"
+#include "RenderScheduler.h"
+
+#define OUT_TIMER 2
+
+// last level written to a pin, -1 if none
+static int pinLevel(HostBoardProfile &board, int pin)
+{
+    int level = -1;
+    for (const PinWrite &w : board.getPinWrites())
+        if (w.pin == pin)
+            level = w.value;
+    return level;
+}
+
+// wall clock time, so wake() and update() really overlap
+struct RealTimeBoard : HostBoardProfile
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    unsigned long getTimeMicroseconds() override
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    }
+    unsigned long millis() override { return getTimeMicroseconds() / 1000; }
+    void delayMicroseconds(unsigned int us) override { std::this_thread::sleep_for(std::chrono::microseconds(us)); }
+    void digitalWrite(int, int) override {}
+    void pinMode(int) override {}
+};
+
+static HostBoardProfile *board;
+static IBoardTimer *timer;
+static PowerManager *power;
+static RenderScheduler *scheduler;
+static int powerCalls;
+static bool poweredOn;
+
+void setUp(void)
+{
+    board = new HostBoardProfile();
+    timer = board->createTimerEvents(OUT_TIMER, 8000);
+    timer->startTimer();
+    scheduler = new RenderScheduler(8000);
+    // the driver serves both channels, the amplifier only channel 1
+    power = new PowerManager(board, 2);
+    power->addEnablePin(DRV_SHDN_PIN);
+    power->addEnablePin(PAM_SHDN_PIN, 1, 1u << 1);
+    power->addTimer(timer);
+    power->attachScheduler(scheduler);
+    powerCalls = 0;
+    poweredOn = true;
+    power->onPower([](bool on) {
+        powerCalls++;
+        poweredOn = on;
+    });
+    power->begin();
+}
+
+void tearDown(void)
+{
+    delete power;
+    delete scheduler;
+    delete board;
+}
+
+static void advanceMs(uint32_t ms)
+{
+    board->advanceUs(ms * 1000UL);
+    power->update(board->millis());
+}
+
+void test_shuts_down_after_the_idle_timeout(void)
+{
+    TEST_ASSERT_EQUAL(255, pinLevel(*board, DRV_SHDN_PIN));
+    TEST_ASSERT_EQUAL(255, pinLevel(*board, PAM_SHDN_PIN));
+    TEST_ASSERT_TRUE(power->isRunning());
+    advanceMs(PM_IDLE_TIMEOUT_MS - 1);
+    TEST_ASSERT_TRUE(power->isRunning());
+    advanceMs(1);
+    TEST_ASSERT_FALSE(power->isRunning());
+    TEST_ASSERT_FALSE(board->getTimer(OUT_TIMER)->isRunning());
+    TEST_ASSERT_TRUE(scheduler->isPaused());
+    TEST_ASSERT_EQUAL(0, pinLevel(*board, DRV_SHDN_PIN));
+    TEST_ASSERT_EQUAL(0, pinLevel(*board, PAM_SHDN_PIN));
+    TEST_ASSERT_FALSE(power->isPowered(0));
+    TEST_ASSERT_FALSE(power->isPowered(1));
+    TEST_ASSERT_EQUAL(1, powerCalls);
+    TEST_ASSERT_FALSE(poweredOn);
+    TEST_ASSERT_EQUAL_UINT32(1, power->getStats().shutdowns);
+
+    // the timer interrupt costs nothing while shut down
+    int fired = 0;
+    timer->setCallback([](void *p) { (*(int *)p)++; }, &fired);
+    for (int i = 0; i < 8000; i++)
+        board->fireTimer(OUT_TIMER);
+    TEST_ASSERT_EQUAL(0, fired);
+}
+
+void test_wake_powers_only_the_channel(void)
+{
+    advanceMs(PM_IDLE_TIMEOUT_MS);
+    board->advanceUs(2000000);
+    // the settle wait is the whole, bounded wake latency
+    TEST_ASSERT_EQUAL_UINT32(PM_SETTLE_US, power->wake(0));
+    TEST_ASSERT_TRUE(power->isRunning());
+    TEST_ASSERT_TRUE(board->getTimer(OUT_TIMER)->isRunning());
+    TEST_ASSERT_FALSE(scheduler->isPaused());
+    TEST_ASSERT_EQUAL(2, powerCalls);
+    TEST_ASSERT_TRUE(poweredOn);
+    TEST_ASSERT_EQUAL(255, pinLevel(*board, DRV_SHDN_PIN));
+    TEST_ASSERT_EQUAL(0, pinLevel(*board, PAM_SHDN_PIN));
+    TEST_ASSERT_TRUE(power->isPowered(0));
+    TEST_ASSERT_FALSE(power->isPowered(1));
+    TEST_ASSERT_EQUAL_UINT32(0, power->wake(0));
+    TEST_ASSERT_TRUE(power->getStats().sleepMs >= 2000);
+    TEST_ASSERT_EQUAL_UINT32(PM_SETTLE_US, power->getStats().maxWakeUs);
+
+    // channel 1 only needs its amplifier, the timers already run
+    TEST_ASSERT_EQUAL_UINT32(PM_SETTLE_US, power->wake(1));
+    TEST_ASSERT_EQUAL(255, pinLevel(*board, PAM_SHDN_PIN));
+    TEST_ASSERT_EQUAL(2, powerCalls);
+}
+
+void test_idle_channel_is_gated_while_another_plays(void)
+{
+    power->wake(1);
+    for (int i = 0; i < 60; i++)
+    {
+        power->wake(0);
+        advanceMs(10);
+    }
+    TEST_ASSERT_TRUE(power->isRunning());
+    TEST_ASSERT_EQUAL(0, pinLevel(*board, PAM_SHDN_PIN));
+    TEST_ASSERT_EQUAL(255, pinLevel(*board, DRV_SHDN_PIN));
+    TEST_ASSERT_EQUAL_UINT32(1, power->getStats().pinGates);
+}
+
+void test_channel_status_holds_the_power(void)
+{
+    power->notify(0, CHANNEL_WAKE);
+    advanceMs(5000);
+    TEST_ASSERT_TRUE(power->isRunning());
+    // the timeout counts from the idle report
+    power->notify(0, CHANNEL_IDLE);
+    advanceMs(PM_IDLE_TIMEOUT_MS - 100);
+    TEST_ASSERT_TRUE(power->isRunning());
+    advanceMs(100);
+    TEST_ASSERT_FALSE(power->isRunning());
+}
+
+void test_busy_check_holds_the_power(void)
+{
+    bool busy = true;
+    power->setBusyCheck([&](uint8_t channel) { return channel == 1 && busy; });
+    advanceMs(1000);
+    TEST_ASSERT_TRUE(power->isRunning());
+    TEST_ASSERT_EQUAL(255, pinLevel(*board, PAM_SHDN_PIN));
+    busy = false;
+    advanceMs(PM_IDLE_TIMEOUT_MS + 100);
+    TEST_ASSERT_FALSE(power->isRunning());
+}
+
+void test_scheduler_pause_and_resume(void)
+{
+    RenderScheduler rs(8000);
+    rs.pause();
+    TEST_ASSERT_TRUE(rs.isPaused());
+    rs.resume();
+    TEST_ASSERT_FALSE(rs.isPaused());
+}
+
+// run under env:native_tsan: players wake channels while the task shuts them down
+void test_wake_against_update(void)
+{
+    RealTimeBoard rt;
+    PowerManager pm(&rt, 2);
+    pm.setIdleTimeout(2);
+    pm.setSettleUs(20);
+    pm.addEnablePin(1);
+    pm.addEnablePin(2, 1, 1u << 1);
+    int balance = 0;
+    pm.onPower([&](bool on) { balance += on ? 1 : -1; });
+    pm.begin();
+    std::atomic<bool> stop{false};
+    std::atomic<uint32_t> unpowered{0}, wakes{0};
+    std::thread task([&] {
+        while (!stop)
+        {
+            pm.update(rt.millis());
+            std::this_thread::yield();
+        }
+    });
+    auto player = [&](uint8_t channel) {
+        std::mt19937 rng(channel);
+        while (!stop)
+        {
+            unsigned long start = rt.millis();
+            pm.wake(channel);
+            // within the idle timeout the channel must still be powered
+            if (!pm.isPowered(channel) && rt.millis() - start < 1)
+                unpowered++;
+            wakes++;
+            std::this_thread::sleep_for(std::chrono::microseconds(rng() % 4000));
+        }
+    };
+    std::thread p0(player, 0), p1(player, 1);
+    std::this_thread::sleep_for(std::chrono::seconds(2));
+    stop = true;
+    task.join();
+    p0.join();
+    p1.join();
+    TEST_ASSERT_TRUE(wakes > 100);
+    TEST_ASSERT_EQUAL_UINT32(0, unpowered.load());
+    // every power-down answered a power-up
+    TEST_ASSERT_EQUAL(pm.isRunning() ? 0 : -1, balance);
+}
+
+int main(int, char **)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_shuts_down_after_the_idle_timeout);
+    RUN_TEST(test_wake_powers_only_the_channel);
+    RUN_TEST(test_idle_channel_is_gated_while_another_plays);
+    RUN_TEST(test_channel_status_holds_the_power);
+    RUN_TEST(test_busy_check_holds_the_power);
+    RUN_TEST(test_scheduler_pause_and_resume);
+    RUN_TEST(test_wake_against_update);
+    return UNITY_END();
+}
@@ -0,0 +1,184 @@
+// Host test of RenderScheduler: mixing, idle detection, a refused block, and
+// the wakeups of the task on HostTaskPlatform.
+#include <unity.h>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include "HostBoardProfile.h"
+#include "HostTaskPlatform.h"
+#include "RenderScheduler.h"
+
+#define OUT_TIMER 0 // any host timer: no VH driver runs on the host board
+
+static uint8_t out[MC_MAX_CHANNELS][MC_BLOCK_SAMPLES];
+
+static bool capture(const uint8_t planar[][MC_BLOCK_SAMPLES], uint8_t channels)
+{
+    memcpy(out, planar, channels * MC_BLOCK_SAMPLES);
+    return true;
+}
+
+void setUp(void) { memset(out, 0xAA, sizeof(out)); }
+void tearDown(void) {}
+
+void test_sources_are_mixed_per_channel(void)
+{
+    RenderScheduler scheduler(8000);
+    uint8_t a = 100, b = 200;
+    int calls = 0;
+    scheduler.addSource(0, [&](uint8_t *p, size_t n) { memset(p, a, n); calls++; });
+    scheduler.addSource(0, [&](uint8_t *p, size_t n) { memset(p, b, n); calls++; });
+    scheduler.addSource(2, [&](uint8_t *p, size_t n) { memset(p, a, n); calls++; });
+    scheduler.setOutput(capture);
+    TEST_ASSERT_EQUAL_UINT8(3, scheduler.getChannelCount());
+
+    // additive saturates, a channel without sources is silent
+    TEST_ASSERT_TRUE(scheduler.renderBlock());
+    TEST_ASSERT_EQUAL(3, calls);
+    TEST_ASSERT_EQUAL_UINT8(255, out[0][5]);
+    TEST_ASSERT_EQUAL_UINT8(0, out[1][0]);
+    TEST_ASSERT_EQUAL_UINT8(100, out[2][MC_BLOCK_SAMPLES - 1]);
+
+    scheduler.setMixing(0, LARGESTVAL_MIX);
+    scheduler.renderBlock();
+    TEST_ASSERT_EQUAL_UINT8(200, out[0][0]);
+
+    // the last source overrides while it is non-zero
+    scheduler.setMixing(0, INTERRUPT_MIX);
+    b = 0;
+    scheduler.renderBlock();
+    TEST_ASSERT_EQUAL_UINT8(100, out[0][0]);
+    b = 30;
+    scheduler.renderBlock();
+    TEST_ASSERT_EQUAL_UINT8(30, out[0][0]);
+
+    scheduler.setIntensity(2, 128);
+    scheduler.setActive(0, false);
+    calls = 0;
+    scheduler.renderBlock();
+    TEST_ASSERT_EQUAL(1, calls);
+    TEST_ASSERT_EQUAL_UINT8(0, out[0][0]);
+    TEST_ASSERT_UINT8_WITHIN(1, 50, out[2][0]);
+    TEST_ASSERT_UINT8_WITHIN(1, 50, scheduler.getLevel(2));
+}
+
+void test_idle_and_wake_are_reported(void)
+{
+    RenderScheduler scheduler(8000);
+    uint8_t a = 100, b = 200;
+    scheduler.addSource(0, [&](uint8_t *p, size_t n) { memset(p, a, n); });
+    scheduler.addSource(0, [&](uint8_t *p, size_t n) { memset(p, b, n); });
+    scheduler.addSource(2, [&](uint8_t *p, size_t n) { memset(p, a, n); });
+    scheduler.setOutput(capture);
+    int idle = 0, wake = 0;
+    scheduler.attachCallback([&](uint8_t, CHANNEL_STATUS status) { status == CHANNEL_IDLE ? idle++ : wake++; });
+
+    // channel 1 has no source
+    for (int i = 0; i < RS_IDLE_BLOCKS; i++)
+        scheduler.renderBlock();
+    TEST_ASSERT_TRUE(scheduler.isIdle(1));
+    TEST_ASSERT_FALSE(scheduler.isIdle(0));
+    TEST_ASSERT_EQUAL(1, idle);
+
+    a = b = 0;
+    for (int i = 0; i < RS_IDLE_BLOCKS; i++)
+        scheduler.renderBlock();
+    TEST_ASSERT_TRUE(scheduler.isIdle(0));
+    TEST_ASSERT_TRUE(scheduler.isIdle(2));
+    TEST_ASSERT_EQUAL(3, idle);
+
+    a = 9;
+    scheduler.renderBlock();
+    TEST_ASSERT_FALSE(scheduler.isIdle(0));
+    TEST_ASSERT_FALSE(scheduler.isIdle(2));
+    TEST_ASSERT_EQUAL(2, wake);
+}
+
+void test_refused_block_is_delivered_first(void)
+{
+    RenderScheduler scheduler(8000);
+    uint8_t next = 0;
+    std::vector<uint8_t> delivered;
+    int offers = 0;
+    scheduler.addSource(0, [&](uint8_t *p, size_t n) {
+        for (size_t k = 0; k < n; k++)
+            p[k] = next++;
+    });
+    // every third hand-over has no room
+    scheduler.setOutput([&](const uint8_t planar[][MC_BLOCK_SAMPLES], uint8_t) {
+        if (++offers % 3 == 0)
+            return false;
+        delivered.insert(delivered.end(), planar[0], planar[0] + MC_BLOCK_SAMPLES);
+        return true;
+    });
+    for (int i = 0; i < 60; i++)
+        scheduler.renderBlock();
+    for (size_t k = 0; k < delivered.size(); k++)
+        TEST_ASSERT_EQUAL_UINT8((uint8_t)k, delivered[k]);
+    TEST_ASSERT_EQUAL_UINT32(20, scheduler.getStats().overflows);
+    TEST_ASSERT_EQUAL(40 * MC_BLOCK_SAMPLES, (int)delivered.size());
+    // the block refused last is still held
+    TEST_ASSERT_EQUAL_UINT32(41, scheduler.getStats().blocks);
+}
+
+void test_feeds_a_cpu_mode_output(void)
+{
+    HostBoardProfile board;
+    MultiChannelOutput output(8000);
+    output.addChannel(25);
+    output.addChannel(26);
+    TEST_ASSERT_TRUE(output.begin(&board, OUT_TIMER) == McMode::CPU);
+    RenderScheduler scheduler(8000);
+    scheduler.addSource(0, [](uint8_t *p, size_t n) { memset(p, 7, n); });
+    scheduler.addSource(1, [](uint8_t *p, size_t n) { memset(p, 9, n); });
+    scheduler.setOutput([&](const uint8_t planar[][MC_BLOCK_SAMPLES], uint8_t) { return output.push(planar); });
+
+    // begin() primed both buffers, so the output is full until a block plays
+    TEST_ASSERT_FALSE(scheduler.renderBlock());
+    for (int i = 0; i < MC_BLOCK_SAMPLES; i++)
+        board.fireTimer(OUT_TIMER);
+    TEST_ASSERT_TRUE(scheduler.renderBlock());
+    TEST_ASSERT_FALSE(scheduler.renderBlock());
+    // the first block was held and handed over again, not rendered twice
+    TEST_ASSERT_EQUAL_UINT32(2, scheduler.getStats().blocks);
+    TEST_ASSERT_EQUAL_UINT32(2, scheduler.getStats().overflows);
+}
+
+void test_one_wakeup_per_block(void)
+{
+    RenderScheduler scheduler(8000);
+    std::atomic<uint32_t> samples{0};
+    scheduler.addSource(0, [&](uint8_t *p, size_t n) {
+        memset(p, 1, n);
+        samples += n;
+    });
+    scheduler.addSource(1, [](uint8_t *p, size_t n) { memset(p, 1, n); });
+    scheduler.setOutput([](const uint8_t[][MC_BLOCK_SAMPLES], uint8_t) { return true; });
+    HostTaskPlatform platform;
+    TaskFramework tasks(&platform);
+    tasks.add(&scheduler);
+    TEST_ASSERT_TRUE(tasks.start());
+    std::this_thread::sleep_for(std::chrono::seconds(2));
+    tasks.stop();
+
+    // one wakeup per 4 ms block instead of a timer interrupt per sample; wall
+    // clock on a shared host, so the bounds are loose
+    const RenderSchedulerStats &stats = scheduler.getStats();
+    TEST_ASSERT_EQUAL_UINT32(4, RenderScheduler::periodMs(8000));
+    TEST_ASSERT_UINT32_WITHIN(100, 500, stats.wakeups);
+    TEST_ASSERT_UINT32_WITHIN(1600, 16000, samples.load());
+    TEST_ASSERT_EQUAL_UINT32(stats.blocks * MC_BLOCK_SAMPLES, samples.load());
+}
+
+int main(int, char **)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_sources_are_mixed_per_channel);
+    RUN_TEST(test_idle_and_wake_are_reported);
+    RUN_TEST(test_refused_block_is_delivered_first);
+    RUN_TEST(test_feeds_a_cpu_mode_output);
+    RUN_TEST(test_one_wakeup_per_block);
+    return UNITY_END();
+}
@@ -0,0 +1,157 @@
+// Host test of ResonanceTracker against a simulated second-order LRA: burst,
+// back-EMF ringdown, drift tracking, outliers and the stored estimate.
+#include <unity.h>
+#include <cmath>
+#include <map>
+#include <random>
+#include <string>
+#include "HostBoardProfile.h"
+#include "ResonanceTracker.h"
+
+// keeps what the tracker saves, like the board's preferences
+struct StoringBoard : HostBoardProfile
+{
+    std::map<std::string, std::string> values;
+    void save(const char *key, const char *value) override { values[key] = value; }
+    std::string read(const char *key, const char *defaultVal) override
+    {
+        auto it = values.find(key);
+        return it == values.end() ? defaultVal : it->second;
+    }
+};
+
+// x'' + w/Q x' + w^2 x = F, driven by a square wave while the burst is on
+struct Lra
+{
+    double f0, q;
+    double x = 0, v = 0, phase = 0, driveHz = 0;
+    bool on = false;
+    Lra(double hz, double quality) : f0(hz), q(quality) {}
+    void rest() { x = v = phase = 0; }
+};
+
+static std::mt19937 rng(1);
+
+// the ADC sees the back-EMF, noise and, while driving, the driver itself
+static void runMeasurement(ResonanceTracker &tracker, Lra &lra, double emfGain = 600, double noise = 3)
+{
+    std::normal_distribution<double> adcNoise(0, noise);
+    tracker.setDrive([&](bool on, float hz) {
+        lra.on = on;
+        lra.driveHz = hz;
+    });
+    TEST_ASSERT_TRUE(tracker.measure());
+    const int sub = 16;
+    const double dt = 1.0 / RT_SAMPLE_RATE / sub, w = 2 * M_PI * lra.f0;
+    for (int n = 0; tracker.isMeasuring() && n < RT_SAMPLE_RATE; n++)
+    {
+        double square = 0;
+        for (int s = 0; s < sub; s++)
+        {
+            square = 0;
+            if (lra.on)
+            {
+                lra.phase += lra.driveHz * dt;
+                square = fmod(lra.phase, 1) < 0.5 ? 1 : -1;
+            }
+            double a = square * w * w * 0.001 - w / lra.q * lra.v - w * w * lra.x;
+            lra.v += a * dt;
+            lra.x += lra.v * dt;
+        }
+        double emf = lra.v / (w * 0.001 * lra.q);
+        long value = lrint(2048 + emfGain * emf + adcNoise(rng) + 500 * square);
+        uint16_t sample = (uint16_t)(value < 0 ? 0 : value > 4095 ? 4095 : value);
+        tracker.addSamples(&sample, 1);
+    }
+    TEST_ASSERT_FALSE(tracker.isMeasuring());
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_finds_resonance_across_the_tolerance(void)
+{
+    // +-10 % around 160 Hz, low to high Q
+    for (double f0 = 144; f0 <= 176; f0 += 4)
+        for (double q : {8.0, 12.0, 20.0})
+        {
+            ResonanceTracker tracker(0);
+            Lra lra(f0, q);
+            runMeasurement(tracker, lra);
+            TEST_ASSERT_EQUAL_UINT32(1, tracker.getAccepted());
+            const ResonanceEstimate &e = tracker.getLast();
+            double tau = q / (M_PI * f0) * 1000;
+            TEST_ASSERT_FLOAT_WITHIN(0.75, f0, e.frequencyHz);
+            TEST_ASSERT_FLOAT_WITHIN(0.08 * tau, tau, e.timeConstantMs);
+            TEST_ASSERT_TRUE(e.cycles >= RT_MIN_CYCLES);
+            TEST_ASSERT_FLOAT_WITHIN(0.01, 1000.0 / e.frequencyHz, tracker.pulseDurationMs());
+        }
+}
+
+void test_follows_a_drift_and_rejects_outliers(void)
+{
+    ResonanceTracker tracker(1);
+    Lra lra(170, 12);
+    // warming up: a hertz per measurement
+    for (int i = 0; i < 6; i++)
+    {
+        lra.f0 = 170 - i;
+        lra.rest();
+        runMeasurement(tracker, lra);
+        TEST_ASSERT_FLOAT_WITHIN(1, lra.f0, tracker.getFrequency());
+    }
+    float tracked = tracker.getFrequency();
+    // further than RT_MAX_STEP from the estimate: a bad measurement
+    lra.f0 = 240;
+    lra.rest();
+    runMeasurement(tracker, lra);
+    TEST_ASSERT_EQUAL_UINT32(1, tracker.getRejected());
+    TEST_ASSERT_EQUAL_FLOAT(tracked, tracker.getFrequency());
+}
+
+void test_no_back_emf_is_rejected(void)
+{
+    ResonanceTracker tracker(2);
+    Lra lra(160, 12);
+    runMeasurement(tracker, lra, 0);
+    TEST_ASSERT_EQUAL_UINT32(0, tracker.getAccepted());
+    TEST_ASSERT_EQUAL_UINT32(1, tracker.getRejected());
+    TEST_ASSERT_EQUAL_FLOAT(RESONANT_FREQ, tracker.getFrequency());
+}
+
+void test_estimate_is_stored_and_applied(void)
+{
+    StoringBoard board;
+    ResonanceTracker tracker(1);
+    TEST_ASSERT_FALSE(tracker.load(&board));
+    int updates = 0;
+    tracker.onUpdate([&](uint8_t channel, const ResonanceEstimate &) {
+        TEST_ASSERT_EQUAL_UINT8(1, channel);
+        updates++;
+    });
+    Lra lra(152, 12);
+    runMeasurement(tracker, lra);
+    TEST_ASSERT_EQUAL(1, updates);
+    tracker.save(&board);
+    TEST_ASSERT_EQUAL(1, (int)board.values.count("res1f"));
+
+    ResonanceTracker restored(1);
+    TEST_ASSERT_TRUE(restored.load(&board));
+    TEST_ASSERT_FLOAT_WITHIN(0.01, tracker.getFrequency(), restored.getFrequency());
+    TEST_ASSERT_FLOAT_WITHIN(0.01, tracker.getTimeConstantMs(), restored.getTimeConstantMs());
+
+    ActuatorShaper shaper(ActuatorModel::lra());
+    restored.applyTo(shaper);
+    TEST_ASSERT_FLOAT_WITHIN(0.01, restored.getFrequency(), shaper.getModel().resonantHz);
+    TEST_ASSERT_FLOAT_WITHIN(0.01, restored.getTimeConstantMs(), shaper.getModel().timeConstantMs);
+}
+
+int main(int, char **)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_finds_resonance_across_the_tolerance);
+    RUN_TEST(test_follows_a_drift_and_rejects_outliers);
+    RUN_TEST(test_no_back_emf_is_rejected);
+    RUN_TEST(test_estimate_is_stored_and_applied);
+    return UNITY_END();
+}
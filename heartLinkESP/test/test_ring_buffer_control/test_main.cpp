@@ -0,0 +1,267 @@
+// Host test of A2DPRingBufferControl: the mode transitions and counters, and
+// the adaptive watermark on a simulated clock, with a packet producer and an
+// I2S consumer that runs faster or slower than the source.
+#include <unity.h>
+#include <cstdint>
+#include <vector>
+#include <A2DPRingBufferControl.h>
+
+#define BYTE_RATE 176400 // 44.1 kHz, 16 bit stereo
+#define PACKET_MS 20
+#define PACKET_BYTES (BYTE_RATE / 1000 * PACKET_MS)
+#define CAPACITY 32768
+
+// the queued sink around the control: write_audio() on the producer side,
+// the I2S task draining the ringbuffer every ms on the consumer side
+struct Sink
+{
+    A2DPRingBufferControl control;
+    size_t fill = 0;
+    bool playing = false;
+    uint32_t consumerRate = BYTE_RATE;
+    uint32_t due = 0;
+    uint64_t produced = 0, consumed = 0;
+    std::vector<uint32_t> underflowsAtMs;
+
+    // 65%, as the sink
+    explicit Sink(int maxPercent = 65, bool adaptive = true) : control(maxPercent)
+    {
+        control.begin(CAPACITY);
+        control.set_adaptive(adaptive);
+        control.set_byte_rate(BYTE_RATE);
+    }
+
+    void write(size_t size, uint32_t nowMs)
+    {
+        produced += size;
+        if (control.is_dropping(fill))
+            return;
+        bool accepted = fill + size <= CAPACITY;
+        if (accepted)
+            fill += size;
+        if (control.on_write(accepted, fill, nowMs))
+            playing = true;
+    }
+
+    void consume(uint32_t nowMs)
+    {
+        if (!playing)
+            return;
+        due += consumerRate;
+        size_t want = due / 1000;
+        due %= 1000;
+        size_t take = want < fill ? want : fill;
+        fill -= take;
+        consumed += take;
+        if (take < want && control.on_empty())
+        {
+            playing = false;
+            underflowsAtMs.push_back(nowMs);
+        }
+    }
+};
+
+static uint32_t seed = 1;
+
+static uint32_t randomMs(uint32_t range)
+{
+    seed = seed * 1664525 + 1013904223;
+    return (seed >> 8) % range;
+}
+
+// a packet every PACKET_MS, each late by up to jitterMs; plus a radio gap of
+// gapMs every gapEveryMs, after which the held back packets arrive at once
+static void run(Sink &sink, uint32_t fromMs, uint32_t toMs, uint32_t jitterMs, uint32_t gapEveryMs = 0, uint32_t gapMs = 0)
+{
+    uint32_t nominal = fromMs;
+    uint32_t next = nominal + (jitterMs ? randomMs(jitterMs) : 0);
+    for (uint32_t now = fromMs; now < toMs; now++)
+    {
+        bool inGap = gapEveryMs && now % gapEveryMs < gapMs;
+        while (!inGap && next <= now)
+        {
+            sink.write(PACKET_BYTES, now);
+            nominal += PACKET_MS;
+            next = nominal + (jitterMs ? randomMs(jitterMs) : 0);
+        }
+        sink.consume(now);
+    }
+}
+
+static size_t bytesFor(uint32_t ms)
+{
+    return (size_t)ms * BYTE_RATE / 1000 / 4 * 4;
+}
+
+void setUp(void) { seed = 1; }
+void tearDown(void) {}
+
+void test_prefetch_process_drop(void)
+{
+    A2DPRingBufferControl control(50);
+    control.begin(4096);
+    TEST_ASSERT_EQUAL(RINGBUFFER_MODE_PREFETCHING, control.get_mode());
+    TEST_ASSERT_EQUAL(2048, (int)control.watermark());
+
+    // the consumer is released by the write that reaches the watermark
+    TEST_ASSERT_FALSE(control.on_write(true, 1536, 0));
+    TEST_ASSERT_FALSE(control.is_dropping(1536));
+    TEST_ASSERT_TRUE(control.on_write(true, 2048, 10));
+    TEST_ASSERT_EQUAL(RINGBUFFER_MODE_PROCESSING, control.get_mode());
+    TEST_ASSERT_FALSE(control.on_write(true, 3584, 20));
+
+    // a rejected write drops until the fill is back at the watermark
+    TEST_ASSERT_FALSE(control.on_write(false, 4096, 30));
+    TEST_ASSERT_EQUAL(RINGBUFFER_MODE_DROPPING, control.get_mode());
+    TEST_ASSERT_EQUAL_UINT32(1, control.get_overflow_count());
+    TEST_ASSERT_TRUE(control.is_dropping(3072));
+    TEST_ASSERT_EQUAL(RINGBUFFER_MODE_DROPPING, control.get_mode());
+    TEST_ASSERT_TRUE(control.is_dropping(2048));
+    TEST_ASSERT_EQUAL(RINGBUFFER_MODE_PROCESSING, control.get_mode());
+    TEST_ASSERT_EQUAL_UINT32(3, control.get_overflow_count());
+    TEST_ASSERT_FALSE(control.is_dropping(2048));
+    TEST_ASSERT_EQUAL_UINT32(3, control.get_overflow_count());
+
+    // one underflow per run out, none while already prefetching
+    TEST_ASSERT_TRUE(control.on_empty());
+    TEST_ASSERT_EQUAL(RINGBUFFER_MODE_PREFETCHING, control.get_mode());
+    TEST_ASSERT_FALSE(control.on_empty());
+    TEST_ASSERT_EQUAL_UINT32(1, control.get_underflow_count());
+    TEST_ASSERT_FALSE(control.on_write(true, 1024, 40));
+    TEST_ASSERT_TRUE(control.on_write(true, 2048, 50));
+
+    // the percent applies from the next check
+    control.set_max_percent(25);
+    TEST_ASSERT_EQUAL(1024, (int)control.watermark());
+    control.restart();
+    TEST_ASSERT_EQUAL(RINGBUFFER_MODE_PREFETCHING, control.get_mode());
+    TEST_ASSERT_TRUE(control.on_write(true, 1024, 60));
+}
+
+void test_full_ringbuffer_completes_the_prefetch(void)
+{
+    // 100% is not reached in whole packets: the write that does not fit
+    // releases the consumer and the drop takes it back to the watermark
+    A2DPRingBufferControl control(100);
+    control.begin(4096);
+    TEST_ASSERT_FALSE(control.on_write(true, 3000, 0));
+    TEST_ASSERT_TRUE(control.on_write(false, 3000, 10));
+    TEST_ASSERT_EQUAL(RINGBUFFER_MODE_DROPPING, control.get_mode());
+    TEST_ASSERT_TRUE(control.is_dropping(2000));
+    TEST_ASSERT_EQUAL(RINGBUFFER_MODE_PROCESSING, control.get_mode());
+    // not again once playing
+    TEST_ASSERT_FALSE(control.on_write(false, 4000, 20));
+}
+
+void test_fixed_watermark_ignores_jitter(void)
+{
+    Sink sink(50, false);
+    run(sink, 0, 2000, 16);
+    TEST_ASSERT_TRUE(sink.control.get_jitter_ms() > 0);
+    TEST_ASSERT_EQUAL(CAPACITY / 2, (int)sink.control.watermark());
+    sink.control.on_empty();
+    TEST_ASSERT_EQUAL(CAPACITY / 2, (int)sink.control.watermark());
+}
+
+void test_adaptive_watermark_follows_jitter(void)
+{
+    // nothing measured yet: the full percent
+    Sink sink;
+    TEST_ASSERT_EQUAL(CAPACITY * 65 / 100 / 4 * 4, (int)sink.control.watermark());
+
+    // a steady source: one interval
+    run(sink, 0, 2000, 0);
+    TEST_ASSERT_EQUAL_UINT32(PACKET_MS, sink.control.get_interval_ms());
+    TEST_ASSERT_EQUAL_UINT32(0, sink.control.get_jitter_ms());
+    TEST_ASSERT_EQUAL(bytesFor(PACKET_MS), sink.control.watermark());
+    TEST_ASSERT_EQUAL(0, (int)sink.underflowsAtMs.size());
+
+    // a jittery one: the interval plus four mean deviations, plus the
+    // margin of any underflow on the way
+    run(sink, 2000, 6000, 16);
+    uint32_t interval = sink.control.get_interval_ms(), deviation = sink.control.get_jitter_ms();
+    uint32_t margin = A2DP_PREFETCH_UNDERFLOW_MS * sink.control.get_underflow_count();
+    TEST_ASSERT_UINT32_WITHIN(2, PACKET_MS, interval);
+    TEST_ASSERT_TRUE(deviation >= 2 && deviation <= 8);
+    TEST_ASSERT_TRUE(sink.control.watermark() >= bytesFor(interval + 4 * deviation + margin));
+    TEST_ASSERT_TRUE(sink.control.watermark() <= bytesFor(interval + 1 + 4 * (deviation + 1) + margin));
+
+    // kept between the lower limit and the percent
+    sink.control.set_max_percent(15);
+    TEST_ASSERT_EQUAL(CAPACITY * 15 / 100 / 4 * 4, (int)sink.control.watermark());
+    Sink fast;
+    for (uint32_t t = 0; t < 200; t += 2)
+        fast.write(64, t);
+    TEST_ASSERT_EQUAL(CAPACITY * A2DP_PREFETCH_MIN_PERCENT / 100 / 4 * 4, (int)fast.control.watermark());
+}
+
+void test_bursty_source(void)
+{
+    // a radio gap of 80 ms every 2 s: each underflow adds to the margin,
+    // so they get rare
+    Sink sink;
+    run(sink, 0, 60000, 6, 2000, 80);
+    size_t count = sink.underflowsAtMs.size();
+    TEST_ASSERT_TRUE(count >= 1);
+    TEST_ASSERT_EQUAL_UINT32(count, sink.control.get_underflow_count());
+    TEST_ASSERT_EQUAL_UINT32(0, sink.control.get_overflow_count());
+    TEST_ASSERT_TRUE(sink.control.watermark() >= bytesFor(PACKET_MS + A2DP_PREFETCH_UNDERFLOW_MS * count));
+    TEST_ASSERT_EQUAL(RINGBUFFER_MODE_PROCESSING, sink.control.get_mode());
+
+    // at the lower limit without the margin it runs out at almost every gap
+    seed = 1;
+    Sink fixed(A2DP_PREFETCH_MIN_PERCENT, false);
+    run(fixed, 0, 60000, 6, 2000, 80);
+    TEST_ASSERT_TRUE(fixed.underflowsAtMs.size() >= 25);
+    TEST_ASSERT_TRUE(count * 4 <= fixed.underflowsAtMs.size());
+}
+
+void test_faster_consumer_underflows(void)
+{
+    // the I2S clock runs 2% fast: it drains what the source delivers, and
+    // every underflow raises the prefetch, up to the percent
+    Sink sink;
+    sink.consumerRate = BYTE_RATE * 102 / 100;
+    run(sink, 0, 120000, 6);
+    std::vector<uint32_t> &at = sink.underflowsAtMs;
+    TEST_ASSERT_TRUE(at.size() >= 3);
+    TEST_ASSERT_EQUAL_UINT32(at.size(), sink.control.get_underflow_count());
+    TEST_ASSERT_EQUAL_UINT32(0, sink.control.get_overflow_count());
+    TEST_ASSERT_EQUAL(CAPACITY * 65 / 100 / 4 * 4, (int)sink.control.watermark());
+    // so the runs between them grow until it is reached, give or take
+    // where in a packet the prefetch completes
+    for (size_t i = 2; i < at.size(); i++)
+        TEST_ASSERT_TRUE(at[i] - at[i - 1] + 500 >= at[i - 1] - at[i - 2]);
+    TEST_ASSERT_TRUE(at.back() - at[at.size() - 2] > 3 * (at[1] - at[0]));
+}
+
+void test_slower_consumer_drops(void)
+{
+    // the I2S clock runs 2% slow: the ringbuffer fills up and the excess is
+    // dropped in whole packets, down to the watermark each time
+    Sink sink;
+    sink.consumerRate = BYTE_RATE * 98 / 100;
+    run(sink, 0, 120000, 6);
+    TEST_ASSERT_EQUAL(RINGBUFFER_MODE_PROCESSING, sink.control.get_mode());
+    // dropping down to the watermark may run it out once
+    TEST_ASSERT_TRUE(sink.control.get_underflow_count() <= 2);
+    uint32_t dropped = sink.control.get_overflow_count();
+    TEST_ASSERT_TRUE(dropped > 0);
+    TEST_ASSERT_TRUE(sink.produced - sink.consumed - sink.fill == (uint64_t)dropped * PACKET_BYTES);
+    // about 2% of the packets
+    uint32_t packets = sink.produced / PACKET_BYTES;
+    TEST_ASSERT_UINT32_WITHIN(packets / 100, packets / 50, dropped);
+}
+
+int main(int, char **)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_prefetch_process_drop);
+    RUN_TEST(test_full_ringbuffer_completes_the_prefetch);
+    RUN_TEST(test_fixed_watermark_ignores_jitter);
+    RUN_TEST(test_adaptive_watermark_follows_jitter);
+    RUN_TEST(test_bursty_source);
+    RUN_TEST(test_faster_consumer_underflows);
+    RUN_TEST(test_slower_consumer_drops);
+    return UNITY_END();
+}
@@ -0,0 +1,357 @@
+// Host test of A2DPSBCHapticDecoder against a reference: a test signal is
+// SBC encoded with a windowed-sinc PQMF, fully decoded (all subbands,
+// synthesis, 1 kHz low-pass, decimation by 8) and compared with the reduced
+// subband 0 decode.
+#include <unity.h>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+// the library only builds for the ESP32; its decoder is portable
+#include <A2DPSBCHapticDecoder.cpp>
+
+typedef std::vector<std::vector<std::vector<double>>> Subbands; // [channel][subband][block]
+
+struct Config
+{
+    int frequencyIdx, blocks, mode, snr, subbands, bitpool;
+};
+
+// exposes the decoder's bit allocation to the encoder
+struct Allocator : A2DPSBCHapticDecoder
+{
+    void allocate(const Config &c, uint8_t sf[2][8], uint8_t bits[2][8])
+    {
+        SBCFrameInfo info{};
+        info.frequency_idx = c.frequencyIdx;
+        info.blocks = c.blocks;
+        info.channel_mode = c.mode;
+        info.channels = c.mode == MONO ? 1 : 2;
+        info.snr_allocation = c.snr;
+        info.subbands = c.subbands;
+        info.bitpool = c.bitpool;
+        calc_bit_allocation(info, sf, bits);
+    }
+};
+
+struct BitWriter
+{
+    std::vector<uint8_t> bytes;
+    size_t pos = 0;
+    void put(uint32_t value, int count)
+    {
+        for (int i = count - 1; i >= 0; i--, pos++)
+        {
+            if (pos / 8 >= bytes.size())
+                bytes.push_back(0);
+            if ((value >> i) & 1)
+                bytes[pos / 8] |= 0x80 >> (pos % 8);
+        }
+    }
+};
+
+// cosine modulated filterbank on a Kaiser windowed sinc, cutoff pi / 2M
+struct Pqmf
+{
+    int m, taps;
+    std::vector<double> proto;
+    explicit Pqmf(int subbands) : m(subbands), taps(10 * subbands), proto(10 * subbands)
+    {
+        auto i0 = [](double x) {
+            double s = 1, t = 1;
+            for (int k = 1; k < 30; k++)
+            {
+                t *= x / (2 * k);
+                s += t * t;
+            }
+            return s;
+        };
+        double c = (taps - 1) / 2.0, sum = 0;
+        for (int n = 0; n < taps; n++)
+        {
+            double t = n - c, r = t / c;
+            double h = t == 0 ? 1.0 / (2 * m) : sin(M_PI * t / (2 * m)) / (M_PI * t);
+            proto[n] = h * i0(9.0 * sqrt(std::max(0.0, 1 - r * r))) / i0(9.0);
+            sum += proto[n];
+        }
+        for (double &v : proto)
+            v /= sum;
+    }
+    double h(int k, int n, bool synthesis) const
+    {
+        double theta = (k % 2 ? -1 : 1) * M_PI / 4;
+        return 2 * proto[n] * cos((k + 0.5) * (n - (taps - 1) / 2.0) * M_PI / m + (synthesis ? -theta : theta));
+    }
+};
+
+static std::vector<double> lowPass1k(const std::vector<double> &in, int fs, int taps, int step)
+{
+    std::vector<double> out;
+    for (size_t n = 0; n + taps < in.size(); n += step)
+    {
+        double s = 0;
+        for (int j = 0; j < taps; j++)
+        {
+            double t = j - (taps - 1) / 2.0;
+            double h = t == 0 ? 2.0 * 1000 / fs : sin(2 * M_PI * 1000 * t / fs) / (M_PI * t);
+            s += h * (0.54 - 0.46 * cos(2 * M_PI * j / (taps - 1))) * in[n + j];
+        }
+        out.push_back(s);
+    }
+    return out;
+}
+
+static int scaleFactor(double peak)
+{
+    int s = 0;
+    while (s < 15 && peak >= (double)(1 << (s + 1)))
+        s++;
+    return s;
+}
+
+static std::vector<int16_t> decoded;
+
+struct Outcome
+{
+    int frames = 0, decodedFrames = 0;
+    uint32_t rejected = 0;
+    int rate = 0;
+    double gain = 0, corr = 0, snrDb = 0;
+    std::vector<uint8_t> stream;
+};
+
+static Outcome encodeAndCompare(const Config &c)
+{
+    const int m = c.subbands, fs = c.frequencyIdx == 2 ? 44100 : 48000, count = fs;
+    const int channels = c.mode == 0 ? 1 : 2;
+    Pqmf q(m);
+    std::vector<double> left(count), right(count);
+    for (int n = 0; n < count; n++)
+    {
+        double t = (double)n / fs, env = 0.5 + 0.5 * sin(2 * M_PI * 2 * t);
+        left[n] = 9000 * env * sin(2 * M_PI * 80 * t) + 4000 * sin(2 * M_PI * 3000 * t) + 2500 * sin(2 * M_PI * 9000 * t);
+        right[n] = 7000 * sin(2 * M_PI * 150 * t + 1) + 6000 * sin(2 * M_PI * 5000 * t);
+        if (c.mode == 0)
+            left[n] = (left[n] + right[n]) / 2;
+    }
+    Outcome result;
+    result.frames = count / (m * c.blocks) - 2;
+
+    // analysis
+    int blocks = count / m;
+    Subbands s(2, std::vector<std::vector<double>>(m, std::vector<double>(blocks)));
+    for (int ch = 0; ch < channels; ch++)
+    {
+        const std::vector<double> &x = ch ? right : left;
+        for (int b = 0; b < blocks; b++)
+        {
+            for (int k = 0; k < m; k++)
+            {
+                double sum = 0;
+                for (int n = 0; n < q.taps && b * m - n >= 0; n++)
+                    sum += q.h(k, n, false) * x[b * m - n];
+                s[ch][k][b] = sum;
+            }
+        }
+    }
+
+    // encode, keeping the dequantized values for the reference decode
+    Allocator allocator;
+    Subbands dequantized = s;
+    for (int f = 0; f < result.frames; f++)
+    {
+        uint8_t sf[2][8] = {}, bits[2][8] = {};
+        double v[2][8][16];
+        int join[8] = {};
+        for (int ch = 0; ch < channels; ch++)
+            for (int k = 0; k < m; k++)
+                for (int b = 0; b < c.blocks; b++)
+                    v[ch][k][b] = s[ch][k][f * c.blocks + b];
+        if (c.mode == 3)
+        {
+            for (int k = 0; k < m - 1; k++)
+            {
+                double l = 0, r = 0, mid = 0, side = 0;
+                for (int b = 0; b < c.blocks; b++)
+                {
+                    l = std::max(l, fabs(v[0][k][b]));
+                    r = std::max(r, fabs(v[1][k][b]));
+                    mid = std::max(mid, fabs((v[0][k][b] + v[1][k][b]) / 2));
+                    side = std::max(side, fabs((v[0][k][b] - v[1][k][b]) / 2));
+                }
+                if (scaleFactor(mid) + scaleFactor(side) >= scaleFactor(l) + scaleFactor(r))
+                    continue;
+                join[k] = 1;
+                for (int b = 0; b < c.blocks; b++)
+                {
+                    double a = v[0][k][b], d = v[1][k][b];
+                    v[0][k][b] = (a + d) / 2;
+                    v[1][k][b] = (a - d) / 2;
+                }
+            }
+        }
+        for (int ch = 0; ch < channels; ch++)
+        {
+            for (int k = 0; k < m; k++)
+            {
+                double peak = 0;
+                for (int b = 0; b < c.blocks; b++)
+                    peak = std::max(peak, fabs(v[ch][k][b]));
+                sf[ch][k] = scaleFactor(peak);
+            }
+        }
+        allocator.allocate(c, sf, bits);
+
+        BitWriter w;
+        w.put(SBC_SYNCWORD, 8);
+        w.put(c.frequencyIdx, 2);
+        w.put(c.blocks / 4 - 1, 2);
+        w.put(c.mode, 2);
+        w.put(c.snr, 1);
+        w.put(m == 8, 1);
+        w.put(c.bitpool, 8);
+        w.put(0, 8); // CRC, not checked
+        if (c.mode == 3)
+            for (int k = 0; k < m; k++)
+                w.put(join[k], 1);
+        for (int ch = 0; ch < channels; ch++)
+            for (int k = 0; k < m; k++)
+                w.put(sf[ch][k], 4);
+        for (int b = 0; b < c.blocks; b++)
+        {
+            for (int ch = 0; ch < channels; ch++)
+            {
+                for (int k = 0; k < m; k++)
+                {
+                    int nb = bits[ch][k];
+                    double scale = 1 << (sf[ch][k] + 1), dq = 0;
+                    if (nb)
+                    {
+                        int levels = (1 << nb) - 1;
+                        int qv = (int)floor((v[ch][k][b] / scale + 1.0) * levels / 2.0);
+                        qv = std::min(std::max(qv, 0), levels);
+                        w.put(qv, nb);
+                        dq = scale * ((2.0 * qv + 1) / levels - 1);
+                    }
+                    v[ch][k][b] = dq;
+                }
+            }
+        }
+        for (int b = 0; b < c.blocks; b++)
+        {
+            for (int k = 0; k < m; k++)
+            {
+                int i = f * c.blocks + b;
+                if (c.mode == 3 && join[k])
+                {
+                    dequantized[0][k][i] = v[0][k][b] + v[1][k][b];
+                    dequantized[1][k][i] = v[0][k][b] - v[1][k][b];
+                }
+                else
+                {
+                    for (int ch = 0; ch < channels; ch++)
+                        dequantized[ch][k][i] = v[ch][k][b];
+                }
+            }
+        }
+        // the A2DP media payload header in front of each frame must be skipped
+        result.stream.push_back(0x01);
+        result.stream.insert(result.stream.end(), w.bytes.begin(), w.bytes.end());
+    }
+
+    // reference: synthesis of every subband, mono, 1 kHz low-pass, / 8
+    int used = result.frames * c.blocks, outCount = used * m;
+    std::vector<double> mono(outCount, 0);
+    for (int ch = 0; ch < channels; ch++)
+        for (int k = 0; k < m; k++)
+            for (int b = 0; b < used; b++)
+                if (dequantized[ch][k][b] != 0)
+                    for (int n = 0; n < q.taps && b * m + n < outCount; n++)
+                        mono[b * m + n] += m * q.h(k, n, true) * dequantized[ch][k][b] / channels;
+    std::vector<double> reference = lowPass1k(mono, fs, 129, 8);
+
+    decoded.clear();
+    A2DPSBCHapticDecoder decoder([](const int16_t *p, uint32_t n) { decoded.insert(decoded.end(), p, p + n); });
+    result.decodedFrames = decoder.write(result.stream.data(), result.stream.size());
+    decoder.flush();
+    result.rejected = decoder.error_count();
+    result.rate = decoder.sample_rate();
+    // the same low-pass at the output rate, for a like-for-like comparison
+    std::vector<double> low = lowPass1k(std::vector<double>(decoded.begin(), decoded.end()), fs / 8, 33, 1);
+
+    int bestLag = 0;
+    for (int lag = -40; lag <= 40; lag++)
+    {
+        double xy = 0, xx = 0, yy = 0;
+        for (size_t n = 200; n + 200 < reference.size(); n++)
+        {
+            long j = (long)n + lag;
+            if (j < 0 || j >= (long)low.size())
+                continue;
+            xy += reference[n] * low[j];
+            xx += low[j] * low[j];
+            yy += reference[n] * reference[n];
+        }
+        double corr = fabs(xy / sqrt(xx * yy));
+        if (corr > result.corr)
+        {
+            result.corr = corr;
+            result.gain = xy / xx;
+            bestLag = lag;
+        }
+    }
+    double error = 0, power = 0;
+    for (size_t n = 200; n + 200 < reference.size(); n++)
+    {
+        long j = (long)n + bestLag;
+        if (j < 0 || j >= (long)low.size())
+            continue;
+        double d = reference[n] - result.gain * low[j];
+        error += d * d;
+        power += reference[n] * reference[n];
+    }
+    result.snrDb = 10 * log10(power / error);
+    return result;
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static void checkConfig(const Config &c)
+{
+    Outcome r = encodeAndCompare(c);
+    TEST_ASSERT_EQUAL(r.frames, r.decodedFrames);
+    TEST_ASSERT_EQUAL_UINT32(0, r.rejected);
+    TEST_ASSERT_EQUAL((c.frequencyIdx == 2 ? 44100 : 48000) / 8, r.rate);
+    TEST_ASSERT_GREATER_THAN(0.999, r.corr);
+    TEST_ASSERT_GREATER_THAN(28.0, r.snrDb);
+    // the output keeps the scale of the coded subband samples
+    TEST_ASSERT_FLOAT_WITHIN(0.05, 0.72, r.gain);
+}
+
+void test_joint_stereo_8_subbands(void) { checkConfig({2, 16, 3, 0, 8, 53}); }
+void test_stereo_snr_allocation(void) { checkConfig({2, 16, 2, 1, 8, 35}); }
+void test_mono(void) { checkConfig({2, 16, 0, 0, 8, 31}); }
+void test_dual_channel(void) { checkConfig({2, 16, 1, 0, 8, 25}); }
+void test_4_subbands_48k(void) { checkConfig({3, 8, 3, 0, 4, 30}); }
+void test_12_blocks(void) { checkConfig({2, 12, 3, 1, 8, 53}); }
+
+void test_truncated_frame_is_not_decoded(void)
+{
+    Outcome r = encodeAndCompare({2, 16, 3, 0, 8, 53});
+    A2DPSBCHapticDecoder decoder;
+    int frames = decoder.write(r.stream.data(), r.stream.size() - 10);
+    TEST_ASSERT_EQUAL(r.frames - 1, frames);
+}
+
+int main(int, char **)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_joint_stereo_8_subbands);
+    RUN_TEST(test_stereo_snr_allocation);
+    RUN_TEST(test_mono);
+    RUN_TEST(test_dual_channel);
+    RUN_TEST(test_4_subbands_48k);
+    RUN_TEST(test_12_blocks);
+    RUN_TEST(test_truncated_frame_is_not_decoded);
+    return UNITY_END();
+}
@@ -0,0 +1,99 @@
+// Host test of StreamBuffers: sizes from the latency target, independent
+// rings, and a DriftCompensator holding one of them against a fast sender.
+#include <unity.h>
+#include <algorithm>
+#include <vector>
+#include "DriftCompensator.h"
+#include "StreamBuffers.h"
+
+typedef VH::StreamBuffers<int16_t, 50, 14700, 1> MonoBuffers;
+typedef VH::StreamBuffers<int16_t, 50, 14700, 2> StereoBuffers;
+
+// the whole haptic stream path has to stay in this budget
+static_assert(MonoBuffers::totalBytes() < 4096, "mono haptic stream RAM budget");
+static_assert(StereoBuffers::totalBytes() < 2 * 4096, "stereo haptic stream RAM budget");
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_sizes_follow_the_latency_target(void)
+{
+    // 50 ms at 14.7 kHz
+    TEST_ASSERT_EQUAL(735, MonoBuffers::targetFill());
+    TEST_ASSERT_EQUAL(2 * 735 + 1, MonoBuffers::SLOTS);
+    TEST_ASSERT_EQUAL(1, VH::StreamBufferPlan::targetFill(1, 1));
+    TEST_ASSERT_EQUAL(15, VH::StreamBufferPlan::targetFill(1, 14700));
+    // storage, rings and pointer table, plus at most the alignment padding
+    size_t parts = 2 * StereoBuffers::SLOTS * sizeof(int16_t) + 2 * (sizeof(VH::RingBuffer<int16_t>) + sizeof(void *));
+    TEST_ASSERT_TRUE(StereoBuffers::totalBytes() >= parts);
+    TEST_ASSERT_TRUE(StereoBuffers::totalBytes() < parts + alignof(VH::RingBuffer<int16_t>) + sizeof(void *));
+}
+
+void test_rings_are_independent(void)
+{
+    StereoBuffers buffers;
+    TEST_ASSERT_EQUAL(2 * buffers.targetFill(), buffers.ring(0).capacity());
+    for (size_t i = 0; i < buffers.ring(0).capacity(); i++)
+        TEST_ASSERT_TRUE(buffers.ring(0).push((int16_t)i));
+    TEST_ASSERT_FALSE(buffers.ring(0).push(1));
+    TEST_ASSERT_TRUE(buffers.ring(1).isEmpty());
+    TEST_ASSERT_TRUE(buffers.ring(1).push(-1));
+    int16_t value;
+    TEST_ASSERT_TRUE(buffers.ring(0).pop(value));
+    TEST_ASSERT_EQUAL_INT16(0, value);
+    TEST_ASSERT_TRUE(buffers.ring(1).pop(value));
+    TEST_ASSERT_EQUAL_INT16(-1, value);
+    TEST_ASSERT_TRUE(buffers.rings()[1] == &buffers.ring(1));
+
+    buffers.reset();
+    TEST_ASSERT_TRUE(buffers.ring(0).isEmpty());
+}
+
+void test_drift_is_held_without_drops(void)
+{
+    MonoBuffers buffers;
+    VH::DriftCompensator drift(buffers.targetFill(), 2);
+    std::vector<int16_t> packet(2 * 128);
+    double consumed = 0;
+    size_t minFill = buffers.ring(0).capacity(), maxFill = 0, drops = 0;
+    int phase = 0;
+    // prefilled as AudioStreaming starts playing at the target
+    for (size_t i = 0; i < buffers.targetFill(); i++)
+        buffers.ring(0).push(0);
+    // ~2 min of audio: the correction is slow enough to stay inaudible
+    const int packets = 40000;
+    for (int p = 0; p < packets; p++)
+    {
+        // decimated by 3 into the ring, as AudioStreaming does at 44.1 kHz
+        drift.write(packet.data(), packet.size(), buffers.ring(0).size(), [&](const int16_t *s, size_t n) {
+            for (size_t k = 0; k < n; k += 2)
+            {
+                if (++phase < 3)
+                    continue;
+                phase = 0;
+                if (!buffers.ring(0).push(s[k]))
+                    drops++;
+            }
+        });
+        // the sender runs 0.1 % fast against the output timer
+        consumed += 128.0 / 3 / 1.001;
+        int16_t value;
+        for (; consumed >= 1; consumed -= 1)
+            buffers.ring(0).pop(value);
+        minFill = std::min(minFill, buffers.ring(0).size());
+        maxFill = std::max(maxFill, buffers.ring(0).size());
+    }
+    TEST_ASSERT_EQUAL(0, drops);
+    TEST_ASSERT_TRUE(minFill > buffers.targetFill() / 2);
+    TEST_ASSERT_TRUE(maxFill < buffers.ring(0).capacity() * 3 / 4);
+    TEST_ASSERT_INT_WITHIN(50, (int)buffers.targetFill(), (int)buffers.ring(0).size());
+}
+
+int main(int, char **)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_sizes_follow_the_latency_target);
+    RUN_TEST(test_rings_are_independent);
+    RUN_TEST(test_drift_is_held_without_drops);
+    return UNITY_END();
+}
@@ -0,0 +1,212 @@
+// Host test of TaskFramework on HostTaskPlatform: start, message dispatch,
+// ticks, full inboxes and stop/join, plus a platform whose tasks free
+// themselves on the way out, as they do on FreeRTOS.
+#include <unity.h>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <thread>
+#include "HostTaskPlatform.h"
+
+#define MSG_VALUE 1
+
+struct Value
+{
+    uint32_t n;
+    uint8_t pad[40];
+};
+
+class Receiver : public FirmwareTask
+{
+public:
+    std::atomic<bool> started{false};
+    std::atomic<uint32_t> sum{0}, last{0}, ticks{0};
+    std::atomic<bool> inOrder{true};
+    std::atomic<uint32_t> blockMs{0};
+
+    Receiver(uint32_t periodMs = 0, uint16_t queueLen = TASK_DEFAULT_QUEUE_LEN)
+        : FirmwareTask("receiver", 1, -1, periodMs, queueLen) {}
+
+protected:
+    void onStart() override { started = true; }
+    void onMessage(const TaskMessage &msg) override
+    {
+        if (msg.type != MSG_VALUE)
+            return;
+        Value v = msg.as<Value>();
+        if (v.n != last + 1)
+            inOrder = false;
+        last = v.n;
+        sum += v.n;
+        if (blockMs)
+            std::this_thread::sleep_for(std::chrono::milliseconds(blockMs.load()));
+    }
+    void onTick(uint32_t) override { ticks++; }
+};
+
+// forwards every value to the next task, as the sensor task does
+class Relay : public FirmwareTask
+{
+    uint8_t mNext;
+
+public:
+    explicit Relay(uint8_t next) : FirmwareTask("relay", 2), mNext(next) {}
+
+protected:
+    void onMessage(const TaskMessage &msg) override
+    {
+        framework()->post(mNext, MSG_VALUE, msg.as<Value>(), getId());
+    }
+};
+
+// a detached thread that frees itself in exit(), like an RtosTask
+class SelfDeletingTask : public ITaskManager
+{
+public:
+    static std::atomic<int> alive;
+    SelfDeletingTask() { alive++; }
+    ~SelfDeletingTask() { alive--; }
+    int createTask(TaskConfig *config) override
+    {
+        mTaskConfig.clone(config);
+        std::thread(mTaskConfig.func, mTaskConfig.param).detach();
+        return 0;
+    }
+    void deleteTask() override {}
+};
+std::atomic<int> SelfDeletingTask::alive{0};
+
+struct SelfDeletingPlatform : HostTaskPlatform
+{
+    ITaskManager *createTask(TaskConfig *config) override
+    {
+        SelfDeletingTask *task = new SelfDeletingTask();
+        task->createTask(config);
+        return task;
+    }
+    bool join(ITaskManager *) override { return false; }
+    void exit(ITaskManager *task) override { delete task; }
+};
+
+struct NoQueuePlatform : HostTaskPlatform
+{
+    IBoardQueue *createQueue(unsigned int, unsigned int) override { return nullptr; }
+};
+
+static void waitFor(const std::function<bool()> &done, int timeoutMs = 2000)
+{
+    for (int i = 0; i < timeoutMs && !done(); i++)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_start_dispatch_and_stop(void)
+{
+    HostTaskPlatform platform;
+    TaskFramework tasks(&platform);
+    Receiver receiver;
+    Relay relay(1);
+    TEST_ASSERT_EQUAL_UINT8(0, tasks.add(&relay));
+    TEST_ASSERT_EQUAL_UINT8(1, tasks.add(&receiver));
+    // posts before start() have no inbox yet
+    TEST_ASSERT_FALSE(tasks.post(0, MSG_VALUE, Value{1, {}}));
+    TEST_ASSERT_TRUE(tasks.start());
+    TEST_ASSERT_TRUE(tasks.isRunning());
+    TEST_ASSERT_EQUAL_UINT8(0xFF, tasks.add(&receiver));
+    waitFor([&] { return receiver.started.load(); });
+    TEST_ASSERT_TRUE(receiver.started);
+
+    const uint32_t n = 1000;
+    for (uint32_t i = 1; i <= n; i++)
+        while (!tasks.post(0, MSG_VALUE, Value{i, {}}))
+            std::this_thread::yield();
+    waitFor([&] { return receiver.last == n; });
+    TEST_ASSERT_EQUAL_UINT32(n, receiver.last.load());
+    TEST_ASSERT_EQUAL_UINT32(n * (n + 1) / 2, receiver.sum.load());
+    TEST_ASSERT_TRUE(receiver.inOrder);
+    TEST_ASSERT_EQUAL_UINT32(n, receiver.getHandled());
+    TEST_ASSERT_FALSE(tasks.post(7, MSG_VALUE, Value{0, {}}));
+
+    // stop() returns with every thread joined
+    tasks.stop();
+    TEST_ASSERT_FALSE(tasks.isRunning());
+    uint32_t handled = receiver.getHandled();
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    TEST_ASSERT_EQUAL_UINT32(handled, receiver.getHandled());
+
+    // and can start again on the same inboxes
+    receiver.last = 0;
+    TEST_ASSERT_TRUE(tasks.start());
+    tasks.post(1, MSG_VALUE, Value{1, {}});
+    waitFor([&] { return receiver.last == 1; });
+    TEST_ASSERT_EQUAL_UINT32(1, receiver.last.load());
+    tasks.stop();
+}
+
+void test_ticks_and_full_inbox(void)
+{
+    HostTaskPlatform platform;
+    TaskFramework tasks(&platform);
+    Receiver receiver(10, 4);
+    tasks.add(&receiver);
+    TEST_ASSERT_TRUE(tasks.start());
+    std::this_thread::sleep_for(std::chrono::milliseconds(205));
+    uint32_t ticks = receiver.ticks;
+    TEST_ASSERT_TRUE(ticks >= 15 && ticks <= 21);
+
+    // a busy task: the inbox fills, further posts are dropped and counted
+    receiver.blockMs = 50;
+    uint32_t queued = 0, dropped = 0;
+    for (uint32_t i = 1; i <= 10; i++)
+        tasks.post(0, MSG_VALUE, Value{i, {}}) ? queued++ : dropped++;
+    TEST_ASSERT_TRUE(dropped >= 5);
+    TEST_ASSERT_EQUAL_UINT32(dropped, receiver.getDropped());
+    waitFor([&] { return receiver.getHandled() == queued; });
+    TEST_ASSERT_TRUE(receiver.getMaxLatencyMs() >= 50);
+    tasks.stop();
+}
+
+// run under env:native_tsan: each task reads its handle while stop() returns
+void test_tasks_that_free_themselves(void)
+{
+    SelfDeletingPlatform platform;
+    TaskFramework tasks(&platform);
+    Receiver a, b(5);
+    tasks.add(&a);
+    tasks.add(&b);
+    for (int round = 0; round < 20; round++)
+    {
+        // a task of the last round may still be on its way out
+        waitFor([&] { return SelfDeletingTask::alive == 0; });
+        TEST_ASSERT_TRUE(tasks.start());
+        TEST_ASSERT_EQUAL(2, SelfDeletingTask::alive.load());
+        tasks.post(0, MSG_VALUE, Value{a.last + 1, {}});
+        tasks.stop();
+    }
+    // every task freed its own handle once it left its loop
+    waitFor([&] { return SelfDeletingTask::alive == 0; });
+    TEST_ASSERT_EQUAL(0, SelfDeletingTask::alive.load());
+}
+
+void test_missing_queue_fails_start(void)
+{
+    NoQueuePlatform platform;
+    TaskFramework tasks(&platform);
+    Receiver receiver;
+    tasks.add(&receiver);
+    TEST_ASSERT_FALSE(tasks.start());
+    TEST_ASSERT_FALSE(tasks.isRunning());
+    TEST_ASSERT_FALSE(receiver.started);
+}
+
+int main(int, char **)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_start_dispatch_and_stop);
+    RUN_TEST(test_ticks_and_full_inbox);
+    RUN_TEST(test_tasks_that_free_themselves);
+    RUN_TEST(test_missing_queue_fails_start);
+    return UNITY_END();
+}
@@ -0,0 +1,181 @@
+// Host test of TimerService on the simulated clock of HostBoardProfile: exact
+// rates, delays, one-shots, random add/remove and a MultiChannelOutput on a
+// virtual timer.
+#include <unity.h>
+#include <random>
+#include <vector>
+#include "HostBoardProfile.h"
+#include "MultiChannelOutput.h"
+#include "TimerService.h"
+
+struct Counter
+{
+    HostBoardProfile *board;
+    std::vector<uint64_t> times;
+};
+
+static void count(void *param)
+{
+    Counter *c = (Counter *)param;
+    c->times.push_back(c->board->getTimeMicroseconds());
+}
+
+static HostBoardProfile *board;
+static HostAlarm *alarm;
+static TimerService *timers;
+
+void setUp(void)
+{
+    board = new HostBoardProfile();
+    alarm = board->createAlarm(TS_HW_TIMER);
+    timers = new TimerService();
+    timers->begin(alarm);
+}
+
+void tearDown(void)
+{
+    delete timers;
+    delete alarm;
+    delete board;
+}
+
+void test_rates_are_exact(void)
+{
+    Counter a{board, {}}, b{board, {}}, c{board, {}};
+    timers->add(8000, count, &a);
+    timers->add(1000, count, &b);
+    int cd = timers->add(44100, count, &c);
+    board->advanceUs(1000000);
+    TEST_ASSERT_EQUAL(8000, (int)a.times.size());
+    TEST_ASSERT_EQUAL(1000, (int)b.times.size());
+    // 44.1 kHz keeps its average even though its period is not whole us
+    TEST_ASSERT_EQUAL(44100, (int)c.times.size());
+    for (size_t i = 1; i < c.times.size(); i++)
+        TEST_ASSERT_TRUE(c.times[i] > c.times[i - 1]);
+    TimerJitter j = timers->getJitter(cd);
+    TEST_ASSERT_EQUAL_UINT32(0, j.missed);
+    TEST_ASSERT_TRUE(j.maxLateUs <= TS_GROUP_US);
+    TEST_ASSERT_TRUE(j.minLateUs >= -TS_GROUP_US);
+    // timers due together share one alarm
+    TEST_ASSERT_TRUE(timers->getStats().alarms < timers->getStats().dispatches);
+}
+
+void test_alarm_latency_shows_in_the_jitter(void)
+{
+    Counter a{board, {}};
+    int id = timers->add(8000, count, &a);
+    alarm->latencyUs = 3;
+    board->advanceUs(100000);
+    TimerJitter j = timers->getJitter(id);
+    TEST_ASSERT_EQUAL_UINT32(800, j.count);
+    TEST_ASSERT_EQUAL_INT32(3, j.maxLateUs);
+    TEST_ASSERT_FLOAT_WITHIN(0.5, 3.0, j.meanLateUs());
+
+    timers->resetStats();
+    TEST_ASSERT_EQUAL_UINT32(0, timers->getJitter(id).count);
+}
+
+void test_stop_remove_and_new_rate(void)
+{
+    Counter a{board, {}}, b{board, {}}, c{board, {}};
+    int ia = timers->add(8000, count, &a);
+    int ib = timers->add(1000, count, &b);
+    int ic = timers->add(44100, count, &c);
+    board->advanceUs(10000);
+    TEST_ASSERT_TRUE(timers->stop(ic));
+    TEST_ASSERT_FALSE(timers->isRunning(ic));
+    timers->remove(ib);
+    size_t na = a.times.size(), nb = b.times.size(), nc = c.times.size();
+    board->advanceUs(10000);
+    TEST_ASSERT_EQUAL(nc, c.times.size());
+    TEST_ASSERT_EQUAL(nb, b.times.size());
+    TEST_ASSERT_EQUAL(na + 80, a.times.size());
+
+    TEST_ASSERT_TRUE(timers->setFrequency(ia, 4000));
+    na = a.times.size();
+    board->advanceUs(10000);
+    TEST_ASSERT_INT_WITHIN(1, 40, (int)(a.times.size() - na));
+
+    TEST_ASSERT_TRUE(timers->start(ic));
+    nc = c.times.size();
+    board->advanceUs(1000);
+    TEST_ASSERT_INT_WITHIN(1, 44, (int)(c.times.size() - nc));
+}
+
+void test_one_shot_runs_once_on_time(void)
+{
+    Counter o{board, {}};
+    board->advanceUs(777);
+    uint64_t t0 = board->getTimeMicroseconds();
+    int id = timers->addOneShot(1234, count, &o);
+    board->advanceUs(5000);
+    TEST_ASSERT_EQUAL(1, (int)o.times.size());
+    TEST_ASSERT_EQUAL_UINT32(t0 + 1234, o.times[0]);
+    TEST_ASSERT_FALSE(timers->isRunning(id));
+}
+
+void test_random_add_and_remove_keep_every_period(void)
+{
+    std::mt19937 rng(1);
+    std::vector<Counter> counters(TS_MAX_TIMERS, Counter{board, {}});
+    std::vector<int> ids(TS_MAX_TIMERS, -1);
+    std::vector<uint32_t> periods(TS_MAX_TIMERS);
+    for (int round = 0; round < 2000; round++)
+    {
+        int k = rng() % TS_MAX_TIMERS;
+        if (ids[k] >= 0)
+        {
+            timers->remove(ids[k]);
+            ids[k] = -1;
+        }
+        else
+        {
+            periods[k] = 1 + rng() % 5000;
+            counters[k].times.clear();
+            ids[k] = timers->addPeriodUs(periods[k], count, &counters[k]);
+            TEST_ASSERT_TRUE(ids[k] >= 0);
+        }
+        board->advanceUs(rng() % 3000);
+        for (int q = 0; q < TS_MAX_TIMERS; q++)
+        {
+            if (ids[q] < 0)
+                continue;
+            const std::vector<uint64_t> &t = counters[q].times;
+            for (size_t i = 1; i < t.size(); i++)
+                TEST_ASSERT_INT_WITHIN(TS_GROUP_US, (int)periods[q], (int)(t[i] - t[i - 1]));
+        }
+    }
+}
+
+void test_drives_a_multi_channel_output(void)
+{
+    MultiChannelOutput out(8000);
+    out.addChannel(25, [](uint8_t *s, size_t n) {
+        static uint8_t v;
+        for (size_t i = 0; i < n; i++)
+            s[i] = ++v;
+    });
+    out.addChannel(26);
+    out.setTimer(timers->createTimer(8000));
+    TEST_ASSERT_TRUE(out.begin(board) == McMode::CPU);
+    board->setRecording(false);
+    // the output task loop: service() waits with the board's delay(), which
+    // moves the simulated clock and fires the alarm
+    while (board->getTimeMicroseconds() < 1000000)
+        out.service();
+    TEST_ASSERT_EQUAL_UINT32(0, out.getStats().underruns);
+    // a write per tick for the ramp; the silent channel is not rewritten
+    TEST_ASSERT_UINT32_WITHIN(MC_BLOCK_SAMPLES, 8000, board->getPinWriteCount());
+}
+
+int main(int, char **)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_rates_are_exact);
+    RUN_TEST(test_alarm_latency_shows_in_the_jitter);
+    RUN_TEST(test_stop_remove_and_new_rate);
+    RUN_TEST(test_one_shot_runs_once_on_time);
+    RUN_TEST(test_random_add_and_remove_keep_every_period);
+    RUN_TEST(test_drives_a_multi_channel_output);
+    return UNITY_END();
+}
@@ -0,0 +1,185 @@
+// Host test of ToneHapticOutput on a simulated LEDC channel, driven the way
+// the firmware drives it: cue timing, takeover, preemption and the queue.
+#include <unity.h>
+#include <cmath>
+#include <vector>
+#include "ToneHapticOutput.h"
+
+#define LEDC_BITS 8
+
+// one LEDC channel: ledcChangeFrequency() and ledcWrite(), with the time of
+// every write
+struct Ledc
+{
+    struct Write
+    {
+        uint32_t atMs;
+        uint32_t frequency;
+        uint32_t duty;
+    };
+    uint32_t frequency = (uint32_t)TONE_CARRIER_HZ;
+    uint32_t duty = 0;
+    uint32_t nowMs = 0;
+    std::vector<Write> writes;
+
+    ToneDriveFn drive()
+    {
+        return [this](float hz, float level) {
+            if (level > 0)
+                frequency = (uint32_t)hz;
+            duty = (uint32_t)(level * (1 << (LEDC_BITS - 1)));
+            writes.push_back({nowMs, frequency, duty});
+        };
+    }
+};
+
+static HapticCue cue(HapticCueType type, uint32_t startMs, uint16_t durationMs, float intensity, float frequency = 0)
+{
+    HapticCue c;
+    c.type = type;
+    c.startMs = startMs;
+    c.durationMs = durationMs;
+    c.intensity = intensity;
+    c.frequency = frequency;
+    return c;
+}
+
+// render() every millisecond, as the haptic task's tick does
+static void play(ToneHapticOutput &out, Ledc &ledc, uint32_t fromMs, uint32_t toMs)
+{
+    for (ledc.nowMs = fromMs; ledc.nowMs < toMs; ledc.nowMs++)
+        out.render(ledc.nowMs);
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_cues_start_and_stop_on_time(void)
+{
+    Ledc ledc;
+    ToneHapticOutput out(ledc.drive());
+    const HapticCue cues[] = {
+        cue(HapticCueType::PULSE, 100, 40, 1.0f),
+        cue(HapticCueType::VIBRATE, 300, 50, 0.5f, 90),
+    };
+    // handed over well ahead, as within the mapper's lookahead
+    TEST_ASSERT_EQUAL(2, (int)out.submit(cues, 2, 0));
+    play(out, ledc, 0, 500);
+    TEST_ASSERT_EQUAL(4, (int)ledc.writes.size());
+    TEST_ASSERT_EQUAL_UINT32(100, ledc.writes[0].atMs);
+    TEST_ASSERT_EQUAL_UINT32((uint32_t)TONE_CARRIER_HZ, ledc.writes[0].frequency);
+    TEST_ASSERT_EQUAL_UINT32(128, ledc.writes[0].duty);
+    TEST_ASSERT_EQUAL_UINT32(140, ledc.writes[1].atMs);
+    TEST_ASSERT_EQUAL_UINT32(0, ledc.writes[1].duty);
+    TEST_ASSERT_EQUAL_UINT32(300, ledc.writes[2].atMs);
+    TEST_ASSERT_EQUAL_UINT32(90, ledc.writes[2].frequency);
+    TEST_ASSERT_EQUAL_UINT32(64, ledc.writes[2].duty);
+    TEST_ASSERT_EQUAL_UINT32(350, ledc.writes[3].atMs);
+    TEST_ASSERT_EQUAL_UINT32(0, ledc.writes[3].duty);
+    TEST_ASSERT_FALSE(out.isPlaying());
+    TEST_ASSERT_EQUAL(0, (int)out.getQueued());
+}
+
+void test_later_cue_takes_over(void)
+{
+    Ledc ledc;
+    ToneHapticOutput out(ledc.drive());
+    const HapticCue cues[] = {
+        cue(HapticCueType::VIBRATE, 10, 100, 1.0f, 80),
+        cue(HapticCueType::PULSE, 50, 20, 0.5f),
+    };
+    out.submit(cues, 2, 0);
+    play(out, ledc, 0, 200);
+    // the pulse cuts the vibration short and nothing of it comes back
+    TEST_ASSERT_EQUAL(3, (int)ledc.writes.size());
+    TEST_ASSERT_EQUAL_UINT32(10, ledc.writes[0].atMs);
+    TEST_ASSERT_EQUAL_UINT32(80, ledc.writes[0].frequency);
+    TEST_ASSERT_EQUAL_UINT32(50, ledc.writes[1].atMs);
+    TEST_ASSERT_EQUAL_UINT32((uint32_t)TONE_CARRIER_HZ, ledc.writes[1].frequency);
+    TEST_ASSERT_EQUAL_UINT32(64, ledc.writes[1].duty);
+    TEST_ASSERT_EQUAL_UINT32(70, ledc.writes[2].atMs);
+    TEST_ASSERT_EQUAL_UINT32(0, ledc.writes[2].duty);
+}
+
+void test_alert_preempts_queued_beats(void)
+{
+    Ledc ledc;
+    ToneHapticOutput out(ledc.drive());
+    HapticCue beats[4];
+    for (int i = 0; i < 4; i++)
+        beats[i] = cue(HapticCueType::PULSE, 100 + 150 * i, 40, 0.6f);
+    out.submit(beats, 4, 0);
+    play(out, ledc, 0, 120);
+    TEST_ASSERT_TRUE(out.isPlaying());
+
+    HapticCue alert;
+    alert.type = HapticCueType::SWEEP;
+    alert.preempt = true;
+    alert.startMs = 120;
+    alert.durationMs = 200;
+    alert.intensity = 1.0f;
+    alert.endIntensity = 0.2f;
+    alert.frequency = 250;
+    alert.endFrequency = 80;
+    TEST_ASSERT_EQUAL(1, (int)out.submit(&alert, 1, 120));
+    TEST_ASSERT_EQUAL(1, (int)out.getQueued());
+    size_t before = ledc.writes.size();
+    play(out, ledc, 120, 800);
+
+    // the sweep starts at once, in place of the beat that was playing
+    TEST_ASSERT_EQUAL_UINT32(120, ledc.writes[before].atMs);
+    TEST_ASSERT_EQUAL_UINT32(250, ledc.writes[before].frequency);
+    TEST_ASSERT_EQUAL_UINT32(128, ledc.writes[before].duty);
+    float lastHz = 251;
+    for (size_t i = before; i + 1 < ledc.writes.size(); i++)
+    {
+        const Ledc::Write &w = ledc.writes[i];
+        float t = (w.atMs - 120) / 200.0f;
+        float level = 1.0f - 0.8f * (1 - (1 - t) * (1 - t));
+        TEST_ASSERT_UINT32_WITHIN(1, (uint32_t)(250 - 170 * t), w.frequency);
+        TEST_ASSERT_UINT32_WITHIN(1, (uint32_t)(level * 128), w.duty);
+        TEST_ASSERT_TRUE(w.frequency <= lastHz);
+        lastHz = w.frequency;
+    }
+    // it ends on time and none of the dropped beats plays after it
+    TEST_ASSERT_EQUAL_UINT32(320, ledc.writes.back().atMs);
+    TEST_ASSERT_EQUAL_UINT32(0, ledc.writes.back().duty);
+    TEST_ASSERT_EQUAL(0, (int)out.getQueued());
+}
+
+void test_late_and_overflowing_cues(void)
+{
+    Ledc ledc;
+    ToneHapticOutput out(ledc.drive());
+    // already over when it arrives
+    HapticCue late = cue(HapticCueType::PULSE, 100, 40, 1.0f);
+    TEST_ASSERT_EQUAL(0, (int)out.submit(&late, 1, 140));
+    // started but not over: plays the rest
+    TEST_ASSERT_EQUAL(1, (int)out.submit(&late, 1, 130));
+    play(out, ledc, 130, 200);
+    TEST_ASSERT_EQUAL(2, (int)ledc.writes.size());
+    TEST_ASSERT_EQUAL_UINT32(130, ledc.writes[0].atMs);
+    TEST_ASSERT_EQUAL_UINT32(140, ledc.writes[1].atMs);
+
+    HapticCue many[TONE_MAX_CUES + 3];
+    for (int i = 0; i < TONE_MAX_CUES + 3; i++)
+        many[i] = cue(HapticCueType::TICK, 300 + 10 * i, 5, 1.0f);
+    TEST_ASSERT_EQUAL(TONE_MAX_CUES, (int)out.submit(many, TONE_MAX_CUES + 3, 200));
+    TEST_ASSERT_EQUAL_UINT32(3, out.getDropped());
+    play(out, ledc, 200, 302);
+    TEST_ASSERT_TRUE(out.isPlaying());
+    out.clear();
+    TEST_ASSERT_FALSE(out.isPlaying());
+    TEST_ASSERT_EQUAL(0, (int)out.getQueued());
+    TEST_ASSERT_EQUAL_UINT32(0, ledc.duty);
+}
+
+int main(int, char **)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_cues_start_and_stop_on_time);
+    RUN_TEST(test_later_cue_takes_over);
+    RUN_TEST(test_alert_preempts_queued_beats);
+    RUN_TEST(test_late_and_overflowing_cues);
+    return UNITY_END();
+}